@@ -188,18 +188,26 @@ void bgp_adj_in_set(struct bgp_dest *dest, struct peer *peer, struct attr *attr,
 	adj->uptime = monotime(NULL);
 	adj->addpath_rx_id = addpath_id;
 	adj->labels = bgp_labels_intern(labels);
-	BGP_ADJ_IN_ADD(dest, adj);
+	adj->next = dest->adj_in;
+	dest->adj_in = adj;
 	peer->stat_pfx_adj_rib_in++;
 	bgp_dest_lock_node(dest);
 }
 
 void bgp_adj_in_remove(struct bgp_dest **dest, struct bgp_adj_in *bai)
 {
+	struct bgp_adj_in **prev;
+
 	bgp_attr_unintern(&bai->attr);
 	bgp_labels_unintern(&bai->labels);
 	if (bai->peer)
 		bai->peer->stat_pfx_adj_rib_in--;
-	BGP_ADJ_IN_DEL(*dest, bai);
+
+	for (prev = &(*dest)->adj_in; *prev; prev = &(*prev)->next)
+		if (*prev == bai) {
+			*prev = bai->next;
+			break;
+		}
 	*dest = bgp_dest_unlock_node(*dest);
 	peer_unlock(bai->peer); /* adj_in peer reference */
 	XFREE(MTYPE_BGP_ADJ_IN, bai);
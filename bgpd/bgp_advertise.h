@@ -85,21 +85,25 @@ RB_PROTOTYPE(bgp_adj_out_rb, bgp_adj_out, adj_entry,
 
 /* BGP adjacency in. */
 struct bgp_adj_in {
-	/* Linked list pointer.  */
+	/* Linked list pointer, singly linked since there is one of these per
+	 * soft-reconfiguration peer for every prefix it sent and the lists
+	 * are short.
+	 */
 	struct bgp_adj_in *next;
-	struct bgp_adj_in *prev;
 
 	/* Received peer.  */
 	struct peer *peer;
 
-	/* Received attribute.  */
+	/* Received attribute.  Interned, so when inbound policy leaves it
+	 * alone this is the same attr as the bgp_path_info's.
+	 */
 	struct attr *attr;
 
 	/* VPN label information */
 	struct bgp_labels *labels;
 
-	/* timestamp (monotime) */
-	time_t uptime;
+	/* timestamp (monotime), seconds since boot fit in 32 bits */
+	uint32_t uptime;
 
 	/* Addpath identifier */
 	uint32_t addpath_rx_id;
@@ -111,29 +115,6 @@ struct bgp_synchronize {
 	struct bgp_adv_fifo_head withdraw;
 };
 
-/* BGP adjacency linked list.  */
-#define BGP_PATH_INFO_ADD(N, A, TYPE)                                          \
-	do {                                                                   \
-		(A)->prev = NULL;                                              \
-		(A)->next = (N)->TYPE;                                         \
-		if ((N)->TYPE)                                                 \
-			(N)->TYPE->prev = (A);                                 \
-		(N)->TYPE = (A);                                               \
-	} while (0)
-
-#define BGP_PATH_INFO_DEL(N, A, TYPE)                                          \
-	do {                                                                   \
-		if ((A)->next)                                                 \
-			(A)->next->prev = (A)->prev;                           \
-		if ((A)->prev)                                                 \
-			(A)->prev->next = (A)->next;                           \
-		else                                                           \
-			(N)->TYPE = (A)->next;                                 \
-	} while (0)
-
-#define BGP_ADJ_IN_ADD(N, A) BGP_PATH_INFO_ADD(N, A, adj_in)
-#define BGP_ADJ_IN_DEL(N, A) BGP_PATH_INFO_DEL(N, A, adj_in)
-
 /* Prototypes.  */
 extern bool bgp_adj_out_lookup(struct peer *peer, struct bgp_dest *dest,
 			       uint32_t addpath_tx_id);
@@ -693,6 +693,10 @@ struct aspath *aspath_intern(struct aspath *aspath)
 	find = hash_get(ashash, aspath, hash_alloc_intern);
 	if (find != aspath)
 		aspath_free(aspath);
+	else {
+		memset(find->filter_version, 0, sizeof(find->filter_version));
+		memset(find->filter_type, 0, sizeof(find->filter_type));
+	}
 
 	find->refcnt++;
 
@@ -737,11 +741,12 @@ static void *aspath_hash_alloc(void *arg)
 	/* Malformed AS path value. */
 	assert(aspath->str);
 
-	/* New aspath structure is needed. */
-	new = XMALLOC(MTYPE_AS_PATH, sizeof(struct aspath));
+	/* New aspath structure is needed.  Zeroed so that the filter-list
+	 * cache starts out empty.
+	 */
+	new = XCALLOC(MTYPE_AS_PATH, sizeof(struct aspath));
 
 	/* Reuse segments and string representation */
-	new->refcnt = 0;
 	new->segments = aspath->segments;
 	new->str = aspath->str;
 	new->str_len = aspath->str_len;
@@ -896,6 +901,35 @@ struct aspath *aspath_parse(struct stream *s, size_t length, int use32bit,
 	return find;
 }
 
+/* Same as aspath_parse(), but the AS path is returned without being
+   interned, with its string representation built.  Nothing shared is
+   touched, so the UPDATE parser pthreads can do the expensive part of
+   AS path parsing and leave only aspath_intern() to the main pthread.
+
+   On error NULL is returned.
+ */
+struct aspath *aspath_parse_prepare(struct stream *s, size_t length,
+				    int use32bit,
+				    enum asnotation_mode asnotation)
+{
+	struct aspath *as;
+
+	if (length % AS16_VALUE_SIZE)
+		return NULL;
+
+	as = XCALLOC(MTYPE_AS_PATH, sizeof(struct aspath));
+	as->asnotation = asnotation;
+	if (assegments_parse(s, length, &as->segments, use32bit) < 0) {
+		XFREE(MTYPE_AS_PATH, as);
+		return NULL;
+	}
+
+	as->count = aspath_count_hops_internal(as);
+	aspath_str_update(as, false);
+
+	return as;
+}
+
 /* Add specified AS to the rightmost of aspath. */
 static struct aspath *aspath_add_asns_rightmost(struct aspath *aspath, as_t asno, uint8_t type,
 						unsigned int num)
@@ -63,6 +63,13 @@ struct aspath {
 
 	/* AS notation used by string expression of AS path */
 	enum asnotation_mode asnotation;
+
+	/* Last as_list_apply() results, by as_list version, most recent
+	 * first.  Only kept while interned.
+	 */
+#define ASPATH_FILTER_CACHE 2
+	uint32_t filter_version[ASPATH_FILTER_CACHE];
+	uint8_t filter_type[ASPATH_FILTER_CACHE];
 };
 
 #define ASPATH_STR_DEFAULT_LEN 32
@@ -84,6 +91,9 @@ extern void aspath_finish(void);
 extern struct aspath *aspath_parse(struct stream *s, size_t length,
 				   int use32bit,
 				   enum asnotation_mode asnotation);
+extern struct aspath *aspath_parse_prepare(struct stream *s, size_t length,
+					   int use32bit,
+					   enum asnotation_mode asnotation);
 
 extern struct aspath *aspath_dup(struct aspath *aspath);
 extern struct aspath *aspath_aggregate(struct aspath *as1, struct aspath *as2);
@@ -29,6 +29,7 @@
 #include "bgpd/bgp_errors.h"
 #include "bgpd/bgp_label.h"
 #include "bgpd/bgp_packet.h"
+#include "bgpd/bgp_parse.h"
 #include "bgpd/bgp_ecommunity.h"
 #include "bgpd/bgp_lcommunity.h"
 #include "bgpd/bgp_updgrp.h"
@@ -51,6 +52,9 @@
 #include "bgpd/bgp_route.h"
 #include "bgpd/bgp_unreach.h"
 
+DEFINE_MTYPE_SLAB(BGPD, ATTR, "BGP attribute", sizeof(struct attr),
+		  MEMSLAB_MAGAZINE);
+
 /* Attribute strings for logging. */
 static const struct message attr_str[] = {
 	{BGP_ATTR_ORIGIN, "ORIGIN"},
@@ -2152,16 +2156,27 @@ static int bgp_attr_aspath(struct bgp_attr_parser_args *args)
 	struct peer *const peer = connection->peer;
 	const bgp_size_t length = args->length;
 	enum asnotation_mode asnotation;
+	struct aspath *prepared;
+	bool use32bit;
 
 	asnotation = bgp_get_asnotation(peer->bgp);
 	/*
 	 * peer with AS4 => will get 4Byte ASnums
 	 * otherwise, will get 16 Bit
 	 */
-	attr->aspath = aspath_parse(connection->curr, length,
-				    CHECK_FLAG(peer->cap, PEER_CAP_AS4_RCV) &&
-					    CHECK_FLAG(peer->cap, PEER_CAP_AS4_ADV),
-				    asnotation);
+	use32bit = CHECK_FLAG(peer->cap, PEER_CAP_AS4_RCV) &&
+		   CHECK_FLAG(peer->cap, PEER_CAP_AS4_ADV);
+
+	/* Already parsed by the UPDATE parser pthread? */
+	prepared = bgp_parsed_aspath_take(connection,
+					  stream_pnt(connection->curr), length,
+					  use32bit, asnotation);
+	if (prepared) {
+		attr->aspath = aspath_intern(prepared);
+		stream_forward_getp(connection->curr, length);
+	} else
+		attr->aspath = aspath_parse(connection->curr, length, use32bit,
+					    asnotation);
 
 	/* In case of IBGP, length will be zero. */
 	if (!attr->aspath) {
@@ -5545,7 +5560,9 @@ static void bgp_packet_ecommunity_attribute(struct stream *s, struct peer *peer,
 	stream_put(s, ecomm->val, ecomm->size * ecomm->unit_size);
 }
 
-/* Make attribute packet. */
+/* Make attribute packet.  Also runs on the update format pthreads, so
+ * peer->sort is read as refreshed by peer_sort() on the main pthread.
+ */
 bgp_size_t bgp_packet_attribute(struct bgp *bgp, struct peer *peer, struct stream *s,
 				struct attr *attr, struct bpacket_attr_vec_arr *vecarr,
 				struct prefix *p, afi_t afi, safi_t safi, struct peer *from,
@@ -5589,8 +5606,6 @@ bgp_size_t bgp_packet_attribute(struct bgp *bgp, struct peer *peer, struct strea
 		bgp_packet_mpattr_end(s, mpattrlen_pos);
 	}
 
-	(void)peer_sort(peer);
-
 	/* Origin attribute. */
 	stream_putc(s, BGP_ATTR_FLAG_TRANS);
 	stream_putc(s, BGP_ATTR_ORIGIN);
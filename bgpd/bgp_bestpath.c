@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/* BGP best path pthread pool.
+ * Sorts the paths of queued route nodes in parallel so that the main
+ * pthread only has to finish best path selection and act on the result.
+ *
+ * When the pool is enabled, meta_queue_process() takes a batch of nodes
+ * off a route subqueue and hands them out here in shards, one per pthread.
+ * Each pthread runs the comparison heavy part of bgp_best_selection() -
+ * deterministic-med and sorting the changed paths into place - which only
+ * touches the node and its own paths.  Nodes needing anything more, such
+ * as reaping removed paths, are left to the main pthread.
+ *
+ * Once all shards are done the main pthread processes the batch in queue
+ * order: multipath, addpath, label and zebra updates and the update-group
+ * announcements all stay single threaded.
+ */
+
+#include <zebra.h>
+
+#include "frr_workers.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_bestpath.h"
+
+static struct frr_workers bgp_bestpath_workers =
+	FRR_WORKERS_INIT("BGP best path thread", "bgpd_best");
+
+void bgp_bestpath_threads_set(unsigned int count)
+{
+	count = MIN(count, BGP_BESTPATH_THREADS_MAX);
+	bm->bestpath_threads = count;
+
+	frr_workers_start(&bgp_bestpath_workers, count);
+}
+
+static void bgp_bestpath_work(void *item)
+{
+	struct bgp_bestpath_job *job = item;
+
+	if (job->presort)
+		bgp_best_selection_presort(job);
+}
+
+void bgp_bestpath_run(struct bgp_bestpath_job *jobs, unsigned int count)
+{
+	frr_workers_run(&bgp_bestpath_workers, bm->bestpath_threads, jobs,
+			sizeof(*jobs), count, bgp_bestpath_work);
+}
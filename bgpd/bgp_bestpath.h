@@ -0,0 +1,36 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/* BGP best path pthread pool.
+ * Sorts the paths of queued route nodes in parallel so that the main
+ * pthread only has to finish best path selection and act on the result.
+ */
+
+#ifndef _FRR_BGP_BESTPATH_H
+#define _FRR_BGP_BESTPATH_H
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_route.h"
+
+/* Upper bound for "bgp bestpath-threads" */
+#define BGP_BESTPATH_THREADS_MAX 64U
+
+/* Nodes taken off a meta queue subqueue at a time */
+#define BGP_BESTPATH_BATCH 256U
+
+/*
+ * Set the number of best path pthreads.  Missing pthreads are started.
+ * 0 disables the pool and the meta queue is processed one node at a time
+ * on the main pthread only.
+ */
+extern void bgp_bestpath_threads_set(unsigned int count);
+
+/*
+ * Run bgp_best_selection_presort() for every job marked presort, split
+ * into contiguous shards over the pool, and wait for all of them.
+ *
+ * The main pthread is blocked for the duration, so the workers only race
+ * each other; each dest belongs to exactly one job.
+ */
+extern void bgp_bestpath_run(struct bgp_bestpath_job *jobs,
+			     unsigned int count);
+
+#endif /* _FRR_BGP_BESTPATH_H */
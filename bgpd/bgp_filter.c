@@ -74,6 +74,16 @@ static struct as_list_master as_list_master = {{NULL, NULL},
 					       NULL,
 					       NULL};
 
+static uint32_t as_list_version;
+
+static void as_list_version_bump(struct as_list *aslist)
+{
+	/* 0 is never cached */
+	if (++as_list_version == 0)
+		as_list_version++;
+	aslist->version = as_list_version;
+}
+
 /* Allocate new AS filter. */
 static struct as_filter *as_filter_new(void)
 {
@@ -85,6 +95,8 @@ static void as_filter_free(struct as_filter *asfilter)
 {
 	if (asfilter->reg)
 		bgp_regex_free(asfilter->reg);
+	if (asfilter->asre)
+		bgp_asregex_free(asfilter->asre);
 	XFREE(MTYPE_AS_FILTER_STR, asfilter->reg_str);
 	XFREE(MTYPE_AS_FILTER, asfilter);
 }
@@ -97,6 +109,7 @@ static struct as_filter *as_filter_make(struct frregex *reg, const char *reg_str
 
 	asfilter = as_filter_new();
 	asfilter->reg = reg;
+	asfilter->asre = bgp_asregex_compile(reg_str);
 	asfilter->type = type;
 	asfilter->reg_str = XSTRDUP(MTYPE_AS_FILTER_STR, reg_str);
 
@@ -180,6 +193,8 @@ static void as_list_filter_add(struct as_list *aslist,
 	}
 
 hook:
+	as_list_version_bump(aslist);
+
 	/* Run hook function. */
 	if (as_list_master.add_hook)
 		(*as_list_master.add_hook)(aslist->name);
@@ -334,6 +349,7 @@ static void as_list_filter_delete(struct as_list *aslist,
 		aslist->head = asfilter->next;
 
 	as_filter_free(asfilter);
+	as_list_version_bump(aslist);
 
 	/* If access_list becomes empty delete it from access_master. */
 	if (as_list_empty(aslist))
@@ -347,25 +363,61 @@ static void as_list_filter_delete(struct as_list *aslist,
 
 static bool as_filter_match(struct as_filter *asfilter, struct aspath *aspath)
 {
+	int ret;
+
+	if (asfilter->asre) {
+		ret = bgp_asregex_exec(asfilter->asre, aspath);
+		if (ret >= 0)
+			return ret;
+	}
+
 	return bgp_regexec(asfilter->reg, aspath) != REG_NOMATCH;
 }
 
+static enum as_filter_type as_list_apply_filters(struct as_list *aslist,
+						 struct aspath *aspath)
+{
+	struct as_filter *asfilter;
+
+	for (asfilter = aslist->head; asfilter; asfilter = asfilter->next) {
+		if (as_filter_match(asfilter, aspath))
+			return asfilter->type;
+	}
+	return AS_FILTER_DENY;
+}
+
 /* Apply AS path filter to AS. */
 enum as_filter_type as_list_apply(struct as_list *aslist, void *object)
 {
-	struct as_filter *asfilter;
+	enum as_filter_type type;
 	struct aspath *aspath;
+	int i;
 
 	aspath = (struct aspath *)object;
 
 	if (aslist == NULL)
 		return AS_FILTER_DENY;
 
-	for (asfilter = aslist->head; asfilter; asfilter = asfilter->next) {
-		if (as_filter_match(asfilter, aspath))
-			return asfilter->type;
+	/* Only interned aspaths are shared by enough routes to be worth
+	 * remembering the result on.
+	 */
+	if (!aspath->refcnt || !aslist->version)
+		return as_list_apply_filters(aslist, aspath);
+
+	for (i = 0; i < ASPATH_FILTER_CACHE; i++)
+		if (aspath->filter_version[i] == aslist->version)
+			return aspath->filter_type[i];
+
+	type = as_list_apply_filters(aslist, aspath);
+
+	for (i = ASPATH_FILTER_CACHE - 1; i > 0; i--) {
+		aspath->filter_version[i] = aspath->filter_version[i - 1];
+		aspath->filter_type[i] = aspath->filter_type[i - 1];
 	}
-	return AS_FILTER_DENY;
+	aspath->filter_version[0] = aslist->version;
+	aspath->filter_type[0] = type;
+
+	return type;
 }
 
 /* Add hook function. */
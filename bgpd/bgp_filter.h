@@ -22,6 +22,7 @@ struct as_filter {
 	enum as_filter_type type;
 
 	struct frregex *reg;
+	struct bgp_asregex *asre;
 	char *reg_str;
 
 	/* Sequence number. */
@@ -39,6 +40,11 @@ struct as_list {
 	struct as_filter *head;
 	struct as_filter *tail;
 
+	/* Changes whenever a filter is added or removed, as_list_apply()
+	 * results cached on interned aspaths are keyed by it.
+	 */
+	uint32_t version;
+
 	/* Changes in AS path */
 	struct as_list_list_head exclude_rule;
 };
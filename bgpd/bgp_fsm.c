@@ -40,6 +40,7 @@
 #include "bgpd/bgp_memory.h"
 #include "bgpd/bgp_keepalives.h"
 #include "bgpd/bgp_io.h"
+#include "bgpd/bgp_parse.h"
 #include "bgpd/bgp_zebra.h"
 #include "bgpd/bgp_vty.h"
 #include "bgpd/bgp_trace.h"
@@ -578,7 +579,7 @@ static void bgp_holdtime_timer(struct event *event)
 	 * reason or another.
 	 */
 	frr_with_mutex (&connection->io_mtx) {
-		inq_count = atomic_load_explicit(&connection->ibuf->count, memory_order_relaxed);
+		inq_count = bgp_connection_inq_count(connection);
 	}
 	if (inq_count) {
 		BGP_TIMER_ON(connection->t_holdtime, bgp_holdtime_timer,
@@ -9,6 +9,9 @@
 #include <zebra.h>
 #include <pthread.h>		// for pthread_mutex_unlock, pthread_mutex_lock
 #include <sys/uio.h>		// for writev
+#ifdef HAVE_LIBURING
+#include <liburing.h>		// for io_uring_prep_writev, io_uring_submit_...
+#endif
 
 #include "frr_pthread.h"
 #include "linklist.h"		// for list_delete, list_delete_all_node, lis...
@@ -24,11 +27,30 @@
 #include "bgpd/bgp_errors.h"	// for expanded error reference information
 #include "bgpd/bgp_fsm.h"	// for BGP_EVENT_ADD, bgp_event
 #include "bgpd/bgp_packet.h"	// for bgp_notify_io_invalid...
+#include "bgpd/bgp_parse.h"	// for bgp_parse_schedule, bgp_connection_inq_count
 #include "bgpd/bgp_trace.h"	// for frrtraces
 #include "bgpd/bgpd.h"		// for peer, BGP_MARKER_SIZE, bgp_master, bm
 /* clang-format on */
 
+/* Packets of one connection handed to writev() in one go */
+struct bgp_io_write {
+	struct peer_connection *connection;
+
+	struct stream *streams[BGP_WRITE_PACKET_MAX];
+	struct iovec iov[BGP_WRITE_PACKET_MAX];
+	unsigned int count;
+	int writenum;
+
+	/* io_uring state: handed to the kernel, and its completion seen */
+	bool submitted;
+	bool completed;
+};
+
 /* forward declarations */
+static unsigned int bgp_write_prepare(struct peer_connection *connection,
+				      struct bgp_io_write *w);
+static uint16_t bgp_write_complete(struct peer_connection *connection,
+				   struct bgp_io_write *w, int num);
 static uint16_t bgp_write(struct peer_connection *connection);
 static uint16_t bgp_read(struct peer_connection *connection, int *code_p);
 static void bgp_process_writes(struct event *event);
@@ -39,6 +61,34 @@ static bool validate_header(struct peer_connection *connection);
 #define BGP_IO_TRANS_ERR (1 << 0) /* EAGAIN or similar occurred */
 #define BGP_IO_FATAL_ERR (1 << 1) /* some kind of fatal TCP error */
 
+/*
+ * Connections that became writable are not written to right away, but
+ * collected and written together by bgp_io_flush() once the I/O pthread
+ * has gone through all ready file descriptors.  With io_uring, that is a
+ * single submission for all of them.
+ */
+DECLARE_DLIST(bgp_io_writes, struct peer_connection, io_writes);
+
+static pthread_mutex_t bgp_io_writes_mtx = PTHREAD_MUTEX_INITIALIZER;
+static struct bgp_io_writes_head bgp_io_writes_list[1] = {
+	INIT_DLIST(bgp_io_writes_list[0]),
+};
+static struct event *t_bgp_io_flush;
+
+/* Connections written per bgp_io_flush() round */
+#define BGP_IO_WRITE_BATCH 64U
+
+static struct bgp_io_write bgp_io_write_batch[BGP_IO_WRITE_BATCH];
+
+#ifdef HAVE_LIBURING
+static struct io_uring bgp_io_ring;
+static enum {
+	BGP_IO_RING_UNSET,
+	BGP_IO_RING_OK,
+	BGP_IO_RING_FAILED,
+} bgp_io_ring_state;
+#endif
+
 /* Thread external API ----------------------------------------------------- */
 
 void bgp_writes_on(struct peer_connection *connection)
@@ -70,6 +120,17 @@ void bgp_writes_off(struct peer_connection *connection)
 
 	UNSET_FLAG(peer->connection->thread_flags, PEER_THREAD_WRITES_ON);
 
+	/* Stop bgp_process_writes() first, so it cannot put the connection
+	 * back on the write batch once it has been taken off.
+	 */
+	event_cancel_async(fpt->master, &connection->t_write, NULL);
+
+	/* Waits for a bgp_io_flush() in progress to be done with it */
+	frr_with_mutex (&bgp_io_writes_mtx) {
+		if (bgp_io_writes_anywhere(connection))
+			bgp_io_writes_del(bgp_io_writes_list, connection);
+	}
+
 	/* Clear out the write fifo */
 	frr_with_mutex (&connection->io_mtx) {
 		if (connection->obuf != NULL) {
@@ -78,7 +139,6 @@ void bgp_writes_off(struct peer_connection *connection)
 		}
 	}
 
-	event_cancel_async(fpt->master, &connection->t_write, NULL);
 	event_cancel(&connection->t_generate_updgrp_packets);
 }
 
@@ -95,6 +155,8 @@ void bgp_reads_on(struct peer_connection *connection)
 	assert(!connection->t_connect_check_w);
 	assert(connection->fd);
 
+	bgp_parse_connection_bind(connection);
+
 	event_add_read(fpt->master, bgp_process_reads, connection,
 		       connection->fd, &connection->t_read);
 
@@ -107,6 +169,7 @@ void bgp_reads_off(struct peer_connection *connection)
 	assert(fpt->running);
 
 	event_cancel_async(fpt->master, &connection->t_read, NULL);
+	bgp_parse_connection_unbind(connection);
 
 	frr_with_mutex (&bm->peer_connection_mtx) {
 		if (peer_connection_fifo_member(&bm->connection_fifo, connection))
@@ -119,28 +182,15 @@ void bgp_reads_off(struct peer_connection *connection)
 /* Thread internal functions ----------------------------------------------- */
 
 /*
- * Called from I/O pthread when a file descriptor has become ready for writing.
+ * Act on the outcome of writing out part of a connection's output buffer.
  */
-static void bgp_process_writes(struct event *event)
+static void bgp_write_done(struct peer_connection *connection, uint16_t status)
 {
-	static struct peer *peer;
-	struct peer_connection *connection = EVENT_ARG(event);
-	uint16_t status;
-	bool reschedule = false;
+	struct peer *peer = connection->peer;
+	bool reschedule;
 	bool fatal = false;
-	struct frr_pthread *fpt = bgp_pth_io;
-
-	peer = connection->peer;
-
-	if (connection->fd < 0)
-		return;
-
-	/* Anticipate rescheduling */
-	event_add_write(fpt->master, bgp_process_writes, connection, connection->fd,
-			&connection->t_write);
 
 	frr_with_mutex (&connection->io_mtx) {
-		status = bgp_write(connection);
 		reschedule = (stream_fifo_head(connection->obuf) != NULL);
 	}
 
@@ -168,6 +218,203 @@ static void bgp_process_writes(struct event *event)
 	}
 }
 
+#ifdef HAVE_LIBURING
+static bool bgp_io_ring_usable(void)
+{
+	int ret;
+
+	if (bgp_io_ring_state == BGP_IO_RING_UNSET) {
+		ret = io_uring_queue_init(BGP_IO_WRITE_BATCH, &bgp_io_ring, 0);
+		if (ret < 0) {
+			flog_warn(EC_BGP_UPDATE_SND,
+				  "%s: io_uring unavailable, writing with writev(): %s",
+				  __func__, safe_strerror(-ret));
+			bgp_io_ring_state = BGP_IO_RING_FAILED;
+		} else
+			bgp_io_ring_state = BGP_IO_RING_OK;
+	}
+
+	return bgp_io_ring_state == BGP_IO_RING_OK;
+}
+
+static void bgp_io_ring_fail(const char *func, const char *what, int err)
+{
+	flog_warn(EC_BGP_UPDATE_SND, "%s: io_uring %s failed, writing with writev(): %s",
+		  func, what, safe_strerror(err));
+	io_uring_queue_exit(&bgp_io_ring);
+	bgp_io_ring_state = BGP_IO_RING_FAILED;
+}
+
+/*
+ * Write out batched connections with one io_uring submission per
+ * BGP_IO_WRITE_BATCH of them.  Each connection stays locked until its
+ * write is done.
+ *
+ * Writes that never reached the kernel fall back to writev().  Writes
+ * that did but whose completion could not be collected are unknown to
+ * have been sent or not, so they fail the connection rather than risk
+ * sending the same bytes twice.
+ */
+static void bgp_io_flush_ring(void)
+{
+	struct bgp_io_write *batch = bgp_io_write_batch;
+	struct peer_connection *connection;
+	struct io_uring_sqe *sqe;
+	struct io_uring_cqe *cqe;
+	struct bgp_io_write *w;
+	int results[BGP_IO_WRITE_BATCH];
+	unsigned int i, count, queued, inflight;
+	uint16_t status;
+	int ret, taken, err;
+
+	while (bgp_io_ring_state == BGP_IO_RING_OK &&
+	       bgp_io_writes_count(bgp_io_writes_list)) {
+		count = queued = 0;
+
+		while (count < BGP_IO_WRITE_BATCH &&
+		       (connection = bgp_io_writes_pop(bgp_io_writes_list))) {
+			if (connection->fd < 0)
+				continue;
+
+			w = &batch[count];
+			pthread_mutex_lock(&connection->io_mtx);
+			if (!bgp_write_prepare(connection, w)) {
+				pthread_mutex_unlock(&connection->io_mtx);
+				bgp_write_done(connection, 0);
+				continue;
+			}
+
+			w->submitted = w->completed = false;
+			sqe = io_uring_get_sqe(&bgp_io_ring);
+			if (sqe) {
+				io_uring_prep_writev(sqe, connection->fd, w->iov,
+						     w->count, 0);
+				io_uring_sqe_set_data(sqe, w);
+				w->submitted = true;
+				queued++;
+			}
+			count++;
+		}
+
+		taken = io_uring_submit_and_wait(&bgp_io_ring, queued);
+		err = EAGAIN;
+		if (taken < 0) {
+			err = -taken;
+			taken = 0;
+		}
+
+		/* The kernel takes queued entries in order; any it did not
+		 * take were never sent.
+		 */
+		inflight = 0;
+		for (i = 0; i < count; i++) {
+			if (!batch[i].submitted)
+				continue;
+			if (inflight < (unsigned int)taken)
+				inflight++;
+			else
+				batch[i].submitted = false;
+		}
+
+		/* Collect every completion before looking at the results */
+		ret = 0;
+		while (inflight) {
+			ret = io_uring_wait_cqe(&bgp_io_ring, &cqe);
+			if (ret == -EINTR || ret == -EAGAIN)
+				continue;
+			if (ret < 0)
+				break;
+
+			w = io_uring_cqe_get_data(cqe);
+			results[w - batch] = cqe->res;
+			w->completed = true;
+			io_uring_cqe_seen(&bgp_io_ring, cqe);
+			inflight--;
+		}
+
+		if (inflight)
+			bgp_io_ring_fail(__func__, "completion", -ret);
+		else if ((unsigned int)taken < queued)
+			/* Drop whatever is left unsubmitted in the ring */
+			bgp_io_ring_fail(__func__, "submission", err);
+
+		for (i = 0; i < count; i++) {
+			w = &batch[i];
+			connection = w->connection;
+
+			if (!w->submitted)
+				/* Not written through the ring */
+				results[i] = writev(connection->fd, w->iov,
+						    w->count);
+			else if (!w->completed) {
+				errno = EIO;
+				results[i] = -1;
+			} else if (results[i] < 0) {
+				errno = -results[i];
+				results[i] = -1;
+			}
+
+			status = bgp_write_complete(connection, w, results[i]);
+			pthread_mutex_unlock(&connection->io_mtx);
+			bgp_write_done(connection, status);
+		}
+	}
+}
+#endif
+
+/*
+ * Called from I/O pthread after the file descriptor events of a loop
+ * iteration, to write out all connections that became writable.
+ */
+static void bgp_io_flush(struct event *event)
+{
+	struct peer_connection *connection;
+	uint16_t status;
+
+	frr_with_mutex (&bgp_io_writes_mtx) {
+#ifdef HAVE_LIBURING
+		if (bgp_io_writes_count(bgp_io_writes_list) > 1 &&
+		    bgp_io_ring_usable())
+			bgp_io_flush_ring();
+#endif
+
+		while ((connection = bgp_io_writes_pop(bgp_io_writes_list))) {
+			if (connection->fd < 0)
+				continue;
+
+			frr_with_mutex (&connection->io_mtx) {
+				status = bgp_write(connection);
+			}
+
+			bgp_write_done(connection, status);
+		}
+	}
+}
+
+/*
+ * Called from I/O pthread when a file descriptor has become ready for writing.
+ */
+static void bgp_process_writes(struct event *event)
+{
+	struct peer_connection *connection = EVENT_ARG(event);
+	struct frr_pthread *fpt = bgp_pth_io;
+
+	if (connection->fd < 0)
+		return;
+
+	/* Anticipate rescheduling */
+	event_add_write(fpt->master, bgp_process_writes, connection, connection->fd,
+			&connection->t_write);
+
+	/* Written by bgp_io_flush() along with all others ready in this round */
+	frr_with_mutex (&bgp_io_writes_mtx) {
+		if (!bgp_io_writes_anywhere(connection))
+			bgp_io_writes_add_tail(bgp_io_writes_list, connection);
+	}
+
+	event_add_event(fpt->master, bgp_io_flush, NULL, 0, &t_bgp_io_flush);
+}
+
 static int read_ibuf_work(struct peer_connection *connection)
 {
 	/* shorter alias to peer's input buffer */
@@ -181,7 +428,7 @@ static int read_ibuf_work(struct peer_connection *connection)
 		return 0;
 
 	frr_with_mutex (&connection->io_mtx) {
-		if (connection->ibuf->count >= bm->inq_limit)
+		if (bgp_connection_inq_count(connection) >= bm->inq_limit)
 			return -ENOMEM;
 	}
 
@@ -320,74 +567,76 @@ done:
 	if (ret != -ENOMEM)
 		event_add_read(fpt->master, bgp_process_reads, connection, connection->fd,
 			       &connection->t_read);
-	if (added_pkt) {
-		frr_with_mutex (&bm->peer_connection_mtx) {
-			if (!peer_connection_fifo_member(&bm->connection_fifo, connection))
-				peer_connection_fifo_add_tail(&bm->connection_fifo, connection);
-		}
-		event_add_event(bm->master, bgp_process_packet, NULL, 0, &bm->e_process_packet);
-	}
+	/* UPDATE parser pthread, if any, passes them on to the main pthread */
+	if (added_pkt && !bgp_parse_schedule(connection))
+		bgp_process_packet_schedule(connection);
 }
 
 /*
- * Flush peer output buffer.
- *
- * This function pops packets off of peer->connection.obuf and writes them to
- * peer->connection.fd. The amount of packets written is equal to the minimum of
- * peer->wpkt_quanta and the number of packets on the output buffer, unless an
- * error occurs.
- *
- * If write() returns an error, the appropriate FSM event is generated.
+ * Gather the packets at the head of connection->obuf for writing, up to
+ * the instance's write quanta.  Returns the number of packets gathered.
  *
- * The return value is equal to the number of packets written
- * (which may be zero).
+ * Must be called with connection->io_mtx held, which must stay held until
+ * bgp_write_complete().
  */
-static uint16_t bgp_write(struct peer_connection *connection)
+static unsigned int bgp_write_prepare(struct peer_connection *connection,
+				      struct bgp_io_write *w)
 {
 	struct peer *peer = connection->peer;
-	uint8_t type;
-	struct stream *s;
-	int update_last_write = 0;
-	unsigned int count;
-	uint32_t uo = 0;
-	uint16_t status = 0;
 	uint32_t wpkt_quanta_old;
-
-	int writenum = 0;
-	int num;
-	unsigned int iovsz;
-	unsigned int strmsz;
-	unsigned int total_written;
-	time_t now;
+	struct stream *s;
 
 	wpkt_quanta_old = atomic_load_explicit(&peer->bgp->wpkt_quanta,
 					       memory_order_relaxed);
-	struct stream *ostreams[wpkt_quanta_old];
-	struct stream **streams = ostreams;
-	struct iovec iov[wpkt_quanta_old];
+	wpkt_quanta_old = MIN(wpkt_quanta_old, array_size(w->iov));
 
-	s = stream_fifo_head(connection->obuf);
+	w->connection = connection;
+	w->count = 0;
+	w->writenum = 0;
 
-	if (!s)
-		goto done;
+	s = stream_fifo_head(connection->obuf);
 
-	count = iovsz = 0;
-	while (count < wpkt_quanta_old && iovsz < array_size(iov) && s) {
-		ostreams[iovsz] = s;
-		iov[iovsz].iov_base = stream_pnt(s);
-		iov[iovsz].iov_len = STREAM_READABLE(s);
-		writenum += STREAM_READABLE(s);
+	while (w->count < wpkt_quanta_old && s) {
+		w->streams[w->count] = s;
+		w->iov[w->count].iov_base = stream_pnt(s);
+		w->iov[w->count].iov_len = STREAM_READABLE(s);
+		w->writenum += STREAM_READABLE(s);
 		s = s->next;
-		++iovsz;
-		++count;
+		++w->count;
 	}
 
-	strmsz = iovsz;
-	total_written = 0;
+	return w->count;
+}
 
-	do {
-		num = writev(connection->fd, iov, iovsz);
+/*
+ * Finish writing the packets gathered by bgp_write_prepare(), given the
+ * result of the first writev() of them.
+ *
+ * Partial writes are continued with writev() until everything was written
+ * or the socket would block. Written packets are popped off
+ * connection->obuf and counted. If writing fails, the appropriate FSM
+ * event is generated.
+ */
+static uint16_t bgp_write_complete(struct peer_connection *connection,
+				   struct bgp_io_write *w, int num)
+{
+	struct peer *peer = connection->peer;
+	uint8_t type;
+	struct stream *s;
+	int update_last_write = 0;
+	unsigned int count = w->count;
+	uint32_t uo = 0;
+	uint16_t status = 0;
+
+	struct stream **streams = w->streams;
+	struct iovec *iov = w->iov;
+	int writenum = w->writenum;
+	unsigned int iovsz = w->count;
+	unsigned int strmsz = w->count;
+	unsigned int total_written = 0;
+	time_t now;
 
+	while (true) {
 		if (num < 0) {
 			if (!ERRNO_IO_RETRY(errno)) {
 				BGP_EVENT_ADD(connection, TCP_fatal_error);
@@ -417,7 +666,7 @@ static uint16_t bgp_write(struct peer_connection *connection)
 
 			assert(total_written < count);
 
-			memmove(&iov, &iov[msg_written],
+			memmove(iov, &iov[msg_written],
 				sizeof(iov[0]) * iovsz);
 			streams = &streams[msg_written];
 			stream_forward_getp(streams[0], num);
@@ -429,15 +678,17 @@ static uint16_t bgp_write(struct peer_connection *connection)
 			assert(writenum > 0);
 		} else {
 			total_written = strmsz;
+			break;
 		}
 
-	} while (num != writenum);
+		num = writev(connection->fd, iov, iovsz);
+	}
 
 	/* Handle statistics */
 	for (unsigned int i = 0; i < total_written; i++) {
 		s = stream_fifo_pop(connection->obuf);
 
-		assert(s == ostreams[i]);
+		assert(s == w->streams[i]);
 
 		/* Retrieve BGP packet type. */
 		stream_set_getp(s, BGP_MARKER_SIZE + 2);
@@ -486,7 +737,7 @@ static uint16_t bgp_write(struct peer_connection *connection)
 		}
 
 		stream_free(s);
-		ostreams[i] = NULL;
+		w->streams[i] = NULL;
 		update_last_write = 1;
 	}
 
@@ -512,6 +763,30 @@ done : {
 	return status;
 }
 
+/*
+ * Flush peer output buffer.
+ *
+ * This function pops packets off of peer->connection.obuf and writes them to
+ * peer->connection.fd. The amount of packets written is equal to the minimum of
+ * peer->wpkt_quanta and the number of packets on the output buffer, unless an
+ * error occurs.
+ *
+ * If write() returns an error, the appropriate FSM event is generated.
+ *
+ * The return value is equal to the number of packets written
+ * (which may be zero).
+ */
+static uint16_t bgp_write(struct peer_connection *connection)
+{
+	struct bgp_io_write w;
+
+	if (!bgp_write_prepare(connection, &w))
+		return 0;
+
+	return bgp_write_complete(connection, &w,
+				  writev(connection->fd, w.iov, w.count));
+}
+
 uint8_t ibuf_scratch[BGP_IBUF_WORK_SIZE];
 /*
  * Reads a chunk of data from peer->connection.fd into
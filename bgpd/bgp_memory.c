@@ -30,7 +30,6 @@ DEFINE_MTYPE(BGPD, BGP_PEER_AF, "BGP peer af");
 DEFINE_MTYPE(BGPD, BGP_UPDGRP, "BGP update group");
 DEFINE_MTYPE(BGPD, BGP_UPD_SUBGRP, "BGP update subgroup");
 DEFINE_MTYPE(BGPD, BGP_PACKET, "BGP packet");
-DEFINE_MTYPE(BGPD, ATTR, "BGP attribute");
 DEFINE_MTYPE(BGPD, ATTR_EXTRA, "BGP attribute extra");
 DEFINE_MTYPE(BGPD, AS_PATH, "BGP aspath");
 DEFINE_MTYPE(BGPD, AS_SEG, "BGP aspath seg");
@@ -38,8 +37,6 @@ DEFINE_MTYPE(BGPD, AS_SEG_DATA, "BGP aspath segment data");
 DEFINE_MTYPE(BGPD, AS_STR, "BGP aspath str");
 
 DEFINE_MTYPE(BGPD, BGP_TABLE, "BGP table");
-DEFINE_MTYPE(BGPD, BGP_NODE, "BGP node");
-DEFINE_MTYPE(BGPD, BGP_ROUTE, "BGP route");
 DEFINE_MTYPE(BGPD, BGP_ROUTE_EXTRA, "BGP ancillary route info");
 DEFINE_MTYPE(BGPD, BGP_ROUTE_EXTRA_EVPN, "BGP extra info for EVPN");
 DEFINE_MTYPE(BGPD, BGP_ROUTE_EXTRA_FS, "BGP extra info for flowspec");
@@ -47,6 +47,7 @@
 #include "bgpd/bgp_updgrp.h"
 #include "bgpd/bgp_label.h"
 #include "bgpd/bgp_io.h"
+#include "bgpd/bgp_parse.h"
 #include "bgpd/bgp_keepalives.h"
 #include "bgpd/bgp_flowspec.h"
 #include "bgpd/bgp_unreach.h"
@@ -492,6 +493,9 @@ void bgp_generate_updgrp_packets(struct event *event)
 		return;
 	}
 
+	/* Format what this and the other pending peers need in parallel */
+	subgroup_build_packets(peer);
+
 	do {
 		enum bgp_af_index index;
 
@@ -2408,6 +2412,7 @@ static int bgp_update_receive(struct peer_connection *connection, bgp_size_t siz
 		NLRI_TYPE_MAX
 	};
 	struct bgp_nlri nlris[NLRI_TYPE_MAX];
+	const struct bgp_nlri_decoded *decoded;
 
 	/* Status must be Established. */
 	if (!peer_established(connection)) {
@@ -2576,16 +2581,26 @@ static int bgp_update_receive(struct peer_connection *connection, bgp_size_t siz
 		if (nlris[i].length == 0)
 			continue;
 
+		/* Already decoded by the UPDATE parser pool? */
+		decoded = bgp_parsed_nlri_lookup(connection, &nlris[i]);
+
 		switch (i) {
 		case NLRI_UPDATE:
 		case NLRI_MP_UPDATE:
-			nlri_ret = bgp_nlri_parse(peer, NLRI_ATTR_ARG,
-						  &nlris[i], 0);
+			if (decoded)
+				nlri_ret = bgp_nlri_apply_ip(peer, NLRI_ATTR_ARG,
+							     decoded);
+			else
+				nlri_ret = bgp_nlri_parse(peer, NLRI_ATTR_ARG,
+							  &nlris[i], 0);
 			break;
 		case NLRI_WITHDRAW:
 		case NLRI_MP_WITHDRAW:
-			nlri_ret = bgp_nlri_parse(peer, NLRI_ATTR_ARG,
-						  &nlris[i], 1);
+			if (decoded)
+				nlri_ret = bgp_nlri_apply_ip(peer, NULL, decoded);
+			else
+				nlri_ret = bgp_nlri_parse(peer, NLRI_ATTR_ARG,
+							  &nlris[i], 1);
 			break;
 		default:
 			nlri_ret = BGP_NLRI_PARSE_ERROR;
@@ -4164,8 +4179,9 @@ void bgp_process_packet(struct event *event)
 		bool rearm_reads = false;
 
 		frr_with_mutex (&connection->io_mtx) {
-			rearm_reads = (bm->inq_limit && connection->ibuf->count >= bm->inq_limit);
-			connection->curr = stream_fifo_pop(connection->ibuf);
+			rearm_reads = (bm->inq_limit &&
+				       bgp_connection_inq_count(connection) >= bm->inq_limit);
+			connection->curr = bgp_parse_pop(connection);
 		}
 
 		if (rearm_reads)
@@ -4283,6 +4299,7 @@ void bgp_process_packet(struct event *event)
 		/* delete processed packet */
 		stream_free(connection->curr);
 		connection->curr = NULL;
+		bgp_parsed_pkt_done(connection);
 		processed++;
 		curr_connection_processed++;
 
@@ -4324,7 +4341,7 @@ void bgp_process_packet(struct event *event)
 		}
 
 		frr_with_mutex (&connection->io_mtx) {
-			if (connection->ibuf->count > 0)
+			if (bgp_connection_ready_count(connection) > 0)
 				more_work = true;
 			else
 				more_work = false;
@@ -4341,7 +4358,7 @@ void bgp_process_packet(struct event *event)
 
 	if (connection) {
 		frr_with_mutex (&connection->io_mtx) {
-			if (connection->ibuf->count > 0)
+			if (bgp_connection_ready_count(connection) > 0)
 				more_work = true;
 			else
 				more_work = false;
@@ -4361,6 +4378,19 @@ done:
 		event_add_event(bm->master, bgp_process_packet, NULL, 0, &bm->e_process_packet);
 }
 
+/*
+ * Queue a connection with received packets for bgp_process_packet() on the
+ * main pthread.  Called from the I/O and UPDATE parser pthreads.
+ */
+void bgp_process_packet_schedule(struct peer_connection *connection)
+{
+	frr_with_mutex (&bm->peer_connection_mtx) {
+		if (!peer_connection_fifo_member(&bm->connection_fifo, connection))
+			peer_connection_fifo_add_tail(&bm->connection_fifo, connection);
+	}
+	event_add_event(bm->master, bgp_process_packet, NULL, 0, &bm->e_process_packet);
+}
+
 /* Send EOR when routes are processed by selection deferral timer */
 void bgp_send_delayed_eor(struct bgp *bgp)
 {
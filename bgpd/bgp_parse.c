@@ -0,0 +1,572 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/* BGP UPDATE parser pool.
+ * Pre-decodes received UPDATE messages on a set of pthreads so that the
+ * main pthread only has to apply the decoded prefixes to the RIB.
+ *
+ * The I/O pthread frames packets onto connection->ibuf as before.  When the
+ * pool is enabled, each connection is bound to one parser pthread, which
+ * moves packets from connection->ibuf to connection->parsed and decodes the
+ * withdrawn routes, NLRI, MP_REACH_NLRI and MP_UNREACH_NLRI sections of
+ * IPv4/IPv6 unicast and multicast UPDATEs into prefix arrays.  The AS_PATH
+ * attribute is parsed into an AS path with its string built, so that the
+ * main pthread only has to look it up in the AS path hash.
+ *
+ * The attribute hashes themselves are not shared with the parsers: their
+ * reference counts are plain integers updated all over bgpd, so interning
+ * stays on the main pthread and only the work that comes before it is
+ * moved here.
+ *
+ * The parser only does syntactic work that needs no shared state.  Anything
+ * it does not understand, or that fails to decode, is left alone and the
+ * main pthread parses it from the wire exactly as without the pool, so all
+ * error handling and NOTIFICATION generation stays in one place.
+ */
+
+#include <zebra.h>
+
+#include "frr_pthread.h"
+#include "frrevent.h"
+#include "memory.h"
+#include "stream.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_packet.h"
+#include "bgpd/bgp_parse.h"
+#include "bgpd/bgp_route.h"
+
+DEFINE_MTYPE_STATIC(BGPD, BGP_PARSED_PKT, "BGP pre-decoded packet");
+DEFINE_MTYPE_STATIC(BGPD, BGP_PARSED_NLRI, "BGP pre-decoded NLRI");
+
+/* Parser pthreads are only ever added; they are stopped on shutdown by
+ * frr_pthread_stop_all().
+ */
+static struct frr_pthread *bgp_parse_pths[BGP_PARSE_THREADS_MAX];
+static unsigned int bgp_parse_pths_count;
+static unsigned int bgp_parse_next;
+
+static void bgp_parse_packets(struct event *event);
+
+void bgp_parse_threads_set(unsigned int count)
+{
+	char name[64], os_name[OS_THREAD_NAMELEN];
+	struct frr_pthread_attr attr = {
+		.start = frr_pthread_attr_default.start,
+		.stop = frr_pthread_attr_default.stop,
+	};
+	struct frr_pthread *fpt;
+
+	count = MIN(count, BGP_PARSE_THREADS_MAX);
+	bm->parse_threads = count;
+
+	while (bgp_parse_pths_count < count) {
+		snprintf(name, sizeof(name), "BGP UPDATE parser thread %u",
+			 bgp_parse_pths_count);
+		snprintf(os_name, sizeof(os_name), "bgpd_parse%u",
+			 bgp_parse_pths_count);
+
+		fpt = frr_pthread_new(&attr, name, os_name);
+		frr_pthread_run(fpt, NULL);
+		frr_pthread_wait_running(fpt);
+
+		bgp_parse_pths[bgp_parse_pths_count++] = fpt;
+	}
+}
+
+void bgp_parse_connection_bind(struct peer_connection *connection)
+{
+	struct frr_pthread *fpt;
+
+	if (connection->parser || !bm->parse_threads)
+		return;
+
+	fpt = bgp_parse_pths[bgp_parse_next++ % bm->parse_threads];
+
+	frr_with_mutex (&connection->io_mtx) {
+		connection->parser = fpt;
+
+		/* Packets flushed back by an earlier unbind would otherwise
+		 * wait for the next read off the socket.
+		 */
+		if (connection->ibuf->count)
+			event_add_event(fpt->master, bgp_parse_packets,
+					connection, 0, &connection->t_parse);
+	}
+}
+
+void bgp_parse_connection_unbind(struct peer_connection *connection)
+{
+	struct frr_pthread *fpt = connection->parser;
+
+	if (!fpt)
+		return;
+
+	/* Once parser is cleared nothing schedules or re-arms t_parse */
+	frr_with_mutex (&connection->io_mtx) {
+		connection->parser = NULL;
+	}
+
+	/* Also waits for a bgp_parse_packets() that is still running */
+	event_cancel_async(fpt->master, &connection->t_parse, NULL);
+
+	frr_with_mutex (&connection->io_mtx) {
+		/* Hand back whatever was parsed but not processed yet, in
+		 * order, so nothing is lost if reads are turned back on.
+		 */
+		bgp_parsed_pkts_flush(connection);
+	}
+}
+
+bool bgp_parse_schedule(struct peer_connection *connection)
+{
+	bool bound = false;
+
+	frr_with_mutex (&connection->io_mtx) {
+		if (connection->parser) {
+			event_add_event(connection->parser->master,
+					bgp_parse_packets, connection, 0,
+					&connection->t_parse);
+			bound = true;
+		}
+	}
+
+	return bound;
+}
+
+static void bgp_nlri_decoded_free(struct bgp_nlri_decoded *dec)
+{
+	XFREE(MTYPE_BGP_PARSED_NLRI, dec->prefixes);
+	dec->count = dec->alloc = 0;
+}
+
+static void bgp_parsed_pkt_free(struct bgp_parsed_pkt *pkt)
+{
+	for (uint8_t i = 0; i < pkt->nsections; i++)
+		bgp_nlri_decoded_free(&pkt->sections[i]);
+
+	aspath_free(pkt->aspath.aspath);
+	stream_free(pkt->s);
+	XFREE(MTYPE_BGP_PARSED_PKT, pkt);
+}
+
+/*
+ * Decode an IPv4/IPv6 NLRI section.  Mirrors the syntax checks of
+ * bgp_nlri_parse_ip(); on any error the section is discarded and left to
+ * the main pthread, which will log and send the NOTIFICATION.
+ */
+static bool bgp_parse_nlri_ip(struct bgp_nlri_decoded *dec)
+{
+	const uint8_t *pnt = dec->nlri;
+	const uint8_t *lim = pnt + dec->length;
+	struct bgp_nlri_prefix *np;
+	uint32_t addpath_id = 0;
+	uint8_t prefixlen;
+	uint8_t maxlen;
+	int psize;
+
+	maxlen = (dec->afi == AFI_IP) ? IPV4_MAX_BITLEN : IPV6_MAX_BITLEN;
+
+	while (pnt < lim) {
+		if (dec->addpath) {
+			if (pnt + BGP_ADDPATH_ID_LEN >= lim)
+				return false;
+
+			memcpy(&addpath_id, pnt, BGP_ADDPATH_ID_LEN);
+			addpath_id = ntohl(addpath_id);
+			pnt += BGP_ADDPATH_ID_LEN;
+		}
+
+		prefixlen = *pnt++;
+		if (prefixlen > maxlen)
+			return false;
+
+		psize = PSIZE(prefixlen);
+		if (pnt + psize > lim)
+			return false;
+
+		if (dec->count == dec->alloc) {
+			dec->alloc = dec->alloc ? dec->alloc * 2 : 32;
+			dec->prefixes = XREALLOC(MTYPE_BGP_PARSED_NLRI,
+						 dec->prefixes,
+						 dec->alloc * sizeof(*np));
+		}
+
+		np = &dec->prefixes[dec->count++];
+		memset(&np->p, 0, sizeof(np->p));
+		np->p.family = afi2family(dec->afi);
+		np->p.prefixlen = prefixlen;
+		memcpy(&np->p.u.val, pnt, psize);
+		np->addpath_id = addpath_id;
+
+		pnt += psize;
+	}
+
+	return true;
+}
+
+static void bgp_parse_section(struct bgp_parsed_pkt *pkt, struct peer *peer,
+			      afi_t afi, safi_t safi, const uint8_t *nlri,
+			      bgp_size_t length)
+{
+	struct bgp_nlri_decoded *dec;
+
+	if (!length || pkt->nsections >= BGP_PARSED_SECTIONS_MAX)
+		return;
+
+	if ((afi != AFI_IP && afi != AFI_IP6) ||
+	    (safi != SAFI_UNICAST && safi != SAFI_MULTICAST))
+		return;
+
+	dec = &pkt->sections[pkt->nsections];
+	memset(dec, 0, sizeof(*dec));
+	dec->afi = afi;
+	dec->safi = safi;
+	dec->nlri = nlri;
+	dec->length = length;
+	dec->addpath = bgp_addpath_encode_rx(peer, afi, safi);
+
+	if (bgp_parse_nlri_ip(dec))
+		pkt->nsections++;
+	else
+		bgp_nlri_decoded_free(dec);
+}
+
+/*
+ * Parse an AS_PATH attribute the way bgp_attr_aspath() would.  If it is
+ * malformed nothing is kept and the main pthread deals with it.  Like all
+ * decoding this runs with connection->io_mtx released, since building the
+ * segments and the string is the most expensive part of it.
+ */
+static void bgp_parse_aspath(struct bgp_parsed_pkt *pkt, struct peer *peer,
+			     const uint8_t *pnt, bgp_size_t length)
+{
+	struct bgp_aspath_prepared *prep = &pkt->aspath;
+	struct stream *s = pkt->s;
+	size_t getp;
+
+	if (prep->data)
+		return;
+
+	prep->data = pnt;
+	prep->length = length;
+	prep->use32bit = CHECK_FLAG(peer->cap, PEER_CAP_AS4_RCV) &&
+			 CHECK_FLAG(peer->cap, PEER_CAP_AS4_ADV);
+
+	/* Until bgp_parse_packets() queues it on connection->parsed, the
+	 * stream is only seen by this pthread.
+	 */
+	getp = stream_get_getp(s);
+	stream_set_getp(s, pnt - s->data);
+	prep->aspath = aspath_parse_prepare(s, length, prep->use32bit,
+					    bgp_get_asnotation(peer->bgp));
+	stream_set_getp(s, getp);
+}
+
+/* Locate AS_PATH, MP_REACH_NLRI and MP_UNREACH_NLRI in the path
+ * attributes.
+ */
+static void bgp_parse_attrs(struct bgp_parsed_pkt *pkt, struct peer *peer,
+			    const uint8_t *pnt, const uint8_t *lim)
+{
+	uint8_t flag, type, nhlen;
+	bgp_size_t length, offset;
+	iana_afi_t pkt_afi;
+	iana_safi_t pkt_safi;
+	afi_t afi;
+	safi_t safi;
+
+	while (pnt + 3 <= lim) {
+		flag = pnt[0];
+		type = pnt[1];
+
+		if (CHECK_FLAG(flag, BGP_ATTR_FLAG_EXTLEN)) {
+			if (pnt + 4 > lim)
+				return;
+			length = (pnt[2] << 8) | pnt[3];
+			pnt += 4;
+		} else {
+			length = pnt[2];
+			pnt += 3;
+		}
+
+		if (pnt + length > lim)
+			return;
+
+		if (type == BGP_ATTR_AS_PATH)
+			bgp_parse_aspath(pkt, peer, pnt, length);
+
+		if (type == BGP_ATTR_MP_REACH_NLRI ||
+		    type == BGP_ATTR_MP_UNREACH_NLRI) {
+			if (length < 3)
+				return;
+
+			pkt_afi = (pnt[0] << 8) | pnt[1];
+			pkt_safi = pnt[2];
+			if (bgp_map_afi_safi_iana2int(pkt_afi, pkt_safi, &afi,
+						      &safi))
+				return;
+
+			if (type == BGP_ATTR_MP_REACH_NLRI) {
+				/* afi, safi, nexthop length, nexthop and the
+				 * reserved SNPA octet.
+				 */
+				if (length < 4)
+					return;
+				nhlen = pnt[3];
+				offset = 4 + nhlen + 1;
+			} else
+				offset = 3;
+
+			if (offset < length)
+				bgp_parse_section(pkt, peer, afi, safi,
+						  pnt + offset, length - offset);
+		}
+
+		pnt += length;
+	}
+}
+
+/* Split an UPDATE into its sections and decode what we can. */
+static void bgp_parse_update(struct bgp_parsed_pkt *pkt, struct peer *peer)
+{
+	struct stream *s = pkt->s;
+	const uint8_t *pnt, *end;
+	bgp_size_t withdraw_len, attribute_len;
+
+	pnt = s->data + BGP_HEADER_SIZE;
+	end = s->data + stream_get_endp(s);
+
+	if (pnt + 2 > end)
+		return;
+	withdraw_len = (pnt[0] << 8) | pnt[1];
+	pnt += 2;
+	if (pnt + withdraw_len > end)
+		return;
+
+	bgp_parse_section(pkt, peer, AFI_IP, SAFI_UNICAST, pnt, withdraw_len);
+	pnt += withdraw_len;
+
+	if (pnt + 2 > end)
+		return;
+	attribute_len = (pnt[0] << 8) | pnt[1];
+	pnt += 2;
+	if (pnt + attribute_len > end)
+		return;
+
+	bgp_parse_attrs(pkt, peer, pnt, pnt + attribute_len);
+	pnt += attribute_len;
+
+	/* NLRI without attributes is ignored by bgp_update_receive() */
+	if (attribute_len)
+		bgp_parse_section(pkt, peer, AFI_IP, SAFI_UNICAST, pnt,
+				  end - pnt);
+}
+
+/* Decode one packet taken off connection->ibuf; called without io_mtx. */
+static struct bgp_parsed_pkt *bgp_parse_one(struct peer_connection *connection,
+					    struct stream *s)
+{
+	struct bgp_parsed_pkt *pkt;
+
+	pkt = XCALLOC(MTYPE_BGP_PARSED_PKT, sizeof(*pkt));
+	pkt->s = s;
+
+	/* header has been validated by the I/O pthread */
+	if (s->data[BGP_MARKER_SIZE + 2] == BGP_MSG_UPDATE &&
+	    peer_established(connection))
+		bgp_parse_update(pkt, connection->peer);
+
+	return pkt;
+}
+
+/*
+ * Called from a parser pthread when packets are waiting on
+ * connection->ibuf.  Packets are decoded with io_mtx released, so the
+ * I/O pthread is only held up while they are moved between the queues.
+ */
+static void bgp_parse_packets(struct event *event)
+{
+	struct peer_connection *connection = EVENT_ARG(event);
+	struct bgp_parsed_pkt *pkt;
+	struct stream *s;
+	unsigned int processed = 0;
+	bool bound = true;
+	bool more = false;
+
+	while (bound && processed < BGP_PARSE_PACKET_MAX) {
+		frr_with_mutex (&connection->io_mtx) {
+			s = NULL;
+			if (connection->parser)
+				s = stream_fifo_pop(connection->ibuf);
+			if (s)
+				atomic_fetch_add_explicit(&connection->parsed_count,
+							  1,
+							  memory_order_relaxed);
+		}
+
+		if (!s)
+			break;
+
+		pkt = bgp_parse_one(connection, s);
+
+		/* If the connection was unbound meanwhile, the packet is still
+		 * queued here; bgp_parse_connection_unbind() hands it back
+		 * once this handler is done.
+		 */
+		frr_with_mutex (&connection->io_mtx) {
+			bgp_parsed_pkts_add_tail(&connection->parsed, pkt);
+			bound = !!connection->parser;
+			more = connection->ibuf->count > 0;
+		}
+
+		processed++;
+	}
+
+	if (!bound)
+		return;
+
+	if (processed)
+		bgp_process_packet_schedule(connection);
+
+	if (more && processed == BGP_PARSE_PACKET_MAX) {
+		frr_with_mutex (&connection->io_mtx) {
+			if (connection->parser)
+				event_add_event(event->master, bgp_parse_packets,
+						connection, 0,
+						&connection->t_parse);
+		}
+	}
+}
+
+struct stream *bgp_parse_pop(struct peer_connection *connection)
+{
+	struct bgp_parsed_pkt *pkt;
+	struct stream *s;
+
+	if (!connection->parser)
+		return stream_fifo_pop(connection->ibuf);
+
+	pkt = bgp_parsed_pkts_pop(&connection->parsed);
+	if (!pkt)
+		return NULL;
+	atomic_fetch_sub_explicit(&connection->parsed_count, 1,
+				  memory_order_relaxed);
+
+	/* ownership of the stream moves to connection->curr */
+	s = pkt->s;
+	pkt->s = NULL;
+
+	assert(!connection->curr_parsed);
+	connection->curr_parsed = pkt;
+	return s;
+}
+
+void bgp_parsed_pkt_done(struct peer_connection *connection)
+{
+	if (!connection->curr_parsed)
+		return;
+
+	bgp_parsed_pkt_free(connection->curr_parsed);
+	connection->curr_parsed = NULL;
+}
+
+void bgp_parsed_pkts_flush(struct peer_connection *connection)
+{
+	struct bgp_parsed_pkt *pkt;
+	struct stream_fifo *fifo;
+	struct stream *s;
+
+	if (!bgp_parsed_pkts_count(&connection->parsed))
+		return;
+
+	/* Put the raw packets back in front of anything not parsed yet */
+	fifo = stream_fifo_new();
+	while ((pkt = bgp_parsed_pkts_pop(&connection->parsed))) {
+		stream_fifo_push(fifo, pkt->s);
+		pkt->s = NULL;
+		bgp_parsed_pkt_free(pkt);
+		atomic_fetch_sub_explicit(&connection->parsed_count, 1,
+					  memory_order_relaxed);
+	}
+	while ((s = stream_fifo_pop(connection->ibuf)))
+		stream_fifo_push(fifo, s);
+	while ((s = stream_fifo_pop(fifo)))
+		stream_fifo_push(connection->ibuf, s);
+	stream_fifo_free(fifo);
+}
+
+const struct bgp_nlri_decoded *
+bgp_parsed_nlri_lookup(struct peer_connection *connection,
+		       const struct bgp_nlri *packet)
+{
+	struct bgp_parsed_pkt *pkt = connection->curr_parsed;
+	const struct bgp_nlri_decoded *dec;
+
+	if (!pkt)
+		return NULL;
+
+	for (uint8_t i = 0; i < pkt->nsections; i++) {
+		dec = &pkt->sections[i];
+
+		if (dec->nlri != packet->nlri || dec->length != packet->length ||
+		    dec->afi != packet->afi || dec->safi != packet->safi)
+			continue;
+
+		/* AddPath may have been renegotiated by a CAPABILITY message
+		 * processed after this packet was decoded.
+		 */
+		if (dec->addpath != bgp_addpath_encode_rx(connection->peer,
+							  dec->afi, dec->safi))
+			return NULL;
+
+		return dec;
+	}
+
+	return NULL;
+}
+
+struct aspath *bgp_parsed_aspath_take(struct peer_connection *connection,
+				      const uint8_t *data, bgp_size_t length,
+				      bool use32bit,
+				      enum asnotation_mode asnotation)
+{
+	struct bgp_parsed_pkt *pkt = connection->curr_parsed;
+	struct bgp_aspath_prepared *prep;
+	struct aspath *aspath;
+
+	if (!pkt)
+		return NULL;
+
+	prep = &pkt->aspath;
+	if (!prep->aspath || prep->data != data || prep->length != length)
+		return NULL;
+
+	/* A CAPABILITY message or "bgp as-notation" may have changed things
+	 * since the packet was parsed.
+	 */
+	if (prep->use32bit != use32bit ||
+	    prep->aspath->asnotation != asnotation)
+		return NULL;
+
+	aspath = prep->aspath;
+	prep->aspath = NULL;
+	return aspath;
+}
+
+size_t bgp_connection_inq_count(struct peer_connection *connection)
+{
+	return atomic_load_explicit(&connection->ibuf->count,
+				    memory_order_relaxed) +
+	       atomic_load_explicit(&connection->parsed_count,
+				    memory_order_relaxed);
+}
+
+size_t bgp_connection_ready_count(struct peer_connection *connection)
+{
+	if (connection->parser)
+		return bgp_parsed_pkts_count(&connection->parsed);
+
+	return atomic_load_explicit(&connection->ibuf->count,
+				    memory_order_relaxed);
+}
@@ -0,0 +1,144 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/* BGP UPDATE parser pool.
+ * Pre-decodes received UPDATE messages on a set of pthreads so that the
+ * main pthread only has to apply the decoded prefixes to the RIB.
+ */
+
+#ifndef _FRR_BGP_PARSE_H
+#define _FRR_BGP_PARSE_H
+
+#include "frr_pthread.h"
+#include "prefix.h"
+#include "stream.h"
+#include "typesafe.h"
+
+#include "bgpd/bgpd.h"
+
+/* Upper bound for "bgp update-parse-threads" */
+#define BGP_PARSE_THREADS_MAX 64U
+
+/* Packets handled per connection before a parser yields */
+#define BGP_PARSE_PACKET_MAX 100U
+
+struct bgp_nlri_prefix {
+	struct prefix p;
+	uint32_t addpath_id;
+};
+
+/*
+ * One IPv4/IPv6 unicast/multicast NLRI section of an UPDATE, decoded
+ * off the main pthread.  nlri/length identify the section in the packet
+ * so the consumer can match it up with what bgp_attr_parse() found.
+ */
+struct bgp_nlri_decoded {
+	afi_t afi;
+	safi_t safi;
+
+	const uint8_t *nlri;
+	bgp_size_t length;
+
+	/* AddPath receive state the section was decoded with */
+	bool addpath;
+
+	uint32_t count;
+	uint32_t alloc;
+	struct bgp_nlri_prefix *prefixes;
+};
+
+/* withdrawn routes, NLRI, MP_REACH_NLRI and MP_UNREACH_NLRI */
+#define BGP_PARSED_SECTIONS_MAX 4
+
+/*
+ * The AS_PATH attribute of an UPDATE, parsed off the main pthread by
+ * aspath_parse_prepare() but not interned yet.
+ */
+struct bgp_aspath_prepared {
+	const uint8_t *data;
+	bgp_size_t length;
+
+	/* AS4 state the attribute was parsed with */
+	bool use32bit;
+
+	struct aspath *aspath;
+};
+
+struct bgp_parsed_pkt {
+	struct stream *s;
+
+	uint8_t nsections;
+	struct bgp_nlri_decoded sections[BGP_PARSED_SECTIONS_MAX];
+
+	struct bgp_aspath_prepared aspath;
+
+	struct bgp_parsed_pkts_item item;
+};
+
+DECLARE_LIST(bgp_parsed_pkts, struct bgp_parsed_pkt, item);
+
+/*
+ * Set the number of parser pthreads.  Missing pthreads are started; a
+ * smaller value only affects connections bound afterwards.  0 disables the
+ * pool and packets are parsed on the main pthread only.
+ */
+extern void bgp_parse_threads_set(unsigned int count);
+
+/*
+ * Bind / unbind a connection to one of the parser pthreads.  All packets
+ * of a connection are handled by the same parser, so per-peer ordering
+ * is preserved.  Called on the main pthread from bgp_reads_on() and
+ * bgp_reads_off().
+ */
+extern void bgp_parse_connection_bind(struct peer_connection *connection);
+extern void bgp_parse_connection_unbind(struct peer_connection *connection);
+
+/*
+ * Kick the parser of a connection after new packets have been placed on
+ * connection->ibuf.  Returns false if the connection has no parser, in
+ * which case the caller must hand the packets to the main pthread.
+ */
+extern bool bgp_parse_schedule(struct peer_connection *connection);
+
+/*
+ * Pop the next parsed packet for the main pthread; its decoded sections
+ * stay available in connection->curr_parsed until bgp_parsed_pkt_done().
+ *
+ * Requires: connection->io_mtx
+ */
+extern struct stream *bgp_parse_pop(struct peer_connection *connection);
+extern void bgp_parsed_pkt_done(struct peer_connection *connection);
+
+/* Drop all parsed packets.  Requires: connection->io_mtx */
+extern void bgp_parsed_pkts_flush(struct peer_connection *connection);
+
+/*
+ * Find the decoded form of an NLRI section of the packet currently being
+ * processed, or NULL if it has to be parsed from the wire.
+ */
+extern const struct bgp_nlri_decoded *
+bgp_parsed_nlri_lookup(struct peer_connection *connection,
+		       const struct bgp_nlri *packet);
+
+/*
+ * Take the prepared AS_PATH at data/length of the packet currently being
+ * processed, for the caller to hand to aspath_intern(), or NULL if it has
+ * to be parsed from the wire.
+ */
+extern struct aspath *
+bgp_parsed_aspath_take(struct peer_connection *connection,
+		       const uint8_t *data, bgp_size_t length, bool use32bit,
+		       enum asnotation_mode asnotation);
+
+/*
+ * Packets received but not yet handed to bgp_process_packet(), including
+ * any a parser is decoding.  Needs no lock, like the fifo counts.
+ */
+extern size_t bgp_connection_inq_count(struct peer_connection *connection);
+
+/*
+ * Packets that bgp_process_packet() can consume right now.
+ *
+ * Requires: connection->io_mtx
+ */
+extern size_t bgp_connection_ready_count(struct peer_connection *connection);
+
+#endif /* _FRR_BGP_PARSE_H */
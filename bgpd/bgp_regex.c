@@ -73,3 +73,264 @@ void bgp_regex_free(struct frregex *regex)
 	regfree(&regex->real);
 	XFREE(MTYPE_BGP_REGEXP, regex);
 }
+
+/* Upper bound of ASNs in a natively matched regex */
+#define BGP_ASREGEX_MAX 32
+
+struct bgp_asregex {
+	bool anchor_start;
+	bool anchor_end;
+
+	/* Runs of consecutive ASNs; at least one other ASN has to sit
+	 * between two runs.
+	 */
+	uint8_t ngroups;
+	uint8_t goff[BGP_ASREGEX_MAX];
+	uint8_t glen[BGP_ASREGEX_MAX];
+	as_t asn[BGP_ASREGEX_MAX];
+};
+
+enum asregex_tok {
+	ASRE_CARET,
+	ASRE_DOLLAR,
+	ASRE_US,
+	ASRE_DOTSTAR,
+	ASRE_NUM,
+};
+
+struct asregex_token {
+	enum asregex_tok type;
+	as_t asn;
+};
+
+static int asregex_lex(const char *regstr, struct asregex_token *toks,
+		       unsigned int max)
+{
+	const char *p = regstr;
+	unsigned int n = 0;
+	uint64_t val;
+
+	while (*p) {
+		if (n == max)
+			return -1;
+
+		switch (*p) {
+		case '^':
+			toks[n++].type = ASRE_CARET;
+			p++;
+			continue;
+		case '$':
+			toks[n++].type = ASRE_DOLLAR;
+			p++;
+			continue;
+		case '_':
+			toks[n++].type = ASRE_US;
+			p++;
+			continue;
+		case '.':
+			if (p[1] != '*')
+				return -1;
+			toks[n++].type = ASRE_DOTSTAR;
+			p += 2;
+			continue;
+		}
+
+		/* ASNs are printed without leading zeros */
+		if (!isdigit((unsigned char)*p) ||
+		    (*p == '0' && isdigit((unsigned char)p[1])))
+			return -1;
+
+		for (val = 0; isdigit((unsigned char)*p); p++) {
+			val = val * 10 + (*p - '0');
+			if (val > UINT32_MAX)
+				return -1;
+		}
+		toks[n].type = ASRE_NUM;
+		toks[n++].asn = val;
+	}
+
+	return n;
+}
+
+/*
+ * Accepts
+ *	[^] [_ | .*]...  NUM (_ NUM)* (_ .* _ NUM (_ NUM)*)*  [_ | .*]... [$]
+ * where an ASN run has to be bounded by `_', `^' or `$' on both sides so
+ * it only matches whole ASNs; `.*' next to an anchor undoes it.
+ */
+struct bgp_asregex *bgp_asregex_compile(const char *regstr)
+{
+	struct asregex_token toks[4 * BGP_ASREGEX_MAX];
+	struct bgp_asregex re = {};
+	struct bgp_asregex *asre;
+	bool bounded = false, dotstar = false, newrun = true;
+	unsigned int i = 0, j, nasn = 0;
+	int n;
+
+	n = asregex_lex(regstr, toks, array_size(toks));
+	if (n <= 0)
+		return NULL;
+	j = n;
+
+	if (toks[i].type == ASRE_CARET) {
+		re.anchor_start = bounded = true;
+		i++;
+	}
+	for (; i < j; i++) {
+		if (toks[i].type == ASRE_US) {
+			if (i > 0 && toks[i - 1].type == ASRE_US)
+				return NULL;
+			bounded = true;
+		} else if (toks[i].type == ASRE_DOTSTAR) {
+			dotstar = true;
+			bounded = false;
+		} else
+			break;
+	}
+	if (dotstar)
+		re.anchor_start = false;
+	if (i < j && !bounded && toks[i].type == ASRE_NUM)
+		return NULL;
+
+	bounded = dotstar = false;
+	if (j > i && toks[j - 1].type == ASRE_DOLLAR) {
+		re.anchor_end = bounded = true;
+		j--;
+	}
+	for (; j > i; j--) {
+		if (toks[j - 1].type == ASRE_US) {
+			if (j < (unsigned int)n && toks[j].type == ASRE_US)
+				return NULL;
+			bounded = true;
+		} else if (toks[j - 1].type == ASRE_DOTSTAR) {
+			dotstar = true;
+			bounded = false;
+		} else
+			break;
+	}
+	if (dotstar)
+		re.anchor_end = false;
+	if (j > i && !bounded)
+		return NULL;
+
+	while (i < j) {
+		if (toks[i].type != ASRE_NUM || nasn == BGP_ASREGEX_MAX)
+			return NULL;
+
+		if (newrun) {
+			re.goff[re.ngroups] = nasn;
+			re.glen[re.ngroups++] = 0;
+		}
+		re.glen[re.ngroups - 1]++;
+		re.asn[nasn++] = toks[i++].asn;
+
+		if (i == j)
+			break;
+		if (toks[i++].type != ASRE_US)
+			return NULL;
+
+		newrun = toks[i].type == ASRE_DOTSTAR;
+		if (!newrun)
+			continue;
+
+		/* `_.*_' gap, more `.*' don't change it */
+		while (i < j && toks[i].type == ASRE_DOTSTAR)
+			i++;
+		if (i == j || toks[i++].type != ASRE_US)
+			return NULL;
+	}
+
+	asre = XMALLOC(MTYPE_BGP_REGEXP, sizeof(*asre));
+	*asre = re;
+
+	return asre;
+}
+
+static bool asregex_run_at(const struct bgp_asregex *asre, unsigned int g,
+			   const as_t *path, unsigned int pos)
+{
+	return !memcmp(path + pos, asre->asn + asre->goff[g],
+		       asre->glen[g] * sizeof(*path));
+}
+
+static int asregex_match(const struct bgp_asregex *asre, const as_t *path,
+			 unsigned int n)
+{
+	unsigned int g, len, start, pos = 0;
+
+	for (g = 0; g < asre->ngroups; g++) {
+		len = asre->glen[g];
+		if (n < len)
+			return 0;
+
+		if (g == asre->ngroups - 1u && asre->anchor_end) {
+			start = n - len;
+			if (start < pos || (g == 0 && asre->anchor_start && start))
+				return 0;
+			return asregex_run_at(asre, g, path, start);
+		}
+
+		if (g == 0 && asre->anchor_start) {
+			start = 0;
+			if (!asregex_run_at(asre, g, path, start))
+				return 0;
+		} else {
+			/* The earliest placement leaves the most room for the
+			 * runs after it.
+			 */
+			for (start = pos; start + len <= n; start++)
+				if (asregex_run_at(asre, g, path, start))
+					break;
+			if (start + len > n)
+				return 0;
+		}
+
+		pos = start + len + 1;
+	}
+
+	return 1;
+}
+
+int bgp_asregex_exec(const struct bgp_asregex *asre,
+		     const struct aspath *aspath)
+{
+	as_t buf[64], *path = buf;
+	struct assegment *seg;
+	unsigned int n = 0;
+	int ret;
+
+	/* Sets and confederations print with punctuation the runs don't
+	 * know about.
+	 */
+	if (aspath->asnotation != ASNOTATION_PLAIN)
+		return -1;
+	for (seg = aspath->segments; seg; seg = seg->next) {
+		if (seg->type != AS_SEQUENCE)
+			return -1;
+		n += seg->length;
+	}
+
+	if (!asre->ngroups)
+		return !(asre->anchor_start && asre->anchor_end) || n == 0;
+
+	if (n > array_size(buf))
+		path = XMALLOC(MTYPE_TMP, n * sizeof(*path));
+
+	n = 0;
+	for (seg = aspath->segments; seg; seg = seg->next) {
+		memcpy(path + n, seg->as, seg->length * sizeof(*path));
+		n += seg->length;
+	}
+
+	ret = asregex_match(asre, path, n);
+
+	if (path != buf)
+		XFREE(MTYPE_TMP, path);
+
+	return ret;
+}
+
+void bgp_asregex_free(struct bgp_asregex *asre)
+{
+	XFREE(MTYPE_BGP_REGEXP, asre);
+}
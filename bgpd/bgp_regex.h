@@ -14,4 +14,17 @@ extern void bgp_regex_free(struct frregex *regex);
 extern struct frregex *bgp_regcomp(const char *str);
 extern int bgp_regexec(struct frregex *regex, struct aspath *aspath);
 
+/* Native matcher for the common shape of as-path regexes - runs of ASNs
+ * separated by `_' or `_.*_', optionally anchored - which walks the
+ * segments rather than the string.
+ */
+struct bgp_asregex;
+
+/* NULL if regstr is not of a shape the native matcher handles */
+extern struct bgp_asregex *bgp_asregex_compile(const char *regstr);
+/* 1 on match, 0 if not, -1 if aspath needs bgp_regexec() after all */
+extern int bgp_asregex_exec(const struct bgp_asregex *asre,
+			    const struct aspath *aspath);
+extern void bgp_asregex_free(struct bgp_asregex *asre);
+
 #endif /* _FRR_BGP_REGEX_H */
@@ -84,6 +84,8 @@
 #include "bgpd/bgp_flowspec.h"
 #include "bgpd/bgp_flowspec_util.h"
 #include "bgpd/bgp_pbr.h"
+#include "bgpd/bgp_parse.h"
+#include "bgpd/bgp_bestpath.h"
 
 #include "bgpd/bgp_route_clippy.c"
 
@@ -102,6 +104,8 @@ static bool bgp_attr_nexthop_same(const struct attr *attr1, const struct attr *a
 	return IPV4_ADDR_SAME(&attr1->nexthop, &attr2->nexthop);
 }
 
+DEFINE_MTYPE_SLAB(BGPD, BGP_ROUTE, "BGP route", sizeof(struct bgp_path_info),
+		  MEMSLAB_MAGAZINE);
 DEFINE_MTYPE_STATIC(BGPD, BGP_EOIU_MARKER_INFO, "BGP EOIU Marker info");
 DEFINE_MTYPE_STATIC(BGPD, BGP_METAQ, "BGP MetaQ");
 /* Memory for batched clearing of peers from the RIB */
@@ -982,7 +986,7 @@ int bgp_path_info_cmp(struct bgp *bgp, struct bgp_path_info *new,
 	struct bgp_path_info *bpi_ultimate;
 	struct peer *peer_new, *peer_exist;
 
-	bgp->bestpath_runs++;
+	atomic_fetch_add_explicit(&bgp->bestpath_runs, 1, memory_order_relaxed);
 
 	*paths_eq = 0;
 
@@ -1955,6 +1959,245 @@ int bgp_path_info_cmp_compatible(struct bgp *bgp, struct bgp_path_info *new,
 	return ret;
 }
 
+static int bgp_path_dkey_sort(const void *a, const void *b)
+{
+	const struct bgp_path_dkey *ka = a, *kb = b;
+
+	if ((uintptr_t)ka->pi < (uintptr_t)kb->pi)
+		return -1;
+	return (uintptr_t)ka->pi > (uintptr_t)kb->pi;
+}
+
+void bgp_path_dkeys_free(struct bgp_path_dkeys *dkeys)
+{
+	if (dkeys->keys != dkeys->stack)
+		XFREE(MTYPE_TMP, dkeys->keys);
+	dkeys->count = 0;
+}
+
+static bool bgp_path_dkey_same(const struct bgp_path_dkey *a,
+			       const struct bgp_path_dkey *b)
+{
+	return a->weight == b->weight && a->local_pref == b->local_pref &&
+	       a->aspath_len == b->aspath_len && a->origin == b->origin &&
+	       a->depth == b->depth && a->flags == b->flags;
+}
+
+void bgp_path_dkeys_build(struct bgp_path_dkeys *dkeys, struct bgp *bgp,
+			  struct bgp_dest *dest, safi_t safi)
+{
+	struct bgp_path_info *pi;
+	struct bgp_path_dkey *key;
+	struct attr *attr;
+	unsigned int count = 0;
+	bool differ = false;
+
+	dkeys->keys = dkeys->stack;
+	dkeys->count = 0;
+
+	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next)
+		count++;
+	if (count < BGP_DKEYS_MIN)
+		return;
+
+	if (count > BGP_DKEYS_STACK)
+		dkeys->keys = XMALLOC(MTYPE_TMP, count * sizeof(*dkeys->keys));
+
+	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next) {
+		key = &dkeys->keys[dkeys->count++];
+		attr = pi->attr;
+
+		memset(key, 0, sizeof(*key));
+		key->pi = pi;
+
+		if (bgp_attr_get_community(attr) &&
+		    community_include(bgp_attr_get_community(attr),
+				      COMMUNITY_LLGR_STALE))
+			SET_FLAG(key->flags, BGP_DKEY_LLGR_STALE);
+
+		/* The EVPN and admin distance steps come before weight */
+		if (safi == SAFI_EVPN ||
+		    (pi->peer == bgp->peer_self &&
+		     pi->sub_type == BGP_ROUTE_REDISTRIBUTE)) {
+			key->depth = BGP_DKEY_DEPTH_LLGR;
+			continue;
+		}
+
+		key->weight = attr->weight;
+		if (bgp_attr_exists(attr, BGP_ATTR_LOCAL_PREF)) {
+			SET_FLAG(key->flags, BGP_DKEY_LOCAL_PREF);
+			key->local_pref = attr->local_pref;
+		}
+
+		/* Then accept-own, for VPN */
+		if (safi == SAFI_MPLS_VPN) {
+			key->depth = BGP_DKEY_DEPTH_LOCAL_PREF;
+			continue;
+		}
+
+		if (!(pi->sub_type == BGP_ROUTE_NORMAL ||
+		      pi->sub_type == BGP_ROUTE_IMPORTED))
+			SET_FLAG(key->flags, BGP_DKEY_LOCAL_ROUTE);
+		if (bgp_attr_exists(attr, BGP_ATTR_AIGP))
+			SET_FLAG(key->flags, BGP_DKEY_AIGP);
+
+		/* Then the source path's attributes, for imported ones */
+		if (pi->sub_type == BGP_ROUTE_IMPORTED) {
+			key->depth = BGP_DKEY_DEPTH_LOCAL_ROUTE;
+			continue;
+		}
+
+		key->aspath_len = aspath_count_hops(attr->aspath);
+		if (CHECK_FLAG(bgp->flags, BGP_FLAG_ASPATH_CONFED))
+			key->aspath_len += aspath_count_confeds(attr->aspath);
+		key->origin = attr->origin;
+		key->depth = BGP_DKEY_DEPTH_ORIGIN;
+	}
+
+	for (unsigned int i = 1; i < dkeys->count && !differ; i++)
+		differ = !bgp_path_dkey_same(&dkeys->keys[0], &dkeys->keys[i]);
+
+	/* Keys that can't tell any two paths apart would only be overhead */
+	if (!differ) {
+		bgp_path_dkeys_free(dkeys);
+		dkeys->keys = dkeys->stack;
+		return;
+	}
+
+	qsort(dkeys->keys, dkeys->count, sizeof(*dkeys->keys),
+	      bgp_path_dkey_sort);
+}
+
+
+static const struct bgp_path_dkey *
+bgp_path_dkey_lookup(const struct bgp_path_dkeys *dkeys,
+		     const struct bgp_path_info *pi)
+{
+	unsigned int lo = 0, hi = dkeys->count;
+
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+		const struct bgp_path_dkey *key = &dkeys->keys[mid];
+
+		if (key->pi == pi)
+			return key;
+		if ((uintptr_t)key->pi < (uintptr_t)pi)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return NULL;
+}
+
+/*
+ * The steps of bgp_path_info_cmp() up to the origin check, on the keys.
+ * Returns -1 if they don't settle it.
+ */
+static int bgp_path_dkey_cmp(struct bgp *bgp, const struct bgp_path_info *new,
+			     const struct bgp_path_dkey *nk,
+			     const struct bgp_path_info *exist,
+			     const struct bgp_path_dkey *ek,
+			     enum bgp_path_selection_reason *reason)
+{
+	uint8_t depth = MIN(nk->depth, ek->depth);
+	uint32_t new_pref, exist_pref;
+	bool new_local, exist_local;
+
+	if (CHECK_FLAG(new->flags, BGP_PATH_UPA) !=
+	    CHECK_FLAG(exist->flags, BGP_PATH_UPA)) {
+		*reason = bgp_path_selection_local_route;
+		return !CHECK_FLAG(new->flags, BGP_PATH_UPA);
+	}
+
+	if (CHECK_FLAG(nk->flags, BGP_DKEY_LLGR_STALE))
+		return 0;
+	if (CHECK_FLAG(ek->flags, BGP_DKEY_LLGR_STALE))
+		return 1;
+
+	if (depth < BGP_DKEY_DEPTH_LOCAL_PREF)
+		return -1;
+
+	if (nk->weight != ek->weight) {
+		*reason = bgp_path_selection_weight;
+		return nk->weight > ek->weight;
+	}
+
+	new_pref = CHECK_FLAG(nk->flags, BGP_DKEY_LOCAL_PREF)
+			   ? nk->local_pref
+			   : bgp->default_local_pref;
+	exist_pref = CHECK_FLAG(ek->flags, BGP_DKEY_LOCAL_PREF)
+			     ? ek->local_pref
+			     : bgp->default_local_pref;
+	if (new_pref != exist_pref) {
+		*reason = bgp_path_selection_local_pref;
+		return new_pref > exist_pref;
+	}
+
+	if (depth < BGP_DKEY_DEPTH_LOCAL_ROUTE)
+		return -1;
+
+	new_local = CHECK_FLAG(nk->flags, BGP_DKEY_LOCAL_ROUTE);
+	exist_local = CHECK_FLAG(ek->flags, BGP_DKEY_LOCAL_ROUTE);
+	if (new_local != exist_local) {
+		*reason = bgp_path_selection_local_route;
+		return new_local;
+	}
+
+	if (CHECK_FLAG(nk->flags, BGP_DKEY_AIGP) &&
+	    CHECK_FLAG(ek->flags, BGP_DKEY_AIGP) &&
+	    CHECK_FLAG(bgp->flags, BGP_FLAG_COMPARE_AIGP))
+		return -1;
+
+	if (depth < BGP_DKEY_DEPTH_ORIGIN)
+		return -1;
+
+	if (!CHECK_FLAG(bgp->flags, BGP_FLAG_ASPATH_IGNORE) &&
+	    nk->aspath_len != ek->aspath_len) {
+		*reason = CHECK_FLAG(bgp->flags, BGP_FLAG_ASPATH_CONFED)
+				  ? bgp_path_selection_confed_as_path
+				  : bgp_path_selection_as_path;
+		return nk->aspath_len < ek->aspath_len;
+	}
+
+	if (nk->origin != ek->origin) {
+		*reason = bgp_path_selection_origin;
+		return nk->origin < ek->origin;
+	}
+
+	return -1;
+}
+
+int bgp_path_info_cmp_keyed(struct bgp *bgp, const struct bgp_path_dkeys *dkeys,
+			    struct bgp_path_info *new,
+			    struct bgp_path_info *exist, int *paths_eq,
+			    struct bgp_maxpaths_cfg *mpath_cfg, bool debug,
+			    char *pfx_buf, afi_t afi, safi_t safi,
+			    enum bgp_path_selection_reason *reason)
+{
+	const struct bgp_path_dkey *nk, *ek;
+	int ret;
+
+	/* The full comparison explains itself when debugging */
+	if (dkeys->count && !debug && new && exist) {
+		nk = bgp_path_dkey_lookup(dkeys, new);
+		ek = bgp_path_dkey_lookup(dkeys, exist);
+
+		if (nk && ek) {
+			ret = bgp_path_dkey_cmp(bgp, new, nk, exist, ek, reason);
+			if (ret >= 0) {
+				atomic_fetch_add_explicit(&bgp->bestpath_runs, 1,
+							  memory_order_relaxed);
+				*paths_eq = 0;
+				return ret;
+			}
+		}
+	}
+
+	return bgp_path_info_cmp(bgp, new, exist, paths_eq, mpath_cfg, debug,
+				 pfx_buf, afi, safi, reason);
+}
+
 static enum filter_type bgp_input_filter(struct peer *peer,
 					 const struct prefix *p,
 					 struct attr *attr, afi_t afi,
@@ -2964,12 +3207,16 @@ bool subgroup_announce_check(struct bgp_dest *dest, struct bgp_path_info *pi,
 
 		SET_FLAG(peer->rmap_type, PEER_RMAP_TYPE_OUT);
 
+		/* Before the route-map, attr only differs from piattr in
+		 * ways that depend on the subgroup, so piattr can key the
+		 * memo of subgroup_announce_table().
+		 */
 		if (bgp_path_suppressed(pi))
-			ret = route_map_apply(UNSUPPRESS_MAP(filter), p,
-					      &rmap_path);
+			ret = route_map_apply_memo(UNSUPPRESS_MAP(filter), p,
+						   &rmap_path, piattr);
 		else
-			ret = route_map_apply(ROUTE_MAP_OUT(filter), p,
-					      &rmap_path);
+			ret = route_map_apply_memo(ROUTE_MAP_OUT(filter), p,
+						   &rmap_path, piattr);
 
 		bgp_attr_flush(&dummy_attr);
 		peer->rmap_type = 0;
@@ -3459,31 +3706,35 @@ static void bgp_route_select_timer_expire(struct event *event)
 	bgp_do_deferred_path_selection(bgp, afi, safi);
 }
 
-void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
-			struct bgp_maxpaths_cfg *mpath_cfg,
-			struct bgp_path_info_pair *result, afi_t afi,
-			safi_t safi)
+/*
+ * First half of best path selection: apply deterministic-med and move the
+ * unsorted paths of dest into their place in the list.  Returns the new
+ * best path and sets *old_select to the previous one.  A non-NULL
+ * *old_select on entry is taken as the previous best path, for a dest that
+ * was already sorted by bgp_best_selection_presort() and had paths changed
+ * since.
+ *
+ * Apart from reaping REMOVED paths this only touches dest and its paths.
+ */
+static struct bgp_path_info *
+bgp_best_selection_sort(struct bgp *bgp, struct bgp_dest *dest,
+			struct bgp_maxpaths_cfg *mpath_cfg, afi_t afi,
+			safi_t safi, bool debug, char *pfx_buf,
+			struct bgp_path_info **old_selectp)
 {
 	struct bgp_path_info *new_select, *look_thru;
 	struct bgp_path_info *old_select, *worse, *first;
 	struct bgp_path_info *pi;
 	struct bgp_path_info *pi1;
 	struct bgp_path_info *pi2;
-	int paths_eq, do_mpath;
-	bool debug, any_comparisons;
-	char pfx_buf[PREFIX2STR_BUFFER + VRF_NAMSIZ + 2] = {};
+	int paths_eq;
+	bool any_comparisons;
 	char path_buf[PATH_ADDPATH_STR_BUFFER];
 	enum bgp_path_selection_reason reason = bgp_path_selection_none;
 	bool unsorted_items = true;
-	uint32_t num_candidates = 0;
-
-	do_mpath =
-		(mpath_cfg->maxpaths_ebgp > 1 || mpath_cfg->maxpaths_ibgp > 1);
-
-	debug = bgp_debug_bestpath(dest);
+	struct bgp_path_dkeys dkeys;
 
-	if (debug)
-		snprintfrr(pfx_buf, sizeof(pfx_buf), "%pBD(%s)", dest, bgp->name_pretty);
+	bgp_path_dkeys_build(&dkeys, bgp, dest, safi);
 
 	/* bgp deterministic-med */
 	new_select = NULL;
@@ -3527,10 +3778,12 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 							    pi2->attr->aspath))
 					continue;
 
-				if (bgp_path_info_cmp(bgp, pi2, new_select,
-						      &paths_eq, mpath_cfg,
-						      debug, pfx_buf, afi, safi,
-						      &dest->reason)) {
+				if (bgp_path_info_cmp_keyed(bgp, &dkeys, pi2,
+							    new_select,
+							    &paths_eq,
+							    mpath_cfg, debug,
+							    pfx_buf, afi, safi,
+							    &dest->reason)) {
 					bgp_path_info_unset_flag(dest,
 								 new_select,
 								 BGP_PATH_DMED_SELECTED);
@@ -3564,7 +3817,7 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 	struct bgp_path_info *unsorted_list_spot = NULL;
 	struct bgp_path_info *unsorted_holddown = NULL;
 
-	old_select = NULL;
+	old_select = *old_selectp;
 	pi = bgp_dest_get_bgp_path_info(dest);
 	while (pi && (CHECK_FLAG(pi->flags, BGP_PATH_UNSORTED) ||
 		      (pi->peer != bgp->peer_self &&
@@ -3746,9 +3999,10 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 						 BGP_PATH_DMED_CHECK);
 			reason = dest->reason;
 			any_comparisons = true;
-			if (bgp_path_info_cmp(bgp, first, look_thru, &paths_eq,
-					      mpath_cfg, debug, pfx_buf, afi,
-					      safi, &reason)) {
+			if (bgp_path_info_cmp_keyed(bgp, &dkeys, first,
+						    look_thru, &paths_eq,
+						    mpath_cfg, debug, pfx_buf,
+						    afi, safi, &reason)) {
 				first->reason = reason;
 				worse = look_thru;
 				/*
@@ -3846,6 +4100,33 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 			bgp_dest_set_bgp_path_info(dest, unsorted_holddown);
 	}
 
+	bgp_path_dkeys_free(&dkeys);
+
+	*old_selectp = old_select;
+	return new_select;
+}
+
+/*
+ * Second half of best path selection: work out the multipaths of
+ * new_select and update the multipath and addpath state of dest.
+ */
+static void bgp_best_selection_finish(struct bgp *bgp, struct bgp_dest *dest,
+				      struct bgp_maxpaths_cfg *mpath_cfg,
+				      struct bgp_path_info *new_select,
+				      struct bgp_path_info *old_select,
+				      struct bgp_path_info_pair *result,
+				      afi_t afi, safi_t safi, bool debug,
+				      char *pfx_buf)
+{
+	struct bgp_path_info *pi;
+	int paths_eq, do_mpath;
+	char path_buf[PATH_ADDPATH_STR_BUFFER];
+	enum bgp_path_selection_reason reason = bgp_path_selection_none;
+	uint32_t num_candidates = 0;
+
+	do_mpath =
+		(mpath_cfg->maxpaths_ebgp > 1 || mpath_cfg->maxpaths_ibgp > 1);
+
 	/* Now that we know which path is the bestpath see if any of the other
 	 * paths
 	 * qualify as multipaths
@@ -3869,6 +4150,9 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 
 	if (do_mpath && new_select) {
 		bool first_reason = true;
+		struct bgp_path_dkeys dkeys;
+
+		bgp_path_dkeys_build(&dkeys, bgp, dest, safi);
 
 		for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next) {
 			if (debug)
@@ -3888,8 +4172,9 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 					continue;
 
 			reason = dest->reason;
-			bgp_path_info_cmp(bgp, pi, new_select, &paths_eq, mpath_cfg, debug,
-					  pfx_buf, afi, safi, &reason);
+			bgp_path_info_cmp_keyed(bgp, &dkeys, pi, new_select,
+						&paths_eq, mpath_cfg, debug,
+						pfx_buf, afi, safi, &reason);
 
 			if (!paths_eq && first_reason) {
 				dest->reason = reason;
@@ -3906,6 +4191,8 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 				num_candidates++;
 			}
 		}
+
+		bgp_path_dkeys_free(&dkeys);
 	}
 
 	bgp_path_info_mpath_update(bgp, dest, new_select, old_select, num_candidates, mpath_cfg);
@@ -3915,8 +4202,129 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 
 	result->old = old_select;
 	result->new = new_select;
+}
 
-	return;
+void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
+			struct bgp_maxpaths_cfg *mpath_cfg,
+			struct bgp_path_info_pair *result, afi_t afi,
+			safi_t safi)
+{
+	struct bgp_path_info *new_select, *old_select = NULL;
+	char pfx_buf[PREFIX2STR_BUFFER + VRF_NAMSIZ + 2] = {};
+	bool debug;
+
+	debug = bgp_debug_bestpath(dest);
+
+	if (debug)
+		snprintfrr(pfx_buf, sizeof(pfx_buf), "%pBD(%s)", dest, bgp->name_pretty);
+
+	new_select = bgp_best_selection_sort(bgp, dest, mpath_cfg, afi, safi,
+					     debug, pfx_buf, &old_select);
+	bgp_best_selection_finish(bgp, dest, mpath_cfg, new_select, old_select,
+				  result, afi, safi, debug, pfx_buf);
+}
+
+bool bgp_best_selection_presortable(struct bgp_dest *dest)
+{
+	struct bgp_table *table = bgp_dest_table(dest);
+	struct bgp_path_info *pi = bgp_dest_get_bgp_path_info(dest);
+
+	/* Nothing to sort */
+	if (!pi || !CHECK_FLAG(pi->flags, BGP_PATH_UNSORTED))
+		return false;
+
+	/* bgp_process_main_one() would return before selecting */
+	if (CHECK_FLAG(dest->flags, BGP_NODE_SELECT_DEFER) ||
+	    BGP_INSTANCE_HIDDEN_DELETE_IN_PROGRESS(table->bgp, table->afi,
+						   table->safi))
+		return false;
+
+	/* EVPN has its own selection hooks that reap paths */
+	if (table->safi == SAFI_EVPN)
+		return false;
+
+	for (; pi; pi = pi->next) {
+		/* Reaping frees the path and drops peer and attribute
+		 * references, which must happen on the main pthread.
+		 */
+		if (CHECK_FLAG(pi->flags, BGP_PATH_REMOVED))
+			return false;
+
+		/* Comparing against a locally originated path may look up
+		 * its admin distance with bgp_distance_apply(), which locks
+		 * nodes of tables shared by all dests.
+		 */
+		if (pi->peer == table->bgp->peer_self)
+			return false;
+	}
+
+	return true;
+}
+
+void bgp_best_selection_presort(struct bgp_bestpath_job *job)
+{
+	struct bgp_dest *dest = job->dest;
+	struct bgp_table *table = bgp_dest_table(dest);
+	struct bgp *bgp = table->bgp;
+	char pfx_buf[PREFIX2STR_BUFFER + VRF_NAMSIZ + 2] = {};
+	bool debug;
+
+	debug = bgp_debug_bestpath(dest);
+
+	if (debug)
+		snprintfrr(pfx_buf, sizeof(pfx_buf), "%pBD(%s)", dest, bgp->name_pretty);
+
+	job->result.old = NULL;
+	job->result.new = bgp_best_selection_sort(bgp, dest,
+						  &bgp->maxpaths[table->afi][table->safi],
+						  table->afi, table->safi,
+						  debug, pfx_buf,
+						  &job->result.old);
+	job->sorted = true;
+}
+
+/*
+ * bgp_best_selection() for a dest that may have been sorted already by
+ * bgp_best_selection_presort().  If paths were changed after the presort
+ * they are sorted in now, keeping the previous best path found then.
+ */
+static void bgp_best_selection_job(struct bgp *bgp, struct bgp_dest *dest,
+				   struct bgp_maxpaths_cfg *mpath_cfg,
+				   struct bgp_path_info_pair *result,
+				   afi_t afi, safi_t safi,
+				   const struct bgp_bestpath_job *job)
+{
+	struct bgp_path_info *new_select, *old_select;
+	struct bgp_path_info *first;
+	char pfx_buf[PREFIX2STR_BUFFER + VRF_NAMSIZ + 2] = {};
+	bool debug;
+
+	if (!job || !job->sorted) {
+		bgp_best_selection(bgp, dest, mpath_cfg, result, afi, safi);
+		return;
+	}
+
+	debug = bgp_debug_bestpath(dest);
+
+	if (debug)
+		snprintfrr(pfx_buf, sizeof(pfx_buf), "%pBD(%s)", dest, bgp->name_pretty);
+
+	old_select = job->result.old;
+	new_select = job->result.new;
+
+	first = bgp_dest_get_bgp_path_info(dest);
+	if (first && CHECK_FLAG(first->flags, BGP_PATH_UNSORTED)) {
+		if (debug)
+			zlog_debug("%s: %pBD(%s) changed after presort", __func__,
+				   dest, bgp->name_pretty);
+
+		new_select = bgp_best_selection_sort(bgp, dest, mpath_cfg, afi,
+						     safi, debug, pfx_buf,
+						     &old_select);
+	}
+
+	bgp_best_selection_finish(bgp, dest, mpath_cfg, new_select, old_select,
+				  result, afi, safi, debug, pfx_buf);
 }
 
 /*
@@ -4273,7 +4681,13 @@ bgp_mplsvpn_handle_label_allocation(struct bgp *bgp, struct bgp_dest *dest,
  *     We have no eligible route that we can announce or the rn
  *     is being removed.
  */
-void bgp_process_main_one(struct bgp *bgp, struct bgp_dest *dest, afi_t afi, safi_t safi)
+/*
+ * Process a dest from the meta queue.  job, if not NULL, carries the result
+ * of bgp_best_selection_presort() for dest.
+ */
+static void bgp_process_main_job(struct bgp *bgp, struct bgp_dest *dest,
+				 afi_t afi, safi_t safi,
+				 const struct bgp_bestpath_job *job)
 {
 	struct bgp_path_info *new_select;
 	struct bgp_path_info *old_select;
@@ -4348,8 +4762,8 @@ void bgp_process_main_one(struct bgp *bgp, struct bgp_dest *dest, afi_t afi, saf
 	}
 
 	/* Best path selection. */
-	bgp_best_selection(bgp, dest, &bgp->maxpaths[afi][safi], &old_and_new,
-			   afi, safi);
+	bgp_best_selection_job(bgp, dest, &bgp->maxpaths[afi][safi],
+			       &old_and_new, afi, safi, job);
 	old_select = old_and_new.old;
 	new_select = old_and_new.new;
 
@@ -4566,6 +4980,11 @@ void bgp_process_main_one(struct bgp *bgp, struct bgp_dest *dest, afi_t afi, saf
 	return;
 }
 
+void bgp_process_main_one(struct bgp *bgp, struct bgp_dest *dest, afi_t afi, safi_t safi)
+{
+	bgp_process_main_job(bgp, dest, afi, safi, NULL);
+}
+
 void bgp_process_gr_deferral_complete(struct bgp *bgp, afi_t afi, safi_t safi)
 {
 	bool route_sync_pending = false;
@@ -5006,7 +5425,8 @@ static const char *subqueue2str(enum meta_queue_indexes index)
 /*
  * Process a node from the Early route subqueue.
  */
-static void process_subq_early_route(struct bgp_dest *dest)
+static void process_subq_early_route(struct bgp_dest *dest,
+				     const struct bgp_bestpath_job *job)
 {
 	struct bgp_table *table = bgp_dest_table(dest);
 
@@ -5018,7 +5438,7 @@ static void process_subq_early_route(struct bgp_dest *dest)
 	}
 
 	/* note, new DESTs may be added as part of processing */
-	bgp_process_main_one(table->bgp, dest, table->afi, table->safi);
+	bgp_process_main_job(table->bgp, dest, table->afi, table->safi, job);
 	bgp_dest_unlock_node(dest);
 	bgp_table_unlock(table);
 }
@@ -5026,7 +5446,8 @@ static void process_subq_early_route(struct bgp_dest *dest)
 /*
  * Process a node from the other subqueue.
  */
-static void process_subq_other_route(struct bgp_dest *dest)
+static void process_subq_other_route(struct bgp_dest *dest,
+				     const struct bgp_bestpath_job *job)
 {
 	struct bgp_table *table = bgp_dest_table(dest);
 
@@ -5038,7 +5459,7 @@ static void process_subq_other_route(struct bgp_dest *dest)
 	}
 
 	/* note, new DESTs may be added as part of processing */
-	bgp_process_main_one(table->bgp, dest, table->afi, table->safi);
+	bgp_process_main_job(table->bgp, dest, table->afi, table->safi, job);
 	bgp_dest_unlock_node(dest);
 	bgp_table_unlock(table);
 }
@@ -5082,10 +5503,10 @@ static unsigned int process_subq(struct bgp_dest_queue *subq, enum meta_queue_in
 
 	switch (qindex) {
 	case META_QUEUE_EARLY_ROUTE:
-		process_subq_early_route(dest);
+		process_subq_early_route(dest, NULL);
 		break;
 	case META_QUEUE_OTHER_ROUTE:
-		process_subq_other_route(dest);
+		process_subq_other_route(dest, NULL);
 		break;
 	case META_QUEUE_EOIU_MARKER:
 		process_eoiu_marker(dest);
@@ -5094,6 +5515,44 @@ static unsigned int process_subq(struct bgp_dest_queue *subq, enum meta_queue_in
 	return 1;
 }
 
+/*
+ * Take up to BGP_BESTPATH_BATCH nodes off a route subqueue, have the best
+ * path pthreads sort their paths and then process them in queue order on
+ * this pthread.  Return the number of nodes processed.
+ */
+static unsigned int process_subq_batch(struct bgp_dest_queue *subq,
+				       enum meta_queue_indexes qindex)
+{
+	struct bgp_bestpath_job jobs[BGP_BESTPATH_BATCH];
+	unsigned int count = 0, presort = 0;
+	struct bgp_dest *dest;
+
+	while (count < BGP_BESTPATH_BATCH && (dest = STAILQ_FIRST(subq))) {
+		STAILQ_REMOVE_HEAD(subq, pq);
+		STAILQ_NEXT(dest, pq) = NULL; /* complete unlink */
+
+		jobs[count].dest = dest;
+		jobs[count].presort = bgp_best_selection_presortable(dest);
+		jobs[count].sorted = false;
+		if (jobs[count].presort)
+			presort++;
+		count++;
+	}
+
+	/* Not worth waking anyone up for a single node */
+	if (presort > 1)
+		bgp_bestpath_run(jobs, count);
+
+	for (unsigned int i = 0; i < count; i++) {
+		if (qindex == META_QUEUE_EARLY_ROUTE)
+			process_subq_early_route(jobs[i].dest, &jobs[i]);
+		else
+			process_subq_other_route(jobs[i].dest, &jobs[i]);
+	}
+
+	return count;
+}
+
 /* Dispatch the meta queue by picking and processing the next node from
  * a non-empty sub-queue with lowest priority. wq is equal to bgp->process_queue and
  * data is pointed to the meta queue structure.
@@ -5120,11 +5579,22 @@ static wq_item_status meta_queue_process(struct work_queue *dummy, void *data)
 	if (peers_on_fifo > 10 && total_runs % 10 != 0)
 		return WQ_QUEUE_BLOCKED;
 
-	for (i = 0; i < MQ_SIZE; i++)
+	for (i = 0; i < MQ_SIZE; i++) {
+		if (bm->bestpath_threads && i != META_QUEUE_EOIU_MARKER) {
+			unsigned int count = process_subq_batch(mq->subq[i], i);
+
+			if (count) {
+				mq->size -= count;
+				break;
+			}
+			continue;
+		}
+
 		if (process_subq(mq->subq[i], i)) {
 			mq->size--;
 			break;
 		}
+	}
 
 	return mq->size ? WQ_REQUEUE : WQ_SUCCESS;
 }
@@ -8558,6 +9028,48 @@ bool bgp_addpath_encode_rx(struct peer *peer, afi_t afi, safi_t safi)
 			      PEER_CAP_ADDPATH_AF_TX_RCV));
 }
 
+/* Semantic check of an IPv4/IPv6 NLRI prefix, false if it is ignored. */
+static bool bgp_nlri_ip_prefix_check(struct peer *peer, afi_t afi, safi_t safi,
+				     const struct prefix *p)
+{
+	/* Check address. */
+	if (afi == AFI_IP && safi == SAFI_UNICAST) {
+		if (IN_CLASSD(ntohl(p->u.prefix4.s_addr))) {
+			/* From RFC4271 Section 6.3:
+			 *
+			 * If a prefix in the NLRI field is semantically
+			 * incorrect
+			 * (e.g., an unexpected multicast IP address),
+			 * an error SHOULD
+			 * be logged locally, and the prefix SHOULD be
+			 * ignored.
+			 */
+			flog_err(EC_BGP_UPDATE_RCV,
+				 "%s: IPv4 unicast NLRI is multicast address %pI4, ignoring",
+				 peer->host, &p->u.prefix4);
+			return false;
+		}
+	}
+
+	/* Check address. */
+	if (afi == AFI_IP6 && safi == SAFI_UNICAST) {
+		if (IN6_IS_ADDR_LINKLOCAL(&p->u.prefix6)) {
+			flog_err(EC_BGP_UPDATE_RCV,
+				 "%s: IPv6 unicast NLRI is link-local address %pI6, ignoring",
+				 peer->host, &p->u.prefix6);
+			return false;
+		}
+		if (IN6_IS_ADDR_MULTICAST(&p->u.prefix6)) {
+			flog_err(EC_BGP_UPDATE_RCV,
+				 "%s: IPv6 unicast NLRI is multicast address %pI6, ignoring",
+				 peer->host, &p->u.prefix6);
+			return false;
+		}
+	}
+
+	return true;
+}
+
 /* Parse NLRI stream.  Withdraw NLRI is recognized by NULL attr
    value. */
 int bgp_nlri_parse_ip(struct peer *peer, struct attr *attr,
@@ -8642,45 +9154,8 @@ int bgp_nlri_parse_ip(struct peer *peer, struct attr *attr,
 		/* Fetch prefix from NLRI packet. */
 		memcpy(p.u.val, pnt, psize);
 
-		/* Check address. */
-		if (afi == AFI_IP && safi == SAFI_UNICAST) {
-			if (IN_CLASSD(ntohl(p.u.prefix4.s_addr))) {
-				/* From RFC4271 Section 6.3:
-				 *
-				 * If a prefix in the NLRI field is semantically
-				 * incorrect
-				 * (e.g., an unexpected multicast IP address),
-				 * an error SHOULD
-				 * be logged locally, and the prefix SHOULD be
-				 * ignored.
-				 */
-				flog_err(
-					EC_BGP_UPDATE_RCV,
-					"%s: IPv4 unicast NLRI is multicast address %pI4, ignoring",
-					peer->host, &p.u.prefix4);
-				continue;
-			}
-		}
-
-		/* Check address. */
-		if (afi == AFI_IP6 && safi == SAFI_UNICAST) {
-			if (IN6_IS_ADDR_LINKLOCAL(&p.u.prefix6)) {
-				flog_err(
-					EC_BGP_UPDATE_RCV,
-					"%s: IPv6 unicast NLRI is link-local address %pI6, ignoring",
-					peer->host, &p.u.prefix6);
-
-				continue;
-			}
-			if (IN6_IS_ADDR_MULTICAST(&p.u.prefix6)) {
-				flog_err(
-					EC_BGP_UPDATE_RCV,
-					"%s: IPv6 unicast NLRI is multicast address %pI6, ignoring",
-					peer->host, &p.u.prefix6);
-
-				continue;
-			}
-		}
+		if (!bgp_nlri_ip_prefix_check(peer, afi, safi, &p))
+			continue;
 
 		/* Normal process. */
 		if (attr)
@@ -8714,6 +9189,47 @@ int bgp_nlri_parse_ip(struct peer *peer, struct attr *attr,
 	return BGP_NLRI_PARSE_OK;
 }
 
+/*
+ * Counterpart of bgp_nlri_parse_ip() for NLRI that has already been
+ * decoded by the UPDATE parser pool.  Withdraw is signalled by NULL attr.
+ */
+int bgp_nlri_apply_ip(struct peer *peer, struct attr *attr,
+		      const struct bgp_nlri_decoded *dec)
+{
+	const struct bgp_nlri_prefix *np;
+
+	/* cache the incoming attr to avoid repeated intern */
+	if (attr) {
+		memset(&attr->attr_intern_reuse, 0, sizeof(attr->attr_intern_reuse));
+		attr->attr_intern_reuse.parsed_attr = attr;
+	}
+
+	for (np = dec->prefixes; np < dec->prefixes + dec->count; np++) {
+		if (!bgp_nlri_ip_prefix_check(peer, dec->afi, dec->safi, &np->p))
+			continue;
+
+		if (attr)
+			bgp_update(peer, &np->p, np->addpath_id, attr, dec->afi,
+				   dec->safi, ZEBRA_ROUTE_BGP, BGP_ROUTE_NORMAL,
+				   NULL, NULL, 0, 0, NULL, NULL);
+		else
+			bgp_withdraw(peer, &np->p, np->addpath_id, dec->afi,
+				     dec->safi, ZEBRA_ROUTE_BGP,
+				     BGP_ROUTE_NORMAL, NULL, NULL, 0);
+
+		/* Do not send BGP notification twice when maximum-prefix count
+		 * overflow. */
+		if (CHECK_FLAG(peer->sflags, PEER_STATUS_PREFIX_OVERFLOW))
+			return BGP_NLRI_PARSE_ERROR_PREFIX_OVERFLOW;
+	}
+
+	/* Reset the attr_intern_reuse cache */
+	if (attr)
+		memset(&attr->attr_intern_reuse, 0, sizeof(attr->attr_intern_reuse));
+
+	return BGP_NLRI_PARSE_OK;
+}
+
 static void bgp_nexthop_reachability_check(afi_t afi, safi_t safi,
 					   struct bgp_path_info *bpi,
 					   const struct prefix *p,
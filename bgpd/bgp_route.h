@@ -413,6 +413,58 @@ struct bgp_path_info_pair {
 	struct bgp_path_info *new;
 };
 
+/* The leading best path criteria of a path, gathered from its attr once
+ * per selection so that comparisons they decide don't have to chase it.
+ * They stop at origin: MED depends on the neighbour AS and the med
+ * options, and the IGP metric and router-id steps on nexthop and peer
+ * state, so paths that tie on the keys go through bgp_path_info_cmp().
+ */
+struct bgp_path_dkey {
+	const struct bgp_path_info *pi;
+
+	uint32_t weight;
+	uint32_t local_pref;
+	uint32_t aspath_len;
+	uint8_t origin;
+
+	/* How far bgp_path_info_cmp() can be followed on the key alone */
+	uint8_t depth;
+#define BGP_DKEY_DEPTH_LLGR 0
+#define BGP_DKEY_DEPTH_LOCAL_PREF 1
+#define BGP_DKEY_DEPTH_LOCAL_ROUTE 2
+#define BGP_DKEY_DEPTH_ORIGIN 3
+
+	uint8_t flags;
+#define BGP_DKEY_LLGR_STALE (1 << 0)
+#define BGP_DKEY_LOCAL_PREF (1 << 1)
+#define BGP_DKEY_LOCAL_ROUTE (1 << 2)
+#define BGP_DKEY_AIGP (1 << 3)
+};
+
+/* Paths of a dest below this are compared without keys */
+#define BGP_DKEYS_MIN 4U
+#define BGP_DKEYS_STACK 32U
+
+/* Decision keys of the paths of one dest, sorted by path */
+struct bgp_path_dkeys {
+	struct bgp_path_dkey *keys;
+	unsigned int count;
+
+	struct bgp_path_dkey stack[BGP_DKEYS_STACK];
+};
+
+/* A meta queue node whose paths may be sorted off the main pthread */
+struct bgp_bestpath_job {
+	struct bgp_dest *dest;
+
+	/* Set on the main pthread, see bgp_best_selection_presortable() */
+	bool presort;
+
+	/* Set by bgp_best_selection_presort() */
+	bool sorted;
+	struct bgp_path_info_pair result;
+};
+
 /* BGP static route configuration. */
 struct bgp_static {
 	/* Backdoor configuration.  */
@@ -915,6 +967,9 @@ extern bool bgp_path_info_labels_same(const struct bgp_path_info *bpi,
 				      const mpls_label_t *label, uint32_t n);
 
 extern int bgp_nlri_parse_ip(struct peer *peer, struct attr *attr, struct bgp_nlri *packet);
+struct bgp_nlri_decoded;
+extern int bgp_nlri_apply_ip(struct peer *peer, struct attr *attr,
+			     const struct bgp_nlri_decoded *dec);
 
 extern bool bgp_maximum_prefix_overflow(struct peer *peer, afi_t afi, safi_t safi, int always);
 
@@ -1060,6 +1115,13 @@ extern void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 			       struct bgp_maxpaths_cfg *mpath_cfg,
 			       struct bgp_path_info_pair *result, afi_t afi,
 			       safi_t safi);
+/*
+ * Whether the paths of dest can be sorted by bgp_best_selection_presort()
+ * off the main pthread.  The rest of best path selection is done when the
+ * node is processed from the meta queue.
+ */
+extern bool bgp_best_selection_presortable(struct bgp_dest *dest);
+extern void bgp_best_selection_presort(struct bgp_bestpath_job *job);
 extern void bgp_zebra_clear_route_change_flags(struct bgp_dest *dest);
 extern bool bgp_zebra_has_route_changed(struct bgp_path_info *selected);
 
@@ -1123,6 +1185,29 @@ extern int bgp_path_info_cmp(struct bgp *bgp, struct bgp_path_info *new,
 			     struct bgp_maxpaths_cfg *mpath_cfg, bool debug,
 			     char *pfx_buf, afi_t afi, safi_t safi,
 			     enum bgp_path_selection_reason *reason);
+
+/*
+ * Gather the decision keys of the paths of dest, if it has enough of them
+ * to be worth it.  They are only good while the paths' attrs stay as they
+ * are, i.e. for the duration of one selection.
+ */
+extern void bgp_path_dkeys_build(struct bgp_path_dkeys *dkeys,
+				 struct bgp *bgp, struct bgp_dest *dest,
+				 safi_t safi);
+extern void bgp_path_dkeys_free(struct bgp_path_dkeys *dkeys);
+
+/*
+ * bgp_path_info_cmp(), settled on the decision keys of new and exist if
+ * they are enough to tell them apart.
+ */
+extern int bgp_path_info_cmp_keyed(struct bgp *bgp,
+				   const struct bgp_path_dkeys *dkeys,
+				   struct bgp_path_info *new,
+				   struct bgp_path_info *exist, int *paths_eq,
+				   struct bgp_maxpaths_cfg *mpath_cfg,
+				   bool debug, char *pfx_buf, afi_t afi,
+				   safi_t safi,
+				   enum bgp_path_selection_reason *reason);
 #define bgp_path_info_add(A, B)                                                \
 	bgp_path_info_add_with_caller(__func__, (A), (B))
 #define bgp_path_info_free(B) bgp_path_info_free_with_caller(__func__, (B))
@@ -1764,7 +1764,9 @@ static const struct route_map_rule_cmd route_match_aspath_cmd = {
 	"as-path",
 	route_match_aspath,
 	route_match_aspath_compile,
-	route_match_aspath_free
+	route_match_aspath_free,
+	NULL,
+	true
 };
 
 /* `match as-path-count' */
@@ -1922,7 +1924,8 @@ static const struct route_map_rule_cmd route_match_community_cmd = {
 	route_match_community,
 	route_match_community_compile,
 	route_match_community_free,
-	route_match_get_community_key
+	route_match_get_community_key,
+	true
 };
 
 /* Match function for lcommunity match. */
@@ -2003,7 +2006,8 @@ static const struct route_map_rule_cmd route_match_lcommunity_cmd = {
 	route_match_lcommunity,
 	route_match_lcommunity_compile,
 	route_match_lcommunity_free,
-	route_match_get_community_key
+	route_match_get_community_key,
+	true
 };
 
 
@@ -2081,7 +2085,9 @@ static const struct route_map_rule_cmd route_match_ecommunity_cmd = {
 	"extcommunity",
 	route_match_ecommunity,
 	route_match_ecommunity_compile,
-	route_match_ecommunity_free
+	route_match_ecommunity_free,
+	NULL,
+	true
 };
 
 /* `match nlri` and `set nlri` are replaced by `address-family ipv4`
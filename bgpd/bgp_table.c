@@ -21,6 +21,9 @@
 #include "bgp_ls.h"
 #include "bgp_srv6.h"
 
+DEFINE_MTYPE_SLAB(BGPD, BGP_NODE, "BGP node", sizeof(struct bgp_dest),
+		  MEMSLAB_MAGAZINE);
+
 void bgp_table_lock(struct bgp_table *rt)
 {
 	rt->lock++;
@@ -1202,6 +1202,7 @@ static void update_subgroup_delete(struct update_subgroup *subgrp)
 	event_cancel(&subgrp->t_merge_check);
 	event_cancel(&subgrp->t_coalesce);
 
+	subgroup_build_unqueue(subgrp);
 	bpacket_queue_cleanup(SUBGRP_PKTQ(subgrp));
 	subgroup_clear_table(subgrp);
 
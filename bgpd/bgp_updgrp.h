@@ -107,6 +107,12 @@ struct bpacket_queue {
 	unsigned int max_count_reached_count;
 };
 
+/* Subgroups with advertisements waiting, see subgroup_build_packets() */
+PREDECL_DLIST(subgrp_build);
+
+/* Upper bound for "bgp update-format-threads" */
+#define BGP_FORMAT_THREADS_MAX 64U
+
 struct update_group {
 	/* back pointer to the BGP instance */
 	struct bgp *bgp;
@@ -193,6 +199,9 @@ struct update_subgroup {
 	/* synchronization list and time */
 	struct bgp_synchronize *sync;
 
+	/* item on the list of subgroups with advertisements waiting */
+	struct subgrp_build_item build;
+
 	/* send prefix count */
 	uint32_t scount;
 
@@ -413,6 +422,10 @@ extern void subgroup_default_update_packet(struct update_subgroup *subgrp,
 					   struct attr *attr,
 					   struct peer *from);
 extern void subgroup_default_withdraw_packet(struct update_subgroup *subgrp);
+extern void subgroup_build_queue(struct update_subgroup *subgrp);
+extern void subgroup_build_unqueue(struct update_subgroup *subgrp);
+extern void subgroup_build_packets(struct peer *peer);
+extern void bgp_format_threads_set(unsigned int count);
 
 /* bgp_updgrp_adv.c */
 extern struct bgp_advertise *
@@ -694,6 +694,7 @@ bool bgp_adj_out_set_subgroup(struct bgp_dest *dest,
 	}
 
 	bgp_adv_fifo_add_tail(&subgrp->sync->update, adv);
+	subgroup_build_queue(subgrp);
 
 	subgrp->version = MAX(subgrp->version, dest->version);
 
@@ -747,6 +748,7 @@ void bgp_adj_out_unset_subgroup(struct bgp_dest *dest, struct update_subgroup *s
 			/* Add to synchronization entry for withdraw
 			 * announcement.  */
 			bgp_adv_fifo_add_tail(&subgrp->sync->withdraw, adv);
+			subgroup_build_queue(subgrp);
 
 			if (BGP_DEBUG(update, UPDATE_OUT)) {
 				peer = SUBGRP_PEER(subgrp);
@@ -826,6 +828,9 @@ void subgroup_announce_table(struct update_subgroup *subgrp,
 	subgrp->pscount = 0;
 	SET_FLAG(subgrp->sflags, SUBGRP_STATUS_TABLE_REPARSING);
 
+	/* Paths sharing attributes share the outbound match results */
+	route_map_memo_start();
+
 	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest)) {
 
 		if (addpath_capable)
@@ -856,6 +861,7 @@ void subgroup_announce_table(struct update_subgroup *subgrp,
 						&ri->tx_addpath));
 		}
 	}
+	route_map_memo_stop();
 	UNSET_FLAG(subgrp->sflags, SUBGRP_STATUS_TABLE_REPARSING);
 
 	/*
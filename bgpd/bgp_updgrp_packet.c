@@ -28,6 +28,7 @@
 #include "hash.h"
 #include "queue.h"
 #include "mpls.h"
+#include "frr_workers.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_debug.h"
@@ -45,6 +46,58 @@
 #include "bgpd/bgp_trace.h"
 #include "bgpd/bgp_ls_nlri.h"
 
+DEFINE_MTYPE_STATIC(BGPD, BGP_SUBGRP_BUILD, "BGP subgroup packet build");
+
+/*
+ * One UPDATE encoded from a subgroup's update or withdraw FIFO.  Encoding
+ * only reads the advertisements, so it can be done for many subgroups at
+ * once; the commit step then consumes them and queues the packet.
+ */
+struct bpacket_enc {
+	struct stream *packet;
+	struct bpacket_attr_vec_arr vecarr;
+
+	/* advertisements, from the head of the FIFO, that are in packet */
+	unsigned int nadv;
+
+	/* advertisement encoding stopped at */
+	struct bgp_advertise *next;
+
+	enum bpacket_enc_stop {
+		/* packet is full or the FIFO is done */
+		BPACKET_ENC_DONE,
+		/* next cannot be encoded and has to be cleaned up */
+		BPACKET_ENC_DROP_ADV,
+		/* next cannot be encoded and its adj-out has to go */
+		BPACKET_ENC_DROP_ADJ,
+		/* attributes too long, the whole update FIFO has to go */
+		BPACKET_ENC_FLUSH,
+	} stop;
+};
+
+/* Packets formatted for one subgroup per subgroup_build_packets() run */
+#define SUBGRP_BUILD_PKTS_MAX 8
+
+struct subgroup_build_job {
+	struct update_subgroup *subgrp;
+
+	/* free space in the subgroup's packet queue */
+	unsigned int max;
+
+	unsigned int count;
+	unsigned int nwithdraw;
+	struct bpacket_enc enc[SUBGRP_BUILD_PKTS_MAX];
+};
+
+DECLARE_DLIST(subgrp_build, struct update_subgroup, build);
+
+static struct subgrp_build_head subgrp_build_list[1] = {
+	INIT_DLIST(subgrp_build_list[0]),
+};
+
+static struct frr_workers subgrp_build_workers =
+	FRR_WORKERS_INIT("BGP update format thread", "bgpd_fmt");
+
 /********************
  * PRIVATE FUNCTIONS
  ********************/
@@ -334,18 +387,18 @@ void bpacket_queue_show_vty(struct bpacket_queue *q, struct vty *vty)
 struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 					 struct peer_af *paf)
 {
-	struct stream *s = NULL;
+	struct stream *s = pkt->buffer;
+	struct stream *copy = NULL;
 	bpacket_attr_vec *vec;
 	struct peer *peer;
 	struct bgp_filter *filter;
 
-	s = stream_dup(pkt->buffer);
 	peer = PAF_PEER(paf);
 
 	vec = &pkt->arr.entries[BGP_ATTR_VEC_NH];
 
 	if (!CHECK_FLAG(vec->flags, BPKT_ATTRVEC_FLAGS_UPDATED))
-		return s;
+		return stream_share(s);
 
 	uint8_t nhlen;
 	afi_t nhafi;
@@ -384,7 +437,6 @@ struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 				EC_BGP_INVALID_NEXTHOP_LENGTH,
 				"%s: %s: invalid MP nexthop length (AFI IP): %u",
 				__func__, peer->host, nhlen);
-			stream_free(s);
 			return NULL;
 		}
 
@@ -433,8 +485,10 @@ struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 			nh_modified = 1;
 		}
 
-		if (nh_modified) /* allow for VPN RD */
-			stream_put_in_addr_at(s, offset_nh, mod_v4nh);
+		if (nh_modified) { /* allow for VPN RD */
+			copy = stream_dup(s);
+			stream_put_in_addr_at(copy, offset_nh, mod_v4nh);
+		}
 
 		if (bgp_debug_update(peer, NULL, NULL, 0))
 			zlog_debug("u%" PRIu64 ":s%" PRIu64
@@ -490,7 +544,6 @@ struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 				EC_BGP_INVALID_NEXTHOP_LENGTH,
 				"%s: %s: invalid MP nexthop length (AFI IP6): %u",
 				__func__, peer->host, nhlen);
-			stream_free(s);
 			return NULL;
 		}
 
@@ -556,12 +609,16 @@ struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 		 */
 		if (ll_nexthop_only) {
 			mod_v6nhl = &peer->nexthop.v6_local;
-			stream_put_in6_addr_at(s, offset_nhlocal, mod_v6nhl);
-		} else {
+			copy = stream_dup(s);
+			stream_put_in6_addr_at(copy, offset_nhlocal, mod_v6nhl);
+		} else if (gnh_modified || lnh_modified) {
+			copy = stream_dup(s);
 			if (gnh_modified)
-				stream_put_in6_addr_at(s, offset_nhglobal, mod_v6nhg);
+				stream_put_in6_addr_at(copy, offset_nhglobal,
+						       mod_v6nhg);
 			if (lnh_modified)
-				stream_put_in6_addr_at(s, offset_nhlocal, mod_v6nhl);
+				stream_put_in6_addr_at(copy, offset_nhlocal,
+						       mod_v6nhl);
 		}
 
 		if (bgp_debug_update(peer, NULL, NULL, 0)) {
@@ -605,8 +662,10 @@ struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 			nh_modified = 1;
 		}
 
-		if (nh_modified)
-			stream_put_in_addr_at(s, vec->offset + 1, mod_v4nh);
+		if (nh_modified) {
+			copy = stream_dup(s);
+			stream_put_in_addr_at(copy, vec->offset + 1, mod_v4nh);
+		}
 
 		if (bgp_debug_update(peer, NULL, NULL, 0))
 			zlog_debug("u%" PRIu64 ":s%" PRIu64
@@ -615,7 +674,8 @@ struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 				   PAF_SUBGRP(paf)->id, peer->host, mod_v4nh);
 	}
 
-	return s;
+	/* Peers that keep the nexthop as formatted share the packet */
+	return copy ? copy : stream_share(s);
 }
 
 /*
@@ -655,17 +715,19 @@ bool subgroup_packets_to_build(struct update_subgroup *subgrp)
 	return false;
 }
 
-/* Make BGP update packet.  */
-struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
+/*
+ * Encode one UPDATE from the subgroup's update FIFO, starting at adv.
+ * Only reads the advertisements; subgroup_update_commit() consumes them.
+ */
+static void subgroup_update_encode(struct update_subgroup *subgrp,
+				   struct bgp_advertise *adv,
+				   struct bpacket_enc *enc)
 {
-	struct bpacket_attr_vec_arr vecarr;
-	struct bpacket *pkt;
 	struct peer *peer;
 	struct stream *s;
 	struct stream *snlri;
 	struct stream *packet;
 	struct bgp_adj_out *adj;
-	struct bgp_advertise *adv;
 	struct bgp_dest *dest = NULL;
 	struct bgp_path_info *path = NULL;
 	bgp_size_t total_attr_len = 0;
@@ -689,11 +751,9 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 	struct bgp_ls_nlri *ls_nlri = NULL;
 	bool packet_is_upa = false;
 
-	if (!subgrp)
-		return NULL;
-
-	if (bpacket_queue_is_full(SUBGRP_INST(subgrp), SUBGRP_PKTQ(subgrp)))
-		return NULL;
+	enc->packet = NULL;
+	enc->nadv = 0;
+	enc->stop = BPACKET_ENC_DONE;
 
 	peer = SUBGRP_PEER(subgrp);
 	afi = SUBGRP_AFI(subgrp);
@@ -703,12 +763,11 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 	snlri = subgrp->scratch;
 	stream_reset(snlri);
 
-	bpacket_attr_vec_arr_reset(&vecarr);
+	bpacket_attr_vec_arr_reset(&enc->vecarr);
 
 	addpath_capable = bgp_addpath_encode_tx(peer, afi, safi);
 	addpath_overhead = addpath_capable ? BGP_ADDPATH_ID_LEN : 0;
 
-	adv = bgp_adv_fifo_first(&subgrp->sync->update);
 	while (adv) {
 		const struct prefix *dest_p;
 
@@ -784,7 +843,7 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 			/* 5: Encode all the attributes, except MP_REACH_NLRI
 			 * attr. */
 			total_attr_len = bgp_packet_attribute(NULL, peer, s, adv->baa->attr,
-							      &vecarr, NULL, afi, safi, from, NULL,
+							      &enc->vecarr, NULL, afi, safi, from, NULL,
 							      NULL, 0, dest->srv6_unicast, 0, 0,
 							      path, NULL, false);
 			space_remaining =
@@ -803,13 +862,11 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 					"u%" PRIu64 ":s%" PRIu64" attributes too long, cannot send UPDATE",
 					subgrp->update_group->id, subgrp->id);
 
-				/* Flush the FIFO update queue */
-				while (adv) {
-					struct bgp_adj_out *curr_adj = adv->adj;
-
-					adv = bgp_advertise_clean_subgroup(subgrp, curr_adj);
-				}
-				return NULL;
+				/* The FIFO update queue is flushed on commit */
+				stream_reset(s);
+				enc->stop = BPACKET_ENC_FLUSH;
+				enc->next = adv;
+				return;
 			}
 
 			if (BGP_DEBUG(update, UPDATE_OUT)
@@ -861,8 +918,8 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 				if (!ls_nlri) {
 					flog_err(EC_BGP_UPDATE_SND,
 						 "BGP-LS path missing ls_nlri data");
-					adv = bgp_advertise_clean_subgroup(subgrp, adj);
-					continue;
+					enc->stop = BPACKET_ENC_DROP_ADV;
+					break;
 				}
 
 				if (bgp_debug_update(NULL, NULL, subgrp->update_group, 0)) {
@@ -898,7 +955,7 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 
 			if (stream_empty(snlri))
 				mpattrlen_pos = bgp_packet_mpattr_start(
-					snlri, peer, afi, safi, &vecarr,
+					snlri, peer, afi, safi, &enc->vecarr,
 					adv->baa->attr);
 
 			bgp_packet_mpattr_prefix(snlri, afi, safi, dest_p, prd, label_pnt,
@@ -944,17 +1001,13 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 				   pfx_buf);
 		}
 
-		/* Synchnorize attribute.  */
-		if (adj->attr)
-			bgp_attr_unintern(&adj->attr);
-		else
-			subgrp->scount++;
-
-		adj->attr = bgp_attr_intern(adv->baa->attr);
-		adv = bgp_advertise_clean_subgroup(subgrp, adj);
+		enc->nadv++;
+		adv = bgp_adv_fifo_next(&subgrp->sync->update, adv);
 	}
 
-	if (!stream_empty(s)) {
+	enc->next = adv;
+
+	if (num_pfx) {
 		if (!stream_empty(snlri)) {
 			bgp_packet_mpattr_end(snlri, mpattrlen_pos);
 			total_attr_len += stream_get_endp(snlri);
@@ -965,7 +1018,7 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 
 		if (!stream_empty(snlri)) {
 			packet = stream_dupcat(s, snlri, mpattr_pos);
-			bpacket_attr_vec_arr_update(&vecarr, mpattr_pos);
+			bpacket_attr_vec_arr_update(&enc->vecarr, mpattr_pos);
 		} else
 			packet = stream_dup(s);
 		bgp_packet_set_size(packet);
@@ -977,15 +1030,87 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 				(stream_get_endp(packet)
 				 - stream_get_getp(packet)),
 				peer->max_packet_size, num_pfx);
-		pkt = bpacket_queue_add(SUBGRP_PKTQ(subgrp), packet, &vecarr);
-		stream_reset(s);
-		stream_reset(snlri);
-		return pkt;
+		enc->packet = packet;
 	}
-	return NULL;
+
+	stream_reset(s);
+	stream_reset(snlri);
+}
+
+/*
+ * Consume the advertisements that went into enc->packet, deal with the
+ * one encoding stopped at if needed and queue the packet.
+ */
+static struct bpacket *subgroup_update_commit(struct update_subgroup *subgrp,
+					      struct bpacket_enc *enc)
+{
+	struct bgp_advertise *adv;
+	struct bgp_adj_out *adj;
+
+	for (unsigned int i = 0; i < enc->nadv; i++) {
+		adv = bgp_adv_fifo_first(&subgrp->sync->update);
+		assert(adv);
+		adj = adv->adj;
+
+		/* Synchnorize attribute.  */
+		if (adj->attr)
+			bgp_attr_unintern(&adj->attr);
+		else
+			subgrp->scount++;
+
+		adj->attr = bgp_attr_intern(adv->baa->attr);
+		bgp_advertise_clean_subgroup(subgrp, adj);
+	}
+
+	adv = bgp_adv_fifo_first(&subgrp->sync->update);
+
+	switch (enc->stop) {
+	case BPACKET_ENC_DONE:
+		break;
+	case BPACKET_ENC_DROP_ADV:
+	case BPACKET_ENC_DROP_ADJ:
+		bgp_advertise_clean_subgroup(subgrp, adv->adj);
+		break;
+	case BPACKET_ENC_FLUSH:
+		/* Flush the FIFO update queue */
+		while (adv) {
+			struct bgp_adj_out *curr_adj = adv->adj;
+
+			adv = bgp_advertise_clean_subgroup(subgrp, curr_adj);
+		}
+		break;
+	}
+
+	if (!enc->packet)
+		return NULL;
+
+	return bpacket_queue_add(SUBGRP_PKTQ(subgrp), enc->packet, &enc->vecarr);
+}
+
+/* Make BGP update packet.  */
+struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
+{
+	struct bpacket_enc enc;
+	struct bpacket *pkt;
+
+	if (!subgrp)
+		return NULL;
+
+	if (bpacket_queue_is_full(SUBGRP_INST(subgrp), SUBGRP_PKTQ(subgrp)))
+		return NULL;
+
+	(void)peer_sort(SUBGRP_PEER(subgrp));
+
+	do {
+		subgroup_update_encode(subgrp,
+				       bgp_adv_fifo_first(&subgrp->sync->update),
+				       &enc);
+		pkt = subgroup_update_commit(subgrp, &enc);
+	} while (!pkt && enc.stop == BPACKET_ENC_DROP_ADV);
+
+	return pkt;
 }
 
-/* Make BGP withdraw packet.  */
 /* For ipv4 unicast:
    16-octet marker | 2-octet length | 1-octet type |
     2-octet withdrawn route length | withdrawn prefixes | 2-octet attrlen (=0)
@@ -995,12 +1120,18 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
     2-octet withdrawn route length (=0) | 2-octet attrlen |
      mp_unreach attr type | attr len | afi | safi | withdrawn prefixes
 */
-struct bpacket *subgroup_withdraw_packet(struct update_subgroup *subgrp)
+
+/*
+ * Encode one withdraw UPDATE from the subgroup's withdraw FIFO, starting at
+ * adv.  Only reads the advertisements; subgroup_withdraw_commit() removes
+ * them.
+ */
+static void subgroup_withdraw_encode(struct update_subgroup *subgrp,
+				     struct bgp_advertise *adv,
+				     struct bpacket_enc *enc)
 {
-	struct bpacket *pkt;
 	struct stream *s;
 	struct bgp_adj_out *adj;
-	struct bgp_advertise *adv;
 	struct peer *peer;
 	struct bgp_dest *dest;
 	bgp_size_t unfeasible_len;
@@ -1019,13 +1150,11 @@ struct bpacket *subgroup_withdraw_packet(struct update_subgroup *subgrp)
 	uint32_t addpath_tx_id = 0;
 	const struct prefix_rd *prd = NULL;
 	struct bgp_ls_nlri *ls_nlri = NULL;
+	size_t endp;
 
-
-	if (!subgrp)
-		return NULL;
-
-	if (bpacket_queue_is_full(SUBGRP_INST(subgrp), SUBGRP_PKTQ(subgrp)))
-		return NULL;
+	enc->packet = NULL;
+	enc->nadv = 0;
+	enc->stop = BPACKET_ENC_DONE;
 
 	peer = SUBGRP_PEER(subgrp);
 	afi = SUBGRP_AFI(subgrp);
@@ -1035,7 +1164,7 @@ struct bpacket *subgroup_withdraw_packet(struct update_subgroup *subgrp)
 	addpath_capable = bgp_addpath_encode_tx(peer, afi, safi);
 	addpath_overhead = addpath_capable ? BGP_ADDPATH_ID_LEN : 0;
 
-	while ((adv = bgp_adv_fifo_first(&subgrp->sync->withdraw)) != NULL) {
+	for (; adv; adv = bgp_adv_fifo_next(&subgrp->sync->withdraw, adv)) {
 		const struct prefix *dest_p;
 
 		assert(adv->dest);
@@ -1081,17 +1210,19 @@ struct bpacket *subgroup_withdraw_packet(struct update_subgroup *subgrp)
 			ls_nlri = dest->ls_nlri;
 			if (ls_nlri) {
 				/* Encode the BGP-LS NLRI into the stream */
+				endp = stream_get_endp(s);
 				if (bgp_ls_encode_nlri(s, ls_nlri) < 0) {
 					flog_err(EC_BGP_UPDATE_SND,
 						 "Failed to encode BGP-LS NLRI withdrawal");
-					bgp_adj_out_remove_subgroup(dest, adj, subgrp);
-					continue;
+					stream_set_endp(s, endp);
+					enc->stop = BPACKET_ENC_DROP_ADJ;
+					break;
 				}
 			} else {
 				flog_err(EC_BGP_UPDATE_SND,
 					 "BGP-LS withdrawal missing ls_nlri data");
-				bgp_adj_out_remove_subgroup(dest, adj, subgrp);
-				continue;
+				enc->stop = BPACKET_ENC_DROP_ADJ;
+				break;
 			}
 
 			num_pfx++;
@@ -1101,8 +1232,7 @@ struct bpacket *subgroup_withdraw_packet(struct update_subgroup *subgrp)
 					   " send UPDATE BGP-LS NLRI -- unreachable",
 					   subgrp->update_group->id, subgrp->id);
 
-			subgrp->scount--;
-			bgp_adj_out_remove_subgroup(dest, adj, subgrp);
+			enc->nadv++;
 			continue;
 		}
 
@@ -1120,8 +1250,8 @@ struct bpacket *subgroup_withdraw_packet(struct update_subgroup *subgrp)
 				if (!ls_nlri) {
 					flog_err(EC_BGP_UPDATE_SND,
 						 "BGP-LS path missing ls_nlri data");
-					bgp_advertise_clean_subgroup(subgrp, adj);
-					continue;
+					enc->stop = BPACKET_ENC_DROP_ADV;
+					break;
 				}
 			}
 
@@ -1174,12 +1304,12 @@ struct bpacket *subgroup_withdraw_packet(struct update_subgroup *subgrp)
 				   pfx_buf);
 		}
 
-		subgrp->scount--;
-
-		bgp_adj_out_remove_subgroup(dest, adj, subgrp);
+		enc->nadv++;
 	}
 
-	if (!stream_empty(s)) {
+	enc->next = adv;
+
+	if (num_pfx) {
 		if (afi == AFI_IP && safi == SAFI_UNICAST
 		    && !peer_cap_enhe(peer, afi, safi)) {
 			unfeasible_len = stream_get_endp(s) - BGP_HEADER_SIZE
@@ -1204,13 +1334,70 @@ struct bpacket *subgroup_withdraw_packet(struct update_subgroup *subgrp)
 		frrtrace(4, frr_bgp, upd_send_withdraw_details, subgrp->update_group->id,
 			 subgrp->id, (stream_get_endp(s) - stream_get_getp(s)), num_pfx);
 
-		pkt = bpacket_queue_add(SUBGRP_PKTQ(subgrp), stream_dup(s),
-					NULL);
-		stream_reset(s);
-		return pkt;
+		enc->packet = stream_dup(s);
 	}
 
-	return NULL;
+	stream_reset(s);
+}
+
+/*
+ * Remove the advertisements that went into enc->packet, deal with the one
+ * encoding stopped at if needed and queue the packet.
+ */
+static struct bpacket *
+subgroup_withdraw_commit(struct update_subgroup *subgrp,
+			 struct bpacket_enc *enc)
+{
+	struct bgp_advertise *adv;
+
+	for (unsigned int i = 0; i < enc->nadv; i++) {
+		adv = bgp_adv_fifo_first(&subgrp->sync->withdraw);
+		assert(adv);
+
+		subgrp->scount--;
+		bgp_adj_out_remove_subgroup(adv->dest, adv->adj, subgrp);
+	}
+
+	adv = bgp_adv_fifo_first(&subgrp->sync->withdraw);
+
+	switch (enc->stop) {
+	case BPACKET_ENC_DONE:
+	case BPACKET_ENC_FLUSH:
+		break;
+	case BPACKET_ENC_DROP_ADV:
+		bgp_advertise_clean_subgroup(subgrp, adv->adj);
+		break;
+	case BPACKET_ENC_DROP_ADJ:
+		bgp_adj_out_remove_subgroup(adv->dest, adv->adj, subgrp);
+		break;
+	}
+
+	if (!enc->packet)
+		return NULL;
+
+	return bpacket_queue_add(SUBGRP_PKTQ(subgrp), enc->packet, NULL);
+}
+
+/* Make BGP withdraw packet.  */
+struct bpacket *subgroup_withdraw_packet(struct update_subgroup *subgrp)
+{
+	struct bpacket_enc enc;
+	struct bpacket *pkt;
+
+	if (!subgrp)
+		return NULL;
+
+	if (bpacket_queue_is_full(SUBGRP_INST(subgrp), SUBGRP_PKTQ(subgrp)))
+		return NULL;
+
+	do {
+		subgroup_withdraw_encode(subgrp,
+					 bgp_adv_fifo_first(&subgrp->sync->withdraw),
+					 &enc);
+		pkt = subgroup_withdraw_commit(subgrp, &enc);
+	} while (!pkt && enc.stop != BPACKET_ENC_DONE);
+
+	return pkt;
 }
 
 void subgroup_default_update_packet(struct update_subgroup *subgrp,
@@ -1242,6 +1429,7 @@ void subgroup_default_update_packet(struct update_subgroup *subgrp,
 		return;
 
 	peer = SUBGRP_PEER(subgrp);
+	(void)peer_sort(peer);
 	afi = SUBGRP_AFI(subgrp);
 	safi = SUBGRP_SAFI(subgrp);
 	bpacket_attr_vec_arr_reset(&vecarr);
@@ -1489,3 +1677,156 @@ void bpacket_attr_vec_arr_set_vec(struct bpacket_attr_vec_arr *vecarr,
 	if (attr)
 		bpacket_vec_arr_inherit_attr_flags(vecarr, type, attr);
 }
+
+void subgroup_build_queue(struct update_subgroup *subgrp)
+{
+	if (!subgrp_build_anywhere(subgrp))
+		subgrp_build_add_tail(subgrp_build_list, subgrp);
+}
+
+void subgroup_build_unqueue(struct update_subgroup *subgrp)
+{
+	if (subgrp_build_anywhere(subgrp))
+		subgrp_build_del(subgrp_build_list, subgrp);
+}
+
+void bgp_format_threads_set(unsigned int count)
+{
+	count = MIN(count, BGP_FORMAT_THREADS_MAX);
+	bm->format_threads = count;
+
+	frr_workers_start(&subgrp_build_workers, count);
+}
+
+/*
+ * Whether bgp_generate_updgrp_packets() is about to pull packets from the
+ * subgroup, for peer or one of the other members.
+ */
+static bool subgroup_build_wanted(struct update_subgroup *subgrp,
+				  struct peer *peer)
+{
+	struct bgp *bgp = SUBGRP_INST(subgrp);
+	struct peer_af *paf;
+
+	if (bgp->main_peers_update_hold || bgp_update_delay_active(bgp) ||
+	    bgp_in_graceful_restart())
+		return false;
+
+	if (bpacket_queue_is_full(bgp, SUBGRP_PKTQ(subgrp)))
+		return false;
+
+	SUBGRP_FOREACH_PEER (subgrp, paf) {
+		if (paf->peer == peer ||
+		    event_is_scheduled(paf->peer->connection
+					       ->t_generate_updgrp_packets))
+			return true;
+	}
+
+	return false;
+}
+
+static void subgroup_build_work(void *item)
+{
+	struct subgroup_build_job *job = item;
+	struct update_subgroup *subgrp = job->subgrp;
+	struct bgp_advertise *adv;
+	struct bpacket_enc *enc;
+
+	/* Withdraws first, as bgp_generate_updgrp_packets() does */
+	adv = bgp_adv_fifo_first(&subgrp->sync->withdraw);
+	while (adv && job->count < job->max) {
+		enc = &job->enc[job->count];
+		subgroup_withdraw_encode(subgrp, adv, enc);
+		if (!enc->packet && enc->stop == BPACKET_ENC_DONE)
+			return;
+
+		job->count++;
+		job->nwithdraw++;
+		if (enc->stop != BPACKET_ENC_DONE)
+			return;
+		adv = enc->next;
+	}
+
+	if (adv)
+		return;
+
+	adv = bgp_adv_fifo_first(&subgrp->sync->update);
+	while (adv && job->count < job->max) {
+		enc = &job->enc[job->count];
+		subgroup_update_encode(subgrp, adv, enc);
+		if (!enc->packet && enc->stop == BPACKET_ENC_DONE)
+			return;
+
+		job->count++;
+		if (enc->stop != BPACKET_ENC_DONE)
+			return;
+		adv = enc->next;
+	}
+}
+
+/*
+ * Format packets for all subgroups with advertisements waiting that are
+ * about to be written out, on the update format pthreads.  The packets
+ * are queued on their subgroups in order; whatever is left over is built
+ * by subgroup_withdraw_packet() / subgroup_update_packet() as usual.
+ */
+void subgroup_build_packets(struct peer *peer)
+{
+	struct subgroup_build_job *jobs;
+	struct update_subgroup *subgrp;
+	unsigned int count = 0, room, i, j;
+
+	if (!bm->format_threads || subgrp_build_count(subgrp_build_list) < 2)
+		return;
+
+	frr_each_safe (subgrp_build, subgrp_build_list, subgrp) {
+		if (!subgroup_packets_to_build(subgrp)) {
+			subgrp_build_del(subgrp_build_list, subgrp);
+			continue;
+		}
+
+		if (subgroup_build_wanted(subgrp, peer))
+			count++;
+	}
+
+	/* A single subgroup is no better off than being built in place */
+	if (count < 2)
+		return;
+
+	jobs = XCALLOC(MTYPE_BGP_SUBGRP_BUILD, count * sizeof(*jobs));
+
+	i = 0;
+	frr_each (subgrp_build, subgrp_build_list, subgrp) {
+		if (!subgroup_build_wanted(subgrp, peer))
+			continue;
+
+		room = SUBGRP_INST(subgrp)->default_subgroup_pkt_queue_max -
+		       subgrp->pkt_queue.curr_count;
+
+		jobs[i].subgrp = subgrp;
+		jobs[i].max = MIN(room, SUBGRP_BUILD_PKTS_MAX);
+		i++;
+
+		/* bgp_packet_attribute() must not write it on the workers */
+		(void)peer_sort(SUBGRP_PEER(subgrp));
+	}
+
+	frr_workers_run(&subgrp_build_workers, bm->format_threads, jobs,
+			sizeof(*jobs), count, subgroup_build_work);
+
+	for (i = 0; i < count; i++) {
+		subgrp = jobs[i].subgrp;
+
+		for (j = 0; j < jobs[i].count; j++) {
+			if (j < jobs[i].nwithdraw)
+				subgroup_withdraw_commit(subgrp, &jobs[i].enc[j]);
+			else
+				subgroup_update_commit(subgrp, &jobs[i].enc[j]);
+		}
+
+		if (!subgroup_packets_to_build(subgrp))
+			subgrp_build_del(subgrp_build_list, subgrp);
+	}
+
+	XFREE(MTYPE_BGP_SUBGRP_BUILD, jobs);
+}
@@ -59,6 +59,8 @@
 #include "bgpd/bgp_updgrp.h"
 #include "bgpd/bgp_bfd.h"
 #include "bgpd/bgp_io.h"
+#include "bgpd/bgp_parse.h"
+#include "bgpd/bgp_bestpath.h"
 #include "bgpd/bgp_evpn.h"
 #include "bgpd/bgp_evpn_vty.h"
 #include "bgpd/bgp_evpn_mh.h"
@@ -13325,6 +13327,9 @@ DEFPY(show_bgp_router,
 	if (uj) {
 		json_object_int_add(json, "bgpInputQueueLimit", bm->inq_limit);
 		json_object_int_add(json, "bgpOutputQueueLimit", bm->outq_limit);
+		json_object_int_add(json, "bgpUpdateParseThreads", bm->parse_threads);
+		json_object_int_add(json, "bgpBestpathThreads", bm->bestpath_threads);
+		json_object_int_add(json, "bgpUpdateFormatThreads", bm->format_threads);
 		json_object_int_add(json, "zebraAnnounceCount",
 				    zebra_announce_count(&bm->zebra_announce_head));
 		json_object_int_add(json, "zebraAnnounceEarlyCount",
@@ -13341,6 +13346,9 @@ DEFPY(show_bgp_router,
 	} else {
 		vty_out(vty, "BGP Input Queue Limit: %d\n", bm->inq_limit);
 		vty_out(vty, "BGP Output Queue Limit: %d\n", bm->outq_limit);
+		vty_out(vty, "BGP Update Parse Threads: %u\n", bm->parse_threads);
+		vty_out(vty, "BGP Best Path Threads: %u\n", bm->bestpath_threads);
+		vty_out(vty, "BGP Update Format Threads: %u\n", bm->format_threads);
 		vty_out(vty, "Zebra announce queue (priority): %zu\n",
 			zebra_announce_count(&bm->zebra_announce_early_head));
 		vty_out(vty, "Zebra announce queue (normal): %zu\n",
@@ -14768,11 +14776,7 @@ static int bgp_show_summary(struct vty *vty, struct bgp *bgp, int afi, int safi,
 								      ->obuf
 								      ->count,
 							     memory_order_relaxed);
-				inq_count =
-					atomic_load_explicit(&peer->connection
-								      ->ibuf
-								      ->count,
-							     memory_order_relaxed);
+				inq_count = bgp_connection_inq_count(peer->connection);
 
 				json_object_int_add(
 					json_peer, "tableVersion",
@@ -14952,11 +14956,7 @@ static int bgp_show_summary(struct vty *vty, struct bgp *bgp, int afi, int safi,
 								      ->obuf
 								      ->count,
 							     memory_order_relaxed);
-				inq_count =
-					atomic_load_explicit(&peer->connection
-								      ->ibuf
-								      ->count,
-							     memory_order_relaxed);
+				inq_count = bgp_connection_inq_count(peer->connection);
 
 				vty_out(vty, "4");
 				vty_out(vty, ASN_FORMAT_SPACE(bgp->asnotation),
@@ -18068,8 +18068,7 @@ static void bgp_show_peer(struct vty *vty, struct peer *p, uint16_t sh_flags, bo
 		atomic_size_t outq_count, inq_count;
 		outq_count = atomic_load_explicit(&p->connection->obuf->count,
 						  memory_order_relaxed);
-		inq_count = atomic_load_explicit(&p->connection->ibuf->count,
-						 memory_order_relaxed);
+		inq_count = bgp_connection_inq_count(p->connection);
 
 		json_object_int_add(json_stat, "depthInq",
 				    (unsigned long)inq_count);
@@ -18131,8 +18130,7 @@ static void bgp_show_peer(struct vty *vty, struct peer *p, uint16_t sh_flags, bo
 			dynamic_cap_out, dynamic_cap_in;
 		outq_count = atomic_load_explicit(&p->connection->obuf->count,
 						  memory_order_relaxed);
-		inq_count = atomic_load_explicit(&p->connection->ibuf->count,
-						 memory_order_relaxed);
+		inq_count = bgp_connection_inq_count(p->connection);
 		open_out = atomic_load_explicit(&p->open_out,
 						memory_order_relaxed);
 		open_in =
@@ -22345,6 +22343,15 @@ int bgp_config_write(struct vty *vty)
 	if (bm->outq_limit != BM_DEFAULT_Q_LIMIT)
 		vty_out(vty, "bgp output-queue-limit %u\n", bm->outq_limit);
 
+	if (bm->parse_threads)
+		vty_out(vty, "bgp update-parse-threads %u\n", bm->parse_threads);
+
+	if (bm->bestpath_threads)
+		vty_out(vty, "bgp bestpath-threads %u\n", bm->bestpath_threads);
+
+	if (bm->format_threads)
+		vty_out(vty, "bgp update-format-threads %u\n", bm->format_threads);
+
 	vty_out(vty, "!\n");
 
 	/* BGP configuration. */
@@ -23280,6 +23287,81 @@ DEFPY (no_bgp_inq_limit,
 	return CMD_SUCCESS;
 }
 
+DEFPY (bgp_update_parse_threads,
+       bgp_update_parse_threads_cmd,
+       "bgp update-parse-threads (1-64)$threads",
+       BGP_STR
+       "Decode received UPDATE messages on a pool of pthreads\n"
+       "Number of parser pthreads\n")
+{
+	bgp_parse_threads_set(threads);
+
+	return CMD_SUCCESS;
+}
+
+DEFPY (no_bgp_update_parse_threads,
+       no_bgp_update_parse_threads_cmd,
+       "no bgp update-parse-threads [(1-64)]",
+       NO_STR
+       BGP_STR
+       "Decode received UPDATE messages on a pool of pthreads\n"
+       "Number of parser pthreads\n")
+{
+	bgp_parse_threads_set(0);
+
+	return CMD_SUCCESS;
+}
+
+DEFPY (bgp_bestpath_threads,
+       bgp_bestpath_threads_cmd,
+       "bgp bestpath-threads (1-64)$threads",
+       BGP_STR
+       "Sort paths for best path selection on a pool of pthreads\n"
+       "Number of best path pthreads\n")
+{
+	bgp_bestpath_threads_set(threads);
+
+	return CMD_SUCCESS;
+}
+
+DEFPY (no_bgp_bestpath_threads,
+       no_bgp_bestpath_threads_cmd,
+       "no bgp bestpath-threads [(1-64)]",
+       NO_STR
+       BGP_STR
+       "Sort paths for best path selection on a pool of pthreads\n"
+       "Number of best path pthreads\n")
+{
+	bgp_bestpath_threads_set(0);
+
+	return CMD_SUCCESS;
+}
+
+DEFPY (bgp_update_format_threads,
+       bgp_update_format_threads_cmd,
+       "bgp update-format-threads (1-64)$threads",
+       BGP_STR
+       "Format UPDATE messages for update-groups on a pool of pthreads\n"
+       "Number of update format pthreads\n")
+{
+	bgp_format_threads_set(threads);
+
+	return CMD_SUCCESS;
+}
+
+DEFPY (no_bgp_update_format_threads,
+       no_bgp_update_format_threads_cmd,
+       "no bgp update-format-threads [(1-64)]",
+       NO_STR
+       BGP_STR
+       "Format UPDATE messages for update-groups on a pool of pthreads\n"
+       "Number of update format pthreads\n")
+{
+	bgp_format_threads_set(0);
+
+	return CMD_SUCCESS;
+}
+
 DEFPY (bgp_outq_limit,
        bgp_outq_limit_cmd,
        "bgp output-queue-limit (1-4294967295)$limit",
@@ -23498,6 +23580,12 @@ void bgp_vty_init(void)
 	install_element(CONFIG_NODE, &no_bgp_inq_limit_cmd);
 	install_element(CONFIG_NODE, &bgp_outq_limit_cmd);
 	install_element(CONFIG_NODE, &no_bgp_outq_limit_cmd);
+	install_element(CONFIG_NODE, &bgp_update_parse_threads_cmd);
+	install_element(CONFIG_NODE, &no_bgp_update_parse_threads_cmd);
+	install_element(CONFIG_NODE, &bgp_bestpath_threads_cmd);
+	install_element(CONFIG_NODE, &no_bgp_bestpath_threads_cmd);
+	install_element(CONFIG_NODE, &bgp_update_format_threads_cmd);
+	install_element(CONFIG_NODE, &no_bgp_update_format_threads_cmd);
 
 	/* "bgp local-mac" hidden commands. */
 	install_element(CONFIG_NODE, &bgp_local_mac_cmd);
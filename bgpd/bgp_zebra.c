@@ -1894,6 +1894,9 @@ static void bgp_handle_route_announcements_to_zebra(struct event *e)
 	bool install;
 	const struct prefix_evpn *evp = NULL;
 
+	/* Route adds go out as bulk messages */
+	zclient_route_bulk_begin(bgp_zclient);
+
 	while (count < ZEBRA_ANNOUNCEMENTS_LIMIT) {
 		is_evpn = false;
 
@@ -1917,6 +1920,9 @@ static void bgp_handle_route_announcements_to_zebra(struct event *e)
 			is_evpn = true;
 			evp = (const struct prefix_evpn *)bgp_dest_get_prefix(
 				dest);
+
+			/* Don't let EVPN messages overtake held routes */
+			zclient_route_bulk_flush(bgp_zclient);
 		}
 
 		if (BGP_DEBUG(zebra, ZEBRA))
@@ -1979,6 +1985,10 @@ static void bgp_handle_route_announcements_to_zebra(struct event *e)
 		count++;
 	}
 
+	/* Send what is left of the bulk message */
+	if (zclient_route_bulk_end(bgp_zclient) == ZCLIENT_SEND_BUFFERED)
+		status = ZCLIENT_SEND_BUFFERED;
+
 	if (status != ZCLIENT_SEND_BUFFERED &&
 	    (zebra_announce_count(&bm->zebra_announce_early_head) ||
 	     zebra_announce_count(&bm->zebra_announce_head)))
@@ -70,6 +70,7 @@
 #include "bgpd/bgp_evpn_vty.h"
 #include "bgpd/bgp_keepalives.h"
 #include "bgpd/bgp_io.h"
+#include "bgpd/bgp_parse.h"
 #include "bgpd/bgp_ecommunity.h"
 #include "bgpd/bgp_flowspec.h"
 #include "bgpd/bgp_labelpool.h"
@@ -1316,6 +1317,8 @@ void bgp_peer_connection_buffers_free(struct peer_connection *connection)
 {
 	frr_with_mutex (&connection->io_mtx) {
 		if (connection->ibuf) {
+			bgp_parsed_pkts_flush(connection);
+			bgp_parsed_pkts_fini(&connection->parsed);
 			stream_fifo_free(connection->ibuf);
 			connection->ibuf = NULL;
 		}
@@ -1335,6 +1338,8 @@ void bgp_peer_connection_buffers_free(struct peer_connection *connection)
 		stream_free(connection->curr);
 		connection->curr = NULL;
 	}
+
+	bgp_parsed_pkt_done(connection);
 }
 
 void bgp_peer_connection_free(struct peer_connection **connection)
@@ -1383,6 +1388,7 @@ struct peer_connection *bgp_peer_connection_new(struct peer *peer, const union s
 
 	connection->ibuf = stream_fifo_new();
 	connection->obuf = stream_fifo_new();
+	bgp_parsed_pkts_init(&connection->parsed);
 	pthread_mutex_init(&connection->io_mtx, NULL);
 
 	/* ibuf_work is allocated on demand in bgp_read() when needed to hold
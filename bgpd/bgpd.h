@@ -132,6 +132,12 @@ extern struct frr_pthread *bgp_pth_ka;
 /* FIFO list for peer connections */
 PREDECL_LIST(peer_connection_fifo);
 
+/* Packets pre-decoded by the UPDATE parser pool, see bgp_parse.h */
+PREDECL_LIST(bgp_parsed_pkts);
+
+/* Connections batched for writing by the I/O pthread, see bgp_io.c */
+PREDECL_DLIST(bgp_io_writes);
+
 /* BGP master for system wide configurations and variables.  */
 struct bgp_master {
 	/* BGP instance list.  */
@@ -237,6 +243,15 @@ struct bgp_master {
 	uint32_t inq_limit;
 	uint32_t outq_limit;
 
+	/* Number of UPDATE parser pthreads, 0 parses on the main pthread */
+	uint32_t parse_threads;
+
+	/* Number of best path pthreads, 0 selects on the main pthread only */
+	uint32_t bestpath_threads;
+
+	/* Number of update format pthreads, 0 formats on the main pthread */
+	uint32_t format_threads;
+
 	struct event *t_bgp_sync_label_manager;
 	struct event *t_bgp_start_label_manager;
 
@@ -1155,7 +1170,7 @@ struct bgp {
 	/* BGP route flap dampening configuration */
 	struct bgp_damp_config damp[AFI_MAX][SAFI_MAX];
 
-	uint64_t bestpath_runs;
+	_Atomic uint64_t bestpath_runs; // also counted on bestpath pthreads
 	uint64_t node_already_on_queue;
 	uint64_t node_deferred_on_queue;
 
@@ -1524,9 +1539,17 @@ struct peer_connection {
 	pthread_mutex_t io_mtx;	  // guards ibuf, obuf
 	struct stream_fifo *ibuf; // packets waiting to be processed
 	struct stream_fifo *obuf; // packets waiting to be written
+	struct bgp_io_writes_item io_writes; // in the I/O pthread's write batch
 
 	struct ringbuf *ibuf_work; // WiP buffer used by bgp_read() only
 
+	/* UPDATE parser pthread this connection is bound to, if any */
+	struct frr_pthread *parser;
+	struct event *t_parse;
+	struct bgp_parsed_pkts_head parsed; // guarded by io_mtx
+	atomic_size_t parsed_count; // held by the parser, readable unlocked
+	struct bgp_parsed_pkt *curr_parsed;
+
 	struct event *t_read;
 	struct event *t_write;
 	struct event *t_connect;
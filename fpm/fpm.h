@@ -115,8 +115,45 @@ typedef enum fpm_msg_type_e_ {
 	 */
 	FPM_MSG_TYPE_NETLINK = 1,
 	FPM_MSG_TYPE_PROTOBUF = 2,
+
+	/*
+	 * Hands the FPM a shared memory ring, see struct fpm_shm_ring.  Has
+	 * no payload; the ring memfd and the doorbell eventfd come along as
+	 * SCM_RIGHTS ancillary data, in that order.
+	 */
+	FPM_MSG_TYPE_SHM_SETUP = 3,
+
+	/*
+	 * Payload is a struct fpm_generation.  From zebra, every route
+	 * change up to and including gen has been sent.  From the FPM, sent
+	 * once right after connecting (and the shared memory setup, if any):
+	 * the last generation it applied, 0 if it holds no routes.
+	 */
+	FPM_MSG_TYPE_GENERATION = 4,
+
+	/*
+	 * Payload is a struct fpm_generation.  Sent by zebra in reply to the
+	 * FPM's generation, before replaying its state: only route changes
+	 * after gen follow, and if gen is 0 the FPM must drop all routes it
+	 * holds.
+	 */
+	FPM_MSG_TYPE_RESYNC = 5,
 } fpm_msg_type_e;
 
+/*
+ * Incremental resync
+ *
+ * zebra numbers the route changes it hands to the dataplane.  The numbers
+ * are only meaningful within one run of zebra, identified by epoch.  When
+ * resyncing, zebra still replays all LSPs, next hop groups and router MACs,
+ * but for routes only the ones added, changed or deleted after the FPM's
+ * generation.  Both fields are in network byte order.
+ */
+struct fpm_generation {
+	uint64_t epoch;
+	uint64_t gen;
+};
+
 /*
  * The FPM message header is aligned to the same boundary as netlink
  * messages (4). This means that a netlink message does not need
@@ -255,6 +292,53 @@ static inline int fpm_msg_ok(const fpm_msg_hdr_t *hdr, size_t len)
 	return 1;
 }
 
+/*
+ * Shared memory transport
+ *
+ * An FPM on the same host may listen on a unix stream socket instead.
+ * Once connected, zebra sends an FPM_MSG_TYPE_SHM_SETUP message and from
+ * then on places its messages in a single producer, single consumer ring
+ * in the shared memory instead of writing them to the socket.  The socket
+ * stays up to carry messages from the FPM back to zebra, and its closing
+ * ends the session.
+ *
+ * The mapping starts with struct fpm_shm_ring, followed by the ring data
+ * at data_offset.  head and tail count the bytes ever written and
+ * consumed, so the fill is head - tail and a position in the ring is the
+ * count modulo size, a power of two.  zebra only writes head and the FPM
+ * only writes tail, each with release semantics, and they read the other
+ * with acquire semantics.
+ *
+ * Every message in the ring is a complete FPM message starting at a
+ * FPM_MSG_ALIGNTO boundary, and takes fpm_msg_align(msg_len) bytes.  A
+ * message never wraps around the end of the ring: zebra fills the rest
+ * with an FPM_MSG_TYPE_NONE message instead, which the FPM skips.
+ *
+ * Before waiting on the doorbell, the FPM sets waiting and then checks
+ * head once more.  After moving head, zebra writes to the doorbell if
+ * waiting is set.  Both sides use sequentially consistent accesses for
+ * this, so a wakeup is never lost.
+ */
+#define FPM_SHM_MAGIC 0x46504d52 /* "FPMR" */
+
+/* Room zebra keeps for a single message, including the FPM header */
+#define FPM_SHM_MSG_MAX 65536
+
+struct fpm_shm_ring {
+	uint32_t magic;
+	uint32_t data_offset;
+	uint64_t size;
+
+	uint64_t head __attribute__((aligned(64)));
+	uint64_t tail __attribute__((aligned(64)));
+	uint32_t waiting __attribute__((aligned(64)));
+};
+
+static inline uint8_t *fpm_shm_data(struct fpm_shm_ring *ring)
+{
+	return (uint8_t *)ring + ring->data_offset;
+}
+
 // tcp maximum range
 #define TCP_MAX_PORT   65535
 
@@ -31,16 +31,33 @@ DEFINE_MTYPE_STATIC(LIB, EVENT_MASTER, "Thread master");
 DEFINE_MTYPE_STATIC(LIB, EVENT_POLL, "Thread Poll Info");
 DEFINE_MTYPE_STATIC(LIB, EVENT_STATS, "Thread stats");
 
+/* io_uring is an alternative to epoll_pwait() on the same fd bookkeeping */
+#if EPOLL_ENABLED && defined(HAVE_LIBURING)
+#define URING_ENABLED 1
+#include <liburing.h>
+#else
+#define URING_ENABLED 0
+#endif
+
 #if EPOLL_ENABLED
 
 PREDECL_HASH(epoll_event_hash);
 PREDECL_DLIST(epoll_revent_list);
+#if URING_ENABLED
+PREDECL_DLIST(epoll_uring_dirty);
+#endif
 
 struct frr_epoll_event {
 	struct epoll_event ev;
 	int flags;
 	struct epoll_event_hash_item hlink;
 	struct epoll_revent_list_item rlink;
+#if URING_ENABLED
+	/* events of the poll armed in the ring (0 if none), and its tag */
+	uint32_t uring_events;
+	uint32_t uring_gen;
+	struct epoll_uring_dirty_item dlink;
+#endif
 };
 
 /* Flags values */
@@ -70,6 +87,27 @@ struct fd_handler {
 	struct epoll_revent_list_head epoll_revents_list;
 
 	unsigned long *fd_poll_counter;
+
+#if URING_ENABLED
+	/* Set if io_uring is used instead of epoll_pwait() */
+	struct io_uring *uring;
+
+	/* The ring is only touched by the owning pthread; fds whose poll
+	 * changed on other pthreads, and async transfers added there, wait
+	 * here for it.
+	 */
+	struct epoll_uring_dirty_head uring_dirty;
+	struct event_list_head uring_async;
+
+	/* tag of the last poll armed */
+	uint32_t uring_gen;
+
+	/* async transfers submitted and not reaped yet */
+	unsigned int uring_inflight;
+
+	/* poll results reaped into .revents and not processed yet */
+	int uring_revents;
+#endif
 };
 #else
 struct fd_handler {
@@ -97,6 +135,7 @@ struct event_loop {
 	struct event **read;
 	struct event **write;
 	struct event_timer_list_head timer;
+	struct event_timer_wheel *wheel; /* NULL if not used */
 	struct event_list_head event, ready, unuse;
 	struct list *cancel_req;
 	bool canceled;
@@ -144,6 +183,11 @@ DECLARE_HASH(epoll_event_hash, struct frr_epoll_event, hlink, epoll_event_hash_c
 /* List of "regular" epoll objects, that are not added to the epoll set. */
 DECLARE_DLIST(epoll_revent_list, struct frr_epoll_event, rlink);
 
+#if URING_ENABLED
+/* List of epoll objects whose poll has to be updated in the ring */
+DECLARE_DLIST(epoll_uring_dirty, struct frr_epoll_event, dlink);
+#endif
+
 #endif
 
 DECLARE_LIST(event_list, struct event, eventitem);
@@ -173,6 +217,221 @@ static int event_timer_cmp(const struct event *a, const struct event *b)
 
 DECLARE_HEAP(event_timer_list, struct event, timeritem, event_timer_cmp);
 
+/*
+ * Hierarchical timer wheel for second resolution timers.
+ *
+ * Level 0 has one slot per tick; every slot of level n covers all of
+ * level n - 1.  A timer goes into the lowest level that reaches its
+ * expiry, and moves down a level ("cascades") when the level below wraps
+ * around to its slot.  Adding and cancelling are O(1), running costs O(1)
+ * per timer per level.  Timers further out than the top level are parked
+ * in its last slot and cascade again.
+ *
+ * Expiries are rounded up to the next tick, so timers never fire early.
+ * The per-level bitmaps of occupied slots let the loop find the next
+ * tick it has to wake up for without walking the slots.
+ */
+#define WHEEL_TICK_USEC 10000ULL
+#define WHEEL_BITS	6
+#define WHEEL_SLOTS	(1U << WHEEL_BITS)
+#define WHEEL_MASK	(WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS	4
+/* ticks covered by the whole wheel */
+#define WHEEL_SPAN	(1ULL << (WHEEL_BITS * WHEEL_LEVELS))
+
+DECLARE_DLIST(event_wheel, struct event, wheelitem);
+
+struct event_timer_wheel {
+	/* time of tick 0 */
+	struct timeval base;
+	/* next tick to run */
+	uint64_t tick;
+	/* earliest tick the loop is waiting for, to know when to wake it */
+	uint64_t wait;
+
+	size_t count;
+	uint64_t occupied[WHEEL_LEVELS];
+	struct event_wheel_head slots[WHEEL_LEVELS * WHEEL_SLOTS];
+};
+
+static int64_t wheel_usec(const struct event_timer_wheel *w,
+			  const struct timeval *tv)
+{
+	return (int64_t)(tv->tv_sec - w->base.tv_sec) * TIMER_SECOND_MICRO +
+	       (tv->tv_usec - w->base.tv_usec);
+}
+
+/* First tick at or after tv */
+static uint64_t wheel_tick_of(const struct event_timer_wheel *w,
+			      const struct timeval *tv)
+{
+	int64_t usec = wheel_usec(w, tv);
+
+	if (usec <= 0)
+		return 0;
+
+	return ((uint64_t)usec + WHEEL_TICK_USEC - 1) / WHEEL_TICK_USEC;
+}
+
+static void wheel_tick_time(const struct event_timer_wheel *w, uint64_t tick,
+			    struct timeval *tv)
+{
+	struct timeval delta;
+
+	delta.tv_sec = tick * WHEEL_TICK_USEC / TIMER_SECOND_MICRO;
+	delta.tv_usec = tick * WHEEL_TICK_USEC % TIMER_SECOND_MICRO;
+	timeradd(&w->base, &delta, tv);
+}
+
+static void wheel_add(struct event_timer_wheel *w, struct event *event)
+{
+	uint64_t t, delta;
+	unsigned int level, slot;
+
+	t = MAX(wheel_tick_of(w, &event->u.sands), w->tick);
+	delta = t - w->tick;
+
+	for (level = 0; level < WHEEL_LEVELS - 1; level++)
+		if (delta < (1ULL << (WHEEL_BITS * (level + 1))))
+			break;
+
+	if (delta >= WHEEL_SPAN)
+		t = w->tick + WHEEL_SPAN - 1;
+
+	slot = (t >> (WHEEL_BITS * level)) & WHEEL_MASK;
+	event->wheel_slot = level * WHEEL_SLOTS + slot;
+	event_wheel_add_tail(&w->slots[event->wheel_slot], event);
+	w->occupied[level] |= 1ULL << slot;
+	w->count++;
+}
+
+static void wheel_del(struct event_timer_wheel *w, struct event *event)
+{
+	unsigned int idx = event->wheel_slot;
+
+	event_wheel_del(&w->slots[idx], event);
+	if (!event_wheel_count(&w->slots[idx]))
+		w->occupied[idx / WHEEL_SLOTS] &= ~(1ULL << (idx % WHEEL_SLOTS));
+	w->count--;
+}
+
+/* Move the timers of level's current slot down; returns the slot */
+static unsigned int wheel_cascade(struct event_timer_wheel *w,
+				  unsigned int level)
+{
+	unsigned int slot = (w->tick >> (WHEEL_BITS * level)) & WHEEL_MASK;
+	struct event_wheel_head *head = &w->slots[level * WHEEL_SLOTS + slot];
+	struct event *event;
+
+	while ((event = event_wheel_pop(head))) {
+		w->count--;
+		wheel_add(w, event);
+	}
+	w->occupied[level] &= ~(1ULL << slot);
+
+	return slot;
+}
+
+static inline uint64_t rotr64(uint64_t v, unsigned int n)
+{
+	n &= 63;
+	return n ? (v >> n) | (v << (64 - n)) : v;
+}
+
+/* Next tick with timers to run or cascade; the wheel must not be empty */
+static uint64_t wheel_next(const struct event_timer_wheel *w)
+{
+	uint64_t next = UINT64_MAX, bits, cand;
+	unsigned int level, shift, pos;
+
+	for (level = 0; level < WHEEL_LEVELS; level++) {
+		shift = WHEEL_BITS * level;
+		pos = (w->tick >> shift) & WHEEL_MASK;
+		bits = rotr64(w->occupied[level], pos);
+
+		/* Above level 0, the current slot comes round again only
+		 * after a full turn, unless we're right at its start.
+		 */
+		if (level && (w->tick & ((1ULL << shift) - 1)))
+			bits &= ~1ULL;
+		if (!bits) {
+			if (level && w->occupied[level])
+				cand = ((w->tick >> shift) + WHEEL_SLOTS) << shift;
+			else
+				continue;
+		} else
+			cand = ((w->tick >> shift) + __builtin_ctzll(bits))
+			       << shift;
+
+		next = MIN(next, cand);
+	}
+
+	return next;
+}
+
+/* Ready all timers up to now; returns the number readied */
+static unsigned int wheel_run(struct event_loop *m, const struct timeval *now)
+{
+	struct event_timer_wheel *w = m->wheel;
+	struct event_wheel_head *head;
+	unsigned int ready = 0, idx, level;
+	uint64_t end, bits;
+	int64_t usec;
+	struct event *event;
+
+	usec = wheel_usec(w, now);
+	if (usec < 0)
+		return 0;
+
+	/* one past the last tick that is due */
+	end = (uint64_t)usec / WHEEL_TICK_USEC + 1;
+
+	while (w->tick < end) {
+		if (!w->count) {
+			w->tick = end;
+			break;
+		}
+
+		idx = w->tick & WHEEL_MASK;
+		if (idx == 0)
+			for (level = 1; level < WHEEL_LEVELS; level++)
+				if (wheel_cascade(w, level))
+					break;
+
+		head = &w->slots[idx];
+		while ((event = event_wheel_pop(head))) {
+			w->count--;
+			event->type = EVENT_READY;
+			event_list_add_tail(&m->ready, event);
+			ready++;
+		}
+		w->occupied[0] &= ~(1ULL << idx);
+
+		/* Skip ahead to the next used slot, or the next cascade */
+		bits = idx == WHEEL_MASK ? 0 : w->occupied[0] >> (idx + 1);
+		if (bits)
+			w->tick += 1 + __builtin_ctzll(bits);
+		else
+			w->tick = (w->tick | WHEEL_MASK) + 1;
+		w->tick = MIN(w->tick, end);
+	}
+
+	return ready;
+}
+
+static struct event_timer_wheel *wheel_new(void)
+{
+	struct event_timer_wheel *w;
+
+	w = XCALLOC(MTYPE_EVENT_MASTER, sizeof(*w));
+	monotime(&w->base);
+	w->wait = UINT64_MAX;
+	for (unsigned int i = 0; i < array_size(w->slots); i++)
+		event_wheel_init(&w->slots[i]);
+
+	return w;
+}
+
 #define AWAKEN(m)                                                              \
 	do {                                                                   \
 		const unsigned char wakebyte = 0x01;                           \
@@ -651,6 +910,14 @@ static void show_event_timers_helper(struct vty *vty, struct event_loop *m)
 	frr_each (event_timer_list, &m->timer, event) {
 		vty_out(vty, "  %-50s%pTH\n", event->hist->funcname, event);
 	}
+
+	if (!m->wheel)
+		return;
+
+	for (unsigned int i = 0; i < array_size(m->wheel->slots); i++)
+		frr_each (event_wheel, &m->wheel->slots[i], event)
+			vty_out(vty, "  %-50s%pTH (wheel)\n",
+				event->hist->funcname, event);
 }
 
 DEFPY_NOSH (show_event_timers,
@@ -734,11 +1001,361 @@ static void get_fd_stat(int fd, struct stat *fd_stat, bool *fd_closed)
 }
 #endif
 
+#if URING_ENABLED
+/*
+ * io_uring backend.
+ *
+ * The fd bookkeeping is the same as for epoll; instead of epoll_ctl(),
+ * every fd with events gets a oneshot poll in the ring, which is re-armed
+ * as the loop updates the fd's events, same as it would update the epoll
+ * set.  All changes are batched into the io_uring_enter() that also waits
+ * for the next events.  The io_pipe poker is watched by a multishot poll.
+ *
+ * Async reads/writes go to the ring as they are, and their events are
+ * readied when the transfer completes.
+ *
+ * Only the owning pthread touches the ring.
+ */
+#define URING_ENTRIES 256
+
+static inline bool event_uring(const struct event_loop *m)
+{
+	return m->handler.uring != NULL;
+}
+
+/* user_data of ring requests: kind in the low 2 bits */
+#define URING_UD_IGNORE 0ULL
+#define URING_UD_WAKE	1ULL
+#define URING_UD_POLL	2ULL
+#define URING_UD_IO	3ULL
+#define URING_UD_KIND(ud) ((ud) & 3ULL)
+
+/* polls: fd in the upper 32 bits, tag in bits 2-31 */
+#define URING_GEN_MASK 0x3fffffffU
+
+static inline uint64_t uring_ud_poll(int fd, uint32_t gen)
+{
+	return ((uint64_t)(uint32_t)fd << 32) | ((uint64_t)gen << 2) |
+	       URING_UD_POLL;
+}
+
+/* async transfers: the event, which is at least 4-byte aligned */
+static inline uint64_t uring_ud_io(struct event *event)
+{
+	return (uint64_t)(uintptr_t)event | URING_UD_IO;
+}
+
+static struct io_uring_sqe *uring_get_sqe(struct event_loop *m)
+{
+	struct io_uring_sqe *sqe;
+
+	sqe = io_uring_get_sqe(m->handler.uring);
+	if (!sqe) {
+		/* Submission queue is full, hand it to the kernel now */
+		io_uring_submit(m->handler.uring);
+		sqe = io_uring_get_sqe(m->handler.uring);
+	}
+
+	assert(sqe);
+	return sqe;
+}
+
+static void uring_arm_wake(struct event_loop *m)
+{
+	struct io_uring_sqe *sqe = uring_get_sqe(m);
+
+	io_uring_prep_poll_multishot(sqe, m->io_pipe[0], POLLIN);
+	io_uring_sqe_set_data64(sqe, URING_UD_WAKE);
+}
+
+/* Make the poll in the ring match the fd's events; owning pthread only */
+static void uring_poll_update(struct event_loop *m, struct frr_epoll_event *ev)
+{
+	struct io_uring_sqe *sqe;
+	int fd = ev->ev.data.fd;
+
+	if (ev->uring_events == ev->ev.events)
+		return;
+
+	if (ev->uring_events) {
+		sqe = uring_get_sqe(m);
+		io_uring_prep_poll_remove(sqe, uring_ud_poll(fd, ev->uring_gen));
+		io_uring_sqe_set_data64(sqe, URING_UD_IGNORE);
+		ev->uring_events = 0;
+	}
+
+	if (ev->ev.events) {
+		m->handler.uring_gen = (m->handler.uring_gen + 1) & URING_GEN_MASK;
+		ev->uring_gen = m->handler.uring_gen;
+		ev->uring_events = ev->ev.events;
+
+		sqe = uring_get_sqe(m);
+		io_uring_prep_poll_add(sqe, fd, ev->ev.events);
+		io_uring_sqe_set_data64(sqe, uring_ud_poll(fd, ev->uring_gen));
+	}
+}
+
+/* The fd's events changed; the loop's lock is held */
+static void uring_poll_changed(struct event_loop *m, struct frr_epoll_event *ev)
+{
+	if (pthread_self() == m->owner)
+		uring_poll_update(m, ev);
+	else if (!epoll_uring_dirty_anywhere(ev))
+		epoll_uring_dirty_add_tail(&m->handler.uring_dirty, ev);
+}
+
+/* The fd is about to be dropped; owning pthread only */
+static void uring_poll_forget(struct event_loop *m, struct frr_epoll_event *ev)
+{
+	if (epoll_uring_dirty_anywhere(ev))
+		epoll_uring_dirty_del(&m->handler.uring_dirty, ev);
+
+	ev->ev.events = 0;
+	uring_poll_update(m, ev);
+}
+
+static void uring_submit_async(struct event_loop *m, struct event *event)
+{
+	struct io_uring_sqe *sqe = uring_get_sqe(m);
+
+	if (event->add_type == EVENT_READ)
+		io_uring_prep_read(sqe, event->u.fd, event->io.iov_base,
+				   event->io.iov_len, -1);
+	else
+		io_uring_prep_write(sqe, event->u.fd, event->io.iov_base,
+				    event->io.iov_len, -1);
+	io_uring_sqe_set_data64(sqe, uring_ud_io(event));
+
+	m->handler.uring_inflight++;
+}
+
+/* Queue what other pthreads left for the ring; the loop's lock is held */
+static void uring_flush(struct event_loop *m)
+{
+	struct frr_epoll_event *ev;
+	struct event *event;
+
+	while ((ev = epoll_uring_dirty_pop(&m->handler.uring_dirty)))
+		uring_poll_update(m, ev);
+
+	while ((event = event_list_pop(&m->handler.uring_async)))
+		uring_submit_async(m, event);
+}
+
+/*
+ * Reap completions: finished transfers are readied right away, poll
+ * results are appended to .revents for thread_process_io().  The
+ * transfer of 'cancelled' is dropped.  The loop's lock is held.
+ */
+static void uring_reap(struct event_loop *m, struct event *cancelled)
+{
+	struct frr_epoll_event set_ev = {};
+	struct frr_epoll_event *hash_ev;
+	struct epoll_event *revent;
+	struct io_uring_cqe *cqe;
+	struct event *event;
+	uint64_t ud;
+
+	while (io_uring_peek_cqe(m->handler.uring, &cqe) == 0) {
+		ud = io_uring_cqe_get_data64(cqe);
+
+		switch (URING_UD_KIND(ud)) {
+		case URING_UD_IGNORE:
+			break;
+
+		case URING_UD_WAKE:
+			if (!(cqe->flags & IORING_CQE_F_MORE))
+				uring_arm_wake(m);
+			break;
+
+		case URING_UD_POLL:
+			set_ev.ev.data.fd = (int)(ud >> 32);
+			hash_ev = epoll_event_hash_find(&m->handler.epoll_event_hash,
+							&set_ev);
+
+			/* Removed or re-armed since */
+			if (!hash_ev || !hash_ev->uring_events ||
+			    hash_ev->uring_gen != ((ud >> 2) & URING_GEN_MASK))
+				break;
+
+			hash_ev->uring_events = 0;
+			if (cqe->res == -ECANCELED)
+				break;
+
+			/* No room left, poll again next time around */
+			if (m->handler.uring_revents == m->handler.eventsize) {
+				uring_poll_update(m, hash_ev);
+				break;
+			}
+
+			revent = &m->handler.revents[m->handler.uring_revents++];
+			revent->data.fd = set_ev.ev.data.fd;
+			revent->events = cqe->res < 0 ? EPOLLERR : (uint32_t)cqe->res;
+			break;
+
+		case URING_UD_IO:
+			event = (struct event *)(uintptr_t)(ud & ~3ULL);
+			m->handler.uring_inflight--;
+			event->io.iov_base = NULL;
+
+			if (event == cancelled)
+				break;
+
+			if (event->add_type == EVENT_READ)
+				m->read[event->u.fd] = NULL;
+			else
+				m->write[event->u.fd] = NULL;
+
+			event->u.val = cqe->res;
+			event->type = EVENT_READY;
+			event_list_add_tail(&m->ready, event);
+			break;
+		}
+
+		io_uring_cqe_seen(m->handler.uring, cqe);
+	}
+}
+
+/*
+ * Cancel an async transfer and wait for the kernel to let go of its
+ * buffer; owning pthread only, with the loop's lock held.
+ */
+static void uring_async_cancel(struct event_loop *m, struct event *event)
+{
+	struct io_uring_sqe *sqe;
+
+	/* Not submitted yet */
+	if (event_list_del(&m->handler.uring_async, event))
+		return;
+
+	sqe = uring_get_sqe(m);
+	io_uring_prep_cancel64(sqe, uring_ud_io(event), 0);
+	io_uring_sqe_set_data64(sqe, URING_UD_IGNORE);
+
+	while (event->io.iov_base) {
+		io_uring_submit_and_wait(m->handler.uring, 1);
+		uring_reap(m, event);
+	}
+}
+
+/* Set up the ring for a new loop; false if io_uring can't be used */
+static bool uring_init(struct event_loop *m)
+{
+	int ret;
+
+	m->handler.uring = XCALLOC(MTYPE_EVENT_MASTER, sizeof(struct io_uring));
+
+	ret = io_uring_queue_init(URING_ENTRIES, m->handler.uring, 0);
+	if (ret < 0) {
+		zlog_warn("%s: io_uring unavailable, using epoll: %s",
+			  m->name, safe_strerror(-ret));
+		XFREE(MTYPE_EVENT_MASTER, m->handler.uring);
+		return false;
+	}
+
+	/* Saves looking up the ring's fd on every io_uring_enter() */
+	io_uring_register_ring_fd(m->handler.uring);
+
+	epoll_uring_dirty_init(&m->handler.uring_dirty);
+	event_list_init(&m->handler.uring_async);
+
+	uring_arm_wake(m);
+	return true;
+}
+
+/*
+ * Submit everything queued and wait for completions, the same way
+ * epoll_pwait() would: timeout in milliseconds, -1 to block.  Returns the
+ * number of completions and pending poll results.
+ */
+static int uring_wait(struct event_loop *m, int timeout, sigset_t *sigmask)
+{
+	struct __kernel_timespec ts, *tsp = NULL;
+	struct io_uring_cqe *cqe;
+	int ret;
+
+	/* Poll results left over from cancellations are already in */
+	if (m->handler.uring_revents)
+		timeout = 0;
+
+	if (timeout >= 0) {
+		ts.tv_sec = timeout / 1000;
+		ts.tv_nsec = (timeout % 1000) * 1000000LL;
+		tsp = &ts;
+	}
+
+	ret = io_uring_submit_and_wait_timeout(m->handler.uring, &cqe, 1, tsp,
+					       sigmask);
+	if (ret < 0 && ret != -ETIME) {
+		errno = -ret;
+		return -1;
+	}
+
+	return io_uring_cq_ready(m->handler.uring) + m->handler.uring_revents;
+}
+
+/* Hand an async transfer to the ring; the loop's lock is held */
+static void uring_queue_async(struct event_loop *m, struct event *event)
+{
+	if (pthread_self() == m->owner)
+		uring_submit_async(m, event);
+	else
+		event_list_add_tail(&m->handler.uring_async, event);
+}
+
+/* Async transfers the ring hasn't completed yet */
+static inline bool uring_async_pending(const struct event_loop *m)
+{
+	return m->handler.uring_inflight ||
+	       event_list_count(&m->handler.uring_async);
+}
+#else
+static inline bool event_uring(const struct event_loop *m)
+{
+	return false;
+}
+
+static inline void uring_flush(struct event_loop *m)
+{
+}
+
+static inline void uring_queue_async(struct event_loop *m, struct event *event)
+{
+}
+
+static inline void uring_async_cancel(struct event_loop *m, struct event *event)
+{
+}
+
+static inline bool uring_async_pending(const struct event_loop *m)
+{
+	return false;
+}
+
+#if EPOLL_ENABLED
+static inline void uring_poll_changed(struct event_loop *m,
+				      struct frr_epoll_event *ev)
+{
+}
+
+static inline void uring_poll_forget(struct event_loop *m,
+				     struct frr_epoll_event *ev)
+{
+}
+#endif
+#endif
+
 #define STUPIDLY_LARGE_FD_SIZE 100000
 
 static bool fd_limit_large_warned;
 
 struct event_loop *event_master_create(const char *name)
+{
+	return event_master_create_backend(name, EVENT_BACKEND_DEFAULT);
+}
+
+struct event_loop *event_master_create_backend(const char *name,
+					       enum event_backend backend)
 {
 	struct event_loop *rv;
 	struct rlimit limit;
@@ -789,6 +1406,8 @@ struct event_loop *event_master_create(const char *name)
 	event_list_init(&rv->ready);
 	event_list_init(&rv->unuse);
 	event_timer_list_init(&rv->timer);
+	if (frr_get_timer_wheel())
+		rv->wheel = wheel_new();
 
 	/* Initialize event_fetch() settings */
 	rv->spin = true;
@@ -831,7 +1450,15 @@ struct event_loop *event_master_create(const char *name)
 	rv->handler.fd_poll_counter =
 		XCALLOC(MTYPE_EVENT_MASTER,
 			sizeof(unsigned long) * rv->handler.eventsize);
+#endif
+#if URING_ENABLED
+	if (backend == EVENT_BACKEND_IO_URING ||
+	    (backend == EVENT_BACKEND_DEFAULT && frr_get_io_uring()))
+		uring_init(rv);
 #else
+	(void)backend;
+#endif
+#if !EPOLL_ENABLED
 	/* Initialize data structures for poll() */
 	rv->handler.pfdsize = rv->fd_limit;
 	rv->handler.pfdcount = 0;
@@ -852,6 +1479,27 @@ struct event_loop *event_master_create(const char *name)
 	return rv;
 }
 
+void event_master_set_timer_wheel(struct event_loop *m, bool enable)
+{
+	struct event *event;
+
+	frr_with_mutex (&m->mtx) {
+		if (enable && !m->wheel) {
+			m->wheel = wheel_new();
+		} else if (!enable && m->wheel) {
+			/* Hand the wheel's timers back to the heap */
+			for (unsigned int i = 0; i < array_size(m->wheel->slots);
+			     i++)
+				while ((event = event_wheel_pop(
+						&m->wheel->slots[i])))
+					event_timer_list_add(&m->timer, event);
+			XFREE(MTYPE_EVENT_MASTER, m->wheel);
+		}
+
+		AWAKEN(m);
+	}
+}
+
 void event_master_set_name(struct event_loop *master, const char *name)
 {
 	frr_with_mutex (&master->mtx) {
@@ -920,10 +1568,24 @@ void event_master_free(struct event_loop *m)
 			list_delete(&masters);
 	}
 
+#if URING_ENABLED
+	/* Tears down any transfers still in flight */
+	if (m->handler.uring) {
+		io_uring_queue_exit(m->handler.uring);
+		XFREE(MTYPE_EVENT_MASTER, m->handler.uring);
+	}
+#endif
+
 	thread_array_free(m, m->read);
 	thread_array_free(m, m->write);
 	while ((t = event_timer_list_pop(&m->timer)))
 		thread_free(m, t);
+	if (m->wheel) {
+		for (unsigned int i = 0; i < array_size(m->wheel->slots); i++)
+			while ((t = event_wheel_pop(&m->wheel->slots[i])))
+				thread_free(m, t);
+		XFREE(MTYPE_EVENT_MASTER, m->wheel);
+	}
 	thread_list_free(m, &m->event);
 	thread_list_free(m, &m->ready);
 	thread_list_free(m, &m->unuse);
@@ -1170,6 +1832,14 @@ static int fd_poll(struct event_loop *m, const struct timeval *timer_wait,
 	}
 #endif /* timeout computation */
 
+#if URING_ENABLED
+	if (event_uring(m)) {
+		num = uring_wait(m, timeout, &origsigs);
+		pthread_sigmask(SIG_SETMASK, &origsigs, NULL);
+		goto done;
+	}
+#endif
+
 #if defined(USE_EPOLL) && defined(HAVE_EPOLL_PWAIT)
 	num = epoll_pwait(m->handler.epoll_fd, m->handler.revents, m->handler.eventsize,
 			  timeout, &origsigs);
@@ -1252,7 +1922,10 @@ static void add_epoll_rw_helper(struct event_loop *m, int fd, int dir)
 		/* Union epoll IN/OUT events */
 		set_ev.ev.events |= hash_ev->ev.events;
 
-		if (!is_regular) {
+		if (!is_regular && event_uring(m)) {
+			hash_ev->ev.events = set_ev.ev.events;
+			uring_poll_changed(m, hash_ev);
+		} else if (!is_regular) {
 			if (epoll_ctl(m->handler.epoll_fd, EPOLL_CTL_MOD, fd,
 				      &(set_ev.ev)) == -1) {
 				/* Not regular file, modify the entry in the epoll set */
@@ -1284,7 +1957,7 @@ static void add_epoll_rw_helper(struct event_loop *m, int fd, int dir)
 
 	} else {
 		/* New fd */
-		if (!is_regular) {
+		if (!is_regular && !event_uring(m)) {
 			/* Not regular file, add into the epoll set */
 			ret = epoll_ctl(m->handler.epoll_fd, EPOLL_CTL_ADD, fd,
 					&set_ev.ev);
@@ -1310,14 +1983,59 @@ static void add_epoll_rw_helper(struct event_loop *m, int fd, int dir)
 		 * don't expect to find it in the hash now
 		 */
 		assert(tmp_ev == NULL);
+
+		if (!is_regular && event_uring(m))
+			uring_poll_changed(m, hash_ev);
 	}
 }
 #endif /* EPOLL */
 
 /* Add new read thread. */
-void _event_add_read_write(const struct xref_eventsched *xref,
-			   struct event_loop *m, void (*func)(struct event *),
-			   void *arg, int fd, struct event **t_ptr)
+/* Add fd to the poll set for dir; we expect the loop's lock to be held */
+static void add_rw_poll(struct event_loop *m, int fd, int dir)
+{
+#if EPOLL_ENABLED
+	add_epoll_rw_helper(m, fd, dir);
+#else
+	/* default to a new pollfd */
+	nfds_t queuepos = m->handler.pfdcount;
+
+	/*
+	 * if we already have a pollfd for our file descriptor, find and
+	 * use it
+	 */
+	for (nfds_t i = 0; i < m->handler.pfdcount; i++) {
+		if (m->handler.pfds[i].fd == fd) {
+			queuepos = i;
+			break;
+		}
+		/*
+		 * We are setting the fd = -1 for the
+		 * case when a read/write event is going
+		 * away.  if we find a -1 we can stuff it
+		 * into that spot, so note it
+		 */
+		if (m->handler.pfds[i].fd == -1 && queuepos == m->handler.pfdcount)
+			queuepos = i;
+	}
+
+	/* make sure we have room for this fd + pipe poker fd */
+	assert(queuepos + 1 < m->handler.pfdsize);
+
+	m->handler.pfds[queuepos].fd = fd;
+	m->handler.pfds[queuepos].events |=
+		(dir == EVENT_READ ? POLLIN : POLLOUT);
+
+	if (queuepos == m->handler.pfdcount)
+		m->handler.pfdcount++;
+#endif
+}
+
+static void event_add_read_write_buf(const struct xref_eventsched *xref,
+				     struct event_loop *m,
+				     void (*func)(struct event *), void *arg,
+				     int fd, void *buf, size_t len,
+				     struct event **t_ptr)
 {
 	int dir = xref->event_type;
 	struct event *event = NULL;
@@ -1341,41 +2059,9 @@ void _event_add_read_write(const struct xref_eventsched *xref,
 		if (t_ptr && *t_ptr)
 			break;
 
-#if EPOLL_ENABLED
-		add_epoll_rw_helper(m, fd, dir);
-#else
-		/* default to a new pollfd */
-		nfds_t queuepos = m->handler.pfdcount;
-
-		/*
-		 * if we already have a pollfd for our file descriptor, find and
-		 * use it
-		 */
-		for (nfds_t i = 0; i < m->handler.pfdcount; i++) {
-			if (m->handler.pfds[i].fd == fd) {
-				queuepos = i;
-				break;
-			}
-			/*
-			 * We are setting the fd = -1 for the
-			 * case when a read/write event is going
-			 * away.  if we find a -1 we can stuff it
-			 * into that spot, so note it
-			 */
-			if (m->handler.pfds[i].fd == -1 && queuepos == m->handler.pfdcount)
-				queuepos = i;
-		}
-
-		/* make sure we have room for this fd + pipe poker fd */
-		assert(queuepos + 1 < m->handler.pfdsize);
-
-		m->handler.pfds[queuepos].fd = fd;
-		m->handler.pfds[queuepos].events |=
-			(dir == EVENT_READ ? POLLIN : POLLOUT);
-
-		if (queuepos == m->handler.pfdcount)
-			m->handler.pfdcount++;
-#endif
+		/* The ring does async transfers without polling the fd */
+		if (!buf || !event_uring(m))
+			add_rw_poll(m, fd, dir);
 
 		if (dir == EVENT_READ)
 			thread_array = m->read;
@@ -1396,6 +2082,8 @@ void _event_add_read_write(const struct xref_eventsched *xref,
 		if (event) {
 			frr_with_mutex (&event->mtx) {
 				event->u.fd = fd;
+				event->io.iov_base = buf;
+				event->io.iov_len = len;
 				thread_array[event->u.fd] = event;
 			}
 
@@ -1403,17 +2091,37 @@ void _event_add_read_write(const struct xref_eventsched *xref,
 				*t_ptr = event;
 				event->ref = t_ptr;
 			}
+
+			if (buf && event_uring(m))
+				uring_queue_async(m, event);
 		}
 
 		AWAKEN(m);
 	}
 }
 
+void _event_add_read_write(const struct xref_eventsched *xref,
+			   struct event_loop *m, void (*func)(struct event *),
+			   void *arg, int fd, struct event **t_ptr)
+{
+	event_add_read_write_buf(xref, m, func, arg, fd, NULL, 0, t_ptr);
+}
+
+void _event_add_read_write_async(const struct xref_eventsched *xref,
+				 struct event_loop *m,
+				 void (*func)(struct event *), void *arg,
+				 int fd, void *buf, size_t len,
+				 struct event **t_ptr)
+{
+	assert(buf);
+	event_add_read_write_buf(xref, m, func, arg, fd, buf, len, t_ptr);
+}
+
 static void _event_add_timer_timeval(const struct xref_eventsched *xref,
 				     struct event_loop *m,
 				     void (*func)(struct event *), void *arg,
 				     struct timeval *time_relative,
-				     struct event **t_ptr)
+				     struct event **t_ptr, bool coarse)
 {
 	struct event *event;
 	struct timeval t;
@@ -1441,18 +2149,29 @@ static void _event_add_timer_timeval(const struct xref_eventsched *xref,
 
 		frr_with_mutex (&event->mtx) {
 			event->u.sands = t;
-			event_timer_list_add(&m->timer, event);
+			if (coarse && m->wheel)
+				wheel_add(m->wheel, event);
+			else
+				event_timer_list_add(&m->timer, event);
 			if (t_ptr) {
 				*t_ptr = event;
 				event->ref = t_ptr;
 			}
 		}
 
-		/* The timer list is sorted - if this new timer
-		 * might change the time we'll wait for, give the pthread
-		 * a chance to re-compute.
-		 */
-		if (event_timer_list_first(&m->timer) == event)
+		if (event_wheel_anywhere(event)) {
+			/* Wake the pthread if it is waiting for a later tick */
+			uint64_t tick = wheel_tick_of(m->wheel, &t);
+
+			if (tick < m->wheel->wait) {
+				m->wheel->wait = tick;
+				AWAKEN(m);
+			}
+		} else if (event_timer_list_first(&m->timer) == event)
+			/* The timer list is sorted - if this new timer
+			 * might change the time we'll wait for, give the
+			 * pthread a chance to re-compute.
+			 */
 			AWAKEN(m);
 	}
 #define ONEYEAR2SEC (60 * 60 * 24 * 365)
@@ -1475,7 +2194,7 @@ void _event_add_timer(const struct xref_eventsched *xref, struct event_loop *m,
 	trel.tv_sec = timer;
 	trel.tv_usec = 0;
 
-	_event_add_timer_timeval(xref, m, func, arg, &trel, t_ptr);
+	_event_add_timer_timeval(xref, m, func, arg, &trel, t_ptr, true);
 }
 
 /* Add timer event thread with "millisecond" resolution */
@@ -1490,7 +2209,7 @@ void _event_add_timer_msec(const struct xref_eventsched *xref,
 	trel.tv_sec = timer / 1000;
 	trel.tv_usec = 1000 * (timer % 1000);
 
-	_event_add_timer_timeval(xref, m, func, arg, &trel, t_ptr);
+	_event_add_timer_timeval(xref, m, func, arg, &trel, t_ptr, false);
 }
 
 /* Add timer event thread with "timeval" resolution */
@@ -1498,7 +2217,7 @@ void _event_add_timer_tv(const struct xref_eventsched *xref,
 			 struct event_loop *m, void (*func)(struct event *),
 			 void *arg, struct timeval *tv, struct event **t_ptr)
 {
-	_event_add_timer_timeval(xref, m, func, arg, tv, t_ptr);
+	_event_add_timer_timeval(xref, m, func, arg, tv, t_ptr, false);
 }
 
 /* Add simple event thread. */
@@ -1582,6 +2301,8 @@ static void event_cancel_rw(struct event_loop *master, int fd, short state,
 			/* Remove from list */
 			epoll_revent_list_del(&(master->handler.epoll_revents_list),
 					      hash_ev);
+		} else if (event_uring(master)) {
+			uring_poll_forget(master, hash_ev);
 		} else if (epoll_ctl(master->handler.epoll_fd, EPOLL_CTL_DEL, fd,
 				     NULL) == -1) {
 			/* Not regular file, remove the fd from the epoll set */
@@ -1598,7 +2319,9 @@ static void event_cancel_rw(struct event_loop *master, int fd, short state,
 		frr_epoll_event_del(&hash_ev);
 	} else {
 		/* Not all events are canceled */
-		if (!is_regular) {
+		if (!is_regular && event_uring(master)) {
+			uring_poll_changed(master, hash_ev);
+		} else if (!is_regular) {
 			if (epoll_ctl(master->handler.epoll_fd, EPOLL_CTL_MOD, fd,
 				      &set_ev.ev) == -1) {
 				/* Not regular file, update the fd's events
@@ -1720,6 +2443,29 @@ static bool epoll_cancel_arg_helper(struct frr_epoll_event *ev, struct event_loo
 }
 #endif
 
+/*
+ * Helper for cancelling an async transfer in the ring; check for match with
+ * cancelled 'arg' value.
+ */
+static void cancel_async_arg_helper(struct event_loop *m,
+				    struct event **thread_array, int fd,
+				    void *arg)
+{
+	struct event *t = thread_array[fd];
+
+	if (!t || !t->io.iov_base || t->arg != arg)
+		return;
+
+	uring_async_cancel(m, t);
+	thread_array[fd] = NULL;
+
+	/* Clear caller's ref */
+	if (t->ref)
+		*t->ref = NULL;
+
+	thread_add_unuse(m, t);
+}
+
 /*
  * Process task cancellation given a task argument: iterate through the
  * various lists of tasks, looking for any that match the argument.
@@ -1763,7 +2509,16 @@ static void cancel_arg_helper(struct event_loop *master,
 	if (CHECK_FLAG(cr->flags, EVENT_CANCEL_FLAG_READY))
 		return;
 
-	/* Check the io tasks */
+	/* Check the io tasks; async ones in the ring aren't in the poll set */
+	if (event_uring(master) && uring_async_pending(master)) {
+		for (int idx = 0; idx < master->fd_limit; idx++) {
+			cancel_async_arg_helper(master, master->read, idx,
+						cr->eventobj);
+			cancel_async_arg_helper(master, master->write, idx,
+						cr->eventobj);
+		}
+	}
+
 #if EPOLL_ENABLED
 	frr_each_safe(epoll_event_hash, &(master->handler.epoll_event_hash), ev) {
 		epoll_cancel_arg_helper(ev, master, cr->eventobj);
@@ -1825,6 +2580,20 @@ static void cancel_arg_helper(struct event_loop *master,
 
 		t = t_next;
 	}
+
+	if (!master->wheel)
+		return;
+
+	for (unsigned int i = 0; i < array_size(master->wheel->slots); i++) {
+		frr_each_safe (event_wheel, &master->wheel->slots[i], t) {
+			if (t->arg != cr->eventobj)
+				continue;
+			wheel_del(master->wheel, t);
+			if (t->ref)
+				*t->ref = NULL;
+			thread_add_unuse(master, t);
+		}
+	}
 }
 
 /**
@@ -1871,23 +2640,32 @@ static void do_event_cancel(struct event_loop *master)
 		/* Determine the appropriate queue to cancel the thread from */
 		switch (event->type) {
 		case EVENT_READ:
+			if (event->io.iov_base && event_uring(master))
+				uring_async_cancel(master, event);
+			else
 #if EPOLL_ENABLED
-			event_cancel_rw(master, event->u.fd, EPOLLIN, -1);
+				event_cancel_rw(master, event->u.fd, EPOLLIN, -1);
 #else
-			event_cancel_rw(master, event->u.fd, POLLIN, -1);
+				event_cancel_rw(master, event->u.fd, POLLIN, -1);
 #endif
 			thread_array = master->read;
 			break;
 		case EVENT_WRITE:
+			if (event->io.iov_base && event_uring(master))
+				uring_async_cancel(master, event);
+			else
 #if EPOLL_ENABLED
-			event_cancel_rw(master, event->u.fd, EPOLLOUT, -1);
+				event_cancel_rw(master, event->u.fd, EPOLLOUT, -1);
 #else
-			event_cancel_rw(master, event->u.fd, POLLOUT, -1);
+				event_cancel_rw(master, event->u.fd, POLLOUT, -1);
 #endif
 			thread_array = master->write;
 			break;
 		case EVENT_TIMER:
-			event_timer_list_del(&master->timer, event);
+			if (event_wheel_anywhere(event))
+				wheel_del(master->wheel, event);
+			else
+				event_timer_list_del(&master->timer, event);
 			break;
 		case EVENT_EVENT:
 			list = &master->event;
@@ -2074,18 +2852,44 @@ void event_cancel_async(struct event_loop *master, struct event **thread,
 }
 /* ------------------------------------------------------------------------- */
 
-static struct timeval *thread_timer_wait(struct event_timer_list_head *timers,
+static struct timeval *thread_timer_wait(struct event_loop *m,
 					 struct timeval *timer_val)
 {
-	if (!event_timer_list_count(timers))
-		return NULL;
+	struct event_timer_wheel *w = m->wheel;
+	struct event *next_timer = event_timer_list_first(&m->timer);
+	struct timeval next;
 
-	struct event *next_timer = event_timer_list_first(timers);
+	if (w)
+		w->wait = UINT64_MAX;
+
+	if (w && w->count) {
+		w->wait = wheel_next(w);
+		wheel_tick_time(w, w->wait, &next);
+		if (next_timer && timercmp(&next_timer->u.sands, &next, <))
+			next = next_timer->u.sands;
+	} else if (next_timer)
+		next = next_timer->u.sands;
+	else
+		return NULL;
 
-	monotime_until(&next_timer->u.sands, timer_val);
+	monotime_until(&next, timer_val);
 	return timer_val;
 }
 
+/* Do the read() / write() of an async event whose fd is ready */
+static void event_io_transfer(struct event *event)
+{
+	ssize_t ret;
+
+	if (event->add_type == EVENT_READ)
+		ret = read(event->u.fd, event->io.iov_base, event->io.iov_len);
+	else
+		ret = write(event->u.fd, event->io.iov_base, event->io.iov_len);
+
+	event->u.val = ret < 0 ? -errno : (int)ret;
+	event->io.iov_base = NULL;
+}
+
 static struct event *event_run(struct event_loop *m, struct event *event, struct event *fetch)
 {
 	*fetch = *event;
@@ -2116,7 +2920,11 @@ static int thread_process_io_helper(struct event_loop *m, struct event *event,
 	set_ev.data.fd = fd;
 	set_ev.events = hash_ev->ev.events & ~(state);
 
-	if (!is_regular) {
+	if (!is_regular && event_uring(m)) {
+		/* The poll was oneshot, re-arm it for what is left */
+		hash_ev->ev.events = set_ev.events;
+		uring_poll_changed(m, hash_ev);
+	} else if (!is_regular) {
 		if (epoll_ctl(m->handler.epoll_fd, EPOLL_CTL_MOD, fd, &set_ev) == -1) {
 			/* Not regular file, update the fd's events
 			 * from the epoll set
@@ -2194,15 +3002,17 @@ static inline void thread_process_io_inner_loop(struct event_loop *m,
 	 * and remove the fd from regular/epoll set, and hash table.
 	 */
 	if (fd_closed || (revent->events & (EPOLLHUP | EPOLLERR | EPOLLRDHUP))) {
-		/* Return any application tasks back to the application. */
+		/* Return any application tasks back to the application.
+		 * Transfers in the ring complete on their own.
+		 */
 		event = m->read[fd];
-		if (event) {
+		if (event && !(event_uring(m) && event->io.iov_base)) {
 			m->read[fd] = NULL;
 			event->type = EVENT_READY;
 			event_list_add_tail(&m->ready, event);
 		}
 		event = m->write[fd];
-		if (event) {
+		if (event && !(event_uring(m) && event->io.iov_base)) {
 			m->write[fd] = NULL;
 			event->type = EVENT_READY;
 			event_list_add_tail(&m->ready, event);
@@ -2211,6 +3021,9 @@ static inline void thread_process_io_inner_loop(struct event_loop *m,
 		if (is_regular) {
 			/* Regular file, remove the fd from list */
 			epoll_revent_list_del(&(m->handler.epoll_revents_list), hash_ev);
+		} else if (event_uring(m)) {
+			hash_ev->ev.events = 0;
+			uring_poll_forget(m, hash_ev);
 		} else {
 			/* Not regular file, remove the fd from the epoll set */
 			ret = epoll_ctl(m->handler.epoll_fd, EPOLL_CTL_DEL, fd, NULL);
@@ -2250,6 +3063,16 @@ static void thread_process_io(struct event_loop *m, int num)
 	int i;
 	struct frr_epoll_event *ev;
 
+#if URING_ENABLED
+	/* Completed transfers go straight to the ready queue, polls to
+	 * m->handler.revents
+	 */
+	if (event_uring(m)) {
+		uring_reap(m, NULL);
+		num = m->handler.uring_revents;
+	}
+#endif
+
 	/* First, handle regular file I/O events in regular events list. */
 	frr_each (epoll_revent_list, &m->handler.epoll_revents_list, ev)
 		thread_process_io_inner_loop(m, &(ev->ev));
@@ -2259,6 +3082,10 @@ static void thread_process_io(struct event_loop *m, int num)
 	 */
 	for (i = 0; i < num; ++i)
 		thread_process_io_inner_loop(m, m->handler.revents + i);
+
+#if URING_ENABLED
+	m->handler.uring_revents = 0;
+#endif
 }
 #else
 /*
@@ -2408,6 +3235,9 @@ static unsigned int thread_process_timers(struct event_loop *m,
 		ready++;
 	}
 
+	if (m->wheel)
+		ready += wheel_run(m, timenow);
+
 	return ready;
 }
 
@@ -2454,6 +3284,9 @@ static struct event *event_fetch_inner_loop(struct event_loop *m, struct event *
 		if (fetch->ref)
 			*fetch->ref = NULL;
 		pthread_mutex_unlock(&m->mtx);
+		/* fd is ready for an async transfer the ring didn't do */
+		if (fetch->io.iov_base)
+			event_io_transfer(fetch);
 		if (!m->ready_run_loop)
 			GETRUSAGE(&m->last_getrusage);
 		m->ready_run_loop = true;
@@ -2487,14 +3320,15 @@ static struct event *event_fetch_inner_loop(struct event_loop *m, struct event *
 	 * once per loop to avoid starvation by events
 	 */
 	if (!event_list_count(&m->ready))
-		tw = thread_timer_wait(&m->timer, &tv);
+		tw = thread_timer_wait(m, &tv);
 
 	if (event_list_count(&m->ready) || (tw && !timercmp(tw, &zerotime, >)))
 		tw = &zerotime;
 
 #if EPOLL_ENABLED
 	if (!tw && epoll_revent_list_count(&m->handler.epoll_revents_list) == 0 &&
-	    epoll_event_hash_count(&m->handler.epoll_event_hash) == 0) { /* die */
+	    epoll_event_hash_count(&m->handler.epoll_event_hash) == 0 &&
+	    !uring_async_pending(m)) { /* die */
 		pthread_mutex_unlock(&m->mtx);
 		*broken = true;
 		return NULL;
@@ -2520,6 +3354,10 @@ static struct event *event_fetch_inner_loop(struct event_loop *m, struct event *
 	       m->handler.copycount * sizeof(struct pollfd));
 #endif
 
+	/* Pick up ring changes made by other pthreads */
+	if (event_uring(m))
+		uring_flush(m);
+
 	pthread_mutex_unlock(&m->mtx);
 	{
 		eintr_p = false;
@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/* Fork/join worker pthreads.
+ * Runs a function over an array of independent items on a set of
+ * pthreads while the main pthread waits for the result.
+ *
+ * This is for work the main pthread would otherwise do in one go, such as
+ * sorting the paths of a batch of route nodes or resolving their nexthops.
+ * Since the main pthread is blocked until every shard is done, the items
+ * may read any daemon state that only the main pthread writes; they must
+ * only write to state owned by their own item.
+ */
+
+#include <zebra.h>
+
+#include "frr_pthread.h"
+#include "frrevent.h"
+#include "frr_workers.h"
+
+void frr_workers_start(struct frr_workers *workers, unsigned int count)
+{
+	char name[64], os_name[OS_THREAD_NAMELEN];
+	struct frr_pthread_attr attr = {
+		.start = frr_pthread_attr_default.start,
+		.stop = frr_pthread_attr_default.stop,
+	};
+	struct frr_pthread *fpt;
+
+	count = MIN(count, FRR_WORKERS_MAX);
+
+	while (workers->started < count) {
+		snprintf(name, sizeof(name), "%s %u", workers->name,
+			 workers->started);
+		snprintf(os_name, sizeof(os_name), "%s%u", workers->os_name,
+			 workers->started);
+
+		fpt = frr_pthread_new(&attr, name, os_name);
+		frr_pthread_run(fpt, NULL);
+		frr_pthread_wait_running(fpt);
+
+		workers->pths[workers->started++] = fpt;
+	}
+}
+
+static void frr_workers_work(struct event *event)
+{
+	struct frr_workers_shard *shard = EVENT_ARG(event);
+	struct frr_workers *workers = shard->workers;
+
+	for (unsigned int i = 0; i < shard->count; i++)
+		workers->func(shard->items + i * workers->item_size);
+
+	frr_with_mutex (&workers->mtx) {
+		if (--workers->pending == 0)
+			pthread_cond_signal(&workers->cond);
+	}
+}
+
+void frr_workers_run(struct frr_workers *workers, unsigned int nthreads,
+		     void *items, size_t item_size, unsigned int count,
+		     void (*func)(void *item))
+{
+	unsigned int nshards, per, extra;
+	struct frr_workers_shard *shard;
+	char *pos = items;
+
+	nshards = MIN(MIN(nthreads, workers->started), count);
+	if (!nshards) {
+		for (unsigned int i = 0; i < count; i++)
+			func(pos + i * item_size);
+		return;
+	}
+
+	workers->func = func;
+	workers->item_size = item_size;
+
+	per = count / nshards;
+	extra = count % nshards;
+
+	frr_with_mutex (&workers->mtx) {
+		workers->pending = nshards;
+	}
+
+	for (unsigned int i = 0; i < nshards; i++) {
+		shard = &workers->shards[i];
+		shard->workers = workers;
+		shard->items = pos;
+		shard->count = per + (i < extra ? 1 : 0);
+		pos += shard->count * item_size;
+
+		event_add_event(workers->pths[i]->master, frr_workers_work,
+				shard, 0, NULL);
+	}
+
+	frr_with_mutex (&workers->mtx) {
+		while (workers->pending)
+			pthread_cond_wait(&workers->cond, &workers->mtx);
+	}
+}
@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/* Fork/join worker pthreads.
+ * Runs a function over an array of independent items on a set of
+ * pthreads while the main pthread waits for the result.
+ */
+
+#ifndef _FRR_WORKERS_H
+#define _FRR_WORKERS_H
+
+#include "frr_pthread.h"
+
+/* Upper bound for the size of any pool */
+#define FRR_WORKERS_MAX 64U
+
+struct frr_workers;
+
+struct frr_workers_shard {
+	struct frr_workers *workers;
+
+	char *items;
+	unsigned int count;
+};
+
+struct frr_workers {
+	/* pthread names, suffixed with the pthread number */
+	const char *name;
+	const char *os_name;
+
+	void (*func)(void *item);
+	size_t item_size;
+
+	/* pthreads are only ever added; they are stopped on shutdown by
+	 * frr_pthread_stop_all().
+	 */
+	struct frr_pthread *pths[FRR_WORKERS_MAX];
+	unsigned int started;
+
+	struct frr_workers_shard shards[FRR_WORKERS_MAX];
+
+	pthread_mutex_t mtx;
+	pthread_cond_t cond;
+	unsigned int pending; // guarded by mtx
+};
+
+#define FRR_WORKERS_INIT(name_, os_name_)                                      \
+	{                                                                      \
+		.name = (name_), .os_name = (os_name_),                        \
+		.mtx = PTHREAD_MUTEX_INITIALIZER,                              \
+		.cond = PTHREAD_COND_INITIALIZER,                              \
+	}
+
+/* Make sure at least count pthreads are running */
+extern void frr_workers_start(struct frr_workers *workers,
+			      unsigned int count);
+
+/*
+ * Call func for each of the count items of item_size bytes at items,
+ * split into contiguous shards over up to nthreads pthreads, and wait for
+ * all of them.  With nthreads 0 the items are handled on the calling
+ * pthread.
+ *
+ * The caller is blocked for the duration, so func only races other
+ * invocations of itself.
+ */
+extern void frr_workers_run(struct frr_workers *workers, unsigned int nthreads,
+			    void *items, size_t item_size, unsigned int count,
+			    void (*func)(void *item));
+
+#endif /* _FRR_WORKERS_H */
@@ -16,6 +16,7 @@
 #include <zebra.h>
 #include <pthread.h>
 #include <poll.h>
+#include <sys/uio.h>
 #if EPOLL_ENABLED
 #include <sys/epoll.h>
 #endif
@@ -47,6 +48,7 @@ struct rusage_t {
 
 PREDECL_LIST(event_list);
 PREDECL_HEAP(event_timer_list);
+PREDECL_DLIST(event_wheel);
 
 struct xref_eventsched {
 	struct xref xref;
@@ -75,6 +77,8 @@ struct event {
 	enum event_types add_type; /* event type as it was created */
 	struct event_list_item eventitem;
 	struct event_timer_list_item timeritem;
+	struct event_wheel_item wheelitem; /* if on the timer wheel */
+	unsigned int wheel_slot;
 	struct event **ref;	      /* external reference (if given) */
 	struct event_loop *master;    /* pointer to the struct event_loop */
 	void (*func)(struct event *e); /* event function */
@@ -84,6 +88,7 @@ struct event {
 		int fd;		      /* file descriptor in case of r/w */
 		struct timeval sands; /* rest of time sands value. */
 	} u;
+	struct iovec io;	      /* buffer of async r/w, until done */
 	struct timeval real;
 	struct cpu_event_history *hist;	    /* cache pointer to cpu_history */
 	unsigned long yield;		    /* yield time in microseconds */
@@ -175,6 +180,33 @@ static inline unsigned long timeval_elapsed(struct timeval a, struct timeval b)
 	_xref_t_a(timer_tv, TIMER, m, f, a, v, t)
 #define event_add_event(m, f, a, v, t) _xref_t_a(event, EVENT, m, f, a, v, t)
 
+#define _xref_t_a_async(type, m, f, a, fd, buf, len, t)                        \
+	({                                                                     \
+		static const struct xref_eventsched _xref __attribute__(       \
+			(used)) = {                                            \
+			.xref = XREF_INIT(XREFT_EVENTSCHED, NULL, __func__),   \
+			.funcname = #f,                                        \
+			.dest = #t,                                            \
+			.event_type = EVENT_##type,                            \
+		};                                                             \
+		XREF_LINK(_xref.xref);                                         \
+		_event_add_read_write_async(&_xref, m, f, a, fd, buf, len, t); \
+	}) /* end */
+
+/*
+ * Read up to len bytes from fd into buf, or write len bytes from buf to
+ * fd, and then run f.  EVENT_VAL() is the result of the read() / write(),
+ * or -errno on failure.  buf must stay valid until f runs or the event is
+ * cancelled.
+ *
+ * With the io_uring backend the kernel does the transfer on its own;
+ * otherwise it is done by the event loop as soon as fd is ready.
+ */
+#define event_add_read_async(m, f, a, fd, buf, len, t)                         \
+	_xref_t_a_async(READ, m, f, a, fd, buf, len, t)
+#define event_add_write_async(m, f, a, fd, buf, len, t)                        \
+	_xref_t_a_async(WRITE, m, f, a, fd, buf, len, t)
+
 #define event_execute(m, f, a, v, p)                                           \
 	({                                                                     \
 		static const struct xref_eventsched _xref __attribute__(       \
@@ -188,16 +220,43 @@ static inline unsigned long timeval_elapsed(struct timeval a, struct timeval b)
 		_event_execute(&_xref, m, f, a, v, p);                         \
 	}) /* end */
 
+/* I/O backends of an event loop */
+enum event_backend {
+	/* io_uring if the daemon was started with --io-uring, else poll */
+	EVENT_BACKEND_DEFAULT = 0,
+	/* epoll() or poll(), whichever the platform has */
+	EVENT_BACKEND_POLL,
+	/* io_uring, falling back to poll if unavailable */
+	EVENT_BACKEND_IO_URING,
+};
+
 /* Prototypes. */
 extern struct event_loop *event_master_create(const char *name);
+extern struct event_loop *event_master_create_backend(const char *name,
+						       enum event_backend backend);
 void event_master_set_name(struct event_loop *master, const char *name);
 extern void event_master_free(struct event_loop *m);
 
+/*
+ * Keep the loop's second resolution timers, event_add_timer(), on a
+ * hierarchical timer wheel instead of the timer heap: adding and
+ * cancelling them is O(1), at the cost of firing up to 10ms late.
+ * Meant for loops with lots of per-neighbor keepalive / hold timers.
+ * Millisecond timers always stay on the heap.
+ */
+extern void event_master_set_timer_wheel(struct event_loop *m, bool enable);
+
 extern void _event_add_read_write(const struct xref_eventsched *xref,
 				  struct event_loop *master,
 				  void (*fn)(struct event *), void *arg, int fd,
 				  struct event **tref);
 
+extern void _event_add_read_write_async(const struct xref_eventsched *xref,
+					struct event_loop *master,
+					void (*fn)(struct event *), void *arg,
+					int fd, void *buf, size_t len,
+					struct event **tref);
+
 extern void _event_add_timer(const struct xref_eventsched *xref,
 			     struct event_loop *master,
 			     void (*fn)(struct event *), void *arg, long t,
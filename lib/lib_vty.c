@@ -81,6 +81,24 @@ static int show_memory_mallinfo(struct vty *vty)
 }
 #endif /* HAVE_MALLINFO */
 
+static void qmem_slab_json(struct json_object *jmt, struct memtype *mt)
+{
+	struct json_object *jslab;
+	struct memslab_stats st;
+
+	if (!qmem_slab_stats(mt, &st))
+		return;
+
+	jslab = json_object_new_object();
+	json_object_int_add(jslab, "objectSize", st.objsize);
+	json_object_int_add(jslab, "pages", st.pages);
+	json_object_int_add(jslab, "pagesPartial", st.pages_partial);
+	json_object_int_add(jslab, "slots", st.pages * st.per_page);
+	json_object_int_add(jslab, "slotsUsed", st.used);
+	json_object_int_add(jslab, "slotsStranded", st.stranded);
+	json_object_object_add(jmt, "slab", jslab);
+}
+
 struct qmem_walk_json_arg {
 	struct json_object *json;
 	struct json_object *current_group;
@@ -133,6 +151,28 @@ static int qmem_walker(void *arg, struct memgroup *mg, struct memtype *mt)
 	return 0;
 }
 
+static int qmem_walker_slab(void *arg, struct memgroup *mg, struct memtype *mt)
+{
+	struct vty *vty = arg;
+	struct memslab_stats st;
+	size_t slots, live;
+
+	if (!mt || !qmem_slab_stats(mt, &st))
+		return 0;
+
+	slots = st.pages * st.per_page;
+	live = MIN(mt->n_alloc, st.used);
+
+	/* occupancy: live objects per slot mapped;
+	 * fragmentation: free slots pinned by partially used pages
+	 */
+	vty_out(vty, "%-30s: %7zu %6zu %8zu %7zu %8.1f%% %8.1f%%\n", mt->name,
+		st.objsize, st.pages, live, st.used - live,
+		slots ? 100.0 * live / slots : 0.0,
+		slots ? 100.0 * st.stranded / slots : 0.0);
+	return 0;
+}
+
 static int qmem_walker_json(void *arg, struct memgroup *mg, struct memtype *mt)
 {
 	struct qmem_walk_json_arg *jarg = arg;
@@ -156,6 +196,7 @@ static int qmem_walker_json(void *arg, struct memgroup *mg, struct memtype *mt)
 #ifdef HAVE_MALLOC_USABLE_SIZE
 			json_object_int_add(jmt, "maxBytes", mt->max_size);
 #endif
+			qmem_slab_json(jmt, mt);
 
 			json_object_array_add(jarg->current_group, jmt);
 		}
@@ -189,6 +230,11 @@ DEFUN_NOSH (show_memory,
 #endif /* HAVE_MALLINFO */
 
 		qmem_walk(qmem_walker, vty);
+
+		vty_out(vty, "--- slab caches ---\n");
+		vty_out(vty, "%-30s: %7s %6s %8s %7s %9s %9s\n", "Type", "ObjSize",
+			"Pages", "Live#", "Cached#", "Occupancy", "Fragment");
+		qmem_walk(qmem_walker_slab, vty);
 	}
 
 	return CMD_SUCCESS;
@@ -104,6 +104,8 @@ static void opt_extend(const struct optspec *os)
 #define OPTION_LOGGING   1007
 #define OPTION_LIMIT_FDS 1008
 #define OPTION_SCRIPTDIR 1009
+#define OPTION_IO_URING  1010
+#define OPTION_TIMER_WHEEL 1011
 
 static const struct option lo_always[] = {
 	{ "help", no_argument, NULL, 'h' },
@@ -124,6 +126,8 @@ static const struct option lo_always[] = {
 	{ "log-level", required_argument, NULL, OPTION_LOGLEVEL },
 	{ "command-log-always", no_argument, NULL, OPTION_LOGGING },
 	{ "limit-fds", required_argument, NULL, OPTION_LIMIT_FDS },
+	{ "io-uring", no_argument, NULL, OPTION_IO_URING },
+	{ "timer-wheel", no_argument, NULL, OPTION_TIMER_WHEEL },
 	{ NULL }
 };
 static const struct optspec os_always = {
@@ -148,7 +152,9 @@ static const struct optspec os_always = {
 	"      --log          Set Logging to stdout, syslog, or file:<name>\n"
 	"      --log-level    Set Logging Level to use, debug, info, warn, etc\n"
 	"      --command-log-always Always log every command, cannot be turned off\n"
-	"      --limit-fds    Limit number of fds supported\n",
+	"      --limit-fds    Limit number of fds supported\n"
+	"      --io-uring     Use io_uring for event loops, if available\n"
+	"      --timer-wheel  Keep second resolution timers on a timer wheel\n",
 	lo_always
 };
 
@@ -654,6 +660,12 @@ static int frr_opt(int opt)
 	case OPTION_LIMIT_FDS:
 		di->limit_fds = strtoul(optarg, &err, 0);
 		break;
+	case OPTION_IO_URING:
+		di->io_uring = true;
+		break;
+	case OPTION_TIMER_WHEEL:
+		di->timer_wheel = true;
+		break;
 	default:
 		return 1;
 	}
@@ -871,6 +883,16 @@ uint32_t frr_get_fd_limit(void)
 	return di ? di->limit_fds : 0;
 }
 
+bool frr_get_io_uring(void)
+{
+	return di ? di->io_uring : false;
+}
+
+bool frr_get_timer_wheel(void)
+{
+	return di ? di->timer_wheel : false;
+}
+
 static int rcvd_signal = 0;
 
 static void rcv_signal(int signum)
@@ -167,6 +167,12 @@ struct frr_daemon_info {
 
 	/* Optional upper limit on the number of fds used in select/poll */
 	uint32_t limit_fds;
+
+	/* Use io_uring for event loops */
+	bool io_uring;
+
+	/* Keep second resolution timers on a timer wheel */
+	bool timer_wheel;
 };
 
 /* execname is the daemon's executable (and pidfile and configfile) name,
@@ -199,6 +205,8 @@ extern struct event_loop *frr_init(void);
 extern const char *frr_get_progname(void);
 extern enum frr_cli_mode frr_get_cli_mode(void);
 extern uint32_t frr_get_fd_limit(void);
+extern bool frr_get_io_uring(void);
+extern bool frr_get_timer_wheel(void);
 extern bool frr_is_startup_fd(int fd);
 extern bool frr_is_daemon(void);
 /* call order of these hooks is as ordered here */
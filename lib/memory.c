@@ -16,8 +16,11 @@
 #include <malloc/malloc.h>
 #endif
 
+#include <sys/mman.h>
+
 #include "memory.h"
 #include "log.h"
+#include "typesafe.h"
 #include "libfrr_trace.h"
 
 #if defined(HAVE_MALLOC_SIZE) && !defined(HAVE_MALLOC_USABLE_SIZE)
@@ -33,6 +36,375 @@ DEFINE_MTYPE(LIB, TMP, "Temporary memory");
 DEFINE_MTYPE(LIB, TMP_TTABLE, "Temporary memory for TTABLE");
 DEFINE_MTYPE(LIB, BITFIELD, "Bitfield memory");
 
+/* Slab caches
+ *
+ * Objects of a DEFINE_MTYPE_SLAB type are carved out of 64KiB pages that
+ * are mmap()ed directly rather than taken from the malloc heap.  All slots
+ * on a page are the same size, so churn cannot fragment it, and a page is
+ * unmapped as soon as its last object is freed - one empty page per slab
+ * is kept to avoid thrashing at that boundary.  Pages are aligned to their
+ * size, which makes finding an object's page on free a mask operation.
+ *
+ * With MEMSLAB_MAGAZINE each pthread additionally keeps up to
+ * MEMSLAB_MAG_SIZE free objects of the slab, moving them to and from the
+ * pages in halves.  This keeps the slab lock off the hot path when several
+ * pthreads allocate from the same MTYPE.
+ */
+#define MEMSLAB_PAGE_SIZE	(64U * 1024U)
+#define MEMSLAB_ALIGN		16U
+#define MEMSLAB_MAG_SIZE	32U
+#define MEMSLAB_MAX_MAGAZINES	32U
+
+PREDECL_DLIST(memslab_pages);
+
+struct memslab_page {
+	struct memslab *slab;
+	struct memslab_pages_item item;
+
+	/* freed slots, linked through their first word */
+	void *freelist;
+	/* slots from here to the end of the page were never handed out */
+	char *fresh;
+	unsigned int used;
+};
+
+DECLARE_DLIST(memslab_pages, struct memslab_page, item);
+
+#define MEMSLAB_PAGE_HDR                                                       \
+	((sizeof(struct memslab_page) + MEMSLAB_ALIGN - 1) &                   \
+	 ~(size_t)(MEMSLAB_ALIGN - 1))
+
+struct memslab {
+	struct memtype *mt;
+	size_t objsize;
+	unsigned int per_page;
+	/* index into the per-pthread magazine array, -1 if none */
+	int mag_idx;
+
+	pthread_mutex_t mtx;
+	/* guarded by mtx */
+	struct memslab_pages_head partial;
+	struct memslab_pages_head full;
+	struct memslab_page *spare;
+	size_t used;
+};
+
+struct memslab_mag {
+	unsigned int count;
+	void *objs[MEMSLAB_MAG_SIZE];
+};
+
+static struct memslab *memslab_mag_slabs[MEMSLAB_MAX_MAGAZINES];
+static unsigned int memslab_mag_count;
+static pthread_key_t memslab_mag_key;
+
+static void memslab_mag_release(void *arg);
+
+static void memslab_mag_key_init(void) __attribute__((_CONSTRUCTOR(500)));
+static void memslab_mag_key_init(void)
+{
+	pthread_key_create(&memslab_mag_key, memslab_mag_release);
+}
+
+/* the key's destructor is what flushes magazines on pthread exit; ELF TLS
+ * is just the faster way to find them, as in zlog.c
+ */
+#ifdef __OpenBSD__
+static inline struct memslab_mag *memslab_mags_get(void)
+{
+	return pthread_getspecific(memslab_mag_key);
+}
+
+static inline void memslab_mags_set(struct memslab_mag *mags)
+{
+	pthread_setspecific(memslab_mag_key, mags);
+}
+#else
+# ifndef thread_local
+#  define thread_local __thread
+# endif
+
+static thread_local struct memslab_mag *memslab_mags_var;
+
+static inline struct memslab_mag *memslab_mags_get(void)
+{
+	return memslab_mags_var;
+}
+
+static inline void memslab_mags_set(struct memslab_mag *mags)
+{
+	pthread_setspecific(memslab_mag_key, mags);
+	memslab_mags_var = mags;
+}
+#endif
+
+static struct memslab_page *memslab_page_new(struct memslab *slab)
+{
+	struct memslab_page *page;
+	uintptr_t start, aligned;
+	char *map;
+
+	/* overallocate and trim to get a page aligned to its size */
+	map = mmap(NULL, 2 * MEMSLAB_PAGE_SIZE, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (map == MAP_FAILED)
+		memory_oom(MEMSLAB_PAGE_SIZE, slab->mt->name);
+
+	start = (uintptr_t)map;
+	aligned = (start + MEMSLAB_PAGE_SIZE - 1) &
+		  ~(uintptr_t)(MEMSLAB_PAGE_SIZE - 1);
+	if (aligned > start)
+		munmap(map, aligned - start);
+	munmap((char *)aligned + MEMSLAB_PAGE_SIZE,
+	       start + MEMSLAB_PAGE_SIZE - aligned);
+
+	page = (struct memslab_page *)aligned;
+	page->slab = slab;
+	page->freelist = NULL;
+	page->fresh = (char *)page + MEMSLAB_PAGE_HDR;
+	page->used = 0;
+	return page;
+}
+
+/* slab->mtx held */
+static void *memslab_get(struct memslab *slab)
+{
+	struct memslab_page *page;
+	void *ptr;
+
+	page = memslab_pages_first(&slab->partial);
+	if (!page) {
+		if (slab->spare) {
+			page = slab->spare;
+			slab->spare = NULL;
+		} else
+			page = memslab_page_new(slab);
+		memslab_pages_add_head(&slab->partial, page);
+	}
+
+	if (page->freelist) {
+		ptr = page->freelist;
+		page->freelist = *(void **)ptr;
+	} else {
+		ptr = page->fresh;
+		page->fresh += slab->objsize;
+	}
+
+	if (++page->used == slab->per_page) {
+		memslab_pages_del(&slab->partial, page);
+		memslab_pages_add_tail(&slab->full, page);
+	}
+	slab->used++;
+	return ptr;
+}
+
+/* slab->mtx held */
+static void memslab_put(struct memslab *slab, void *ptr)
+{
+	struct memslab_page *page;
+
+	page = (struct memslab_page *)((uintptr_t)ptr &
+				       ~(uintptr_t)(MEMSLAB_PAGE_SIZE - 1));
+	assertf(page->slab == slab, "%p freed to wrong slab %s", ptr,
+		slab->mt->name);
+
+	*(void **)ptr = page->freelist;
+	page->freelist = ptr;
+	slab->used--;
+
+	if (page->used-- == slab->per_page) {
+		/* keep filling the first page before going back to this one */
+		memslab_pages_del(&slab->full, page);
+		memslab_pages_add_tail(&slab->partial, page);
+	}
+	if (page->used)
+		return;
+
+	memslab_pages_del(&slab->partial, page);
+	if (slab->spare) {
+		munmap(page, MEMSLAB_PAGE_SIZE);
+		return;
+	}
+	page->freelist = NULL;
+	page->fresh = (char *)page + MEMSLAB_PAGE_HDR;
+	slab->spare = page;
+}
+
+static void memslab_mag_flush(struct memslab *slab, struct memslab_mag *mag,
+			      unsigned int count)
+{
+	pthread_mutex_lock(&slab->mtx);
+	while (count--)
+		memslab_put(slab, mag->objs[--mag->count]);
+	pthread_mutex_unlock(&slab->mtx);
+}
+
+/* pthread exit: hand cached objects back so their pages can be unmapped */
+static void memslab_mag_release(void *arg)
+{
+	struct memslab_mag *mags = arg;
+
+	for (unsigned int i = 0; i < memslab_mag_count; i++)
+		if (memslab_mag_slabs[i] && mags[i].count)
+			memslab_mag_flush(memslab_mag_slabs[i], &mags[i],
+					  mags[i].count);
+	free(mags);
+}
+
+static struct memslab_mag *memslab_mag(struct memslab *slab)
+{
+	struct memslab_mag *mags;
+
+	if (slab->mag_idx < 0)
+		return NULL;
+
+	mags = memslab_mags_get();
+	if (__builtin_expect(mags == NULL, 0)) {
+		/* plain calloc; this is not accounted to any MTYPE */
+		mags = calloc(MEMSLAB_MAX_MAGAZINES, sizeof(*mags));
+		if (!mags)
+			memory_oom(MEMSLAB_MAX_MAGAZINES * sizeof(*mags),
+				   slab->mt->name);
+		memslab_mags_set(mags);
+	}
+	return &mags[slab->mag_idx];
+}
+
+static void *memslab_alloc(struct memtype *mt, size_t size)
+{
+	struct memslab *slab = mt->slab;
+	struct memslab_mag *mag;
+	void *ptr;
+
+	assertf(size <= slab->objsize, "%zu byte allocation on %s (slab of %zu)",
+		size, mt->name, slab->objsize);
+
+	mag = memslab_mag(slab);
+	if (mag) {
+		if (!mag->count) {
+			pthread_mutex_lock(&slab->mtx);
+			while (mag->count < MEMSLAB_MAG_SIZE / 2)
+				mag->objs[mag->count++] = memslab_get(slab);
+			pthread_mutex_unlock(&slab->mtx);
+		}
+		return mag->objs[--mag->count];
+	}
+
+	pthread_mutex_lock(&slab->mtx);
+	ptr = memslab_get(slab);
+	pthread_mutex_unlock(&slab->mtx);
+	return ptr;
+}
+
+static void memslab_free(struct memtype *mt, void *ptr)
+{
+	struct memslab *slab = mt->slab;
+	struct memslab_mag *mag;
+
+	mag = memslab_mag(slab);
+	if (mag) {
+		if (mag->count == MEMSLAB_MAG_SIZE)
+			memslab_mag_flush(slab, mag, MEMSLAB_MAG_SIZE / 2);
+		mag->objs[mag->count++] = ptr;
+		return;
+	}
+
+	pthread_mutex_lock(&slab->mtx);
+	memslab_put(slab, ptr);
+	pthread_mutex_unlock(&slab->mtx);
+}
+
+void qmem_slab_init(struct memtype *mt)
+{
+	struct memslab *slab;
+	size_t objsize;
+
+	objsize = (mt->slab_size + MEMSLAB_ALIGN - 1) &
+		  ~(size_t)(MEMSLAB_ALIGN - 1);
+	/* objects this large gain nothing from sharing a page */
+	if (objsize > (MEMSLAB_PAGE_SIZE - MEMSLAB_PAGE_HDR) / 8)
+		return;
+
+	/* constructors run before any pthread is started */
+	slab = calloc(1, sizeof(*slab));
+	if (!slab)
+		memory_oom(sizeof(*slab), mt->name);
+
+	slab->mt = mt;
+	slab->objsize = objsize;
+	slab->per_page = (MEMSLAB_PAGE_SIZE - MEMSLAB_PAGE_HDR) / objsize;
+	slab->mag_idx = -1;
+	pthread_mutex_init(&slab->mtx, NULL);
+	memslab_pages_init(&slab->partial);
+	memslab_pages_init(&slab->full);
+
+	if ((mt->slab_flags & MEMSLAB_MAGAZINE) &&
+	    memslab_mag_count < MEMSLAB_MAX_MAGAZINES) {
+		slab->mag_idx = memslab_mag_count++;
+		memslab_mag_slabs[slab->mag_idx] = slab;
+	}
+
+	mt->slab = slab;
+}
+
+void qmem_slab_fini(struct memtype *mt)
+{
+	struct memslab *slab = mt->slab;
+	struct memslab_mag *mag;
+
+	mag = memslab_mags_get() ? memslab_mag(slab) : NULL;
+	if (mag && mag->count)
+		memslab_mag_flush(slab, mag, mag->count);
+
+	/* live objects, or cached on another pthread; leave it all be */
+	if (slab->used)
+		return;
+
+	if (slab->mag_idx >= 0)
+		memslab_mag_slabs[slab->mag_idx] = NULL;
+	if (slab->spare)
+		munmap(slab->spare, MEMSLAB_PAGE_SIZE);
+	memslab_pages_fini(&slab->partial);
+	memslab_pages_fini(&slab->full);
+	pthread_mutex_destroy(&slab->mtx);
+	free(slab);
+	mt->slab = NULL;
+}
+
+bool qmem_slab_stats(struct memtype *mt, struct memslab_stats *stats)
+{
+	struct memslab *slab = mt->slab;
+	struct memslab_page *page;
+
+	if (!slab)
+		return false;
+
+	memset(stats, 0, sizeof(*stats));
+	stats->objsize = slab->objsize;
+	stats->per_page = slab->per_page;
+
+	pthread_mutex_lock(&slab->mtx);
+	frr_each (memslab_pages, &slab->partial, page)
+		stats->stranded += slab->per_page - page->used;
+	stats->pages_partial = memslab_pages_count(&slab->partial);
+	stats->pages = stats->pages_partial +
+		       memslab_pages_count(&slab->full) + !!slab->spare;
+	stats->used = slab->used;
+	pthread_mutex_unlock(&slab->mtx);
+	return true;
+}
+
+static inline size_t mt_usable_size(struct memtype *mt, void *ptr)
+{
+	if (mt->slab)
+		return mt->slab->objsize;
+#ifdef HAVE_MALLOC_USABLE_SIZE
+	return malloc_usable_size(ptr);
+#else
+	return 0;
+#endif
+}
+
 static inline void mt_count_alloc(struct memtype *mt, size_t size, void *ptr)
 {
 	size_t current;
@@ -58,7 +430,7 @@ static inline void mt_count_alloc(struct memtype *mt, size_t size, void *ptr)
 				      memory_order_relaxed);
 
 #ifdef HAVE_MALLOC_USABLE_SIZE
-	size_t mallocsz = malloc_usable_size(ptr);
+	size_t mallocsz = mt_usable_size(mt, ptr);
 
 	current = mallocsz + atomic_fetch_add_explicit(&mt->total, mallocsz,
 						       memory_order_relaxed);
@@ -80,7 +452,7 @@ static inline void mt_count_free(struct memtype *mt, void *ptr)
 	atomic_fetch_sub_explicit(&mt->n_alloc, 1, memory_order_relaxed);
 
 #ifdef HAVE_MALLOC_USABLE_SIZE
-	size_t mallocsz = malloc_usable_size(ptr);
+	size_t mallocsz = mt_usable_size(mt, ptr);
 
 	atomic_fetch_sub_explicit(&mt->total, mallocsz, memory_order_relaxed);
 #endif
@@ -103,11 +475,19 @@ static inline void *mt_checkalloc(struct memtype *mt, void *ptr, size_t size)
 
 void *qmalloc(struct memtype *mt, size_t size)
 {
+	if (mt->slab)
+		return mt_checkalloc(mt, memslab_alloc(mt, size), size);
 	return mt_checkalloc(mt, malloc(size), size);
 }
 
 void *qcalloc(struct memtype *mt, size_t size)
 {
+	if (mt->slab) {
+		void *ptr = memslab_alloc(mt, size);
+
+		memset(ptr, 0, size);
+		return mt_checkalloc(mt, ptr, size);
+	}
 	return mt_checkalloc(mt, calloc(size, 1), size);
 }
 
@@ -115,25 +495,49 @@ void *qrealloc(struct memtype *mt, void *ptr, size_t size)
 {
 	if (ptr)
 		mt_count_free(mt, ptr);
+	if (mt->slab) {
+		/* slots are fixed size, so this either fits or is a bug */
+		if (ptr)
+			assertf(size <= mt->slab->objsize,
+				"%zu byte realloc on %s (slab of %zu)", size,
+				mt->name, mt->slab->objsize);
+		else
+			ptr = memslab_alloc(mt, size);
+		return mt_checkalloc(mt, ptr, size);
+	}
 	return mt_checkalloc(mt, ptr ? realloc(ptr, size) : malloc(size), size);
 }
 
 void *qstrdup(struct memtype *mt, const char *str)
 {
+	if (str && mt->slab) {
+		size_t len = strlen(str) + 1;
+
+		return mt_checkalloc(mt, memcpy(memslab_alloc(mt, len), str, len),
+				     len);
+	}
 	return str ? mt_checkalloc(mt, strdup(str), strlen(str) + 1) : NULL;
 }
 
 void qcountfree(struct memtype *mt, void *ptr)
 {
+	/* slab objects can't be handed to free() */
+	assert(!mt->slab);
+
 	if (ptr)
 		mt_count_free(mt, ptr);
 }
 
 void qfree(struct memtype *mt, void *ptr)
 {
-	if (ptr)
-		mt_count_free(mt, ptr);
-	free(ptr);
+	if (!ptr)
+		return;
+
+	mt_count_free(mt, ptr);
+	if (mt->slab)
+		memslab_free(mt, ptr);
+	else
+		free(ptr);
 }
 
 int qmem_walk(qmem_walk_fn *func, void *arg)
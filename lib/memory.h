@@ -17,6 +17,9 @@ extern "C" {
 #endif
 
 #define SIZE_VAR ~0UL
+
+struct memslab;
+
 struct memtype {
 	struct memtype *next, **ref;
 	const char *name;
@@ -25,8 +28,16 @@ struct memtype {
 	atomic_size_t size;
 	atomic_size_t total;
 	atomic_size_t max_size;
+
+	/* DEFINE_MTYPE_SLAB: object size & MEMSLAB_* flags, slab cache */
+	size_t slab_size;
+	unsigned int slab_flags;
+	struct memslab *slab;
 };
 
+/* keep a few free objects per pthread, avoiding the slab lock */
+#define MEMSLAB_MAGAZINE	(1 << 0)
+
 struct memgroup {
 	struct memgroup *next, **ref;
 	struct memtype *types, **insert;
@@ -98,13 +109,14 @@ struct memgroup {
 	extern struct memtype MTYPE_##name[1]                                  \
 	/* end */
 
-#define DEFINE_MTYPE_ATTR(group, mname, attr, desc)                            \
+#define _DEFINE_MTYPE(group, mname, attr, desc, ...)                          \
 	attr struct memtype MTYPE_##mname[1] _DATA_SECTION("mtypes") = { {     \
 		.name = desc,                                                  \
 		.next = NULL,                                                  \
 		.n_alloc = 0,                                                  \
 		.size = 0,                                                     \
 		.ref = NULL,                                                   \
+		__VA_ARGS__                                                    \
 	} };                                                                   \
 	static void _mtinit_##mname(void) __attribute__((_CONSTRUCTOR(1001))); \
 	static void _mtinit_##mname(void)                                      \
@@ -114,16 +126,24 @@ struct memgroup {
 		MTYPE_##mname->ref = _mg_##group.insert;                       \
 		*_mg_##group.insert = MTYPE_##mname;                           \
 		_mg_##group.insert = &MTYPE_##mname->next;                      \
+		if (MTYPE_##mname->slab_size)                                  \
+			qmem_slab_init(MTYPE_##mname);                         \
 	}                                                                      \
 	static void _mtfini_##mname(void) __attribute__((_DESTRUCTOR(1001)));  \
 	static void _mtfini_##mname(void)                                      \
 	{                                                                      \
+		if (MTYPE_##mname->slab)                                       \
+			qmem_slab_fini(MTYPE_##mname);                         \
 		if (MTYPE_##mname->next)                                       \
 			MTYPE_##mname->next->ref = MTYPE_##mname->ref;         \
 		*MTYPE_##mname->ref = MTYPE_##mname->next;                     \
 	}                                                                      \
 	MACRO_REQUIRE_SEMICOLON() /* end */
 
+#define DEFINE_MTYPE_ATTR(group, mname, attr, desc)                            \
+	_DEFINE_MTYPE(group, mname, attr, desc, )                              \
+	/* end */
+
 #define DEFINE_MTYPE(group, name, desc)                                        \
 	DEFINE_MTYPE_ATTR(group, name, , desc)                                 \
 	/* end */
@@ -132,6 +152,19 @@ struct memgroup {
 	DEFINE_MTYPE_ATTR(group, name, static, desc)                           \
 	/* end */
 
+/* objects of up to objsize bytes come from a slab cache rather than
+ * malloc(); larger allocations on the MTYPE are a bug.  flags: MEMSLAB_*
+ */
+#define DEFINE_MTYPE_SLAB(group, name, desc, objsize, flags)                   \
+	_DEFINE_MTYPE(group, name, , desc, .slab_size = (objsize),             \
+		      .slab_flags = (flags))                                   \
+	/* end */
+
+#define DEFINE_MTYPE_SLAB_STATIC(group, name, desc, objsize, flags)            \
+	_DEFINE_MTYPE(group, name, static, desc, .slab_size = (objsize),       \
+		      .slab_flags = (flags))                                   \
+	/* end */
+
 /* clang-format on */
 
 DECLARE_MGROUP(LIB);
@@ -166,6 +199,29 @@ static inline size_t mtype_stats_alloc(struct memtype *mt)
 	return mt->n_alloc;
 }
 
+/* called from the DEFINE_MTYPE_SLAB constructor/destructor */
+extern void qmem_slab_init(struct memtype *mt);
+extern void qmem_slab_fini(struct memtype *mt);
+
+struct memslab_stats {
+	size_t objsize;
+	/* pages mapped, those of them that are partially used, and object
+	 * slots on one page
+	 */
+	size_t pages;
+	size_t pages_partial;
+	size_t per_page;
+	/* slots handed out, including free objects parked in magazines */
+	size_t used;
+	/* free slots on partially used pages, i.e. memory that cannot be
+	 * returned to the system until the page's other objects are freed
+	 */
+	size_t stranded;
+};
+
+/* returns false if mt is not a slab MTYPE */
+extern bool qmem_slab_stats(struct memtype *mt, struct memslab_stats *stats);
+
 /* NB: calls are ordered by memgroup; and there is a call with mt == NULL for
  * each memgroup (so that a header can be printed, and empty memgroups show)
  *
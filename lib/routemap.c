@@ -31,6 +31,7 @@ DEFINE_MTYPE_STATIC(LIB, ROUTE_MAP_RULE_STR, "Route map rule str");
 DEFINE_MTYPE(LIB, ROUTE_MAP_COMPILED, "Route map compiled");
 DEFINE_MTYPE_STATIC(LIB, ROUTE_MAP_DEP, "Route map dependency");
 DEFINE_MTYPE_STATIC(LIB, ROUTE_MAP_DEP_DATA, "Route map dependency data");
+DEFINE_MTYPE_STATIC(LIB, ROUTE_MAP_MEMO, "Route map match memo");
 
 DEFINE_QOBJ_TYPE(route_map_index);
 DEFINE_QOBJ_TYPE(route_map);
@@ -1743,6 +1744,97 @@ enum rmap_compile_rets route_map_delete_set(struct route_map_index *index,
 	return RMAP_RULE_MISSING;
 }
 
+/* Memoized match results, see route_map_memo_start() */
+PREDECL_HASH(rmap_memo);
+
+struct rmap_memo_entry {
+	struct rmap_memo_item itm;
+
+	const struct route_map_rule *rule;
+	const void *key;
+	enum route_map_cmd_result_t ret;
+};
+
+static int rmap_memo_cmp(const struct rmap_memo_entry *a,
+			 const struct rmap_memo_entry *b)
+{
+	if (a->rule != b->rule)
+		return (uintptr_t)a->rule < (uintptr_t)b->rule ? -1 : 1;
+	if (a->key != b->key)
+		return (uintptr_t)a->key < (uintptr_t)b->key ? -1 : 1;
+	return 0;
+}
+
+static uint32_t rmap_memo_hash(const struct rmap_memo_entry *e)
+{
+	uintptr_t ptrs[2] = { (uintptr_t)e->rule, (uintptr_t)e->key };
+
+	return jhash(ptrs, sizeof(ptrs), 0x7e3f1b9d);
+}
+
+DECLARE_HASH(rmap_memo, struct rmap_memo_entry, itm, rmap_memo_cmp,
+	     rmap_memo_hash);
+
+/* Past this many results per scope, new ones are not kept */
+#define RMAP_MEMO_MAX 65536
+
+static struct {
+	/* Nesting depth of route_map_memo_start() */
+	unsigned int depth;
+	struct rmap_memo_head head;
+
+	/* Key of the object being matched, NULL for no memo */
+	const void *key;
+} rmap_memo;
+
+void route_map_memo_start(void)
+{
+	if (rmap_memo.depth++ == 0)
+		rmap_memo_init(&rmap_memo.head);
+}
+
+void route_map_memo_stop(void)
+{
+	struct rmap_memo_entry *e;
+
+	assert(rmap_memo.depth > 0);
+	if (--rmap_memo.depth > 0)
+		return;
+
+	while ((e = rmap_memo_pop(&rmap_memo.head)))
+		XFREE(MTYPE_ROUTE_MAP_MEMO, e);
+	rmap_memo_fini(&rmap_memo.head);
+}
+
+static enum route_map_cmd_result_t
+route_map_match_rule(struct route_map_rule *match, const struct prefix *prefix,
+		     void *object)
+{
+	struct rmap_memo_entry ref, *e;
+	enum route_map_cmd_result_t ret;
+
+	if (!rmap_memo.key || !match->cmd->memoize)
+		return (*match->cmd->func_apply)(match->value, prefix, object);
+
+	ref.rule = match;
+	ref.key = rmap_memo.key;
+	e = rmap_memo_find(&rmap_memo.head, &ref);
+	if (e)
+		return e->ret;
+
+	ret = (*match->cmd->func_apply)(match->value, prefix, object);
+
+	if (rmap_memo_count(&rmap_memo.head) < RMAP_MEMO_MAX) {
+		e = XMALLOC(MTYPE_ROUTE_MAP_MEMO, sizeof(*e));
+		e->rule = match;
+		e->key = rmap_memo.key;
+		e->ret = ret;
+		rmap_memo_add(&rmap_memo.head, e);
+	}
+
+	return ret;
+}
+
 static enum route_map_cmd_result_t
 route_map_apply_match(struct route_map_rule_list *match_list,
 		      const struct prefix *prefix, void *object)
@@ -1768,8 +1860,7 @@ route_map_apply_match(struct route_map_rule_list *match_list,
 			 * MATCH/NOOP, then also end-result is a match)
 			 * If all result in NOOP, end-result is NOOP.
 			 */
-			ret = (*match->cmd->func_apply)(match->value, prefix,
-							object);
+			ret = route_map_match_rule(match, prefix, object);
 
 			/*
 			 * If the consolidated result of func_apply is:
@@ -2708,6 +2799,12 @@ route_map_result_t route_map_apply_ext(struct route_map *map,
 				/* Match succeeded, rmap is of type permit */
 				ret = RMAP_PERMITMATCH;
 
+				/* The sets may change what the remaining
+				 * match rules look at.
+				 */
+				if (index->set_list.head)
+					rmap_memo.key = NULL;
+
 				/* permit+match must execute sets */
 				for (set = index->set_list.head; set;
 				     set = set->next)
@@ -2804,6 +2901,22 @@ route_map_apply_end:
 	return (ret);
 }
 
+route_map_result_t route_map_apply_memo(struct route_map *map,
+					const struct prefix *prefix,
+					void *object, const void *key)
+{
+	route_map_result_t ret;
+
+	if (!rmap_memo.depth)
+		return route_map_apply(map, prefix, object);
+
+	rmap_memo.key = key;
+	ret = route_map_apply(map, prefix, object);
+	rmap_memo.key = NULL;
+
+	return ret;
+}
+
 void route_map_add_hook(void (*func)(const char *))
 {
 	route_map_master.add_hook = func;
@@ -117,6 +117,13 @@ struct route_map_rule_cmd {
 
 	/** To get the rule key after Compilation **/
 	void *(*func_get_rmap_rule_key)(void *val);
+
+	/*
+	 * Match only depends on the rule and on the part of the object that
+	 * the key passed to route_map_apply_memo() stands for, so its result
+	 * can be reused for that key.  See route_map_memo_start().
+	 */
+	bool memoize;
 };
 
 /* Route map apply error. */
@@ -530,6 +537,25 @@ extern route_map_result_t route_map_apply_ext(struct route_map *map,
 #define route_map_apply(map, prefix, object)                                   \
 	route_map_apply_ext(map, prefix, object, object, NULL)
 
+/*
+ * Between route_map_memo_start() and route_map_memo_stop(), the results
+ * of match rules whose command sets memoize are kept for route-maps applied
+ * with route_map_apply_memo(), per rule and key, and reused for later
+ * objects with the same key.  Once a set clause has run, the rest of that
+ * route-map is matched without the memo, since the sets may have changed
+ * the object.
+ *
+ * The caller guarantees that the key stays valid, and is not reused for a
+ * different object, until route_map_memo_stop(); no route-map may change
+ * in between either, so a scope must not outlive the event it runs in.
+ * Scopes nest.  Outside of one, route_map_apply_memo() is route_map_apply().
+ */
+extern void route_map_memo_start(void);
+extern void route_map_memo_stop(void);
+extern route_map_result_t route_map_apply_memo(struct route_map *map,
+					       const struct prefix *prefix,
+					       void *object, const void *key);
+
 extern void route_map_add_hook(void (*func)(const char *));
 extern void route_map_delete_hook(void (*func)(const char *));
 
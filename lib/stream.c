@@ -23,6 +23,11 @@
 
 DEFINE_MTYPE_STATIC(LIB, STREAM, "Stream");
 DEFINE_MTYPE_STATIC(LIB, STREAM_FIFO, "Stream FIFO");
+DEFINE_MTYPE_STATIC(LIB, STREAM_SHARED, "Stream shared data");
+
+struct stream_shared {
+	atomic_uint_fast32_t refcnt;
+};
 
 /* Tests whether a position is valid */
 #define GETP_VALID(S, G) ((G) <= (S)->endp)
@@ -104,6 +109,7 @@ struct stream *stream_new(size_t size)
 	s->next = NULL;
 	s->size = size;
 	s->allow_expansion = false;
+	s->shared = NULL;
 	return s;
 }
 
@@ -120,10 +126,46 @@ void stream_free(struct stream *s)
 	if (!s)
 		return;
 
+	if (s->shared) {
+		if (atomic_fetch_sub_explicit(&s->shared->refcnt, 1,
+					      memory_order_acq_rel) != 1) {
+			XFREE(MTYPE_STREAM, s);
+			return;
+		}
+
+		XFREE(MTYPE_STREAM_SHARED, s->shared);
+	}
+
 	XFREE(MTYPE_STREAM, s->data);
 	XFREE(MTYPE_STREAM, s);
 }
 
+struct stream *stream_share(struct stream *s)
+{
+	struct stream *snew;
+
+	STREAM_VERIFY_SANE(s);
+
+	if (!s->shared) {
+		s->shared = XCALLOC(MTYPE_STREAM_SHARED, sizeof(*s->shared));
+		atomic_store_explicit(&s->shared->refcnt, 1,
+				      memory_order_relaxed);
+	}
+
+	atomic_fetch_add_explicit(&s->shared->refcnt, 1, memory_order_relaxed);
+
+	snew = XMALLOC(MTYPE_STREAM, sizeof(struct stream));
+	snew->next = NULL;
+	snew->getp = s->getp;
+	snew->endp = s->endp;
+	/* nothing can be written past endp */
+	snew->size = s->endp;
+	snew->allow_expansion = false;
+	snew->data = s->data;
+	snew->shared = s->shared;
+	return snew;
+}
+
 struct stream *stream_copy(struct stream *dest, const struct stream *src)
 {
 	STREAM_VERIFY_SANE(src);
@@ -180,6 +222,7 @@ size_t stream_resize_inplace(struct stream **sptr, size_t newsize)
 	struct stream *orig = *sptr;
 
 	STREAM_VERIFY_SANE(orig);
+	assert(!orig->shared);
 
 	orig->data = XREALLOC(MTYPE_STREAM, orig->data, newsize);
 
@@ -210,6 +253,8 @@ static void stream_expand(struct stream *s, size_t expand_size)
 		actual_expand_size = MIN_STREAM_EXPANSION_SZ;
 	}
 
+	assert(!s->shared);
+
 	/* Calculate new total size */
 	new_size = s->size + actual_expand_size;
 	/* Reallocate the data buffer */
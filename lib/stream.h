@@ -97,6 +97,9 @@ struct stream {
 	size_t size;	       /* size of data segment */
 	bool allow_expansion;  /* whether stream can be expanded */
 	unsigned char *data;   /* data pointer */
+
+	/* data is refcounted and shared with other streams, see stream_share */
+	struct stream_shared *shared;
 };
 
 /* First in first out queue structure. */
@@ -140,6 +143,16 @@ extern struct stream *stream_copy(struct stream *dest,
 				  const struct stream *src);
 extern struct stream *stream_dup(const struct stream *s);
 
+/*
+ * Return a new stream reading the same data as 's', without copying it.
+ *
+ * The data is refcounted and freed with the last stream using it, so the
+ * streams may be freed in any order and on any pthread.  Neither 's' nor
+ * any of its shares may be written to or resized afterwards; getp is
+ * private to each stream.
+ */
+extern struct stream *stream_share(struct stream *s);
+
 extern size_t stream_resize_inplace(struct stream **sptr, size_t newsize);
 
 extern size_t stream_get_getp(const struct stream *s);
@@ -16,6 +16,7 @@
 
 DEFINE_MTYPE_STATIC(LIB, ROUTE_TABLE, "Route table");
 DEFINE_MTYPE(LIB, ROUTE_NODE, "Route node");
+DEFINE_MTYPE_STATIC(LIB, ROUTE_STRIDE, "Route table stride index");
 
 static void route_table_free(struct route_table *);
 
@@ -164,6 +165,8 @@ done:
 
 	rn_hash_node_fini(&rt->hash);
 	rn_tree_fini(&rt->tree);
+	XFREE(MTYPE_ROUTE_STRIDE, rt->stride_index[0]);
+	XFREE(MTYPE_ROUTE_STRIDE, rt->stride_index[1]);
 	XFREE(MTYPE_ROUTE_TABLE, rt);
 	return;
 }
@@ -218,17 +221,146 @@ static void set_link(struct route_node *node, struct route_node *new)
 	new->parent = node;
 }
 
-/* Find matched prefix. */
-struct route_node *route_node_match(struct route_table *table,
-				    union prefixconstptr pu)
+/*
+ * Stride index.
+ *
+ * For each value of the first ROUTE_STRIDE_BITS bits of an address, the
+ * index points to the deepest node of that family with a prefix of at
+ * most ROUTE_STRIDE_BITS which contains all of those addresses, i.e. a
+ * node that every lookup for them passes.  Lookups start there instead of
+ * at the top: nodes below are found walking down as usual, shorter
+ * matches walking up the parents.  With a full table that skips the
+ * first 16 or so levels of the tree.
+ *
+ * Prefixes never change, so an entry stays valid until its node is
+ * removed from the tree, at which point it falls back to the parent.
+ * Only nodes of up to ROUTE_STRIDE_BITS touch the index, updating the
+ * 2^(ROUTE_STRIDE_BITS - prefixlen) entries they cover.
+ */
+#define ROUTE_STRIDE_BITS 16
+#define ROUTE_STRIDE_SIZE (1U << ROUTE_STRIDE_BITS)
+
+/* Table size at which the index gets built */
+#define ROUTE_STRIDE_MIN_COUNT 32768
+
+static int route_stride_family(const struct prefix *p)
+{
+	switch (p->family) {
+	case AF_INET:
+		return 0;
+	case AF_INET6:
+		return 1;
+	}
+	return -1;
+}
+
+static uint32_t route_stride_key(const struct prefix *p)
+{
+	const uint8_t *bytes = &p->u.prefix;
+
+	return (bytes[0] << 8) | bytes[1];
+}
+
+static void route_stride_add(struct route_table *table, struct route_node *node)
+{
+	int family = route_stride_family(&node->p);
+	struct route_node **index;
+	uint32_t key, count;
+
+	if (family < 0 || !table->stride_index[family] ||
+	    node->p.prefixlen > ROUTE_STRIDE_BITS)
+		return;
+
+	index = table->stride_index[family];
+	key = route_stride_key(&node->p);
+	count = 1U << (ROUTE_STRIDE_BITS - node->p.prefixlen);
+
+	/* Nodes containing the same addresses are on one path; the longer
+	 * prefix is further down.
+	 */
+	for (uint32_t i = key; i < key + count; i++)
+		if (!index[i] || index[i]->p.prefixlen < node->p.prefixlen)
+			index[i] = node;
+}
+
+/* The node is leaving the tree; its parent still contains its entries */
+static void route_stride_del(struct route_table *table, struct route_node *node)
+{
+	int family = route_stride_family(&node->p);
+	struct route_node **index;
+	uint32_t key, count;
+
+	if (family < 0 || !table->stride_index[family] ||
+	    node->p.prefixlen > ROUTE_STRIDE_BITS)
+		return;
+
+	index = table->stride_index[family];
+	key = route_stride_key(&node->p);
+	count = 1U << (ROUTE_STRIDE_BITS - node->p.prefixlen);
+
+	for (uint32_t i = key; i < key + count; i++)
+		if (index[i] == node)
+			index[i] = node->parent;
+}
+
+static void route_stride_build_walk(struct route_table *table,
+				    struct route_node *node)
+{
+	/* Children are longer, so the recursion is at most 17 deep */
+	if (!node || node->p.prefixlen > ROUTE_STRIDE_BITS)
+		return;
+
+	route_stride_add(table, node);
+	route_stride_build_walk(table, node->l_left);
+	route_stride_build_walk(table, node->l_right);
+}
+
+static void route_stride_build(struct route_table *table, int family)
+{
+	table->stride_index[family] =
+		XCALLOC(MTYPE_ROUTE_STRIDE,
+			sizeof(struct route_node *) * ROUTE_STRIDE_SIZE);
+	route_stride_build_walk(table, table->top);
+}
+
+/* Node to start a lookup or insert of p at, or NULL to use the top */
+static struct route_node *route_stride_lookup(struct route_table *table,
+					      const struct prefix *p)
+{
+	int family = route_stride_family(p);
+
+	if (family < 0 || !table->stride_index[family] ||
+	    p->prefixlen < ROUTE_STRIDE_BITS)
+		return NULL;
+
+	return table->stride_index[family][route_stride_key(p)];
+}
+
+void route_table_set_stride_index(struct route_table *table, bool enable)
+{
+	table->stride_index_off = !enable;
+
+	for (int family = 0; family < 2; family++) {
+		if (!enable)
+			XFREE(MTYPE_ROUTE_STRIDE, table->stride_index[family]);
+		else if (!table->stride_index[family] && !table->unique_mode)
+			route_stride_build(table, family);
+	}
+}
+
+/* Find matched prefix, without taking a lock on the result. */
+struct route_node *route_node_match_nolock(struct route_table *table,
+					   union prefixconstptr pu)
 {
 	const struct prefix *p = pu.p;
 	struct route_node *node;
 	struct route_node *matched;
+	struct route_node *start;
 	struct route_node rn;
 
 	matched = NULL;
-	node = table->top;
+	start = route_stride_lookup(table, p);
+	node = start ? start : table->top;
 
 	/* For unique mode, just do a lookup */
 	if (table->unique_mode) {
@@ -256,7 +388,22 @@ struct route_node *route_node_match(struct route_table *table,
 		node = node->link[prefix_bit(&p->u.prefix, node->p.prefixlen)];
 	}
 
+	/* Started halfway down, the shorter matches are above */
+	for (node = start ? start->parent : NULL; node && !matched;
+	     node = node->parent)
+		if (node->info)
+			matched = node;
+
 done:
+	return matched;
+}
+
+/* Find matched prefix. */
+struct route_node *route_node_match(struct route_table *table,
+				    union prefixconstptr pu)
+{
+	struct route_node *matched = route_node_match_nolock(table, pu);
+
 	/* If matched route found, return it. */
 	if (matched)
 		return route_lock_node(matched);
@@ -332,7 +479,9 @@ struct route_node *route_node_get(struct route_table *table,
 	}
 
 	match = NULL;
-	node = table->top;
+	node = route_stride_lookup(table, p);
+	if (!node)
+		node = table->top;
 	while (node && node->p.prefixlen <= prefixlen
 	       && prefix_match(&node->p, p)) {
 		if (node->p.prefixlen == prefixlen) {
@@ -369,9 +518,20 @@ struct route_node *route_node_get(struct route_table *table,
 			new = route_node_set(table, p);
 			set_link(match, new);
 			table->count++;
+			route_stride_add(table, match);
 		}
 	}
 
+	route_stride_add(table, new);
+
+	if (table->count + 1 >= ROUTE_STRIDE_MIN_COUNT &&
+	    !table->stride_index_off) {
+		int family = route_stride_family(p);
+
+		if (family >= 0 && !table->stride_index[family])
+			route_stride_build(table, family);
+	}
+
 done:
 	table->count++;
 	route_lock_node(new);
@@ -402,6 +562,8 @@ void route_node_delete(struct route_node *node)
 	if (node->l_left && node->l_right)
 		return;
 
+	route_stride_del(table, node);
+
 	if (node->l_left)
 		child = node->l_left;
 	else
@@ -74,6 +74,14 @@ struct route_table {
 	 */
 	unsigned long info_count;
 
+	/*
+	 * Direct index of the first ROUTE_STRIDE_BITS bits of IPv4 and IPv6
+	 * addresses into the tree, built once the table gets large.  See
+	 * route_table_set_stride_index().
+	 */
+	struct route_node **stride_index[2];
+	bool stride_index_off;
+
 	/*
 	 * User data.
 	 */
@@ -198,6 +206,15 @@ bool route_table_is_unique_mode(const struct route_table *table);
 
 extern route_table_delegate_t *route_table_get_default_delegate(void);
 
+/*
+ * Large tables keep a direct index on the first 16 bits of IPv4 / IPv6
+ * prefixes, so that lookups and inserts start halfway down the tree
+ * instead of at the top.  It is built automatically; this forces it on
+ * (building it now) or off (freeing it).
+ */
+extern void route_table_set_stride_index(struct route_table *table,
+					 bool enable);
+
 static inline void *route_table_get_info(struct route_table *table)
 {
 	return table->info;
@@ -221,6 +238,13 @@ extern struct route_node *route_node_lookup_maynull(struct route_table *table,
 						    union prefixconstptr pu);
 extern struct route_node *route_node_match(struct route_table *table,
 					   union prefixconstptr pu);
+/*
+ * Same as route_node_match() but the result is not locked, so it must not
+ * be unlocked either.  This never modifies the table; it is for readers on
+ * other pthreads while the table's owner is known not to touch it.
+ */
+extern struct route_node *route_node_match_nolock(struct route_table *table,
+						  union prefixconstptr pu);
 
 extern unsigned long route_table_count(struct route_table *table);
 extern unsigned long route_table_info_count(struct route_table *table);
@@ -28,8 +28,10 @@
 #include "srte.h"
 #include "printfrr.h"
 #include "srv6.h"
+#include "jhash.h"
 
 DEFINE_MTYPE_STATIC(LIB, ZCLIENT, "Zclient");
+DEFINE_MTYPE_STATIC(LIB, ZCLIENT_BULK, "Zclient route bulk");
 DEFINE_MTYPE_STATIC(LIB, REDIST_INST, "Redistribution instance IDs");
 DEFINE_MTYPE_STATIC(LIB, REDIST_TABLE_DIRECT, "Redistribution table direct");
 
@@ -63,6 +65,37 @@ socklen_t zclient_addr_len;
 /* This file local debug flag. */
 static int zclient_debug;
 
+/*
+ * Bulk route adds, see ZEBRA_ROUTE_ADD_BULK. Routes are encoded into
+ * their own message until it is full, each distinct nexthop set only
+ * once.
+ */
+#define ZAPI_ROUTE_BULK_SLOTS 512
+
+struct zapi_route_bulk {
+	/* Between zclient_route_bulk_begin() and zclient_route_bulk_end() */
+	bool open;
+
+	/* Message being built, empty if there are no routes */
+	struct stream *s;
+	vrf_id_t vrf_id;
+	unsigned int count;
+
+	/* Encoding of the route being added */
+	struct stream *set;
+
+	/* Nexthop sets of the message, with their hash and place in it */
+	uint16_t nsets;
+	struct {
+		uint32_t hash;
+		uint16_t offset;
+		uint16_t len;
+	} sets[ZAPI_ROUTE_BULK_SETS];
+
+	/* Open addressed index into sets, 1-based, 0 if empty */
+	uint16_t slots[ZAPI_ROUTE_BULK_SLOTS];
+};
+
 /* Allocate zclient structure. */
 struct zclient *zclient_new(struct event_loop *master,
 			    const struct zclient_options *opt,
@@ -95,6 +128,11 @@ struct zclient *zclient_new(struct event_loop *master,
    Free zclient structure. */
 void zclient_free(struct zclient *zclient)
 {
+	if (zclient->bulk) {
+		stream_free(zclient->bulk->s);
+		stream_free(zclient->bulk->set);
+		XFREE(MTYPE_ZCLIENT_BULK, zclient->bulk);
+	}
 	if (zclient->ibuf)
 		stream_free(zclient->ibuf);
 	if (zclient->obuf)
@@ -267,6 +305,11 @@ void zclient_stop(struct zclient *zclient)
 
 	/* Empty the write buffer. */
 	buffer_reset(zclient->wb);
+	if (zclient->bulk) {
+		zclient->bulk->count = 0;
+		zclient->bulk->nsets = 0;
+		memset(zclient->bulk->slots, 0, sizeof(zclient->bulk->slots));
+	}
 
 	/* Close socket. */
 	if (zclient->sock >= 0) {
@@ -971,6 +1014,20 @@ enum zclient_send_status zclient_send_rnh(struct zclient *zclient, int command,
 enum zclient_send_status
 zclient_route_send(uint8_t cmd, struct zclient *zclient, struct zapi_route *api)
 {
+	enum zclient_send_status ret;
+
+	if (zclient->bulk) {
+		if (cmd == ZEBRA_ROUTE_ADD && zclient->bulk->open) {
+			ret = zclient_route_bulk_add(zclient, api);
+			if (ret != ZCLIENT_SEND_FAILURE)
+				return ret;
+		}
+
+		/* Keep the order of the routes */
+		if (zclient_route_bulk_flush(zclient) == ZCLIENT_SEND_FAILURE)
+			return ZCLIENT_SEND_FAILURE;
+	}
+
 	if (zapi_route_encode(cmd, zclient->obuf, api) < 0)
 		return ZCLIENT_SEND_FAILURE;
 	return zclient_send_message(zclient);
@@ -1385,6 +1442,10 @@ enum zclient_send_status zclient_nhg_send(struct zclient *zclient, int cmd,
 {
 	api_nhg->proto = zclient->redist_default;
 
+	/* Routes held for a bulk message may use the group */
+	if (zclient_route_bulk_flush(zclient) == ZCLIENT_SEND_FAILURE)
+		return ZCLIENT_SEND_FAILURE;
+
 	if (zapi_nhg_encode(zclient->obuf, cmd, api_nhg))
 		return -1;
 
@@ -1419,15 +1480,8 @@ void zapi_nexthop_init(struct zapi_nexthop *znh)
 	memset(znh, 0, sizeof(struct zapi_nexthop));
 }
 
-int zapi_route_encode(uint8_t cmd, struct stream *s, struct zapi_route *api)
+static int zapi_route_encode_head(struct stream *s, struct zapi_route *api)
 {
-	struct zapi_nexthop *api_nh;
-	int i;
-	int psize;
-
-	stream_reset(s);
-	zclient_create_header(s, cmd, api->vrf_id);
-
 	if (api->type >= ZEBRA_ROUTE_MAX) {
 		flog_err(EC_LIB_ZAPI_ENCODE,
 			 "%s: Specified route type (%u) is not a legal value",
@@ -1450,8 +1504,15 @@ int zapi_route_encode(uint8_t cmd, struct stream *s, struct zapi_route *api)
 	}
 	stream_putc(s, api->safi);
 
-	/* Put prefix information. */
-	stream_putc(s, api->prefix.family);
+	return 0;
+}
+
+/* Prefix length onwards: the family goes ahead of it */
+static void zapi_route_encode_prefix(struct stream *s,
+				     const struct zapi_route *api)
+{
+	int psize;
+
 	psize = PSIZE(api->prefix.prefixlen);
 	stream_putc(s, api->prefix.prefixlen);
 	stream_write(s, &api->prefix.u.prefix, psize);
@@ -1461,6 +1522,13 @@ int zapi_route_encode(uint8_t cmd, struct stream *s, struct zapi_route *api)
 		stream_putc(s, api->src_prefix.prefixlen);
 		stream_write(s, (uint8_t *)&api->src_prefix.prefix, psize);
 	}
+}
+
+/* Nexthops and the attributes that follow them */
+static int zapi_route_encode_nexthops(struct stream *s, struct zapi_route *api)
+{
+	struct zapi_nexthop *api_nh;
+	int i;
 
 	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_NHG))
 		stream_putl(s, api->nhgid);
@@ -1561,6 +1629,12 @@ int zapi_route_encode(uint8_t cmd, struct stream *s, struct zapi_route *api)
 	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_TABLEID))
 		stream_putl(s, api->tableid);
 
+	return 0;
+}
+
+static int zapi_route_encode_opaque(struct stream *s,
+				    const struct zapi_route *api)
+{
 	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_OPAQUE)) {
 		if (api->opaque.length > ZAPI_MESSAGE_OPAQUE_LENGTH) {
 			flog_err(
@@ -1573,12 +1647,183 @@ int zapi_route_encode(uint8_t cmd, struct stream *s, struct zapi_route *api)
 		stream_putw(s, api->opaque.length);
 		stream_write(s, api->opaque.data, api->opaque.length);
 	}
+
+	return 0;
+}
+
+int zapi_route_encode(uint8_t cmd, struct stream *s, struct zapi_route *api)
+{
+	stream_reset(s);
+	zclient_create_header(s, cmd, api->vrf_id);
+
+	if (zapi_route_encode_head(s, api) < 0)
+		return -1;
+
+	/* Put prefix information. */
+	stream_putc(s, api->prefix.family);
+	zapi_route_encode_prefix(s, api);
+
+	if (zapi_route_encode_nexthops(s, api) < 0)
+		return -1;
+
+	if (zapi_route_encode_opaque(s, api) < 0)
+		return -1;
+
 	/* Put length at the first point of the stream. */
 	stream_putw_at(s, 0, stream_get_endp(s));
 
 	return 0;
 }
 
+void zclient_route_bulk_begin(struct zclient *zclient)
+{
+	struct zapi_route_bulk *b = zclient->bulk;
+
+	if (!b) {
+		b = XCALLOC(MTYPE_ZCLIENT_BULK, sizeof(*b));
+		b->s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+		b->set = stream_new(STREAM_SIZE(zclient->obuf));
+		zclient->bulk = b;
+	}
+
+	b->open = true;
+}
+
+enum zclient_send_status zclient_route_bulk_end(struct zclient *zclient)
+{
+	if (!zclient->bulk)
+		return ZCLIENT_SEND_SUCCESS;
+
+	zclient->bulk->open = false;
+
+	return zclient_route_bulk_flush(zclient);
+}
+
+enum zclient_send_status zclient_route_bulk_flush(struct zclient *zclient)
+{
+	struct zapi_route_bulk *b = zclient->bulk;
+	size_t len;
+
+	if (!b || !b->count)
+		return ZCLIENT_SEND_SUCCESS;
+
+	len = stream_get_endp(b->s);
+	stream_putw_at(b->s, 0, len);
+
+	stream_reset(zclient->obuf);
+	stream_put(zclient->obuf, STREAM_DATA(b->s), len);
+
+	b->count = 0;
+	b->nsets = 0;
+	memset(b->slots, 0, sizeof(b->slots));
+
+	return zclient_send_message(zclient);
+}
+
+/* Set index of the route just encoded into b->set, -1 if it is new */
+static int zclient_route_bulk_find(struct zapi_route_bulk *b, uint32_t hash,
+				   unsigned int *slot)
+{
+	size_t len = stream_get_endp(b->set);
+	unsigned int i = hash & (ZAPI_ROUTE_BULK_SLOTS - 1);
+	unsigned int idx;
+
+	while (b->slots[i]) {
+		idx = b->slots[i] - 1;
+		if (b->sets[idx].hash == hash && b->sets[idx].len == len &&
+		    !memcmp(STREAM_DATA(b->s) + b->sets[idx].offset,
+			    STREAM_DATA(b->set), len))
+			return idx;
+
+		i = (i + 1) & (ZAPI_ROUTE_BULK_SLOTS - 1);
+	}
+
+	*slot = i;
+	return -1;
+}
+
+enum zclient_send_status zclient_route_bulk_add(struct zclient *zclient,
+						struct zapi_route *api)
+{
+	struct zapi_route_bulk *b = zclient->bulk;
+	enum zclient_send_status ret = ZCLIENT_SEND_SUCCESS;
+	size_t setlen, need;
+	unsigned int slot = 0;
+	uint32_t hash;
+	int idx;
+
+	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_OPAQUE) &&
+	    api->opaque.length > ZAPI_MESSAGE_OPAQUE_LENGTH)
+		return ZCLIENT_SEND_FAILURE;
+
+	/* If flushing fails the route is not queued, the caller sends it */
+	if (b->count && b->vrf_id != api->vrf_id) {
+		ret = zclient_route_bulk_flush(zclient);
+		if (ret == ZCLIENT_SEND_FAILURE)
+			return ret;
+	}
+
+	/* Nexthop set: everything but the prefixes and opaque data */
+	stream_reset(b->set);
+	if (zapi_route_encode_head(b->set, api) < 0)
+		return ZCLIENT_SEND_FAILURE;
+	stream_putc(b->set, api->prefix.family);
+	if (zapi_route_encode_nexthops(b->set, api) < 0)
+		return ZCLIENT_SEND_FAILURE;
+
+	setlen = stream_get_endp(b->set);
+	hash = jhash(STREAM_DATA(b->set), setlen, 0x5a9b0c17);
+	idx = b->count ? zclient_route_bulk_find(b, hash, &slot) : -1;
+
+	need = sizeof(uint16_t) + 2 * (1 + sizeof(struct in6_addr));
+	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_OPAQUE))
+		need += sizeof(uint16_t) + api->opaque.length;
+	if (idx < 0)
+		need += setlen;
+
+	/* Doesn't fit even on its own, the caller sends a single add */
+	if (ZEBRA_HEADER_SIZE + setlen + need > ZEBRA_MAX_PACKET_SIZ)
+		return ZCLIENT_SEND_FAILURE;
+
+	if (b->count &&
+	    ((idx < 0 && b->nsets == ZAPI_ROUTE_BULK_SETS) ||
+	     STREAM_WRITEABLE(b->s) < need)) {
+		ret = zclient_route_bulk_flush(zclient);
+		if (ret == ZCLIENT_SEND_FAILURE)
+			return ret;
+		if (idx >= 0) {
+			idx = -1;
+			need += setlen;
+		}
+	}
+
+	if (!b->count) {
+		stream_reset(b->s);
+		zclient_create_header(b->s, ZEBRA_ROUTE_ADD_BULK, api->vrf_id);
+		b->vrf_id = api->vrf_id;
+		if (idx < 0)
+			zclient_route_bulk_find(b, hash, &slot);
+	}
+
+	if (idx < 0) {
+		idx = b->nsets++;
+		b->slots[slot] = idx + 1;
+		b->sets[idx].hash = hash;
+		b->sets[idx].len = setlen;
+
+		stream_putw(b->s, idx);
+		b->sets[idx].offset = stream_get_endp(b->s);
+		stream_put(b->s, STREAM_DATA(b->set), setlen);
+	} else
+		stream_putw(b->s, idx);
+
+	zapi_route_encode_prefix(b->s, api);
+	zapi_route_encode_opaque(b->s, api);
+	b->count++;
+
+	return ret;
+}
+
 /*
  * Decode a single zapi nexthop object
  */
@@ -1685,13 +1930,8 @@ stream_failure:
 	return ret;
 }
 
-int zapi_route_decode(struct stream *s, struct zapi_route *api)
+static int zapi_route_decode_head(struct stream *s, struct zapi_route *api)
 {
-	struct zapi_nexthop *api_nh;
-	int i;
-
-	zapi_route_init(api);
-
 	/* Type, flags, message. */
 	STREAM_GETC(s, api->type);
 	if (api->type >= ZEBRA_ROUTE_MAX) {
@@ -1712,8 +1952,14 @@ int zapi_route_decode(struct stream *s, struct zapi_route *api)
 		return -1;
 	}
 
-	/* Prefix. */
-	STREAM_GETC(s, api->prefix.family);
+	return 0;
+stream_failure:
+	return -1;
+}
+
+/* Prefix length onwards, api->prefix.family is already set */
+static int zapi_route_decode_prefix(struct stream *s, struct zapi_route *api)
+{
 	STREAM_GETC(s, api->prefix.prefixlen);
 	switch (api->prefix.family) {
 	case AF_INET:
@@ -1765,6 +2011,16 @@ int zapi_route_decode(struct stream *s, struct zapi_route *api)
 		}
 	}
 
+	return 0;
+stream_failure:
+	return -1;
+}
+
+static int zapi_route_decode_nexthops(struct stream *s, struct zapi_route *api)
+{
+	struct zapi_nexthop *api_nh;
+	int i;
+
 	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_NHG))
 		STREAM_GETL(s, api->nhgid);
 
@@ -1820,6 +2076,13 @@ int zapi_route_decode(struct stream *s, struct zapi_route *api)
 	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_TABLEID))
 		STREAM_GETL(s, api->tableid);
 
+	return 0;
+stream_failure:
+	return -1;
+}
+
+static int zapi_route_decode_opaque(struct stream *s, struct zapi_route *api)
+{
 	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_OPAQUE)) {
 		STREAM_GETW(s, api->opaque.length);
 		if (api->opaque.length > ZAPI_MESSAGE_OPAQUE_LENGTH) {
@@ -1838,6 +2101,51 @@ stream_failure:
 	return -1;
 }
 
+int zapi_route_decode(struct stream *s, struct zapi_route *api)
+{
+	zapi_route_init(api);
+
+	if (zapi_route_decode_head(s, api) < 0)
+		return -1;
+
+	/* Prefix. */
+	STREAM_GETC(s, api->prefix.family);
+	if (zapi_route_decode_prefix(s, api) < 0)
+		return -1;
+
+	if (zapi_route_decode_nexthops(s, api) < 0)
+		return -1;
+
+	if (zapi_route_decode_opaque(s, api) < 0)
+		return -1;
+
+	return 0;
+stream_failure:
+	return -1;
+}
+
+int zapi_route_bulk_decode_set(struct stream *s, struct zapi_route *api)
+{
+	zapi_route_init(api);
+
+	if (zapi_route_decode_head(s, api) < 0)
+		return -1;
+
+	STREAM_GETC(s, api->prefix.family);
+
+	return zapi_route_decode_nexthops(s, api);
+stream_failure:
+	return -1;
+}
+
+int zapi_route_bulk_decode_route(struct stream *s, struct zapi_route *api)
+{
+	if (zapi_route_decode_prefix(s, api) < 0)
+		return -1;
+
+	return zapi_route_decode_opaque(s, api);
+}
+
 static void zapi_encode_prefix(struct stream *s, struct prefix *p,
 			       uint8_t family)
 {
@@ -238,6 +238,7 @@ typedef enum {
 	ZEBRA_TC_FILTER_DELETE,
 	ZEBRA_OPAQUE_NOTIFY,
 	ZEBRA_SRV6_SID_NOTIFY,
+	ZEBRA_ROUTE_ADD_BULK,
 } zebra_message_types_t;
 /* Zebra message types. Please update the corresponding
  * command_types array with any changes!
@@ -346,6 +347,11 @@ struct zclient {
 	/* Buffer of data waiting to be written to zebra. */
 	struct buffer *wb;
 
+	/* Route adds being collected into a ZEBRA_ROUTE_ADD_BULK message,
+	 * between zclient_route_bulk_begin() and zclient_route_bulk_end().
+	 */
+	struct zapi_route_bulk *bulk;
+
 	/* Read and connect thread. */
 	struct event *t_read;
 	struct event *t_connect;
@@ -1195,6 +1201,40 @@ void zapi_nexthop_init(struct zapi_nexthop *znh);
 
 extern int zapi_route_encode(uint8_t cmd, struct stream *s, struct zapi_route *api);
 extern int zapi_route_decode(struct stream *s, struct zapi_route *api);
+
+/*
+ * ZEBRA_ROUTE_ADD_BULK carries many route adds of one vrf. Each route is
+ *
+ *   index (2 bytes) of its nexthop set
+ *   the nexthop set, if index is the number of sets seen so far
+ *   prefix length, prefix and source prefix, as in ZEBRA_ROUTE_ADD
+ *   opaque data, as in ZEBRA_ROUTE_ADD
+ *
+ * where a nexthop set is the route type, instance, flags, message, safi
+ * and prefix family, followed by the nhg id, nexthops, backup nexthops
+ * and attributes as in ZEBRA_ROUTE_ADD. Routes differing only in their
+ * prefixes and opaque data share a set, encoded once.
+ *
+ * Between zclient_route_bulk_begin() and zclient_route_bulk_end(),
+ * zclient_route_send(ZEBRA_ROUTE_ADD) adds to the message, which is sent
+ * when full. Other route messages send it first so that the order of
+ * the routes is kept; anything else is not ordered against it.
+ */
+#define ZAPI_ROUTE_BULK_SETS 256
+
+extern void zclient_route_bulk_begin(struct zclient *zclient);
+extern enum zclient_send_status zclient_route_bulk_end(struct zclient *zclient);
+extern enum zclient_send_status
+zclient_route_bulk_flush(struct zclient *zclient);
+extern enum zclient_send_status zclient_route_bulk_add(struct zclient *zclient,
+						       struct zapi_route *api);
+
+/* Decode a nexthop set of a bulk message into api, then the rest of
+ * each of its routes: only the prefixes and opaque data are overwritten.
+ */
+extern int zapi_route_bulk_decode_set(struct stream *s, struct zapi_route *api);
+extern int zapi_route_bulk_decode_route(struct stream *s,
+					struct zapi_route *api);
 extern int zapi_nexthop_decode(struct stream *s, struct zapi_nexthop *api_nh,
 			       uint32_t api_flags, uint32_t api_message);
 bool zapi_nhg_notify_decode(struct stream *s, uint32_t *id,
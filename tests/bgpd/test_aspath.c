@@ -11,11 +11,13 @@
 #include "queue.h"
 #include "filter.h"
 #include "frr_pthread.h"
+#include "frregex_real.h"
 
 #include "bgpd/bgpd.c"
 #include "bgpd/bgp_aspath.h"
 #include "bgpd/bgp_attr.h"
 #include "bgpd/bgp_packet.h"
+#include "bgpd/bgp_regex.h"
 
 #define VT100_RESET "\x1b[0m"
 #define VT100_RED "\x1b[31m"
@@ -1154,6 +1156,61 @@ static void empty_get_test(void)
 	aspath_free(as);
 }
 
+/* as-path regexes the native matcher takes, or should hand back */
+static const char *const regex_tests[] = {
+	"^8466_", "_4096$", "^8466_3_", "_3_52737_",
+	"_8466_.*_4096_", "^8466_.*_4096$", "^$", ".*",
+	"^.*_123_", "_52737_.*$", "_3_", "_8722_.*_4_",
+	"^4_", "_456_", "^8722$", "^_8466_",
+	"_4096_$", "^.*$", "_", "8466",
+	"^84", "_2_", "_4096_.*_8466_", NULL,
+};
+
+static void regex_test(void)
+{
+	struct bgp_asregex *asre;
+	struct frregex *reg;
+	struct aspath *asp;
+	int i, j, ret;
+	bool ok = true;
+
+	printf("as-path regex: native matcher agrees with regexec\n");
+
+	for (i = 0; regex_tests[i]; i++) {
+		reg = bgp_regcomp(regex_tests[i]);
+		asre = bgp_asregex_compile(regex_tests[i]);
+
+		for (j = 0; test_segments[j].name; j++) {
+			asp = make_aspath(test_segments[j].asdata,
+					  test_segments[j].len, 0,
+					  test_segments[j].asnotation);
+			if (!asp)
+				continue;
+
+			ret = asre ? bgp_asregex_exec(asre, asp) : -1;
+			if (ret >= 0 &&
+			    ret != (bgp_regexec(reg, asp) != REG_NOMATCH)) {
+				ok = false;
+				printf("  %s on \"%s\": native %d\n",
+				       regex_tests[i], aspath_print(asp), ret);
+			}
+			aspath_unintern(&asp);
+		}
+
+		if (asre)
+			bgp_asregex_free(asre);
+		bgp_regex_free(reg);
+	}
+
+	if (ok)
+		printf("%s\n", OK);
+	else {
+		failed++;
+		printf("%s!\n", FAILED);
+	}
+	printf("\n");
+}
+
 /* basic parsing test */
 static void parse_test(struct test_segment *t)
 {
@@ -1547,6 +1604,10 @@ int main(void)
 
 	i = 0;
 
+	regex_test();
+
+	i = 0;
+
 	frr_pthread_init();
 	bgp_pthreads_init();
 	bgp_pth_ka->running = true;
@@ -68,6 +68,7 @@ for _ in range(22):
     TestAspath.okfail("left cmp ")
 
 TestAspath.okfail("empty_get_test")
+TestAspath.okfail("as-path regex")
 
 TestAspath.attrtest("basic test")
 TestAspath.attrtest("length too short")
@@ -0,0 +1,239 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Test program which measures best path comparisons of the paths of one
+ * prefix, with bgp_path_info_cmp() alone and on the decision keys of
+ * bgp_path_info_cmp_keyed(), and checks that both order them the same,
+ * also when the keys tie and the comparison falls back to the full one.
+ */
+
+#include <zebra.h>
+
+#include "qobj.h"
+#include "vty.h"
+#include "stream.h"
+#include "privs.h"
+#include "memory.h"
+#include "queue.h"
+#include "filter.h"
+#include "prng.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_table.h"
+#include "bgpd/bgp_packet.h"
+#include "bgpd/bgp_vty.h"
+#include "bgpd/bgp_network.h"
+#include "bgpd/bgp_label.h"
+
+#define PATHS 32
+#define ROUNDS 200000
+
+/* need these to link in libbgp */
+struct zebra_privs_t bgpd_privs = {};
+struct event_loop *master = NULL;
+
+static struct bgp *bgp;
+static as_t asn = 100;
+
+static unsigned long msec_since(struct timeval *start, struct timeval *stop)
+{
+	return 1000 * (stop->tv_sec - start->tv_sec) +
+	       (stop->tv_usec - start->tv_usec) / 1000;
+}
+
+enum paths_kind {
+	/* No two paths tie on local-pref, AS path length and origin */
+	PATHS_DISTINCT,
+	/* Half the paths tie with each other on the keys, MED decides */
+	PATHS_TIED,
+	/* All paths tie on the keys */
+	PATHS_ALL_TIED,
+};
+
+/* Paths in random order */
+static void make_paths(struct prng *prng, struct peer *peer,
+		       struct bgp_dest *dest, struct bgp_path_info **paths,
+		       enum paths_kind kind)
+{
+	static const char *const aspaths[] = {
+		"1", "1 2", "1 2 3", "1 2 3 4", "1 2 3 4 5", "1 2 3 4 5 6",
+	};
+	unsigned int combo[2 * 6 * 3];
+	struct attr attr;
+	unsigned int i, j, tmp;
+
+	for (i = 0; i < array_size(combo); i++)
+		combo[i] = i;
+	for (i = array_size(combo) - 1; i > 0; i--) {
+		j = prng_rand(prng) % (i + 1);
+		tmp = combo[i];
+		combo[i] = combo[j];
+		combo[j] = tmp;
+	}
+
+	for (i = 0; i < PATHS; i++) {
+		memset(&attr, 0, sizeof(attr));
+		switch (kind) {
+		case PATHS_DISTINCT:
+			bgp_attr_default_set(&attr, bgp, combo[i] % 3);
+			attr.local_pref = 100 + 100 * ((combo[i] / 3) % 2);
+			aspath_unintern(&attr.aspath);
+			attr.aspath = aspath_str2aspath(aspaths[combo[i] / 6],
+							ASNOTATION_PLAIN);
+			break;
+		case PATHS_TIED:
+		case PATHS_ALL_TIED:
+			bgp_attr_default_set(&attr, bgp, BGP_ORIGIN_IGP);
+			attr.local_pref = 100;
+			if (kind == PATHS_TIED)
+				attr.local_pref += 100 * (i % 2);
+			attr.med = combo[i];
+			SET_FLAG(attr.flag,
+				 ATTR_FLAG_BIT(BGP_ATTR_MULTI_EXIT_DISC));
+			aspath_unintern(&attr.aspath);
+			attr.aspath = aspath_str2aspath(aspaths[0],
+							ASNOTATION_PLAIN);
+			break;
+		}
+		SET_FLAG(attr.flag, ATTR_FLAG_BIT(BGP_ATTR_LOCAL_PREF));
+
+		paths[i] = info_make(ZEBRA_ROUTE_BGP, BGP_ROUTE_NORMAL, 0, peer,
+				     bgp_attr_intern(&attr), dest);
+		aspath_unintern(&attr.aspath);
+
+		if (i) {
+			paths[i - 1]->next = paths[i];
+			paths[i]->prev = paths[i - 1];
+		}
+	}
+	bgp_dest_set_bgp_path_info(dest, paths[0]);
+}
+
+/* The insertion sort of bgp_best_selection(), best path first */
+static void sort_paths(struct bgp_path_info **paths,
+		       struct bgp_path_info **order,
+		       const struct bgp_path_dkeys *dkeys)
+{
+	enum bgp_path_selection_reason reason;
+	unsigned int i, j, n;
+	int paths_eq, ret;
+
+	for (n = 0; n < PATHS; n++) {
+		for (i = 0; i < n; i++) {
+			if (dkeys)
+				ret = bgp_path_info_cmp_keyed(bgp, dkeys,
+							      paths[n],
+							      order[i],
+							      &paths_eq, NULL,
+							      false, NULL,
+							      AFI_IP,
+							      SAFI_UNICAST,
+							      &reason);
+			else
+				ret = bgp_path_info_cmp(bgp, paths[n], order[i],
+							&paths_eq, NULL, false,
+							NULL, AFI_IP,
+							SAFI_UNICAST, &reason);
+			if (ret)
+				break;
+		}
+		for (j = n; j > i; j--)
+			order[j] = order[j - 1];
+		order[i] = paths[n];
+	}
+}
+
+static int run_test(const char *name, const char *prefix,
+		    enum paths_kind kind, struct prng *prng, struct peer *peer)
+{
+	struct bgp_path_info *paths[PATHS];
+	struct bgp_path_info *order_full[PATHS], *order_keyed[PATHS];
+	struct bgp_path_dkeys dkeys;
+	struct timeval tv_start, tv_lap, tv_stop;
+	struct bgp_dest *dest;
+	struct prefix p;
+	unsigned int i, keys;
+	int failed = 0;
+
+	str2prefix(prefix, &p);
+	dest = bgp_node_get(bgp->rib[AFI_IP][SAFI_UNICAST], &p);
+	make_paths(prng, peer, dest, paths, kind);
+
+	bgp_path_dkeys_build(&dkeys, bgp, dest, SAFI_UNICAST);
+	keys = dkeys.count;
+	bgp_path_dkeys_free(&dkeys);
+
+	monotime(&tv_start);
+
+	for (i = 0; i < ROUNDS; i++)
+		sort_paths(paths, order_full, NULL);
+
+	monotime(&tv_lap);
+
+	for (i = 0; i < ROUNDS; i++) {
+		bgp_path_dkeys_build(&dkeys, bgp, dest, SAFI_UNICAST);
+		sort_paths(paths, order_keyed, &dkeys);
+		bgp_path_dkeys_free(&dkeys);
+	}
+
+	monotime(&tv_stop);
+
+	printf("%s: sorting %d paths %d times\n", name, PATHS, ROUNDS);
+	printf("  bgp_path_info_cmp():       %lu msec\n",
+	       msec_since(&tv_start, &tv_lap));
+	printf("  bgp_path_info_cmp_keyed(): %lu msec\n",
+	       msec_since(&tv_lap, &tv_stop));
+
+	if (memcmp(order_full, order_keyed, sizeof(order_full))) {
+		printf("Paths were sorted differently\n");
+		failed++;
+	}
+
+	/* Keys that tie everywhere should not be built at all */
+	if ((kind == PATHS_ALL_TIED) != (keys == 0)) {
+		printf("Built %u keys\n", keys);
+		failed++;
+	}
+
+	printf("%s: %s\n", name, failed ? "failed" : "OK");
+	return failed;
+}
+
+int main(void)
+{
+	struct peer *peer;
+	struct prng *prng;
+	int failed = 0;
+
+	qobj_init();
+	cmd_init(0);
+	bgp_vty_init();
+	master = event_master_create("test bestpath performance");
+	bgp_master_init(master, BGP_SOCKET_SNDBUF_SIZE, list_new());
+	vrf_init(NULL, NULL, NULL, NULL);
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+	bgp_attr_init();
+	bgp_labels_init();
+
+	if (bgp_get(&bgp, &asn, NULL, BGP_INSTANCE_TYPE_DEFAULT, NULL,
+		    ASNOTATION_PLAIN) < 0)
+		return -1;
+
+	peer = peer_create_accept(bgp, NULL);
+	peer->host = (char *)"foo";
+	peer->connection = bgp_peer_connection_new(peer, NULL, UNKNOWN);
+	peer->connection->status = Established;
+
+	prng = prng_new(0);
+
+	failed += run_test("distinct keys", "10.0.0.0/8", PATHS_DISTINCT, prng,
+			   peer);
+	failed += run_test("tied keys", "20.0.0.0/8", PATHS_TIED, prng, peer);
+	failed += run_test("all keys tied", "30.0.0.0/8", PATHS_ALL_TIED, prng,
+			   peer);
+
+	prng_free(prng);
+	return failed ? 1 : 0;
+}
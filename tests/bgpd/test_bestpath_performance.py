@@ -0,0 +1,11 @@
+# SPDX-License-Identifier: GPL-2.0-or-later
+import frrtest
+
+
+class TestBestpathPerformance(frrtest.TestMultiOut):
+    program = "./test_bestpath_performance"
+
+
+TestBestpathPerformance.okfail("distinct keys:")
+TestBestpathPerformance.okfail("tied keys:")
+TestBestpathPerformance.okfail("all keys tied:")
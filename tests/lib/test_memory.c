@@ -3,10 +3,13 @@
  */
 
 #include <zebra.h>
+#include <pthread.h>
 #include <memory.h>
 
 DEFINE_MGROUP(TEST_MEMORY, "memory test");
 DEFINE_MTYPE_STATIC(TEST_MEMORY, TEST, "generic test mtype");
+DEFINE_MTYPE_SLAB_STATIC(TEST_MEMORY, TEST_SLAB, "slab test mtype", 200,
+			 MEMSLAB_MAGAZINE);
 
 /* Memory torture tests
  *
@@ -30,6 +33,65 @@ struct event_loop *master;
 
 #define TIMES 10
 
+#define SLAB_OBJS 100000
+
+static void *slab_objs[SLAB_OBJS];
+
+static void *slab_thread(void *arg)
+{
+	/* free the second half from another pthread; its magazine must be
+	 * handed back on exit
+	 */
+	for (int i = SLAB_OBJS / 2; i < SLAB_OBJS; i++)
+		XFREE(MTYPE_TEST_SLAB, slab_objs[i]);
+	return NULL;
+}
+
+static void test_slab(void)
+{
+	struct memslab_stats st;
+	pthread_t pth;
+	char *p;
+
+	printf("slab alloc/free\n\n");
+	for (int i = 0; i < SLAB_OBJS; i++) {
+		slab_objs[i] = XCALLOC(MTYPE_TEST_SLAB, 200);
+		memset(slab_objs[i], i & 0xff, 200);
+	}
+	assert(mtype_stats_alloc(MTYPE_TEST_SLAB) == SLAB_OBJS);
+
+	assert(qmem_slab_stats(MTYPE_TEST_SLAB, &st));
+	assert(st.objsize == 208);
+	assert(st.pages * st.per_page >= SLAB_OBJS);
+	printf("%zu objects on %zu pages\n", st.used, st.pages);
+
+	for (int i = 0; i < SLAB_OBJS; i++) {
+		p = slab_objs[i];
+		assert(p[0] == (char)(i & 0xff) && p[199] == (char)(i & 0xff));
+	}
+
+	/* every other object: half the slots free but no page empty */
+	for (int i = 0; i < SLAB_OBJS / 2; i += 2)
+		XFREE(MTYPE_TEST_SLAB, slab_objs[i]);
+	assert(qmem_slab_stats(MTYPE_TEST_SLAB, &st));
+	assert(st.stranded > 0);
+
+	p = XREALLOC(MTYPE_TEST_SLAB, slab_objs[1], 100);
+	assert(p == slab_objs[1]);
+
+	pthread_create(&pth, NULL, slab_thread, NULL);
+	pthread_join(pth, NULL);
+
+	for (int i = 1; i < SLAB_OBJS / 2; i += 2)
+		XFREE(MTYPE_TEST_SLAB, slab_objs[i]);
+	assert(mtype_stats_alloc(MTYPE_TEST_SLAB) == 0);
+
+	/* what's left: one spare page and this pthread's magazine */
+	assert(qmem_slab_stats(MTYPE_TEST_SLAB, &st));
+	printf("%zu objects on %zu pages after free\n", st.used, st.pages);
+	assert(st.pages <= 3);
+}
+
 int main(int argc, char **argv)
 {
 	void *a[10];
@@ -100,5 +162,7 @@ int main(int argc, char **argv)
 		XFREE(MTYPE_TEST, a[2]);
 		/* alloc == 0, cache valid next request */
 	}
+
+	test_slab();
 	return 0;
 }
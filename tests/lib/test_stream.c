@@ -33,7 +33,7 @@ static void print_stream(struct stream *s)
 
 int main(void)
 {
-	struct stream *s;
+	struct stream *s, *shared;
 
 	s = stream_new(1024);
 
@@ -53,6 +53,19 @@ int main(void)
 	printfrr("l: 0x%x\n", stream_getl(s));
 	printfrr("q: 0x%" PRIx64 "\n", stream_getq(s));
 
+	/* shares have their own getp and outlive the original */
+	stream_set_getp(s, 0);
+	shared = stream_share(s);
+	stream_forward_getp(s, 7);
+	stream_free(s);
+
+	print_stream(shared);
+
+	s = stream_share(shared);
+	stream_free(shared);
+
+	printfrr("q: 0x%" PRIx64 "\n", stream_getq_from(s, 7));
+
 	stream_free(s);
 	return 0;
 }
@@ -10,6 +10,7 @@
 #include "printfrr.h"
 #include "prefix.h"
 #include "table.h"
+#include "monotime.h"
 
 /*
  * test_node_t
@@ -501,6 +502,194 @@ static void test_info_count(void)
 	route_table_finish(table);
 }
 
+#define STRIDE_PREFIXES 100000
+#define STRIDE_LOOKUPS	200000
+
+static uint64_t stride_rand_state = 88172645463325252ULL;
+
+static uint64_t stride_rand(void)
+{
+	stride_rand_state ^= stride_rand_state << 13;
+	stride_rand_state ^= stride_rand_state >> 7;
+	stride_rand_state ^= stride_rand_state << 17;
+	return stride_rand_state;
+}
+
+/* Random IPv4 / IPv6 prefix, roughly shaped like a full table */
+static void stride_random_prefix(struct prefix *p, bool host)
+{
+	uint64_t r = stride_rand();
+
+	memset(p, 0, sizeof(*p));
+	if (r & 1) {
+		p->family = AF_INET;
+		p->u.prefix4.s_addr = (uint32_t)(r >> 32);
+		p->prefixlen = host ? 32 : 8 + (r >> 8) % 25;
+	} else {
+		p->family = AF_INET6;
+		memcpy(&p->u.prefix6, &r, sizeof(r));
+		r = stride_rand();
+		memcpy((uint8_t *)&p->u.prefix6 + 8, &r, sizeof(r));
+		/* mostly under 2000::/3 */
+		p->u.prefix6.s6_addr[0] = 0x20 | (p->u.prefix6.s6_addr[0] & 0x03);
+		p->prefixlen = host ? 128 : 12 + (r >> 8) % 53;
+	}
+	apply_mask(p);
+}
+
+/* Tables don't mix address families */
+static struct route_table *stride_table(struct route_table **tables,
+					const struct prefix *p)
+{
+	return tables[p->family == AF_INET6];
+}
+
+static unsigned long stride_usec(const struct timeval *start,
+				 const struct timeval *stop)
+{
+	struct timeval delta;
+
+	timersub(stop, start, &delta);
+	return delta.tv_sec * 1000000 + delta.tv_usec;
+}
+
+/* Match the same addresses in both sets of tables, returns the times */
+static void stride_verify(struct route_table **a, struct route_table **b,
+			  unsigned int lookups, unsigned long *usec_a,
+			  unsigned long *usec_b)
+{
+	struct route_node *rn_a, *rn_b;
+	struct timeval start, lap, stop;
+	struct prefix *addrs;
+	unsigned int i;
+
+	addrs = calloc(lookups, sizeof(*addrs));
+	assert(addrs);
+	for (i = 0; i < lookups; i++)
+		stride_random_prefix(&addrs[i], true);
+
+	monotime(&start);
+	for (i = 0; i < lookups; i++) {
+		rn_a = route_node_match(stride_table(a, &addrs[i]), &addrs[i]);
+		if (rn_a)
+			route_unlock_node(rn_a);
+	}
+	monotime(&lap);
+	for (i = 0; i < lookups; i++) {
+		rn_b = route_node_match(stride_table(b, &addrs[i]), &addrs[i]);
+		if (rn_b)
+			route_unlock_node(rn_b);
+	}
+	monotime(&stop);
+
+	for (i = 0; i < lookups; i++) {
+		rn_a = route_node_match(stride_table(a, &addrs[i]), &addrs[i]);
+		rn_b = route_node_match(stride_table(b, &addrs[i]), &addrs[i]);
+		assert(!rn_a == !rn_b);
+		if (!rn_a)
+			continue;
+		assert(prefix_same(&rn_a->p, &rn_b->p));
+		route_unlock_node(rn_a);
+		route_unlock_node(rn_b);
+	}
+
+	free(addrs);
+	*usec_a = stride_usec(&start, &lap);
+	*usec_b = stride_usec(&lap, &stop);
+}
+
+static void stride_clear(struct route_table **tables, struct prefix *prefixes,
+			 unsigned int step)
+{
+	struct route_node *rn;
+
+	for (unsigned int i = 0; i < STRIDE_PREFIXES; i += step) {
+		rn = route_node_lookup(stride_table(tables, &prefixes[i]),
+				       &prefixes[i]);
+		if (!rn)
+			continue;
+		route_node_set_info(rn, NULL);
+		route_unlock_node(rn);
+		route_unlock_node(rn);
+	}
+}
+
+/*
+ * test_stride_index
+ *
+ * Builds the same random IPv4 and IPv6 tables with and without the stride
+ * index, checks that lookups agree before and after deleting half of
+ * them, and compares lookup times.
+ */
+static void test_stride_index(void)
+{
+	struct route_table *a[2], *b[2];
+	struct prefix *prefixes;
+	struct route_node *rn;
+	unsigned long usec_a, usec_b;
+	unsigned int i;
+
+	printf("\n\nTesting the route table stride index\n");
+
+	/* The IPv6 one gets its index built as it grows */
+	for (i = 0; i < 2; i++) {
+		a[i] = route_table_init();
+		route_table_set_stride_index(a[i], false);
+		b[i] = route_table_init();
+	}
+	route_table_set_stride_index(b[0], true);
+
+	prefixes = calloc(STRIDE_PREFIXES, sizeof(*prefixes));
+	assert(prefixes);
+
+	/* A default route, so that every IPv4 lookup has some result */
+	str2prefix("0.0.0.0/0", &prefixes[0]);
+	for (i = 1; i < STRIDE_PREFIXES; i++)
+		stride_random_prefix(&prefixes[i], false);
+
+	for (i = 0; i < STRIDE_PREFIXES; i++) {
+		rn = route_node_get(stride_table(a, &prefixes[i]), &prefixes[i]);
+		if (!rn->info)
+			route_node_set_info(rn, prefixes);
+		else
+			route_unlock_node(rn);
+		rn = route_node_get(stride_table(b, &prefixes[i]), &prefixes[i]);
+		if (!rn->info)
+			route_node_set_info(rn, prefixes);
+		else
+			route_unlock_node(rn);
+	}
+	for (i = 0; i < 2; i++)
+		assert(route_table_count(a[i]) == route_table_count(b[i]));
+	assert(b[1]->stride_index[1]);
+
+	stride_verify(a, b, STRIDE_LOOKUPS, &usec_a, &usec_b);
+	printf("%u lookups in %lu nodes: %lu.%06lus without index, %lu.%06lus with index\n",
+	       STRIDE_LOOKUPS,
+	       route_table_count(a[0]) + route_table_count(a[1]),
+	       usec_a / 1000000, usec_a % 1000000, usec_b / 1000000,
+	       usec_b % 1000000);
+
+	/* Drop every other prefix, the default route included */
+	stride_clear(a, prefixes, 2);
+	stride_clear(b, prefixes, 2);
+	for (i = 0; i < 2; i++)
+		assert(route_table_count(a[i]) == route_table_count(b[i]));
+	stride_verify(a, b, STRIDE_LOOKUPS / 10, &usec_a, &usec_b);
+
+	stride_clear(a, prefixes, 1);
+	stride_clear(b, prefixes, 1);
+	for (i = 0; i < 2; i++) {
+		assert(a[i]->top == NULL && b[i]->top == NULL);
+		route_table_finish(a[i]);
+		route_table_finish(b[i]);
+	}
+
+	free(prefixes);
+	printf("Verified stride index lookups on %u prefixes\n",
+	       STRIDE_PREFIXES);
+}
+
 /*
  * run_tests
  */
@@ -510,6 +699,7 @@ static void run_tests(void)
 	test_get_next();
 	test_iter_pause();
 	test_info_count();
+	test_stride_index();
 }
 
 /*
@@ -26,7 +26,18 @@ static void dummy_func(struct event *event)
 {
 }
 
-int main(int argc, char **argv)
+static unsigned long msec_since(struct timeval *start, struct timeval *stop)
+{
+	return 1000 * (stop->tv_sec - start->tv_sec) +
+	       (stop->tv_usec - start->tv_usec) / 1000;
+}
+
+/*
+ * Schedule and remove random timers, on the timer heap or on the timer
+ * wheel.  The wheel only takes second resolution timers, so that's what
+ * both variants use.
+ */
+static void run(const char *desc, bool wheel)
 {
 	struct prng *prng;
 	int i;
@@ -35,13 +46,14 @@ int main(int argc, char **argv)
 	unsigned long t_schedule, t_remove;
 
 	master = event_master_create(NULL);
+	event_master_set_timer_wheel(master, wheel);
 	prng = prng_new(0);
 	timers = calloc(SCHEDULE_TIMERS, sizeof(*timers));
 
 	/* create thread structures so they won't be allocated during the
 	 * time measurement */
 	for (i = 0; i < SCHEDULE_TIMERS; i++) {
-		event_add_timer_msec(master, dummy_func, NULL, 0, &timers[i]);
+		event_add_timer(master, dummy_func, NULL, 0, &timers[i]);
 	}
 	for (i = 0; i < SCHEDULE_TIMERS; i++)
 		event_cancel(&timers[i]);
@@ -49,11 +61,10 @@ int main(int argc, char **argv)
 	monotime(&tv_start);
 
 	for (i = 0; i < SCHEDULE_TIMERS; i++) {
-		long interval_msec;
+		long interval;
 
-		interval_msec = prng_rand(prng) % (100 * SCHEDULE_TIMERS);
-		event_add_timer_msec(master, dummy_func, NULL, interval_msec,
-				     &timers[i]);
+		interval = prng_rand(prng) % (SCHEDULE_TIMERS / 10);
+		event_add_timer(master, dummy_func, NULL, interval, &timers[i]);
 	}
 
 	monotime(&tv_lap);
@@ -67,20 +78,23 @@ int main(int argc, char **argv)
 
 	monotime(&tv_stop);
 
-	t_schedule = 1000 * (tv_lap.tv_sec - tv_start.tv_sec);
-	t_schedule += (tv_lap.tv_usec - tv_start.tv_usec) / 1000;
+	t_schedule = msec_since(&tv_start, &tv_lap);
+	t_remove = msec_since(&tv_lap, &tv_stop);
 
-	t_remove = 1000 * (tv_stop.tv_sec - tv_lap.tv_sec);
-	t_remove += (tv_stop.tv_usec - tv_lap.tv_usec) / 1000;
-
-	printf("Scheduling %d random timers took %lu.%03lu seconds.\n",
-	       SCHEDULE_TIMERS, t_schedule / 1000, t_schedule % 1000);
-	printf("Removing %d random timers took %lu.%03lu seconds.\n",
-	       REMOVE_TIMERS, t_remove / 1000, t_remove % 1000);
+	printf("%s: scheduling %d random timers took %lu.%03lu seconds.\n",
+	       desc, SCHEDULE_TIMERS, t_schedule / 1000, t_schedule % 1000);
+	printf("%s: removing %d random timers took %lu.%03lu seconds.\n",
+	       desc, REMOVE_TIMERS, t_remove / 1000, t_remove % 1000);
 	fflush(stdout);
 
 	free(timers);
 	event_master_free(master);
 	prng_free(prng);
+}
+
+int main(int argc, char **argv)
+{
+	run("Heap", false);
+	run("Wheel", true);
 	return 0;
 }
@@ -399,6 +399,80 @@ def test_fpm_system_route_nhg_sent_to_fpm_not_kernel():
     router.run("ip route del 172.16.2.0/24 dev r1-eth0")
 
 
+def test_fpm_resync_delete_during_outage():
+    "Test that routes deleted while the FPM is away are gone after a resync"
+
+    tgen = get_topogen()
+    router = tgen.gears["r1"]
+
+    router.vtysh_cmd(
+        """
+        configure terminal
+        fpm use-incremental-resync
+        """
+    )
+
+    def fpm_connected(connected):
+        output = router.vtysh_cmd("show fpm status json")
+        try:
+            return json.loads(output).get("connected") == connected
+        except json.JSONDecodeError:
+            return False
+
+    def fpm_dump_count(prefix):
+        if not _fpm_listener_dump(router):
+            return -1
+        return _read_fpm_dump(router).count(prefix)
+
+    router.vtysh_cmd("sharp install routes 10.200.0.0 nexthop 192.168.44.33 10")
+    success, result = topotest.run_and_expect(
+        partial(fpm_dump_count, "10.200.0.9/32"), 1, count=60, wait=1
+    )
+    assert success, "FPM listener did not receive 10.200.0.9/32"
+
+    # Let zebra tell the FPM which generation it is at
+    topotest.sleep(2)
+
+    # Point zebra at a port nobody listens on
+    router.vtysh_cmd(
+        """
+        configure terminal
+        fpm address 127.0.0.1 port 2621
+        """
+    )
+    success, result = topotest.run_and_expect(
+        partial(fpm_connected, False), True, count=30, wait=1
+    )
+    assert success, "zebra did not disconnect from the FPM"
+
+    router.vtysh_cmd("sharp remove routes 10.200.0.0 10")
+
+    router.vtysh_cmd(
+        """
+        configure terminal
+        fpm address 127.0.0.1
+        """
+    )
+    success, result = topotest.run_and_expect(
+        partial(fpm_connected, True), True, count=30, wait=1
+    )
+    assert success, "zebra did not reconnect to the FPM"
+
+    success, result = topotest.run_and_expect(
+        partial(fpm_dump_count, "10.200.0."), 0, count=60, wait=1
+    )
+    assert success, "FPM listener kept routes deleted during the outage:\n{}".format(
+        _read_fpm_dump(router)[-2000:]
+    )
+
+    router.vtysh_cmd(
+        """
+        configure terminal
+        no fpm use-incremental-resync
+        """
+    )
+
+
 if __name__ == "__main__":
     args = ["-s"] + sys.argv[1:]
     sys.exit(pytest.main(args))
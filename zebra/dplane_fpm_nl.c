@@ -14,6 +14,9 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/un.h>
 
 #include <errno.h>
 #include <string.h>
@@ -38,6 +41,7 @@
 #include "zebra/zebra_dplane.h"
 #include "zebra/zebra_mpls.h"
 #include "zebra/zebra_router.h"
+#include "zebra/zebra_vrf.h"
 #include "zebra/zebra_vxlan_private.h"
 #include "zebra/zebra_evpn.h"
 #include "zebra/zebra_evpn_mac.h"
@@ -68,6 +72,66 @@
  */
 #define FPM_HEADER_SIZE 4
 
+/* Default ring data size of the shared memory transport, in MiB */
+#define FPM_SHM_DEFAULT_SIZE 16
+
+/*
+ * RIB nodes looked at per main pthread event while replaying the RIB, and
+ * how long to wait for the output buffer to drain when it is full.
+ */
+#define FPM_RIB_WALK_CHUNK 10000
+#define FPM_RIB_WALK_RETRY_MSEC 10
+
+/*
+ * Route deletions remembered for incremental resyncs, and how long to wait
+ * for the FPM to report its generation after connecting before replaying
+ * everything.
+ */
+#define FPM_TOMBSTONES 16384
+#define FPM_RESYNC_WAIT 3
+
+/* Deleted route, as it was sent to the FPM */
+struct fpm_tombstone {
+	uint64_t gen;
+
+	/* To tell whether the route came back in the meantime */
+	struct prefix p;
+	struct prefix_ipv6 src_p;
+	afi_t afi;
+	safi_t safi;
+	vrf_id_t vrf_id;
+	uint32_t table;
+
+	uint16_t nl_len;
+	uint8_t nl[128];
+};
+
+/*
+ * Resumable walk over all RIB tables.  Nothing is locked between chunks:
+ * the walk remembers the table by its position in the table iteration
+ * and the node by its (destination) prefix, so tables and routes may come
+ * and go in between.
+ */
+struct fpm_rib_walk {
+	/* Table iteration state before and after finding the current table */
+	rib_tables_iter_t prev;
+	rib_tables_iter_t iter;
+
+	/* Destination prefix to resume at, inclusive */
+	struct prefix resume;
+	bool resuming;
+};
+
+enum fpm_rib_walk_status {
+	FPM_RIB_WALK_DONE,
+	/* Chunk done, call again */
+	FPM_RIB_WALK_YIELD,
+	/* The callback stopped, call again to retry the node */
+	FPM_RIB_WALK_STOPPED,
+};
+
+DEFINE_MTYPE_STATIC(ZEBRA, FPM_TOMBSTONE, "FPM route tombstones");
+
 static const char *prov_name = "dplane_fpm_nl";
 
 static atomic_bool fpm_cleaning_up;
@@ -86,6 +150,43 @@ struct fpm_nl_ctx {
 	struct stream *obuf;
 	pthread_mutex_t obuf_mutex;
 
+	/*
+	 * Shared memory ring used instead of obuf when connected over a unix
+	 * socket, see fpm/fpm.h.  Guarded by obuf_mutex.
+	 */
+	struct fpm_shm_ring *ring;
+	size_t ring_maplen;
+	int ring_doorbell;
+	/* Ring data size in MiB */
+	uint32_t shm_size;
+
+	/*
+	 * Incremental resync, see fpm/fpm.h.  The generations are the ones of
+	 * dplane_ctx_get_route_gen(); all but resync_base and tombstones are
+	 * only used in the FPM pthread.
+	 */
+	bool use_resync;
+	uint64_t epoch;
+	/* Highest generation processed, and the last one sent to the FPM */
+	uint64_t gen_processed;
+	uint64_t gen_marked;
+	/* Between connecting and the end of the RIB replay */
+	bool replaying;
+	/* Generation the running replay starts after, 0 for everything */
+	_Atomic uint64_t resync_base;
+
+	/*
+	 * Circular log of the last FPM_TOMBSTONES route deletions, in
+	 * generation order: entry n is at n % FPM_TOMBSTONES.  Deletions up to
+	 * tombstone_floor are no longer known.
+	 */
+	struct fpm_tombstone *tombstones;
+	uint64_t ntombstones;
+	uint64_t tombstone_floor;
+	pthread_mutex_t tombstone_mutex;
+	/* Last tombstone replayed, zebra pthread */
+	uint64_t tombstone_cursor;
+
 	/*
 	 * data plane context queue:
 	 * When a FPM server connection becomes a bottleneck, we must keep the
@@ -104,6 +205,7 @@ struct fpm_nl_ctx {
 	struct event *t_nhg;
 	struct event *t_dequeue;
 	struct event *t_wedged;
+	struct event *t_resync;
 
 	/* zebra events. */
 	struct event *t_lspreset;
@@ -112,6 +214,7 @@ struct fpm_nl_ctx {
 	struct event *t_nhgwalk;
 	struct event *t_ribreset;
 	struct event *t_ribwalk;
+	struct fpm_rib_walk rib_walk;
 	struct event *t_rmacreset;
 	struct event *t_rmacwalk;
 
@@ -155,6 +258,8 @@ enum fpm_nl_events {
 	FNE_RESET_COUNTERS,
 	/* Toggle next hop group feature. */
 	FNE_TOGGLE_NHG,
+	/* Toggle incremental resync. */
+	FNE_TOGGLE_RESYNC,
 	/* Reconnect request by our own code to avoid races. */
 	FNE_INTERNAL_RECONNECT,
 
@@ -187,6 +292,10 @@ static void fpm_nhg_send(struct event *t);
 static void fpm_nhg_reset(struct event *t);
 static void fpm_rib_send(struct event *t);
 static void fpm_rib_reset(struct event *t);
+static void fpm_tombstone_send(struct event *t);
+static void fpm_replay_start(struct fpm_nl_ctx *fnc);
+static void fpm_resync_report(struct fpm_nl_ctx *fnc, uint64_t epoch,
+			      uint64_t gen);
 static void fpm_rmac_send(struct event *t);
 static void fpm_rmac_reset(struct event *t);
 
@@ -249,6 +358,51 @@ ask_reconnect:
 	return CMD_SUCCESS;
 }
 
+DEFPY(fpm_set_shm, fpm_set_shm_cmd,
+      "fpm shared-memory WORD$path [size (1-1024)$mib]",
+      FPM_STR
+      "Pass messages through shared memory to a local FPM\n"
+      "FPM unix socket path\n"
+      "Ring size\n"
+      "Ring size in MiB\n")
+{
+	struct sockaddr_un *sun = (struct sockaddr_un *)&gfnc->addr;
+
+	if (strlen(path) >= sizeof(sun->sun_path)) {
+		vty_out(vty, "%% Socket path too long: %s\n", path);
+		return CMD_WARNING;
+	}
+
+	/* Ring positions are masked, see fpm/fpm.h */
+	if (mib && (mib & (mib - 1))) {
+		vty_out(vty, "%% Ring size must be a power of two: %ld\n", mib);
+		return CMD_WARNING;
+	}
+
+	memset(sun, 0, sizeof(*sun));
+	sun->sun_family = AF_UNIX;
+	strlcpy(sun->sun_path, path, sizeof(sun->sun_path));
+	gfnc->shm_size = mib ? mib : FPM_SHM_DEFAULT_SIZE;
+
+	event_add_event(gfnc->fthread->master, fpm_process_event, gfnc,
+			FNE_RECONNECT, &gfnc->t_event);
+	return CMD_SUCCESS;
+}
+
+DEFUN(no_fpm_set_shm, no_fpm_set_shm_cmd,
+      "no fpm shared-memory [WORD [size (1-1024)]]",
+      NO_STR
+      FPM_STR
+      "Pass messages through shared memory to a local FPM\n"
+      "FPM unix socket path\n"
+      "Ring size\n"
+      "Ring size in MiB\n")
+{
+	event_add_event(gfnc->fthread->master, fpm_process_event, gfnc,
+			FNE_DISABLE, &gfnc->t_event);
+	return CMD_SUCCESS;
+}
+
 DEFUN(no_fpm_set_address, no_fpm_set_address_cmd,
       "no fpm address [<A.B.C.D|X:X::X:X> [port <1-65535>]]",
       NO_STR
@@ -314,6 +468,37 @@ DEFUN(no_fpm_use_route_replace, no_fpm_use_route_replace_cmd,
 	return CMD_SUCCESS;
 }
 
+DEFUN(fpm_use_resync, fpm_use_resync_cmd,
+      "fpm use-incremental-resync",
+      FPM_STR
+      "Only replay the routes changed since the FPM's last generation\n")
+{
+	/* Already enabled. */
+	if (gfnc->use_resync)
+		return CMD_SUCCESS;
+
+	event_add_event(gfnc->fthread->master, fpm_process_event, gfnc,
+			FNE_TOGGLE_RESYNC, &gfnc->t_event);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(no_fpm_use_resync, no_fpm_use_resync_cmd,
+      "no fpm use-incremental-resync",
+      NO_STR
+      FPM_STR
+      "Only replay the routes changed since the FPM's last generation\n")
+{
+	/* Already disabled. */
+	if (!gfnc->use_resync)
+		return CMD_SUCCESS;
+
+	event_add_event(gfnc->fthread->master, fpm_process_event, gfnc,
+			FNE_TOGGLE_RESYNC, &gfnc->t_event);
+
+	return CMD_SUCCESS;
+}
+
 DEFUN(fpm_reset_counters, fpm_reset_counters_cmd,
       "clear fpm counters",
       CLEAR_STR
@@ -335,6 +520,7 @@ DEFPY(fpm_show_status,
 	uint16_t port;
 	struct sockaddr_in *sin;
 	struct sockaddr_in6 *sin6;
+	struct sockaddr_un *sun;
 	char buf[BUFSIZ];
 
 	connected = gfnc->socket > 0 ? true : false;
@@ -350,6 +536,11 @@ DEFPY(fpm_show_status,
 		snprintfrr(buf, sizeof(buf), "%pI6", &sin6->sin6_addr);
 		port = ntohs(sin6->sin6_port);
 		break;
+	case AF_UNIX:
+		sun = (struct sockaddr_un *)&gfnc->addr;
+		strlcpy(buf, sun->sun_path, sizeof(buf));
+		port = 0;
+		break;
 	default:
 		strlcpy(buf, "Unknown", sizeof(buf));
 		port = FPM_DEFAULT_PORT;
@@ -363,9 +554,15 @@ DEFPY(fpm_show_status,
 		json_object_boolean_add(j, "useNHG", gfnc->use_nhg);
 		json_object_boolean_add(j, "useRouteReplace",
 					gfnc->use_route_replace);
+		json_object_boolean_add(j, "useIncrementalResync",
+					gfnc->use_resync);
 		json_object_boolean_add(j, "disabled", gfnc->disabled);
 		json_object_string_add(j, "address", buf);
 		json_object_int_add(j, "port", port);
+		json_object_string_add(j, "transport",
+				       gfnc->addr.ss_family == AF_UNIX
+					       ? "sharedMemory"
+					       : "tcp");
 
 		vty_json(vty, j);
 	} else {
@@ -375,11 +572,16 @@ DEFPY(fpm_show_status,
 		ttable_rowseps(table, 0, BOTTOM, true, '-');
 		ttable_add_row(table, "Address to connect to|%s", buf);
 		ttable_add_row(table, "Port|%u", port);
+		ttable_add_row(table, "Transport|%s",
+			       gfnc->addr.ss_family == AF_UNIX ? "Shared memory"
+							       : "TCP");
 		ttable_add_row(table, "Connected|%s", connected ? "Yes" : "No");
 		ttable_add_row(table, "Use Nexthop Groups|%s",
 			       gfnc->use_nhg ? "Yes" : "No");
 		ttable_add_row(table, "Use Route Replace Semantics|%s",
 			       gfnc->use_route_replace ? "Yes" : "No");
+		ttable_add_row(table, "Use Incremental Resync|%s",
+			       gfnc->use_resync ? "Yes" : "No");
 		ttable_add_row(table, "Disabled|%s",
 			       gfnc->disabled ? "Yes" : "No");
 
@@ -472,6 +674,7 @@ static int fpm_write_config(struct vty *vty)
 {
 	struct sockaddr_in *sin;
 	struct sockaddr_in6 *sin6;
+	struct sockaddr_un *sun;
 	int written = 0;
 
 	if (gfnc->disabled)
@@ -496,6 +699,15 @@ static int fpm_write_config(struct vty *vty)
 
 		vty_out(vty, "\n");
 		break;
+	case AF_UNIX:
+		written = 1;
+		sun = (struct sockaddr_un *)&gfnc->addr;
+		vty_out(vty, "fpm shared-memory %s", sun->sun_path);
+		if (gfnc->shm_size != FPM_SHM_DEFAULT_SIZE)
+			vty_out(vty, " size %u", gfnc->shm_size);
+
+		vty_out(vty, "\n");
+		break;
 
 	default:
 		break;
@@ -511,6 +723,11 @@ static int fpm_write_config(struct vty *vty)
 		written = 1;
 	}
 
+	if (gfnc->use_resync) {
+		vty_out(vty, "fpm use-incremental-resync\n");
+		written = 1;
+	}
+
 	return written;
 }
 
@@ -526,6 +743,139 @@ static struct cmd_node fpm_node = {
  */
 static void fpm_connect(struct event *t);
 
+/*
+ * Shared memory transport, see fpm/fpm.h.
+ */
+
+/* Unmap the ring, called with obuf_mutex held */
+static void fpm_shm_close(struct fpm_nl_ctx *fnc)
+{
+	if (fnc->ring == NULL)
+		return;
+
+	munmap(fnc->ring, fnc->ring_maplen);
+	close(fnc->ring_doorbell);
+	fnc->ring = NULL;
+	fnc->ring_maplen = 0;
+	fnc->ring_doorbell = -1;
+}
+
+/* Create the ring and hand it to the FPM connected on sock */
+static int fpm_shm_open(struct fpm_nl_ctx *fnc, int sock)
+{
+	struct fpm_shm_ring *ring;
+	size_t size = (size_t)fnc->shm_size << 20;
+	size_t maplen = 4096 + size;
+	fpm_msg_hdr_t hdr = {
+		.version = FPM_PROTO_VERSION,
+		.msg_type = FPM_MSG_TYPE_SHM_SETUP,
+		.msg_len = htons(FPM_MSG_HDR_LEN),
+	};
+	struct iovec iov = { .iov_base = &hdr, .iov_len = sizeof(hdr) };
+	union {
+		char buf[CMSG_SPACE(2 * sizeof(int))];
+		struct cmsghdr align;
+	} cbuf = {};
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = cbuf.buf,
+		.msg_controllen = sizeof(cbuf.buf),
+	};
+	struct cmsghdr *cmsg;
+	int fds[2];
+
+	fds[0] = memfd_create("fpm-ring", MFD_CLOEXEC);
+	if (fds[0] == -1) {
+		zlog_warn("%s: memfd_create failed: %s", __func__,
+			  strerror(errno));
+		return -1;
+	}
+
+	if (ftruncate(fds[0], maplen) == -1) {
+		zlog_warn("%s: ftruncate failed: %s", __func__,
+			  strerror(errno));
+		close(fds[0]);
+		return -1;
+	}
+
+	ring = mmap(NULL, maplen, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0],
+		    0);
+	if (ring == MAP_FAILED) {
+		zlog_warn("%s: mmap failed: %s", __func__, strerror(errno));
+		close(fds[0]);
+		return -1;
+	}
+
+	fds[1] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (fds[1] == -1) {
+		zlog_warn("%s: eventfd failed: %s", __func__, strerror(errno));
+		munmap(ring, maplen);
+		close(fds[0]);
+		return -1;
+	}
+
+	ring->magic = FPM_SHM_MAGIC;
+	ring->data_offset = 4096;
+	ring->size = size;
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+	memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+	if (sendmsg(sock, &msg, 0) != (ssize_t)sizeof(hdr)) {
+		zlog_warn("%s: failed to pass the ring: %s", __func__,
+			  strerror(errno));
+		munmap(ring, maplen);
+		close(fds[0]);
+		close(fds[1]);
+		return -1;
+	}
+
+	/* The FPM holds on to the memory through its own descriptor. */
+	close(fds[0]);
+
+	frr_with_mutex (&fnc->obuf_mutex) {
+		fnc->ring = ring;
+		fnc->ring_maplen = maplen;
+		fnc->ring_doorbell = fds[1];
+	}
+
+	return 0;
+}
+
+/*
+ * Space at the head of the ring once a message that would not fit before
+ * the end has been skipped to the start.  Called with obuf_mutex held.
+ */
+static size_t fpm_shm_writeable(struct fpm_shm_ring *ring, size_t *pad)
+{
+	uint64_t head = ring->head;
+	uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	size_t avail = ring->size - (head - tail);
+	size_t contig = ring->size - (head & (ring->size - 1));
+
+	*pad = contig < FPM_SHM_MSG_MAX ? contig : 0;
+
+	return avail > *pad ? avail - *pad : 0;
+}
+
+/* Move the head and ring the doorbell if the FPM is waiting for it */
+static void fpm_shm_publish(struct fpm_nl_ctx *fnc, uint64_t head)
+{
+	uint64_t one = 1;
+
+	__atomic_store_n(&fnc->ring->head, head, __ATOMIC_SEQ_CST);
+
+	if (__atomic_load_n(&fnc->ring->waiting, __ATOMIC_SEQ_CST) &&
+	    write(fnc->ring_doorbell, &one, sizeof(one)) == -1 &&
+	    errno != EAGAIN)
+		zlog_warn("%s: doorbell write failed: %s", __func__,
+			  strerror(errno));
+}
+
 static void fpm_reconnect(struct fpm_nl_ctx *fnc)
 {
 	bool cleaning_p = false;
@@ -562,8 +912,11 @@ static void fpm_reconnect(struct fpm_nl_ctx *fnc)
 
 	stream_reset(fnc->ibuf);
 	stream_reset(fnc->obuf);
+	fpm_shm_close(fnc);
 	event_cancel(&fnc->t_read);
 	event_cancel(&fnc->t_write);
+	event_cancel(&fnc->t_resync);
+	fnc->replaying = true;
 
 	/* Reset the barrier value */
 	cleaning_p = true;
@@ -674,6 +1027,22 @@ static void fpm_read(struct event *t)
 			goto send_batch;
 		}
 
+		/* The FPM telling which routes it already has. */
+		if (fpm.msg_type == FPM_MSG_TYPE_GENERATION) {
+			struct fpm_generation gen = {};
+			size_t len = fpm.msg_len - FPM_MSG_HDR_LEN;
+
+			available_bytes -= fpm.msg_len;
+			if (len >= sizeof(gen)) {
+				stream_get(&gen, fnc->ibuf, sizeof(gen));
+				len -= sizeof(gen);
+				fpm_resync_report(fnc, be64toh(gen.epoch),
+						  be64toh(gen.gen));
+			}
+			stream_forward_getp(fnc->ibuf, len);
+			continue;
+		}
+
 		available_bytes -= FPM_MSG_HDR_LEN;
 
 		/*
@@ -810,8 +1179,7 @@ static void fpm_write(struct event *t)
 		 * Starting with LSPs walk all FPM objects, marking them
 		 * as unsent and then replaying them.
 		 */
-		event_add_timer(zrouter.master, fpm_lsp_reset, fnc, 0,
-				&fnc->t_lspreset);
+		fpm_replay_start(fnc);
 
 		/* Permit receiving messages now. */
 		event_add_read(fnc->fthread->master, fpm_read, fnc, fnc->socket,
@@ -897,6 +1265,29 @@ static void fpm_connect(struct event *t)
 
 	set_nonblocking(sock);
 
+	if (fnc->addr.ss_family == AF_UNIX) {
+		rv = connect(sock, (struct sockaddr *)&fnc->addr,
+			     sizeof(struct sockaddr_un));
+		if (rv == -1 || fpm_shm_open(fnc, sock) == -1) {
+			if (rv == -1)
+				zlog_warn("%s: fpm connection failed: %s",
+					  __func__, strerror(errno));
+			atomic_fetch_add_explicit(&fnc->counters.connection_errors,
+						  1, memory_order_relaxed);
+			close(sock);
+			event_add_timer(fnc->fthread->master, fpm_connect, fnc,
+					3, &fnc->t_connect);
+			return;
+		}
+
+		fnc->connecting = false;
+		fnc->socket = sock;
+		event_add_read(fnc->fthread->master, fpm_read, fnc, sock,
+			       &fnc->t_read);
+		fpm_replay_start(fnc);
+		return;
+	}
+
 	if (fnc->addr.ss_family == AF_INET) {
 		inet_ntop(AF_INET, &sin->sin_addr, addrstr, sizeof(addrstr));
 		slen = sizeof(*sin);
@@ -936,25 +1327,25 @@ static void fpm_connect(struct event *t)
 	 * If we are not connected, then delay the objects reset/send.
 	 */
 	if (!fnc->connecting)
-		event_add_timer(zrouter.master, fpm_lsp_reset, fnc, 0,
-				&fnc->t_lspreset);
+		fpm_replay_start(fnc);
 }
 
 #define DPLANE_FPM_NL_BUF_SIZE 65536
 /**
- * Encode data plane operation context into netlink and enqueue it in the FPM
- * output buffer.
+ * Encode data plane operation context into netlink.
  *
  * @param fnc the netlink FPM context.
  * @param ctx the data plane operation context data.
- * @return 0 on success or -1 on not enough space.
+ * @param nl_buf where to encode to.
+ * @param nl_buf_size space at nl_buf.
+ * @return the encoded length, 0 if there is nothing to send.
  */
-static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
+static size_t fpm_nl_encode(struct fpm_nl_ctx *fnc,
+			    struct zebra_dplane_ctx *ctx, uint8_t *nl_buf,
+			    size_t nl_buf_size)
 {
-	uint8_t nl_buf[DPLANE_FPM_NL_BUF_SIZE];
 	size_t nl_buf_len;
 	ssize_t rv;
-	uint64_t obytes, obytes_peak;
 	enum dplane_op_e op = dplane_ctx_get_op(ctx);
 
 	/*
@@ -979,7 +1370,7 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 	case DPLANE_OP_ROUTE_UPDATE:
 	case DPLANE_OP_ROUTE_DELETE:
 		rv = netlink_route_multipath_msg_encode(RTM_DELROUTE, ctx,
-							nl_buf, sizeof(nl_buf),
+							nl_buf, nl_buf_size,
 							true, fnc->use_nhg,
 							false);
 		if (rv <= 0) {
@@ -999,7 +1390,7 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 	case DPLANE_OP_ROUTE_INSTALL:
 		rv = netlink_route_multipath_msg_encode(RTM_NEWROUTE, ctx,
 							&nl_buf[nl_buf_len],
-							sizeof(nl_buf) -
+							nl_buf_size -
 								nl_buf_len,
 							true, fnc->use_nhg,
 							fnc->use_route_replace);
@@ -1015,7 +1406,7 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 
 	case DPLANE_OP_MAC_INSTALL:
 	case DPLANE_OP_MAC_DELETE:
-		rv = netlink_macfdb_update_ctx(ctx, nl_buf, sizeof(nl_buf));
+		rv = netlink_macfdb_update_ctx(ctx, nl_buf, nl_buf_size);
 		if (rv <= 0) {
 			flog_err(EC_ZEBRA_FPM_ENCODE_FAIL, "%s: netlink_macfdb_update_ctx failed",
 				 __func__);
@@ -1028,7 +1419,7 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 
 	case DPLANE_OP_NH_DELETE:
 		rv = netlink_nexthop_msg_encode(RTM_DELNEXTHOP, ctx, nl_buf,
-						sizeof(nl_buf), true);
+						nl_buf_size, true);
 		if (rv <= 0) {
 			flog_err(EC_ZEBRA_FPM_ENCODE_FAIL, "%s: netlink_nexthop_msg_encode failed",
 				 __func__);
@@ -1042,7 +1433,7 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 	case DPLANE_OP_NH_INSTALL:
 	case DPLANE_OP_NH_UPDATE:
 		rv = netlink_nexthop_msg_encode(RTM_NEWNEXTHOP, ctx, nl_buf,
-						sizeof(nl_buf), true);
+						nl_buf_size, true);
 		if (rv <= 0) {
 			flog_err(EC_ZEBRA_FPM_ENCODE_FAIL, "%s: netlink_nexthop_msg_encode failed",
 				 __func__);
@@ -1056,7 +1447,7 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 	case DPLANE_OP_LSP_INSTALL:
 	case DPLANE_OP_LSP_UPDATE:
 	case DPLANE_OP_LSP_DELETE:
-		rv = netlink_lsp_msg_encoder(ctx, nl_buf, sizeof(nl_buf));
+		rv = netlink_lsp_msg_encoder(ctx, nl_buf, nl_buf_size);
 		if (rv <= 0) {
 			flog_err(EC_ZEBRA_FPM_ENCODE_FAIL, "%s: netlink_lsp_msg_encoder failed",
 				 __func__);
@@ -1123,24 +1514,116 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 
 	}
 
-	/* Skip empty enqueues. */
-	if (nl_buf_len == 0)
-		return 0;
+	return nl_buf_len;
+}
 
-	/* We must know if someday a message goes beyond 65KiB. */
-	assert((nl_buf_len + FPM_HEADER_SIZE) <= UINT16_MAX);
+/*
+ * Room for a message of up to FPM_SHM_MSG_MAX bytes at the head of the
+ * ring, NULL if there is not enough.  head is moved past any padding.
+ * Called with obuf_mutex held.
+ */
+static fpm_msg_hdr_t *fpm_shm_reserve(struct fpm_nl_ctx *fnc, uint64_t *head)
+{
+	struct fpm_shm_ring *ring = fnc->ring;
+	uint8_t *data = fpm_shm_data(ring);
+	fpm_msg_hdr_t *hdr;
+	size_t pad;
 
-	frr_mutex_lock_autounlock(&fnc->obuf_mutex);
+	*head = ring->head;
+
+	if (fpm_shm_writeable(ring, &pad) < FPM_SHM_MSG_MAX) {
+		atomic_fetch_add_explicit(&fnc->counters.buffer_full, 1,
+					  memory_order_relaxed);
+		return NULL;
+	}
+
+	/* Skip the rest of the ring, the message might not fit there. */
+	if (pad) {
+		hdr = (fpm_msg_hdr_t *)&data[*head & (ring->size - 1)];
+		hdr->version = FPM_PROTO_VERSION;
+		hdr->msg_type = FPM_MSG_TYPE_NONE;
+		hdr->msg_len = htons(pad);
+		*head += pad;
+	}
+
+	return (fpm_msg_hdr_t *)&data[*head & (ring->size - 1)];
+}
+
+/*
+ * Encode straight into the ring, called with obuf_mutex held.
+ */
+static int fpm_shm_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
+{
+	uint64_t head;
+	fpm_msg_hdr_t *hdr;
+	size_t nl_buf_len;
+
+	hdr = fpm_shm_reserve(fnc, &head);
+	if (hdr == NULL)
+		return -1;
+
+	nl_buf_len = fpm_nl_encode(fnc, ctx, (uint8_t *)hdr + FPM_HEADER_SIZE,
+				   UINT16_MAX - FPM_HEADER_SIZE);
+	if (nl_buf_len) {
+		hdr->version = FPM_PROTO_VERSION;
+		hdr->msg_type = FPM_MSG_TYPE_NETLINK;
+		hdr->msg_len = htons(nl_buf_len + FPM_HEADER_SIZE);
+		head += fpm_msg_align(nl_buf_len + FPM_HEADER_SIZE);
+
+		atomic_fetch_add_explicit(&fnc->counters.bytes_sent,
+					  nl_buf_len + FPM_HEADER_SIZE,
+					  memory_order_relaxed);
+	}
+
+	if (head != fnc->ring->head)
+		fpm_shm_publish(fnc, head);
+
+	return 0;
+}
+
+/**
+ * Enqueue an FPM message in the FPM output buffer or ring.  Called with
+ * obuf_mutex held.
+ *
+ * @param fnc the netlink FPM context.
+ * @param msg_type the FPM message type.
+ * @param data the message payload.
+ * @param len the payload length.
+ * @return 0 on success or -1 on not enough space.
+ */
+static int fpm_msg_enqueue(struct fpm_nl_ctx *fnc, uint8_t msg_type,
+			   const void *data, size_t len)
+{
+	uint64_t obytes, obytes_peak;
+	fpm_msg_hdr_t *hdr;
+	uint64_t head;
+
+	if (fnc->ring) {
+		hdr = fpm_shm_reserve(fnc, &head);
+		if (hdr == NULL)
+			return -1;
+
+		hdr->version = FPM_PROTO_VERSION;
+		hdr->msg_type = msg_type;
+		hdr->msg_len = htons(len + FPM_HEADER_SIZE);
+		memcpy((uint8_t *)hdr + FPM_HEADER_SIZE, data, len);
+		fpm_shm_publish(fnc, head + fpm_msg_align(len + FPM_HEADER_SIZE));
+
+		atomic_fetch_add_explicit(&fnc->counters.bytes_sent,
+					  len + FPM_HEADER_SIZE,
+					  memory_order_relaxed);
+		return 0;
+	}
 
 	/* Check if we have enough buffer space. */
-	if (STREAM_WRITEABLE(fnc->obuf) < (nl_buf_len + FPM_HEADER_SIZE)) {
+	if (STREAM_WRITEABLE(fnc->obuf) < (len + FPM_HEADER_SIZE)) {
 		atomic_fetch_add_explicit(&fnc->counters.buffer_full, 1,
 					  memory_order_relaxed);
 
 		if (IS_ZEBRA_DEBUG_FPM)
 			zlog_debug(
 				"%s: buffer full: wants to write %zu but has %zu",
-				__func__, nl_buf_len + FPM_HEADER_SIZE,
+				__func__, len + FPM_HEADER_SIZE,
 				STREAM_WRITEABLE(fnc->obuf));
 
 		return -1;
@@ -1151,16 +1634,16 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 	 *
 	 * See FPM_HEADER_SIZE definition for more information.
 	 */
-	stream_putc(fnc->obuf, 1);
-	stream_putc(fnc->obuf, 1);
-	stream_putw(fnc->obuf, nl_buf_len + FPM_HEADER_SIZE);
+	stream_putc(fnc->obuf, FPM_PROTO_VERSION);
+	stream_putc(fnc->obuf, msg_type);
+	stream_putw(fnc->obuf, len + FPM_HEADER_SIZE);
 
 	/* Write current data. */
-	stream_write(fnc->obuf, nl_buf, (size_t)nl_buf_len);
+	stream_write(fnc->obuf, data, len);
 
 	/* Account number of bytes waiting to be written. */
 	atomic_fetch_add_explicit(&fnc->counters.obuf_bytes,
-				  nl_buf_len + FPM_HEADER_SIZE,
+				  len + FPM_HEADER_SIZE,
 				  memory_order_relaxed);
 	obytes = atomic_load_explicit(&fnc->counters.obuf_bytes,
 				      memory_order_relaxed);
@@ -1177,6 +1660,274 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 	return 0;
 }
 
+/**
+ * Encode data plane operation context into netlink and enqueue it in the FPM
+ * output buffer.
+ *
+ * @param fnc the netlink FPM context.
+ * @param ctx the data plane operation context data.
+ * @return 0 on success or -1 on not enough space.
+ */
+static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
+{
+	uint8_t nl_buf[DPLANE_FPM_NL_BUF_SIZE];
+	size_t nl_buf_len;
+
+	frr_with_mutex (&fnc->obuf_mutex) {
+		if (fnc->ring)
+			return fpm_shm_enqueue(fnc, ctx);
+	}
+
+	nl_buf_len = fpm_nl_encode(fnc, ctx, nl_buf, sizeof(nl_buf));
+
+	/* Skip empty enqueues. */
+	if (nl_buf_len == 0)
+		return 0;
+
+	/* We must know if someday a message goes beyond 65KiB. */
+	assert((nl_buf_len + FPM_HEADER_SIZE) <= UINT16_MAX);
+
+	frr_mutex_lock_autounlock(&fnc->obuf_mutex);
+
+	return fpm_msg_enqueue(fnc, FPM_MSG_TYPE_NETLINK, nl_buf, nl_buf_len);
+}
+
+/*
+ * Incremental resync, see fpm/fpm.h.
+ */
+
+/*
+ * Log a route deletion for replaying after a reconnect.  Also called from
+ * the dplane pthread for deletions skipped while the FPM is disconnected.
+ */
+static void fpm_resync_tombstone(struct fpm_nl_ctx *fnc,
+				 struct zebra_dplane_ctx *ctx, uint64_t gen)
+{
+	const struct prefix *src_p;
+	struct fpm_tombstone *ts;
+	ssize_t rv;
+
+	frr_with_mutex (&fnc->tombstone_mutex) {
+		/* Incremental resync is off */
+		if (fnc->tombstones == NULL)
+			break;
+
+		/* The log must stay in generation order; a deletion coming
+		 * in late from the other pthread is given up on instead.
+		 */
+		ts = &fnc->tombstones[(fnc->ntombstones - 1) % FPM_TOMBSTONES];
+		if (fnc->ntombstones && gen <= ts->gen) {
+			fnc->tombstone_floor = MAX(fnc->tombstone_floor, gen);
+			break;
+		}
+
+		ts = &fnc->tombstones[fnc->ntombstones % FPM_TOMBSTONES];
+		if (fnc->ntombstones >= FPM_TOMBSTONES)
+			fnc->tombstone_floor = ts->gen;
+
+		rv = netlink_route_multipath_msg_encode(RTM_DELROUTE, ctx,
+							ts->nl, sizeof(ts->nl),
+							true, fnc->use_nhg,
+							false);
+		if (rv <= 0) {
+			/* Can't replay it, so no resyncing from before it. */
+			fnc->tombstone_floor = gen;
+			break;
+		}
+
+		ts->gen = gen;
+		ts->nl_len = rv;
+		prefix_copy(&ts->p, dplane_ctx_get_dest(ctx));
+		src_p = dplane_ctx_get_src(ctx);
+		if (src_p)
+			prefix_copy(&ts->src_p, src_p);
+		else
+			memset(&ts->src_p, 0, sizeof(ts->src_p));
+		ts->afi = dplane_ctx_get_afi(ctx);
+		ts->safi = dplane_ctx_get_safi(ctx);
+		ts->vrf_id = dplane_ctx_get_vrf(ctx);
+		ts->table = dplane_ctx_get_table(ctx);
+		fnc->ntombstones++;
+	}
+}
+
+/* Note a route change going to the FPM, FPM pthread */
+static void fpm_resync_track(struct fpm_nl_ctx *fnc,
+			     struct zebra_dplane_ctx *ctx)
+{
+	uint64_t gen = dplane_ctx_get_route_gen(ctx);
+
+	if (gen == 0)
+		return;
+
+	if (gen > fnc->gen_processed)
+		fnc->gen_processed = gen;
+
+	if (fnc->use_resync && dplane_ctx_get_op(ctx) == DPLANE_OP_ROUTE_DELETE)
+		fpm_resync_tombstone(fnc, ctx, gen);
+}
+
+/* Tell the FPM it has all route changes processed so far */
+static void fpm_resync_mark(struct fpm_nl_ctx *fnc)
+{
+	struct fpm_generation gen;
+
+	if (!fnc->use_resync || fnc->replaying || fnc->socket == -1 ||
+	    fnc->gen_marked == fnc->gen_processed)
+		return;
+
+	gen.epoch = htobe64(fnc->epoch);
+	gen.gen = htobe64(fnc->gen_processed);
+
+	frr_with_mutex (&fnc->obuf_mutex) {
+		if (fpm_msg_enqueue(fnc, FPM_MSG_TYPE_GENERATION, &gen,
+				    sizeof(gen)) == 0)
+			fnc->gen_marked = fnc->gen_processed;
+	}
+}
+
+/* Replay the routes changed after base, or all of them if 0 */
+static void fpm_resync_begin(struct fpm_nl_ctx *fnc, uint64_t base)
+{
+	struct fpm_generation gen = {
+		.epoch = htobe64(fnc->epoch),
+		.gen = htobe64(base),
+	};
+
+	event_cancel(&fnc->t_resync);
+
+	if (IS_ZEBRA_DEBUG_FPM)
+		zlog_debug("%s: replaying route changes after generation %" PRIu64,
+			   __func__, base);
+
+	/* Nothing was queued since connecting, so this fits. */
+	frr_with_mutex (&fnc->obuf_mutex) {
+		(void)fpm_msg_enqueue(fnc, FPM_MSG_TYPE_RESYNC, &gen,
+				      sizeof(gen));
+	}
+
+	fnc->gen_marked = 0;
+	atomic_store_explicit(&fnc->resync_base, base, memory_order_relaxed);
+	event_add_timer(zrouter.master, fpm_lsp_reset, fnc, 0,
+			&fnc->t_lspreset);
+}
+
+static void fpm_resync_timeout(struct event *t)
+{
+	struct fpm_nl_ctx *fnc = EVENT_ARG(t);
+
+	zlog_info("%s: FPM did not report its generation, replaying all routes",
+		  __func__);
+	fpm_resync_begin(fnc, 0);
+}
+
+/* The FPM reported the last generation it applied */
+static void fpm_resync_report(struct fpm_nl_ctx *fnc, uint64_t epoch,
+			      uint64_t gen)
+{
+	uint64_t base = 0;
+
+	/* Only expected right after connecting. */
+	if (!event_is_scheduled(fnc->t_resync))
+		return;
+
+	if (epoch == fnc->epoch && gen <= fnc->gen_processed) {
+		frr_with_mutex (&fnc->tombstone_mutex) {
+			if (fnc->tombstones && gen >= fnc->tombstone_floor)
+				base = gen;
+		}
+	}
+
+	fpm_resync_begin(fnc, base);
+}
+
+/*
+ * Connected: replay everything, or first wait for the FPM to tell what it
+ * has.
+ */
+static void fpm_replay_start(struct fpm_nl_ctx *fnc)
+{
+	if (fnc->use_resync) {
+		event_add_timer(fnc->fthread->master, fpm_resync_timeout, fnc,
+				FPM_RESYNC_WAIT, &fnc->t_resync);
+		return;
+	}
+
+	atomic_store_explicit(&fnc->resync_base, 0, memory_order_relaxed);
+	event_add_timer(zrouter.master, fpm_lsp_reset, fnc, 0,
+			&fnc->t_lspreset);
+}
+
+static void fpm_rib_walk_start(struct fpm_rib_walk *walk)
+{
+	memset(walk, 0, sizeof(*walk));
+	walk->iter.state = RIB_TABLES_ITER_S_INIT;
+}
+
+/*
+ * Call cb for up to FPM_RIB_WALK_CHUNK nodes of the RIB, picking up where
+ * the last call left off.  A chunk only ends on a destination node, after
+ * all source nodes of the previous one.  If cb returns -1 the walk stops
+ * and resumes at the destination node of the node cb stopped at.
+ */
+static enum fpm_rib_walk_status
+fpm_rib_walk_run(struct fpm_rib_walk *walk,
+		 int (*cb)(struct route_node *rn, void *arg), void *arg)
+{
+	struct route_table *rt;
+	struct route_node *rn;
+	const struct prefix *dst_p;
+	rib_tables_iter_t iter;
+	unsigned int count = 0;
+
+	while (true) {
+		iter = walk->iter;
+		if (walk->resuming) {
+			/* Find the table we stopped in again */
+			iter = walk->prev;
+			rt = rib_tables_iter_next(&iter);
+			if (rt && (iter.vrf_id != walk->iter.vrf_id ||
+				   iter.afi_safi_ix != walk->iter.afi_safi_ix))
+				walk->resuming = false;
+		} else {
+			walk->prev = iter;
+			rt = rib_tables_iter_next(&iter);
+		}
+
+		walk->iter = iter;
+		if (!rt)
+			return FPM_RIB_WALK_DONE;
+
+		if (walk->resuming) {
+			rn = route_node_lookup_maynull(rt, &walk->resume);
+			if (!rn)
+				rn = route_table_get_next(rt, &walk->resume);
+			walk->resuming = false;
+		} else
+			rn = route_top(rt);
+
+		while (rn) {
+			if (count >= FPM_RIB_WALK_CHUNK && !rnode_is_srcnode(rn)) {
+				prefix_copy(&walk->resume, &rn->p);
+				walk->resuming = true;
+				route_unlock_node(rn);
+				return FPM_RIB_WALK_YIELD;
+			}
+
+			if (cb(rn, arg) < 0) {
+				srcdest_rnode_prefixes(rn, &dst_p, NULL);
+				prefix_copy(&walk->resume, dst_p);
+				walk->resuming = true;
+				route_unlock_node(rn);
+				return FPM_RIB_WALK_STOPPED;
+			}
+
+			count++;
+			rn = srcdest_route_next(rn);
+		}
+	}
+}
+
 /*
  * LSP walk/send functions
  */
@@ -1287,6 +2038,7 @@ static void fpm_nhg_send(struct event *t)
 	/* We are done sending next hops, lets install the routes now. */
 	if (fna.complete) {
 		WALK_FINISH(fnc, FNE_NHG_FINISHED);
+		fpm_rib_walk_start(&fnc->rib_walk);
 		event_add_timer(zrouter.master, fpm_rib_reset, fnc, 0,
 				&fnc->t_ribreset);
 	} else /* Otherwise reschedule next hop group again. */
@@ -1294,54 +2046,68 @@ static void fpm_nhg_send(struct event *t)
 				&fnc->t_nhgwalk);
 }
 
+struct fpm_rib_arg {
+	struct zebra_dplane_ctx *ctx;
+	struct fpm_nl_ctx *fnc;
+};
+
+static int fpm_rib_send_cb(struct route_node *rn, void *arg)
+{
+	struct fpm_rib_arg *fra = arg;
+	rib_dest_t *dest = rib_dest_from_rnode(rn);
+
+	/* Skip bad route entries. */
+	if (dest == NULL || dest->selected_fib == NULL)
+		return 0;
+
+	/* Check for already sent routes. */
+	if (CHECK_FLAG(dest->flags, RIB_DEST_UPDATE_FPM))
+		return 0;
+
+	/* Enqueue route install. */
+	dplane_ctx_reset(fra->ctx);
+	dplane_ctx_route_init(fra->ctx, DPLANE_OP_ROUTE_INSTALL, rn,
+			      dest->selected_fib);
+	if (fpm_nl_enqueue(fra->fnc, fra->ctx) == -1)
+		return -1;
+
+	/* Mark as sent. */
+	SET_FLAG(dest->flags, RIB_DEST_UPDATE_FPM);
+	return 0;
+}
+
 /**
  * Send all RIB installed routes to the connected data plane.
  */
 static void fpm_rib_send(struct event *t)
 {
 	struct fpm_nl_ctx *fnc = EVENT_ARG(t);
-	rib_dest_t *dest;
-	struct route_node *rn;
-	struct route_table *rt;
-	struct zebra_dplane_ctx *ctx;
-	rib_tables_iter_t rt_iter;
+	struct fpm_rib_arg fra;
+	enum fpm_rib_walk_status status;
 
 	/* Allocate temporary context for all transactions. */
-	ctx = dplane_ctx_alloc();
-
-	rt_iter.state = RIB_TABLES_ITER_S_INIT;
-	while ((rt = rib_tables_iter_next(&rt_iter))) {
-		for (rn = route_top(rt); rn; rn = srcdest_route_next(rn)) {
-			dest = rib_dest_from_rnode(rn);
-			/* Skip bad route entries. */
-			if (dest == NULL || dest->selected_fib == NULL)
-				continue;
-
-			/* Check for already sent routes. */
-			if (CHECK_FLAG(dest->flags, RIB_DEST_UPDATE_FPM))
-				continue;
+	fra.ctx = dplane_ctx_alloc();
+	fra.fnc = fnc;
 
-			/* Enqueue route install. */
-			dplane_ctx_reset(ctx);
-			dplane_ctx_route_init(ctx, DPLANE_OP_ROUTE_INSTALL, rn,
-					      dest->selected_fib);
-			if (fpm_nl_enqueue(fnc, ctx) == -1) {
-				/* Free the temporary allocated context. */
-				dplane_ctx_fini(&ctx);
+	status = fpm_rib_walk_run(&fnc->rib_walk, fpm_rib_send_cb, &fra);
 
-				event_add_timer(zrouter.master, fpm_rib_send,
-						fnc, 1, &fnc->t_ribwalk);
-				return;
-			}
+	/* Free the temporary allocated context. */
+	dplane_ctx_fini(&fra.ctx);
 
-			/* Mark as sent. */
-			SET_FLAG(dest->flags, RIB_DEST_UPDATE_FPM);
-		}
+	switch (status) {
+	case FPM_RIB_WALK_YIELD:
+		event_add_event(zrouter.master, fpm_rib_send, fnc, 0,
+				&fnc->t_ribwalk);
+		return;
+	case FPM_RIB_WALK_STOPPED:
+		/* Output buffer is full, pick up again once it drained. */
+		event_add_timer_msec(zrouter.master, fpm_rib_send, fnc,
+				     FPM_RIB_WALK_RETRY_MSEC, &fnc->t_ribwalk);
+		return;
+	case FPM_RIB_WALK_DONE:
+		break;
 	}
 
-	/* Free the temporary allocated context. */
-	dplane_ctx_fini(&ctx);
-
 	/* All RIB routes sent! */
 	WALK_FINISH(fnc, FNE_RIB_FINISHED);
 
@@ -1458,30 +2224,152 @@ static void fpm_lsp_reset(struct event *t)
 	event_add_event(zrouter.master, fpm_lsp_send, fnc, 0, &fnc->t_lspwalk);
 }
 
+static int fpm_rib_reset_cb(struct route_node *rn, void *arg)
+{
+	uint64_t base = *(uint64_t *)arg;
+	rib_dest_t *dest = rib_dest_from_rnode(rn);
+
+	/* Skip bad route entries. */
+	if (dest == NULL)
+		return 0;
+
+	/* The FPM has it already, unless it never went through the dplane. */
+	if (base && dest->dplane_gen && dest->dplane_gen <= base)
+		SET_FLAG(dest->flags, RIB_DEST_UPDATE_FPM);
+	else
+		UNSET_FLAG(dest->flags, RIB_DEST_UPDATE_FPM);
+
+	return 0;
+}
+
 /**
  * Resets the RIB FPM flags so we send all routes again.
  */
 static void fpm_rib_reset(struct event *t)
 {
 	struct fpm_nl_ctx *fnc = EVENT_ARG(t);
-	rib_dest_t *dest;
+	uint64_t base = atomic_load_explicit(&fnc->resync_base,
+					     memory_order_relaxed);
+
+	if (fpm_rib_walk_run(&fnc->rib_walk, fpm_rib_reset_cb, &base) !=
+	    FPM_RIB_WALK_DONE) {
+		event_add_event(zrouter.master, fpm_rib_reset, fnc, 0,
+				&fnc->t_ribreset);
+		return;
+	}
+
+	/* Schedule next step: send missed deletions, or RIB routes. */
+	if (base) {
+		fnc->tombstone_cursor = base;
+		event_add_event(zrouter.master, fpm_tombstone_send, fnc, 0,
+				&fnc->t_ribwalk);
+		return;
+	}
+
+	fpm_rib_walk_start(&fnc->rib_walk);
+	event_add_event(zrouter.master, fpm_rib_send, fnc, 0, &fnc->t_ribwalk);
+}
+
+/*
+ * Copy out the first tombstone after the cursor.  Returns false when
+ * there is none, setting lost if some were dropped before being replayed.
+ */
+static bool fpm_tombstone_next(struct fpm_nl_ctx *fnc,
+			       struct fpm_tombstone *ts, bool *lost)
+{
+	uint64_t lo, hi, mid;
+
+	frr_with_mutex (&fnc->tombstone_mutex) {
+		if (fnc->tombstones == NULL ||
+		    fnc->tombstone_floor > fnc->tombstone_cursor) {
+			*lost = true;
+			return false;
+		}
+
+		lo = fnc->ntombstones > FPM_TOMBSTONES
+			     ? fnc->ntombstones - FPM_TOMBSTONES
+			     : 0;
+		hi = fnc->ntombstones;
+		while (lo < hi) {
+			mid = lo + (hi - lo) / 2;
+			if (fnc->tombstones[mid % FPM_TOMBSTONES].gen <=
+			    fnc->tombstone_cursor)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+		if (lo == fnc->ntombstones)
+			return false;
+
+		*ts = fnc->tombstones[lo % FPM_TOMBSTONES];
+	}
+
+	return true;
+}
+
+/* Whether a deleted route is back, it is then sent with the RIB */
+static bool fpm_tombstone_reinstalled(const struct fpm_tombstone *ts)
+{
+	struct route_table *table;
 	struct route_node *rn;
-	struct route_table *rt;
-	rib_tables_iter_t rt_iter;
-
-	rt_iter.state = RIB_TABLES_ITER_S_INIT;
-	while ((rt = rib_tables_iter_next(&rt_iter))) {
-		for (rn = route_top(rt); rn; rn = srcdest_route_next(rn)) {
-			dest = rib_dest_from_rnode(rn);
-			/* Skip bad route entries. */
-			if (dest == NULL)
-				continue;
+	rib_dest_t *dest;
+	bool installed;
+
+	table = zebra_vrf_lookup_table_with_table_id(ts->afi, ts->safi,
+						     ts->vrf_id, ts->table);
+	if (table == NULL)
+		return false;
 
-			UNSET_FLAG(dest->flags, RIB_DEST_UPDATE_FPM);
+	rn = srcdest_rnode_lookup(table, &ts->p,
+				  ts->src_p.family ? &ts->src_p : NULL);
+	if (rn == NULL)
+		return false;
+
+	dest = rib_dest_from_rnode(rn);
+	installed = dest && dest->selected_fib;
+	route_unlock_node(rn);
+
+	return installed;
+}
+
+/**
+ * Resend the route deletions since the FPM's generation, then the routes
+ * changed since.
+ */
+static void fpm_tombstone_send(struct event *t)
+{
+	struct fpm_nl_ctx *fnc = EVENT_ARG(t);
+	struct fpm_tombstone ts;
+	bool lost = false;
+	int rv = 0;
+
+	while (fpm_tombstone_next(fnc, &ts, &lost)) {
+		if (!fpm_tombstone_reinstalled(&ts)) {
+			frr_with_mutex (&fnc->obuf_mutex) {
+				rv = fpm_msg_enqueue(fnc, FPM_MSG_TYPE_NETLINK,
+						     ts.nl, ts.nl_len);
+			}
+			if (rv == -1) {
+				event_add_timer_msec(zrouter.master,
+						     fpm_tombstone_send, fnc,
+						     FPM_RIB_WALK_RETRY_MSEC,
+						     &fnc->t_ribwalk);
+				return;
+			}
 		}
+
+		fnc->tombstone_cursor = ts.gen;
 	}
 
-	/* Schedule next step: send RIB routes. */
+	if (lost) {
+		zlog_warn("%s: route deletions dropped before they were replayed, resyncing",
+			  __func__);
+		FPM_RECONNECT(fnc);
+		return;
+	}
+
+	fpm_rib_walk_start(&fnc->rib_walk);
 	event_add_event(zrouter.master, fpm_rib_send, fnc, 0, &fnc->t_ribwalk);
 }
 
@@ -1536,7 +2424,13 @@ static void fpm_process_queue(struct event *t)
 		size_t writeable_amount;
 
 		frr_with_mutex (&fnc->obuf_mutex) {
-			writeable_amount = STREAM_WRITEABLE(fnc->obuf);
+			size_t pad;
+
+			if (fnc->ring)
+				writeable_amount =
+					fpm_shm_writeable(fnc->ring, &pad);
+			else
+				writeable_amount = STREAM_WRITEABLE(fnc->obuf);
 		}
 
 		/* No space available yet. */
@@ -1561,6 +2455,8 @@ static void fpm_process_queue(struct event *t)
 		if (fnc->socket != -1)
 			(void)fpm_nl_enqueue(fnc, ctx);
 
+		fpm_resync_track(fnc, ctx);
+
 		/* Account the processed entries. */
 		processed_contexts++;
 
@@ -1571,6 +2467,9 @@ static void fpm_process_queue(struct event *t)
 	atomic_fetch_add_explicit(&fnc->counters.dplane_contexts,
 				  processed_contexts, memory_order_relaxed);
 
+	if (processed_contexts)
+		fpm_resync_mark(fnc);
+
 	/* Re-schedule if we ran out of buffer space */
 	if (no_bufs) {
 		if (processed_contexts)
@@ -1632,6 +2531,24 @@ static void fpm_process_event(struct event *t)
 		fpm_reconnect(fnc);
 		break;
 
+	case FNE_TOGGLE_RESYNC:
+		zlog_info("%s: toggle incremental resync", __func__);
+		frr_with_mutex (&fnc->tombstone_mutex) {
+			if (fnc->use_resync) {
+				XFREE(MTYPE_FPM_TOMBSTONE, fnc->tombstones);
+				break;
+			}
+
+			/* Deletions so far were not kept. */
+			fnc->tombstones = XCALLOC(MTYPE_FPM_TOMBSTONE,
+						  FPM_TOMBSTONES *
+							  sizeof(*fnc->tombstones));
+			fnc->ntombstones = 0;
+			fnc->tombstone_floor = fnc->gen_processed;
+		}
+		fnc->use_resync = !fnc->use_resync;
+		break;
+
 	case FNE_INTERNAL_RECONNECT:
 		fpm_reconnect(fnc);
 		break;
@@ -1644,6 +2561,10 @@ static void fpm_process_event(struct event *t)
 	case FNE_RIB_FINISHED:
 		if (IS_ZEBRA_DEBUG_FPM)
 			zlog_debug("%s: RIB walk finished", __func__);
+
+		/* The FPM is now up to date with all processed changes. */
+		fnc->replaying = false;
+		fpm_resync_mark(fnc);
 		break;
 	case FNE_RMAC_FINISHED:
 		if (IS_ZEBRA_DEBUG_FPM)
@@ -1670,6 +2591,13 @@ static int fpm_nl_start(struct zebra_dplane_provider *prov)
 	fnc->obuf = stream_new(DPLANE_FPM_NL_BUF_SIZE * 128);
 	pthread_mutex_init(&fnc->obuf_mutex, NULL);
 	fnc->socket = -1;
+	fnc->ring_doorbell = -1;
+	fnc->replaying = true;
+	fnc->epoch = ((uint64_t)time(NULL) << 32) |
+		     (uint32_t)frr_weak_random();
+	pthread_mutex_init(&fnc->tombstone_mutex, NULL);
+	if (fnc->shm_size == 0)
+		fnc->shm_size = FPM_SHM_DEFAULT_SIZE;
 	fnc->disabled = true;
 	fnc->prov = prov;
 	dplane_ctx_q_init(&fnc->ctxqueue);
@@ -1729,6 +2657,9 @@ static int fpm_nl_finish_late(struct fpm_nl_ctx *fnc)
 	frr_pthread_stop(fnc->fthread, NULL);
 
 	/* Free all allocated resources. */
+	fpm_shm_close(fnc);
+	XFREE(MTYPE_FPM_TOMBSTONE, fnc->tombstones);
+	pthread_mutex_destroy(&fnc->tombstone_mutex);
 	pthread_mutex_destroy(&fnc->obuf_mutex);
 	pthread_mutex_destroy(&fnc->ctxqueue_mutex);
 	stream_free(fnc->ibuf);
@@ -1808,6 +2739,18 @@ static int fpm_nl_process(struct zebra_dplane_provider *prov)
 				peak_queue = cur_queue;
 			continue;
 		}
+
+		/*
+		 * The RIB walk after reconnecting only finds routes that
+		 * still exist, so keep the deletions it would miss.  Other
+		 * changes need no tracking: their dests have a newer
+		 * generation than anything the FPM reports and are sent again.
+		 */
+		if (dplane_ctx_get_op(ctx) == DPLANE_OP_ROUTE_DELETE &&
+		    dplane_ctx_get_safi(ctx) != SAFI_MULTICAST &&
+		    dplane_ctx_get_route_gen(ctx))
+			fpm_resync_tombstone(fnc, ctx,
+					     dplane_ctx_get_route_gen(ctx));
 skip:
 		dplane_ctx_set_status(ctx, ZEBRA_DPLANE_REQUEST_SUCCESS);
 		dplane_provider_enqueue_out_ctx(prov, ctx);
@@ -1859,10 +2802,14 @@ static int fpm_nl_new(struct event_loop *tm)
 	install_element(ENABLE_NODE, &fpm_reset_counters_cmd);
 	install_element(CONFIG_NODE, &fpm_set_address_cmd);
 	install_element(CONFIG_NODE, &no_fpm_set_address_cmd);
+	install_element(CONFIG_NODE, &fpm_set_shm_cmd);
+	install_element(CONFIG_NODE, &no_fpm_set_shm_cmd);
 	install_element(CONFIG_NODE, &fpm_use_nhg_cmd);
 	install_element(CONFIG_NODE, &no_fpm_use_nhg_cmd);
 	install_element(CONFIG_NODE, &fpm_use_route_replace_cmd);
 	install_element(CONFIG_NODE, &no_fpm_use_route_replace_cmd);
+	install_element(CONFIG_NODE, &fpm_use_resync_cmd);
+	install_element(CONFIG_NODE, &no_fpm_use_resync_cmd);
 
 	return 0;
 }
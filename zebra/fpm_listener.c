@@ -28,6 +28,10 @@
 #include <stdint.h>
 #include <memory.h>
 #include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <poll.h>
 #include <arpa/inet.h>
 #include <errno.h>
 #include <assert.h>
@@ -116,6 +120,16 @@ struct glob {
 	bool reflect;
 	bool reflect_fail_all;
 	bool dump_hex;
+	/* Pause after each message, to act like a slow hardware agent */
+	unsigned int delay_usec;
+	/* Unix socket to take a shared memory ring from, see fpm/fpm.h */
+	const char *shm_path;
+	/* Only count messages, to measure the transport itself */
+	bool bench;
+	uint64_t msg_count;
+	/* Last generation of zebra's routes applied, see fpm/fpm.h */
+	uint64_t epoch;
+	uint64_t gen;
 	FILE *output_file;
 	const char *dump_file;
 	struct fpm_route_head route_tree;
@@ -205,13 +219,54 @@ static int create_listen_sock(int port, int *sock_p)
 	return 1;
 }
 
+/*
+ * create_listen_unix_sock
+ */
+static int create_listen_unix_sock(const char *path, int *sock_p)
+{
+	int sock;
+	struct sockaddr_un addr;
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "Socket path too long: %s\n", path);
+		return 0;
+	}
+
+	sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock < 0) {
+		fprintf(stderr, "Failed to create socket: %s\n", strerror(errno));
+		return 0;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+	unlink(path);
+
+	if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		fprintf(stderr, "Failed to bind to %s: %s\n", path, strerror(errno));
+		close(sock);
+		return 0;
+	}
+
+	if (listen(sock, 5)) {
+		fprintf(stderr, "Failed to listen on socket: %s\n", strerror(errno));
+		close(sock);
+		return 0;
+	}
+
+	*sock_p = sock;
+	return 1;
+}
+
 /*
  * accept_conn
  */
 static int accept_conn(int listen_sock)
 {
 	int sock;
-	struct sockaddr_in client_addr = { 0 };
+	struct sockaddr_storage client_addr = { 0 };
+	struct sockaddr_in *sin = (struct sockaddr_in *)&client_addr;
 	unsigned int client_len;
 
 	while (1) {
@@ -224,7 +279,9 @@ static int accept_conn(int listen_sock)
 
 		if (sock >= 0) {
 			fprintf(glob->output_file, "[%s] Accepted client %s\n", get_timestamp(),
-				inet_ntop(AF_INET, &client_addr.sin_addr, buf, sizeof(buf)));
+				glob->shm_path ? glob->shm_path
+					       : inet_ntop(AF_INET, &sin->sin_addr, buf,
+							   sizeof(buf)));
 			return sock;
 		}
 		fprintf(stderr, "Failed to accept socket: %s\n", strerror(errno));
@@ -1084,11 +1141,78 @@ static void parse_netlink_msg(char *buf, size_t buf_len, fpm_msg_hdr_t *fpm)
 	}
 }
 
+/*
+ * send_fpm_generation
+ *
+ * Tell zebra which of its routes we have, so that it only replays the
+ * ones changed since.
+ */
+static void send_fpm_generation(void)
+{
+	struct {
+		fpm_msg_hdr_t hdr;
+		struct fpm_generation gen;
+	} __attribute__((packed)) msg = {
+		.hdr.version = FPM_PROTO_VERSION,
+		.hdr.msg_type = FPM_MSG_TYPE_GENERATION,
+		.hdr.msg_len = htons(sizeof(msg)),
+		.gen.epoch = htobe64(glob->epoch),
+		.gen.gen = htobe64(glob->gen),
+	};
+
+	if (write(glob->sock, &msg, sizeof(msg)) != sizeof(msg))
+		fprintf(stderr, "Failed to send generation: %s\n", strerror(errno));
+}
+
+/*
+ * process_fpm_generation
+ */
+static void process_fpm_generation(fpm_msg_hdr_t *hdr)
+{
+	struct fpm_generation gen;
+	struct fpm_route *route;
+	struct fpm_nhg *nhg;
+
+	if (fpm_msg_data_len(hdr) < sizeof(gen)) {
+		fprintf(stderr, "Short generation message\n");
+		return;
+	}
+
+	memcpy(&gen, fpm_msg_data(hdr), sizeof(gen));
+	glob->epoch = be64toh(gen.epoch);
+	glob->gen = be64toh(gen.gen);
+
+	if (!glob->bench)
+		fprintf(glob->output_file, "[%s] %s - Epoch: %" PRIx64 ", Generation %" PRIu64 "\n",
+			get_timestamp(),
+			hdr->msg_type == FPM_MSG_TYPE_RESYNC ? "Resync" : "Generation",
+			glob->epoch, glob->gen);
+
+	/* A full replay follows, forget everything. */
+	if (hdr->msg_type == FPM_MSG_TYPE_RESYNC && glob->gen == 0) {
+		while ((route = fpm_route_pop(&glob->route_tree)))
+			free(route);
+		while ((nhg = fpm_nhg_pop(&glob->nhg_hash)))
+			free(nhg);
+	}
+}
+
 /*
  * process_fpm_msg
  */
 static void process_fpm_msg(fpm_msg_hdr_t *hdr)
 {
+	glob->msg_count++;
+
+	if (hdr->msg_type == FPM_MSG_TYPE_GENERATION ||
+	    hdr->msg_type == FPM_MSG_TYPE_RESYNC) {
+		process_fpm_generation(hdr);
+		return;
+	}
+
+	if (glob->bench)
+		return;
+
 	fprintf(glob->output_file, "[%s] FPM message - Type: %d, Length %d\n", get_timestamp(),
 		hdr->msg_type, ntohs(hdr->msg_len));
 
@@ -1108,6 +1232,8 @@ static void fpm_serve(void)
 	char buf[FPM_MAX_MSG_LEN * 4];
 	fpm_msg_hdr_t *hdr;
 
+	send_fpm_generation();
+
 	while (1) {
 
 		hdr = read_fpm_msg(buf, sizeof(buf));
@@ -1117,7 +1243,154 @@ static void fpm_serve(void)
 		}
 
 		process_fpm_msg(hdr);
+
+		if (glob->delay_usec)
+			usleep(glob->delay_usec);
+	}
+}
+
+/*
+ * fpm_shm_attach
+ *
+ * Receive the ring and its doorbell from zebra and map the ring.
+ */
+static struct fpm_shm_ring *fpm_shm_attach(int *doorbell, size_t *maplen)
+{
+	fpm_msg_hdr_t hdr;
+	struct iovec iov = { .iov_base = &hdr, .iov_len = sizeof(hdr) };
+	union {
+		char buf[CMSG_SPACE(2 * sizeof(int))];
+		struct cmsghdr align;
+	} cbuf;
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = cbuf.buf,
+		.msg_controllen = sizeof(cbuf.buf),
+	};
+	struct cmsghdr *cmsg;
+	struct fpm_shm_ring *ring;
+	struct stat st;
+	int fds[2];
+
+	if (recvmsg(glob->sock, &msg, 0) != (ssize_t)sizeof(hdr) ||
+	    hdr.msg_type != FPM_MSG_TYPE_SHM_SETUP) {
+		fprintf(stderr, "Expected a shared memory setup message\n");
+		return NULL;
+	}
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	if (!cmsg || cmsg->cmsg_type != SCM_RIGHTS ||
+	    cmsg->cmsg_len != CMSG_LEN(sizeof(fds))) {
+		fprintf(stderr, "Setup message carries no ring\n");
+		return NULL;
+	}
+	memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+
+	if (fstat(fds[0], &st) < 0) {
+		fprintf(stderr, "Failed to stat ring: %s\n", strerror(errno));
+		close(fds[0]);
+		close(fds[1]);
+		return NULL;
+	}
+
+	ring = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+	close(fds[0]);
+	if (ring == MAP_FAILED) {
+		fprintf(stderr, "Failed to map ring: %s\n", strerror(errno));
+		close(fds[1]);
+		return NULL;
+	}
+
+	if (ring->magic != FPM_SHM_MAGIC || ring->size == 0 ||
+	    (ring->size & (ring->size - 1)) ||
+	    ring->data_offset + ring->size > (uint64_t)st.st_size) {
+		fprintf(stderr, "Malformed shared memory ring\n");
+		munmap(ring, st.st_size);
+		close(fds[1]);
+		return NULL;
+	}
+
+	*doorbell = fds[1];
+	*maplen = st.st_size;
+	return ring;
+}
+
+/*
+ * fpm_shm_serve
+ *
+ * Consume the ring until zebra closes the socket.
+ */
+static void fpm_shm_serve(void)
+{
+	struct fpm_shm_ring *ring;
+	fpm_msg_hdr_t *hdr;
+	uint8_t *data;
+	uint64_t head, tail, bell;
+	size_t maplen;
+	int doorbell;
+	struct pollfd pfd[2];
+
+	ring = fpm_shm_attach(&doorbell, &maplen);
+	if (!ring) {
+		close(glob->sock);
+		return;
 	}
+
+	send_fpm_generation();
+
+	data = fpm_shm_data(ring);
+	tail = ring->tail;
+
+	pfd[0].fd = doorbell;
+	pfd[0].events = POLLIN;
+	pfd[1].fd = glob->sock;
+	pfd[1].events = POLLIN;
+
+	while (1) {
+		head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+		if (head == tail) {
+			/*
+			 * Announce that we are going to sleep, then look
+			 * again: zebra checks the flag after moving the head.
+			 */
+			__atomic_store_n(&ring->waiting, 1, __ATOMIC_SEQ_CST);
+			head = __atomic_load_n(&ring->head, __ATOMIC_SEQ_CST);
+			if (head == tail) {
+				if (poll(pfd, 2, -1) < 0 && errno != EINTR)
+					break;
+				if (pfd[0].revents & POLLIN &&
+				    read(doorbell, &bell, sizeof(bell)) < 0)
+					break;
+				if (pfd[1].revents & (POLLIN | POLLHUP | POLLERR)) {
+					fprintf(glob->output_file,
+						"Socket closed, leaving the ring\n");
+					break;
+				}
+			}
+			__atomic_store_n(&ring->waiting, 0, __ATOMIC_RELAXED);
+			continue;
+		}
+
+		while (tail != head) {
+			hdr = (fpm_msg_hdr_t *)&data[tail & (ring->size - 1)];
+
+			if (hdr->msg_type != FPM_MSG_TYPE_NONE)
+				process_fpm_msg(hdr);
+
+			tail += fpm_msg_align(fpm_msg_len(hdr));
+
+			if (glob->delay_usec)
+				usleep(glob->delay_usec);
+		}
+
+		__atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+	}
+
+	munmap(ring, maplen);
+	close(doorbell);
+	close(glob->sock);
 }
 
 FRR_NORETURN
@@ -1236,7 +1509,7 @@ int main(int argc, char **argv)
 		exit(1);
 	}
 
-	while ((r = getopt(argc, argv, "rfdvo:z:")) != -1) {
+	while ((r = getopt(argc, argv, "rfdvbo:s:u:z:")) != -1) {
 		switch (r) {
 		case 'r':
 			glob->reflect = true;
@@ -1250,9 +1523,18 @@ int main(int argc, char **argv)
 		case 'v':
 			glob->dump_hex = true;
 			break;
+		case 'b':
+			glob->bench = true;
+			break;
 		case 'o':
 			output_file = optarg;
 			break;
+		case 's':
+			glob->delay_usec = strtoul(optarg, NULL, 10);
+			break;
+		case 'u':
+			glob->shm_path = optarg;
+			break;
 		case 'z':
 			glob->dump_file = optarg;
 			break;
@@ -1296,16 +1578,34 @@ int main(int argc, char **argv)
 		}
 	}
 
-	if (!create_listen_sock(FPM_DEFAULT_PORT, &glob->server_sock))
+	if (glob->shm_path) {
+		if (!create_listen_unix_sock(glob->shm_path, &glob->server_sock))
+			exit(1);
+	} else if (!create_listen_sock(FPM_DEFAULT_PORT, &glob->server_sock))
 		exit(1);
 
 	/*
 	 * Server forever.
 	 */
 	while (1) {
+		struct timespec start, end;
+		double secs;
+
 		glob->sock = accept_conn(glob->server_sock);
-		fpm_serve();
-		fprintf(glob->output_file, "Done serving client\n");
+		glob->msg_count = 0;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		if (glob->shm_path)
+			fpm_shm_serve();
+		else
+			fpm_serve();
+
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		secs = (end.tv_sec - start.tv_sec) +
+		       (end.tv_nsec - start.tv_nsec) / 1e9;
+		fprintf(glob->output_file,
+			"Done serving client: %" PRIu64 " messages in %.3fs (%.0f msgs/sec)\n",
+			glob->msg_count, secs, secs > 0 ? glob->msg_count / secs : 0);
 	}
 }
 #else
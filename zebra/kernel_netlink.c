@@ -72,6 +72,17 @@
  */
 #define NL_DEFAULT_BATCH_SEND_THRESHOLD (15 * NL_PKT_BUF_SIZE)
 
+/*
+ * Adaptive batching: the smallest send threshold it goes down to, which
+ * is about one route, and the number of batches whose ack latency is
+ * looked at each time the threshold is adjusted.
+ */
+#define NL_ADAPT_MIN_THRESHOLD 256
+#define NL_ADAPT_WINDOW 100
+
+/* Log2 histogram buckets, the last one catching everything above */
+#define NL_HIST_BUCKETS 24
+
 /*
  * RTNLGRP_BIT - Convert an RTNLGRP_* group constant to a bit position
  * for the nl_groups bitmask. RTNLGRP constants are 1-based bit numbers,
@@ -170,6 +181,7 @@ extern struct event_loop *master;
 extern struct zebra_privs_t zserv_privs;
 
 DEFINE_MTYPE_STATIC(ZEBRA, NL_BUF, "Zebra Netlink buffers");
+DEFINE_MTYPE_STATIC(ZEBRA, NL_SHARDS, "Zebra Netlink dplane shard sockets");
 
 /* Hashtable and mutex to allow lookup of nlsock structs by socket/fd value.
  * We have both the main and dplane pthreads using these structs, so we have
@@ -182,17 +194,56 @@ pthread_mutex_t nlsock_mutex;
 #define NLSOCK_LOCK() pthread_mutex_lock(&nlsock_mutex)
 #define NLSOCK_UNLOCK() pthread_mutex_unlock(&nlsock_mutex)
 
-size_t nl_batch_tx_bufsize;
-char *nl_batch_tx_buf;
+/* One transmit buffer per kernel provider shard */
+static size_t nl_batch_tx_bufsize[ZEBRA_DPLANE_KERNEL_THREADS_MAX];
+static char *nl_batch_tx_buf[ZEBRA_DPLANE_KERNEL_THREADS_MAX];
 
 _Atomic uint32_t nl_batch_bufsize = NL_DEFAULT_BATCH_BUFSIZE;
 _Atomic uint32_t nl_batch_send_threshold = NL_DEFAULT_BATCH_SEND_THRESHOLD;
 
+/* p99 ack latency to aim for in microseconds, 0 for static batching */
+static _Atomic uint32_t nl_batch_latency_target;
+
+/*
+ * Per shard state of the adaptive batching, only touched by the pthread
+ * running the shard.  The send threshold is halved when the p99 of the
+ * last window of batches is over target, and grown by a quarter when it
+ * is within target while batches keep filling up, i.e. while the queue
+ * is deeper than a batch.  A shallow queue is flushed as soon as it has
+ * been taken in, whatever the threshold.
+ */
+struct nl_batch_adapt {
+	size_t limit;
+
+	uint32_t samples[NL_ADAPT_WINDOW];
+	unsigned int nsamples;
+	unsigned int nfull;
+};
+
+static struct nl_batch_adapt nl_batch_adapt[ZEBRA_DPLANE_KERNEL_THREADS_MAX];
+
+/* Histograms of batch size in messages and ack latency in microseconds */
+struct nl_hist {
+	_Atomic uint64_t buckets[NL_HIST_BUCKETS];
+};
+
+static struct nl_hist nl_batch_size_hist;
+static struct nl_hist nl_batch_ack_hist;
+
 struct nl_batch {
 	void *buf;
 	size_t bufsiz;
 	size_t limit;
 
+	/* Kernel provider shard, selecting the socket and buffer */
+	unsigned int shard;
+
+	/* When the first message went in, and whether the batch is being
+	 * sent because it is full rather than because the work ran out.
+	 */
+	struct timeval start;
+	bool full;
+
 	void *buf_head;
 	size_t curlen;
 	size_t msgcnt;
@@ -214,12 +265,18 @@ int netlink_config_write_helper(struct vty *vty)
 		atomic_load_explicit(&nl_batch_bufsize, memory_order_relaxed);
 	uint32_t threshold = atomic_load_explicit(&nl_batch_send_threshold,
 						  memory_order_relaxed);
+	uint32_t target = atomic_load_explicit(&nl_batch_latency_target,
+					       memory_order_relaxed);
 
 	if (size != NL_DEFAULT_BATCH_BUFSIZE
 	    || threshold != NL_DEFAULT_BATCH_SEND_THRESHOLD)
 		vty_out(vty, "zebra kernel netlink batch-tx-buf %u %u\n", size,
 			threshold);
 
+	if (target)
+		vty_out(vty, "zebra kernel netlink batch-latency %u\n",
+			target / 1000);
+
 	if (if_netlink_frr_protodown_r_bit_is_set())
 		vty_out(vty, "zebra protodown reason-bit %u\n",
 			if_netlink_get_frr_protodown_r_bit());
@@ -239,6 +296,139 @@ void netlink_set_batch_buffer_size(uint32_t size, uint32_t threshold, bool set)
 			      memory_order_relaxed);
 }
 
+void netlink_set_batch_latency(uint32_t msec)
+{
+	atomic_store_explicit(&nl_batch_latency_target, msec * 1000,
+			      memory_order_relaxed);
+}
+
+static unsigned int nl_hist_bucket(uint64_t val)
+{
+	unsigned int bucket = 0;
+
+	while (val && bucket < NL_HIST_BUCKETS - 1) {
+		val >>= 1;
+		bucket++;
+	}
+
+	return bucket;
+}
+
+static void nl_hist_add(struct nl_hist *hist, uint64_t val)
+{
+	atomic_fetch_add_explicit(&hist->buckets[nl_hist_bucket(val)], 1,
+				  memory_order_relaxed);
+}
+
+static void nl_hist_show(struct vty *vty, const char *name,
+			 struct nl_hist *hist)
+{
+	uint64_t count;
+
+	vty_out(vty, "%s:\n", name);
+
+	for (unsigned int i = 0; i < NL_HIST_BUCKETS; i++) {
+		count = atomic_load_explicit(&hist->buckets[i],
+					     memory_order_relaxed);
+		if (!count)
+			continue;
+
+		if (i == 0)
+			vty_out(vty, "  %-20s %" PRIu64 "\n", "0", count);
+		else if (i == NL_HIST_BUCKETS - 1)
+			vty_out(vty, "  %-20s %" PRIu64 "\n",
+				"larger", count);
+		else {
+			char range[32];
+
+			snprintf(range, sizeof(range), "%" PRIu64 "-%" PRIu64,
+				 (uint64_t)1 << (i - 1),
+				 ((uint64_t)1 << i) - 1);
+			vty_out(vty, "  %-20s %" PRIu64 "\n", range, count);
+		}
+	}
+}
+
+void netlink_batch_show(struct vty *vty)
+{
+	uint32_t target = atomic_load_explicit(&nl_batch_latency_target,
+					       memory_order_relaxed);
+
+	if (target)
+		vty_out(vty, "Netlink batching:         adaptive, p99 ack latency target %u ms\n",
+			target / 1000);
+	else
+		vty_out(vty, "Netlink batching:         static\n");
+
+	nl_hist_show(vty, "Netlink batch size (messages)", &nl_batch_size_hist);
+	nl_hist_show(vty, "Netlink batch ack latency (usec)", &nl_batch_ack_hist);
+}
+
+static int nl_adapt_cmp(const void *a, const void *b)
+{
+	uint32_t va = *(const uint32_t *)a, vb = *(const uint32_t *)b;
+
+	return (va > vb) - (va < vb);
+}
+
+/*
+ * Account for a batch that took usec from taking in its first message to
+ * having all its acks, and move the send threshold of the shard when a
+ * window is complete.
+ */
+static void nl_batch_adapt_update(struct nl_batch *bth, uint32_t usec)
+{
+	struct nl_batch_adapt *adapt = &nl_batch_adapt[bth->shard];
+	uint32_t target = atomic_load_explicit(&nl_batch_latency_target,
+					       memory_order_relaxed);
+	size_t ceiling = atomic_load_explicit(&nl_batch_send_threshold,
+					      memory_order_relaxed);
+	uint32_t p99;
+
+	if (!target) {
+		adapt->limit = 0;
+		adapt->nsamples = 0;
+		adapt->nfull = 0;
+		return;
+	}
+
+	adapt->samples[adapt->nsamples++] = usec;
+	if (bth->full)
+		adapt->nfull++;
+
+	if (adapt->nsamples < NL_ADAPT_WINDOW)
+		return;
+
+	qsort(adapt->samples, adapt->nsamples, sizeof(adapt->samples[0]),
+	      nl_adapt_cmp);
+	p99 = adapt->samples[(adapt->nsamples * 99 + 99) / 100 - 1];
+
+	if (p99 > target)
+		adapt->limit = MAX(adapt->limit / 2, NL_ADAPT_MIN_THRESHOLD);
+	else if (adapt->nfull)
+		adapt->limit = MIN(adapt->limit + adapt->limit / 4, ceiling);
+
+	adapt->nsamples = 0;
+	adapt->nfull = 0;
+}
+
+/* Send threshold for the next batch of the shard */
+static size_t nl_batch_limit(unsigned int shard)
+{
+	struct nl_batch_adapt *adapt = &nl_batch_adapt[shard];
+	size_t ceiling = atomic_load_explicit(&nl_batch_send_threshold,
+					      memory_order_relaxed);
+
+	if (!atomic_load_explicit(&nl_batch_latency_target,
+				  memory_order_relaxed))
+		return ceiling;
+
+	if (!adapt->limit || adapt->limit > ceiling)
+		adapt->limit = ceiling;
+
+	return adapt->limit;
+}
+
 int netlink_talk_filter(struct nlmsghdr *h, ns_id_t ns_id, int startup, void *arg)
 {
 	/*
@@ -547,77 +737,84 @@ int kernel_dplane_read(struct zebra_dplane_info *info)
  * so that we only have to write one way to handle incoming
  * address add/delete and xxxNETCONF changes.
  */
-static void netlink_install_filter(int sock, uint32_t pid, uint32_t dplane_pid)
+static void netlink_install_filter(int sock, const uint32_t *pids,
+				   unsigned int npids)
 {
 	/*
 	 * BPF_JUMP instructions and where you jump to are based upon
 	 * 0 as being the next statement.  So count from 0.  Writing
 	 * this down because every time I look at this I have to
 	 * re-remember it.
+	 *
+	 * There is one pid comparison per socket, so the offsets are
+	 * relative to npids.
 	 */
-	struct sock_filter filter[] = {
-		/*
-		 * Logic:
-		 *   if (nlmsg_pid == pid ||
-		 *       nlmsg_pid == dplane_pid) {
-		 *       if (the incoming nlmsg_type ==
-		 *           RTM_NEWADDR || RTM_DELADDR || RTM_NEWNETCONF ||
-		 *           RTM_DELNETCONF)
-		 *           keep this message
-		 *       else
-		 *           skip this message
-		 *   } else
-		 *       keep this netlink message
-		 */
-		/*
-		 * 0: Load the nlmsg_pid into the BPF register
-		 */
-		BPF_STMT(BPF_LD | BPF_ABS | BPF_W,
-			 offsetof(struct nlmsghdr, nlmsg_pid)),
-		/*
-		 * 1: Compare to pid
-		 */
-		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htonl(pid), 1, 0),
-		/*
-		 * 2: Compare to dplane pid
-		 */
-		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htonl(dplane_pid), 0, 6),
-		/*
-		 * 3: Load the nlmsg_type into BPF register
-		 */
-		BPF_STMT(BPF_LD | BPF_ABS | BPF_H,
-			 offsetof(struct nlmsghdr, nlmsg_type)),
-		/*
-		 * 4: Compare to RTM_NEWADDR
-		 */
-		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htons(RTM_NEWADDR), 4, 0),
-		/*
-		 * 5: Compare to RTM_DELADDR
-		 */
-		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htons(RTM_DELADDR), 3, 0),
-		/*
-		 * 6: Compare to RTM_NEWNETCONF
-		 */
-		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htons(RTM_NEWNETCONF), 2,
-			 0),
-		/*
-		 * 7: Compare to RTM_DELNETCONF
-		 */
-		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htons(RTM_DELNETCONF), 1,
-			 0),
-		/*
-		 * 8: This is the end state of we want to skip the
-		 *    message
-		 */
-		BPF_STMT(BPF_RET | BPF_K, 0),
-		/* 9: This is the end state of we want to keep
-		 *     the message
-		 */
-		BPF_STMT(BPF_RET | BPF_K, 0xffff),
-	};
+	struct sock_filter filter[npids + 8];
+	unsigned int i, n = 0;
+
+	/*
+	 * Logic:
+	 *   if (nlmsg_pid == pids[0] || ... ||
+	 *       nlmsg_pid == pids[npids - 1]) {
+	 *       if (the incoming nlmsg_type ==
+	 *           RTM_NEWADDR || RTM_DELADDR || RTM_NEWNETCONF ||
+	 *           RTM_DELNETCONF)
+	 *           keep this message
+	 *       else
+	 *           skip this message
+	 *   } else
+	 *       keep this netlink message
+	 */
+	/*
+	 * 0: Load the nlmsg_pid into the BPF register
+	 */
+	filter[n++] = (struct sock_filter)BPF_STMT(
+		BPF_LD | BPF_ABS | BPF_W, offsetof(struct nlmsghdr, nlmsg_pid));
+	/*
+	 * 1 .. npids: Compare to each pid, on a match go on to the type
+	 * checks at npids + 1; if none match keep the message.
+	 */
+	for (i = 0; i < npids; i++)
+		filter[n++] = (struct sock_filter)BPF_JUMP(
+			BPF_JMP | BPF_JEQ | BPF_K, htonl(pids[i]),
+			npids - 1 - i, i == npids - 1 ? 6 : 0);
+	/*
+	 * npids + 1: Load the nlmsg_type into BPF register
+	 */
+	filter[n++] = (struct sock_filter)BPF_STMT(
+		BPF_LD | BPF_ABS | BPF_H, offsetof(struct nlmsghdr, nlmsg_type));
+	/*
+	 * npids + 2: Compare to RTM_NEWADDR
+	 */
+	filter[n++] = (struct sock_filter)BPF_JUMP(
+		BPF_JMP | BPF_JEQ | BPF_K, htons(RTM_NEWADDR), 4, 0);
+	/*
+	 * npids + 3: Compare to RTM_DELADDR
+	 */
+	filter[n++] = (struct sock_filter)BPF_JUMP(
+		BPF_JMP | BPF_JEQ | BPF_K, htons(RTM_DELADDR), 3, 0);
+	/*
+	 * npids + 4: Compare to RTM_NEWNETCONF
+	 */
+	filter[n++] = (struct sock_filter)BPF_JUMP(
+		BPF_JMP | BPF_JEQ | BPF_K, htons(RTM_NEWNETCONF), 2, 0);
+	/*
+	 * npids + 5: Compare to RTM_DELNETCONF
+	 */
+	filter[n++] = (struct sock_filter)BPF_JUMP(
+		BPF_JMP | BPF_JEQ | BPF_K, htons(RTM_DELNETCONF), 1, 0);
+	/*
+	 * npids + 6: This is the end state of we want to skip the
+	 *    message
+	 */
+	filter[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, 0);
+	/* npids + 7: This is the end state of we want to keep
+	 *     the message
+	 */
+	filter[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, 0xffff);
 
 	struct sock_fprog prog = {
-		.len = array_size(filter), .filter = filter,
+		.len = n, .filter = filter,
 	};
 
 	if (setsockopt(sock, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog))
@@ -785,6 +982,13 @@ static int netlink_recv_msg(struct nlsock *nl, struct msghdr *msg)
 
 		bytes = recv(nl->sock, NULL, 0, MSG_PEEK | MSG_TRUNC);
 
+		/*
+		 * Nothing queued: the common end of reading the responses to
+		 * a batch, so don't spend a second syscall to find out again.
+		 */
+		if (bytes == -1 && (errno == EWOULDBLOCK || errno == EAGAIN))
+			return 0;
+
 		if (bytes >= 0 && (size_t)bytes > nl->buflen) {
 			nl->buf = XREALLOC(MTYPE_NL_BUF, nl->buf, bytes);
 			nl->buflen = bytes;
@@ -1168,6 +1372,11 @@ static int nl_batch_read_resp(struct nl_batch *bth, struct nlsock *nl)
 	/*
 	 * The responses are not batched, so we need to read and process one
 	 * message at a time.
+	 *
+	 * Route and nexthop group messages are sent without NLM_F_ACK, so
+	 * the kernel only answers the ones that failed.  rtnetlink handles
+	 * the whole batch within sendmsg(), so once the socket has drained
+	 * every context that got no error succeeded.
 	 */
 	while (true) {
 		status = netlink_recv_msg(nl, &msg);
@@ -1305,12 +1514,14 @@ static void nl_batch_reset(struct nl_batch *bth)
 	bth->curlen = 0;
 	bth->msgcnt = 0;
 	bth->zns = NULL;
+	bth->full = false;
 
 	dplane_ctx_q_init(&(bth->ctx_list));
 }
 
 static void nl_batch_init(struct nl_batch *bth,
-			  struct dplane_ctx_list_head *ctx_out_q)
+			  struct dplane_ctx_list_head *ctx_out_q,
+			  unsigned int shard)
 {
 	/*
 	 * If the size of the buffer has changed, free and then allocate a new
@@ -1318,32 +1529,43 @@ static void nl_batch_init(struct nl_batch *bth,
 	 */
 	size_t bufsize =
 		atomic_load_explicit(&nl_batch_bufsize, memory_order_relaxed);
-	if (bufsize != nl_batch_tx_bufsize) {
-		if (nl_batch_tx_buf)
-			XFREE(MTYPE_NL_BUF, nl_batch_tx_buf);
+	if (bufsize != nl_batch_tx_bufsize[shard]) {
+		if (nl_batch_tx_buf[shard])
+			XFREE(MTYPE_NL_BUF, nl_batch_tx_buf[shard]);
 
-		nl_batch_tx_buf = XCALLOC(MTYPE_NL_BUF, bufsize);
-		nl_batch_tx_bufsize = bufsize;
+		nl_batch_tx_buf[shard] = XCALLOC(MTYPE_NL_BUF, bufsize);
+		nl_batch_tx_bufsize[shard] = bufsize;
 	}
 
-	bth->buf = nl_batch_tx_buf;
+	bth->shard = shard;
+	bth->buf = nl_batch_tx_buf[shard];
 	bth->bufsiz = bufsize;
-	bth->limit = atomic_load_explicit(&nl_batch_send_threshold,
-					  memory_order_relaxed);
+	bth->limit = nl_batch_limit(shard);
 
 	bth->ctx_out_q = ctx_out_q;
 
 	nl_batch_reset(bth);
 }
 
+/* The socket of the batch's shard standing in for the dplane socket nl */
+static struct nlsock *nl_batch_nlsock(const struct nl_batch *bth,
+				      struct nlsock *nl)
+{
+	if (bth->shard && nl && nl->shards)
+		return &nl->shards[bth->shard - 1];
+
+	return nl;
+}
+
 static void nl_batch_send(struct nl_batch *bth)
 {
 	struct zebra_dplane_ctx *ctx;
 	bool err = false;
+	uint32_t usec;
 
 	if (bth->curlen != 0 && bth->zns != NULL) {
-		struct nlsock *nl =
-			kernel_netlink_nlsock_lookup(bth->zns->sock);
+		struct nlsock *nl = nl_batch_nlsock(
+			bth, kernel_netlink_nlsock_lookup(bth->zns->sock));
 
 		if (IS_ZEBRA_DEBUG_KERNEL)
 			zlog_debug("%s: %s, batch size=%zu, msg cnt=%zu",
@@ -1357,6 +1579,12 @@ static void nl_batch_send(struct nl_batch *bth)
 			if (nl_batch_read_resp(bth, nl) == -1)
 				err = true;
 		}
+
+		usec = MIN(monotime_since(&bth->start, NULL), UINT32_MAX);
+		nl_hist_add(&nl_batch_size_hist, bth->msgcnt);
+		nl_hist_add(&nl_batch_ack_hist, usec);
+		nl_batch_adapt_update(bth, usec);
+		bth->limit = nl_batch_limit(bth->shard);
 	}
 
 	/* Move remaining contexts to the outbound queue. */
@@ -1383,7 +1611,8 @@ enum netlink_msg_status netlink_batch_add_msg(
 	int seq;
 	ssize_t size;
 	struct nlmsghdr *msgh;
-	struct nlsock *nl = kernel_netlink_nlsock_lookup(dplane_ctx_get_ns_sock(ctx));
+	struct nlsock *nl = nl_batch_nlsock(
+		bth, kernel_netlink_nlsock_lookup(dplane_ctx_get_ns_sock(ctx)));
 
 	if (!nl || nl->sock < 0 || !nl->buf)
 		return FRR_NETLINK_ERROR;
@@ -1402,6 +1631,7 @@ enum netlink_msg_status netlink_batch_add_msg(
 	 * and retry.
 	 */
 	if (size == 0) {
+		bth->full = true;
 		nl_batch_send(bth);
 		size = (*msg_encoder)(ctx, bth->buf_head,
 				      bth->bufsiz - bth->curlen);
@@ -1422,6 +1652,9 @@ enum netlink_msg_status netlink_batch_add_msg(
 	msgh->nlmsg_seq = seq;
 	msgh->nlmsg_pid = nl->snl.nl_pid;
 
+	if (bth->curlen == 0)
+		monotime(&bth->start);
+
 	bth->zns = dplane_ctx_get_ns(ctx);
 	bth->buf_head = ((char *)bth->buf_head) + size;
 	bth->curlen += size;
@@ -1535,15 +1768,18 @@ static enum netlink_msg_status nl_put_msg(struct nl_batch *bth,
 	return FRR_NETLINK_ERROR;
 }
 
-void kernel_update_multi(struct dplane_ctx_list_head *ctx_list)
+void kernel_update_multi_shard(struct dplane_ctx_list_head *ctx_list,
+			       unsigned int shard)
 {
 	struct nl_batch batch;
 	struct zebra_dplane_ctx *ctx;
 	struct dplane_ctx_list_head handled_list;
 	enum netlink_msg_status res;
 
+	assert(shard < kernel_update_shards());
+
 	dplane_ctx_q_init(&handled_list);
-	nl_batch_init(&batch, &handled_list);
+	nl_batch_init(&batch, &handled_list, shard);
 
 	while (true) {
 		ctx = dplane_ctx_dequeue(ctx_list);
@@ -1580,8 +1816,10 @@ void kernel_update_multi(struct dplane_ctx_list_head *ctx_list)
 			dplane_ctx_set_status(ctx,
 					      ZEBRA_DPLANE_REQUEST_FAILURE);
 
-		if (batch.curlen > batch.limit)
+		if (batch.curlen > batch.limit) {
+			batch.full = dplane_ctx_queue_count(ctx_list) > 0;
 			nl_batch_send(&batch);
+		}
 	}
 
 	nl_batch_send(&batch);
@@ -1590,6 +1828,17 @@ void kernel_update_multi(struct dplane_ctx_list_head *ctx_list)
 	dplane_ctx_list_append(ctx_list, &handled_list);
 }
 
+void kernel_update_multi(struct dplane_ctx_list_head *ctx_list)
+{
+	kernel_update_multi_shard(ctx_list, 0);
+}
+
+unsigned int kernel_update_shards(void)
+{
+	return MIN(MAX(zrouter.dplane_kernel_threads, 1U),
+		   ZEBRA_DPLANE_KERNEL_THREADS_MAX);
+}
+
 struct nlsock *kernel_netlink_nlsock_lookup(int sock)
 {
 	struct nlsock lookup, *retval;
@@ -1712,12 +1961,17 @@ static void netlink_enable_ext_ack(int sock, const char *desc)
  *   netlink_dplane_in  - Inbound link/addr/neigh/netconf/tc events (dplane pthread)
  *   ge_netlink_cmd     - Generic netlink commands (optional, non-fatal)
  *
+ * plus netlink_dplane_out.shards, one more outbound socket for each
+ * additional kernel provider pthread (--dplane-kernel-threads).
+ *
  * Also configures: multicast group subscriptions, extended ACK, non-blocking
  * mode, receive buffer sizes, BPF self-echo filters, and event loop registration.
  */
 void kernel_init(struct zebra_ns *zns)
 {
 	uint32_t groups, dplane_groups, ext_groups;
+	uint32_t pids[2 + ZEBRA_DPLANE_KERNEL_THREADS_MAX];
+	unsigned int i, nshards, npids = 0;
 #if defined SOL_NETLINK
 	int one, ret, grp;
 #endif
@@ -1764,6 +2018,21 @@ void kernel_init(struct zebra_ns *zns)
 			       zns->ns_id, NETLINK_ROUTE, false) < 0)
 		frr_exit_with_buffer_flush(-1);
 
+	/* Outbound sockets for the additional kernel provider pthreads */
+	nshards = kernel_update_shards() - 1;
+	if (nshards)
+		zns->netlink_dplane_out.shards =
+			XCALLOC(MTYPE_NL_SHARDS, nshards * sizeof(struct nlsock));
+
+	for (i = 0; i < nshards; i++) {
+		char name[32];
+
+		snprintf(name, sizeof(name), "netlink-dp-%u", i + 1);
+		if (kernel_init_nlsock(&zns->netlink_dplane_out.shards[i], name, 0, NULL, 0,
+				       zns->ns_id, NETLINK_ROUTE, false) < 0)
+			frr_exit_with_buffer_flush(-1);
+	}
+
 	/* Generic netlink — non-fatal on failure */
 	kernel_init_nlsock(&zns->ge_netlink_cmd, "generic-netlink-cmd", 0, NULL, 0, zns->ns_id,
 			   NETLINK_GENERIC, true);
@@ -1785,6 +2054,8 @@ void kernel_init(struct zebra_ns *zns)
 	/* Enable extended ACK on command and dplane output sockets */
 	netlink_enable_ext_ack(zns->netlink_cmd.sock, "cmd");
 	netlink_enable_ext_ack(zns->netlink_dplane_out.sock, "dp");
+	for (i = 0; i < nshards; i++)
+		netlink_enable_ext_ack(zns->netlink_dplane_out.shards[i].sock, "dp");
 
 	/* Enable extended ACK on generic netlink socket (uses flog_err
 	 * per original behavior — protocol-level failures are significant).
@@ -1809,6 +2080,10 @@ void kernel_init(struct zebra_ns *zns)
 		if (ret < 0)
 			zlog_notice(
 				"Registration for reduced ACK packet size failed, probably running an early kernel");
+
+		for (i = 0; i < nshards; i++)
+			setsockopt(zns->netlink_dplane_out.shards[i].sock, SOL_NETLINK,
+				   NETLINK_CAP_ACK, &one, sizeof(one));
 	}
 #endif /* SOL_NETLINK */
 
@@ -1820,6 +2095,8 @@ void kernel_init(struct zebra_ns *zns)
 	netlink_set_nonblock(&zns->netlink_cmd);
 	netlink_set_nonblock(&zns->netlink_dplane_out);
 	netlink_set_nonblock(&zns->netlink_dplane_in);
+	for (i = 0; i < nshards; i++)
+		netlink_set_nonblock(&zns->netlink_dplane_out.shards[i]);
 
 	if (zns->ge_netlink_cmd.sock >= 0)
 		netlink_set_nonblock(&zns->ge_netlink_cmd);
@@ -1834,6 +2111,8 @@ void kernel_init(struct zebra_ns *zns)
 		netlink_recvbuf(&zns->netlink_cmd, rcvbufsize);
 		netlink_recvbuf(&zns->netlink_dplane_out, rcvbufsize);
 		netlink_recvbuf(&zns->netlink_dplane_in, rcvbufsize);
+		for (i = 0; i < nshards; i++)
+			netlink_recvbuf(&zns->netlink_dplane_out.shards[i], rcvbufsize);
 
 		if (zns->ge_netlink_cmd.sock >= 0)
 			netlink_recvbuf(&zns->ge_netlink_cmd, rcvbufsize);
@@ -1846,11 +2125,13 @@ void kernel_init(struct zebra_ns *zns)
 	 * regardless of origin to keep state in sync).
 	 * ----------------------------------------------------------------
 	 */
-	netlink_install_filter(zns->netlink.sock, zns->netlink_cmd.snl.nl_pid,
-			       zns->netlink_dplane_out.snl.nl_pid);
-	netlink_install_filter(zns->netlink_dplane_in.sock,
-			       zns->netlink_cmd.snl.nl_pid,
-			       zns->netlink_dplane_out.snl.nl_pid);
+	pids[npids++] = zns->netlink_cmd.snl.nl_pid;
+	pids[npids++] = zns->netlink_dplane_out.snl.nl_pid;
+	for (i = 0; i < nshards; i++)
+		pids[npids++] = zns->netlink_dplane_out.shards[i].snl.nl_pid;
+
+	netlink_install_filter(zns->netlink.sock, pids, npids);
+	netlink_install_filter(zns->netlink_dplane_in.sock, pids, npids);
 
 	/* Register main netlink socket with the event loop */
 	zns->t_netlink = NULL;
@@ -1889,8 +2170,15 @@ void kernel_terminate(struct zebra_ns *zns, bool complete)
 	/* During zebra shutdown, we need to leave the dataplane socket
 	 * around until all work is done.
 	 */
-	if (complete)
+	if (complete) {
+		if (zns->netlink_dplane_out.shards) {
+			for (unsigned int i = 0; i < kernel_update_shards() - 1; i++)
+				kernel_nlsock_fini(&zns->netlink_dplane_out.shards[i]);
+			XFREE(MTYPE_NL_SHARDS, zns->netlink_dplane_out.shards);
+		}
+
 		kernel_nlsock_fini(&zns->netlink_dplane_out);
+	}
 }
 
 /*
@@ -1910,7 +2198,8 @@ void kernel_router_init(void)
  */
 void kernel_router_terminate(void)
 {
-	XFREE(MTYPE_NL_BUF, nl_batch_tx_buf);
+	for (unsigned int i = 0; i < ZEBRA_DPLANE_KERNEL_THREADS_MAX; i++)
+		XFREE(MTYPE_NL_BUF, nl_batch_tx_buf[i]);
 
 	pthread_mutex_destroy(&nlsock_mutex);
 
@@ -96,6 +96,15 @@ extern int netlink_config_write_helper(struct vty *vty);
 extern void netlink_set_batch_buffer_size(uint32_t size, uint32_t threshold,
 					  bool set);
 
+/*
+ * Size batches adaptively, aiming for a p99 ack latency of msec.  0 goes
+ * back to the static send threshold.
+ */
+extern void netlink_set_batch_latency(uint32_t msec);
+
+/* Show batching mode and the batch size and ack latency histograms */
+extern void netlink_batch_show(struct vty *vty);
+
 extern struct nlsock *kernel_netlink_nlsock_lookup(int sock);
 
 #ifdef __cplusplus
@@ -1725,4 +1725,16 @@ void kernel_update_multi(struct dplane_ctx_list_head *ctx_list)
 	dplane_ctx_list_append(ctx_list, &handled_list);
 }
 
+/* There is only the one routing socket */
+unsigned int kernel_update_shards(void)
+{
+	return 1;
+}
+
+void kernel_update_multi_shard(struct dplane_ctx_list_head *ctx_list,
+			       unsigned int shard)
+{
+	kernel_update_multi(ctx_list);
+}
+
 #endif /* !HAVE_NETLINK */
@@ -80,6 +80,7 @@ uint32_t rt_table_main_id = RT_TABLE_MAIN;
 #define OPTION_ASIC_OFFLOAD    2001
 #define OPTION_V6_WITH_V4_NEXTHOP 2002
 #define OPTION_NEXTHOP_WEIGHT_16_BIT 2003
+#define OPTION_DPLANE_KERNEL_THREADS 2004
 
 /* Command line options. */
 const struct option longopts[] = {
@@ -95,6 +96,7 @@ const struct option longopts[] = {
 	{ "vrfwnetns", no_argument, NULL, 'n' },
 	{ "nl-bufsize", required_argument, NULL, 's' },
 	{ "v6-rr-semantics", no_argument, NULL, OPTION_V6_RR_SEMANTICS },
+	{ "dplane-kernel-threads", required_argument, NULL, OPTION_DPLANE_KERNEL_THREADS },
 #endif /* HAVE_NETLINK */
 	{ "routing-table", optional_argument, NULL, 'R' },
 	{ 0 }
@@ -414,6 +416,7 @@ int main(int argc, char **argv)
 		    "  -s, --nl-bufsize            Set netlink receive buffer size\n"
 		    "  -n, --vrfwnetns             Use NetNS as VRF backend (deprecated, use -w)\n"
 		    "      --v6-rr-semantics       Use v6 RR semantics\n"
+		    "      --dplane-kernel-threads Program the kernel from this many pthreads\n"
 #else
 		    "  -s,                         Set kernel socket receive buffer size\n"
 #endif /* HAVE_NETLINK */
@@ -490,6 +493,19 @@ int main(int argc, char **argv)
 		case OPTION_V6_WITH_V4_NEXTHOP:
 			v6_with_v4_nexthop = true;
 			break;
+		case OPTION_DPLANE_KERNEL_THREADS: {
+			unsigned long threads = strtoul(optarg, NULL, 10);
+
+			if (threads == 0 ||
+			    threads > ZEBRA_DPLANE_KERNEL_THREADS_MAX) {
+				fprintf(stderr,
+					"Kernel dplane threads must be between 1 and %u\n",
+					ZEBRA_DPLANE_KERNEL_THREADS_MAX);
+				exit(1);
+			}
+			zrouter.dplane_kernel_threads = threads;
+			break;
+		}
 #endif /* HAVE_NETLINK */
 		case OPTION_NEXTHOP_WEIGHT_16_BIT:
 			nexthop_weight_16_bit = true;
@@ -240,6 +240,12 @@ typedef struct rib_dest_t_ {
 	 */
 	uint32_t flags;
 
+	/*
+	 * Generation of the last change to this prefix handed to the
+	 * dataplane, see dplane_ctx_get_route_gen().
+	 */
+	uint64_t dplane_gen;
+
 	/*
 	 * The list of nht prefixes that have ended up
 	 * depending on this route node.
@@ -104,6 +104,16 @@ extern int kernel_del_mac_nhg(uint32_t nhg_id);
  */
 extern void kernel_update_multi(struct dplane_ctx_list_head *ctx_list);
 
+/*
+ * The kernel provider can program the kernel from kernel_update_shards()
+ * pthreads at once, each calling kernel_update_multi_shard() with its own
+ * shard number and so its own kernel socket.  kernel_update_multi() is
+ * shard 0.
+ */
+extern unsigned int kernel_update_shards(void);
+extern void kernel_update_multi_shard(struct dplane_ctx_list_head *ctx_list,
+				      unsigned int shard);
+
 /*
  * Called by the dplane pthread to read incoming OS messages and dispatch them.
  */
@@ -2146,124 +2146,134 @@ static void zread_nhg_add(ZAPI_HANDLER_ARGS)
 		client->nhg_add_cnt++;
 }
 
-static void zread_route_add(ZAPI_HANDLER_ARGS)
+/*
+ * Checks on a decoded route add that don't need its nexthops
+ */
+static bool zapi_route_add_check(struct zserv *client, struct zebra_vrf *zvrf,
+				 const struct zapi_route *api)
 {
-	struct stream *s;
-	struct zapi_route api;
-	afi_t afi;
-	struct prefix_ipv6 *src_p = NULL;
-	struct route_entry *re;
-	struct nexthop_group *ng = NULL;
-	struct nhg_backup_info *bnhg = NULL;
-	int ret;
-	vrf_id_t vrf_id;
-	struct nhg_hash_entry nhe = { 0 }, *n = NULL;
-
-	s = msg;
-	if (zapi_route_decode(s, &api) < 0) {
-		if (IS_ZEBRA_DEBUG_RECV)
-			zlog_debug("%s: Unable to decode zapi_route sent",
-				   __func__);
-		return;
-	}
-
-	vrf_id = zvrf_id(zvrf);
-
-	if (IS_ZEBRA_DEBUG_RECV)
-		zlog_debug("%s: p=(%s:%u)%pFX, msg flags=0x%x, flags=0x%x",
-			   __func__, zvrf_name(zvrf), api.tableid, &api.prefix,
-			   (int)api.message, api.flags);
-
-	/* Allocate new route. */
-	re = zebra_rib_route_entry_new(
-		vrf_id, api.type, api.instance, api.flags, api.nhgid,
-		api.tableid ? api.tableid : zvrf->table_id, api.metric, api.mtu,
-		api.distance, api.tag);
-
-	if (!CHECK_FLAG(api.message, ZAPI_MESSAGE_NHG)
-	    && (!CHECK_FLAG(api.message, ZAPI_MESSAGE_NEXTHOP)
-		|| api.nexthop_num == 0)) {
+	if (!CHECK_FLAG(api->message, ZAPI_MESSAGE_NHG)
+	    && (!CHECK_FLAG(api->message, ZAPI_MESSAGE_NEXTHOP)
+		|| api->nexthop_num == 0)) {
 		flog_warn(EC_ZEBRA_RX_ROUTE_NO_NEXTHOPS,
 			  "%s: received a route without nexthops for prefix (%s:%u)%pFX from client %s",
-			  __func__, zvrf_name(zvrf), api.tableid, &api.prefix,
+			  __func__, zvrf_name(zvrf), api->tableid, &api->prefix,
 			  zebra_route_string(client->proto));
-
-		zebra_rib_route_entry_free(re);
-		return;
+		return false;
 	}
 
 	/* Report misuse of the backup flag */
-	if (CHECK_FLAG(api.message, ZAPI_MESSAGE_BACKUP_NEXTHOPS)
-	    && api.backup_nexthop_num == 0) {
+	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_BACKUP_NEXTHOPS)
+	    && api->backup_nexthop_num == 0) {
 		if (IS_ZEBRA_DEBUG_RECV || IS_ZEBRA_DEBUG_EVENT)
 			zlog_debug("%s: client %s: BACKUP flag set but no backup nexthops, prefix %pFX(%s:%u)",
-				   __func__, zebra_route_string(client->proto), &api.prefix,
-				   zvrf_name(zvrf), api.tableid);
-	}
-
-	if (!re->nhe_id
-	    && (!zapi_read_nexthops(client, &api.prefix, api.nexthops,
-				    api.flags, api.message, api.nexthop_num,
-				    api.backup_nexthop_num, &ng, NULL)
-		|| !zapi_read_nexthops(client, &api.prefix, api.backup_nexthops,
-				       api.flags, api.message,
-				       api.backup_nexthop_num,
-				       api.backup_nexthop_num, NULL, &bnhg))) {
-
-		nexthop_group_delete(&ng);
-		zebra_nhg_backup_free(&bnhg);
-		zebra_rib_route_entry_free(re);
-		return;
-	}
-
-	if (CHECK_FLAG(api.message, ZAPI_MESSAGE_OPAQUE)) {
-		re->opaque =
-			XMALLOC(MTYPE_RE_OPAQUE,
-				sizeof(struct re_opaque) + api.opaque.length);
-		re->opaque->length = api.opaque.length;
-		memcpy(re->opaque->data, api.opaque.data, re->opaque->length);
+				   __func__, zebra_route_string(client->proto), &api->prefix,
+				   zvrf_name(zvrf), api->tableid);
 	}
 
-	afi = family2afi(api.prefix.family);
-	if (afi != AFI_IP6 && CHECK_FLAG(api.message, ZAPI_MESSAGE_SRCPFX)) {
+	if (api->prefix.family != AF_INET6 &&
+	    CHECK_FLAG(api->message, ZAPI_MESSAGE_SRCPFX)) {
 		flog_warn(EC_ZEBRA_RX_SRCDEST_WRONG_AFI,
 			  "%s: Received SRC Prefix but afi is not v6",
 			  __func__);
-		nexthop_group_delete(&ng);
-		zebra_nhg_backup_free(&bnhg);
-		zebra_rib_route_entry_free(re);
-		return;
+		return false;
 	}
-	if (CHECK_FLAG(api.message, ZAPI_MESSAGE_SRCPFX))
-		src_p = &api.src_prefix;
 
-	if (api.safi != SAFI_UNICAST && api.safi != SAFI_MULTICAST) {
+	if (api->safi != SAFI_UNICAST && api->safi != SAFI_MULTICAST) {
 		flog_warn(EC_LIB_ZAPI_MISSMATCH,
 			  "%s: Received safi: %d but we can only accept UNICAST or MULTICAST",
-			  __func__, api.safi);
+			  __func__, api->safi);
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Build the nhe of a decoded route add in *pnhe, left NULL if the route
+ * uses a nexthop group id. Returns false if the nexthops are invalid.
+ */
+static bool zapi_route_add_nhe(struct zserv *client, struct zapi_route *api,
+			       struct nhg_hash_entry **pnhe)
+{
+	struct nexthop_group *ng = NULL;
+	struct nhg_backup_info *bnhg = NULL;
+	struct nhg_hash_entry nhe = { 0 };
+
+	*pnhe = NULL;
+	if (api->nhgid)
+		return true;
+
+	if (!zapi_read_nexthops(client, &api->prefix, api->nexthops,
+				api->flags, api->message, api->nexthop_num,
+				api->backup_nexthop_num, &ng, NULL)
+	    || !zapi_read_nexthops(client, &api->prefix, api->backup_nexthops,
+				   api->flags, api->message,
+				   api->backup_nexthop_num,
+				   api->backup_nexthop_num, NULL, &bnhg)) {
+
 		nexthop_group_delete(&ng);
 		zebra_nhg_backup_free(&bnhg);
-		zebra_rib_route_entry_free(re);
-		return;
+		return false;
 	}
 
+	/*
+	 * Include backup info with the route. We use a temporary nhe here;
+	 * if this is a new/unknown nhe, a new copy will be allocated
+	 * and stored.
+	 */
+	zebra_nhe_init(&nhe, family2afi(api->prefix.family), ng->nexthop);
+	nhe.nhg.nexthop = ng->nexthop;
+	nhe.backup_info = bnhg;
+	*pnhe = zebra_nhe_copy(&nhe, 0);
+
+	/* At this point, these allocations are not needed: the copy uses
+	 * its own.
+	 */
+	nexthop_group_delete(&ng);
+	if (bnhg)
+		zebra_nhg_backup_free(&bnhg);
+
+	return true;
+}
+
+/*
+ * Hand a decoded route add over to the rib, with its nhe n (NULL if it
+ * uses a nexthop group id), which is consumed.
+ */
+static void zapi_route_add_rib(struct zserv *client, struct zebra_vrf *zvrf,
+			       struct zapi_route *api, struct nhg_hash_entry *n)
+{
+	struct prefix_ipv6 *src_p = NULL;
+	struct route_entry *re;
+	int ret;
+
+	/* Allocate new route. */
+	re = zebra_rib_route_entry_new(
+		zvrf_id(zvrf), api->type, api->instance, api->flags, api->nhgid,
+		api->tableid ? api->tableid : zvrf->table_id, api->metric,
+		api->mtu, api->distance, api->tag);
+
+	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_OPAQUE)) {
+		re->opaque =
+			XMALLOC(MTYPE_RE_OPAQUE,
+				sizeof(struct re_opaque) + api->opaque.length);
+		re->opaque->length = api->opaque.length;
+		memcpy(re->opaque->data, api->opaque.data, re->opaque->length);
+	}
+
+	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_SRCPFX))
+		src_p = &api->src_prefix;
+
 	/*
 	 * If we have an ID, this proto owns the NHG it sent along with the
 	 * route, so we just send the ID into rib code with it.
 	 *
 	 * Haven't figured out how to handle backup NHs with this yet, so lets
 	 * keep that separate.
-	 * Include backup info with the route. We use a temporary nhe here;
-	 * if this is a new/unknown nhe, a new copy will be allocated
-	 * and stored.
 	 */
-	if (!re->nhe_id) {
-		zebra_nhe_init(&nhe, afi, ng->nexthop);
-		nhe.nhg.nexthop = ng->nexthop;
-		nhe.backup_info = bnhg;
-		n = zebra_nhe_copy(&nhe, 0);
-	}
-	ret = rib_add_multipath_nhe(afi, api.safi, &api.prefix, src_p, re, n, false, true);
+	ret = rib_add_multipath_nhe(family2afi(api->prefix.family), api->safi,
+				    &api->prefix, src_p, re, n, false, true);
 
 	/*
 	 * rib_add_multipath_nhe only fails in a couple spots
@@ -2272,18 +2282,12 @@ static void zread_route_add(ZAPI_HANDLER_ARGS)
 	if (ret == -1) {
 		client->error_cnt++;
 		zebra_rib_route_entry_free(re);
+		if (n)
+			zebra_nhg_free(n);
 	}
 
-	/* At this point, these allocations are not needed: 're' has been
-	 * retained or freed, and if 're' still exists, it is using
-	 * a reference to a shared group object.
-	 */
-	nexthop_group_delete(&ng);
-	if (bnhg)
-		zebra_nhg_backup_free(&bnhg);
-
 	/* Stats */
-	switch (api.prefix.family) {
+	switch (api->prefix.family) {
 	case AF_INET:
 		if (ret == 0)
 			client->v4_route_add_cnt++;
@@ -2299,6 +2303,162 @@ static void zread_route_add(ZAPI_HANDLER_ARGS)
 	}
 }
 
+static void zread_route_add(ZAPI_HANDLER_ARGS)
+{
+	struct stream *s;
+	struct zapi_route api;
+	struct nhg_hash_entry *n;
+
+	s = msg;
+	if (zapi_route_decode(s, &api) < 0) {
+		if (IS_ZEBRA_DEBUG_RECV)
+			zlog_debug("%s: Unable to decode zapi_route sent",
+				   __func__);
+		return;
+	}
+
+	if (IS_ZEBRA_DEBUG_RECV)
+		zlog_debug("%s: p=(%s:%u)%pFX, msg flags=0x%x, flags=0x%x",
+			   __func__, zvrf_name(zvrf), api.tableid, &api.prefix,
+			   (int)api.message, api.flags);
+
+	if (!zapi_route_add_check(client, zvrf, &api))
+		return;
+
+	if (!zapi_route_add_nhe(client, &api, &n))
+		return;
+
+	zapi_route_add_rib(client, zvrf, &api, n);
+}
+
+/*
+ * A nexthop set of a bulk route add, see ZEBRA_ROUTE_ADD_BULK: the fields
+ * of its routes that are not per prefix, and their nhe.
+ */
+struct zread_route_set {
+	uint8_t type;
+	unsigned short instance;
+	uint32_t flags;
+	uint32_t message;
+	safi_t safi;
+	uint8_t family;
+	uint32_t nhgid;
+	uint8_t distance;
+	uint32_t metric;
+	route_tag_t tag;
+	uint32_t mtu;
+	uint32_t tableid;
+	uint16_t nexthop_num;
+	uint16_t backup_nexthop_num;
+
+	/* false if the nexthops were rejected */
+	bool valid;
+	struct nhg_hash_entry *nhe;
+};
+
+static void zread_route_set_save(struct zread_route_set *set,
+				 const struct zapi_route *api)
+{
+	set->type = api->type;
+	set->instance = api->instance;
+	set->flags = api->flags;
+	set->message = api->message;
+	set->safi = api->safi;
+	set->family = api->prefix.family;
+	set->nhgid = api->nhgid;
+	set->distance = api->distance;
+	set->metric = api->metric;
+	set->tag = api->tag;
+	set->mtu = api->mtu;
+	set->tableid = api->tableid;
+	set->nexthop_num = api->nexthop_num;
+	set->backup_nexthop_num = api->backup_nexthop_num;
+}
+
+static void zread_route_set_load(const struct zread_route_set *set,
+				 struct zapi_route *api)
+{
+	zapi_route_init(api);
+
+	api->type = set->type;
+	api->instance = set->instance;
+	api->flags = set->flags;
+	api->message = set->message;
+	api->safi = set->safi;
+	api->prefix.family = set->family;
+	api->nhgid = set->nhgid;
+	api->distance = set->distance;
+	api->metric = set->metric;
+	api->tag = set->tag;
+	api->mtu = set->mtu;
+	api->tableid = set->tableid;
+	api->nexthop_num = set->nexthop_num;
+	api->backup_nexthop_num = set->backup_nexthop_num;
+}
+
+/*
+ * Bulk route add: the nexthops of each set are read and turned into an
+ * nhe once, each route only gets a copy of it.
+ */
+static void zread_route_add_bulk(ZAPI_HANDLER_ARGS)
+{
+	/* Both are too large for the stack, and only used here */
+	static struct zapi_route api;
+	static struct zread_route_set sets[ZAPI_ROUTE_BULK_SETS];
+	struct zread_route_set *set;
+	struct stream *s = msg;
+	uint16_t nsets = 0, idx;
+
+	while (STREAM_READABLE(s)) {
+		STREAM_GETW(s, idx);
+		if (idx > nsets || idx >= ZAPI_ROUTE_BULK_SETS) {
+			flog_warn(EC_LIB_ZAPI_MISSMATCH,
+				  "%s: invalid nexthop set %u from client %s",
+				  __func__, idx,
+				  zebra_route_string(client->proto));
+			break;
+		}
+
+		set = &sets[idx];
+		if (idx == nsets) {
+			nsets++;
+			set->nhe = NULL;
+			if (zapi_route_bulk_decode_set(s, &api) < 0)
+				goto stream_failure;
+			zread_route_set_save(set, &api);
+			set->valid = zapi_route_add_nhe(client, &api,
+							&set->nhe);
+		} else
+			zread_route_set_load(set, &api);
+
+		if (zapi_route_bulk_decode_route(s, &api) < 0)
+			goto stream_failure;
+
+		if (IS_ZEBRA_DEBUG_RECV)
+			zlog_debug("%s: p=(%s:%u)%pFX, msg flags=0x%x, flags=0x%x",
+				   __func__, zvrf_name(zvrf), api.tableid,
+				   &api.prefix, (int)api.message, api.flags);
+
+		if (!set->valid || !zapi_route_add_check(client, zvrf, &api))
+			continue;
+
+		zapi_route_add_rib(client, zvrf, &api,
+				   set->nhe ? zebra_nhe_copy(set->nhe, 0)
+					    : NULL);
+	}
+
+	goto done;
+
+stream_failure:
+	if (IS_ZEBRA_DEBUG_RECV)
+		zlog_debug("%s: Unable to decode bulk zapi_route sent",
+			   __func__);
+done:
+	for (idx = 0; idx < nsets; idx++)
+		if (sets[idx].nhe)
+			zebra_nhg_free(sets[idx].nhe);
+}
+
 void zapi_re_opaque_free(struct route_entry *re)
 {
 	XFREE(MTYPE_RE_OPAQUE, re->opaque);
@@ -4138,6 +4298,7 @@ void (*const zserv_handlers[])(ZAPI_HANDLER_ARGS) = {
 	[ZEBRA_INTERFACE_DELETE] = zread_interface_delete,
 	[ZEBRA_INTERFACE_SET_PROTODOWN] = zread_interface_set_protodown,
 	[ZEBRA_ROUTE_ADD] = zread_route_add,
+	[ZEBRA_ROUTE_ADD_BULK] = zread_route_add_bulk,
 	[ZEBRA_ROUTE_DELETE] = zread_route_del,
 	[ZEBRA_REDISTRIBUTE_ADD] = zebra_redistribute_add,
 	[ZEBRA_REDISTRIBUTE_DELETE] = zebra_redistribute_delete,
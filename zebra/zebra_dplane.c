@@ -16,6 +16,8 @@
 #include "lib/frratomic.h"
 #include "lib/frr_pthread.h"
 #include "lib/memory.h"
+#include "lib/jhash.h"
+#include "lib/frr_workers.h"
 #include "lib/zebra.h"
 #include "zebra/netconf_netlink.h"
 #include "zebra/zebra_router.h"
@@ -37,6 +39,8 @@ DEFINE_MTYPE_STATIC(ZEBRA, DP_INTF, "Zebra DPlane Intf");
 DEFINE_MTYPE_STATIC(ZEBRA, DP_PROV, "Zebra DPlane Provider");
 DEFINE_MTYPE_STATIC(ZEBRA, DP_NETFILTER, "Zebra Netfilter Internal Object");
 DEFINE_MTYPE_STATIC(ZEBRA, DP_NS, "DPlane NSes");
+DEFINE_MTYPE_STATIC(ZEBRA, DP_KERNEL_ORDER, "DPlane kernel update order");
+DEFINE_MTYPE_STATIC(ZEBRA, DP_COALESCE, "DPlane coalesced route");
 
 DEFINE_MTYPE(ZEBRA, VLAN_CHANGE_ARR, "Vlan Change Array");
 
@@ -138,6 +142,9 @@ struct dplane_route_info {
 	uint32_t zd_flags;
 	bool zd_replace;
 
+	/* Generation of the route change, 0 if not from the RIB */
+	uint64_t zd_gen;
+
 	/* Nexthop hash entry info */
 	struct dplane_nexthop_info nhe;
 
@@ -597,6 +604,51 @@ struct dplane_zns_info {
 	struct zns_info_list_item link;
 };
 
+/*
+ * Route updates held back for coalescing, one per route node. The
+ * dataplane still has whatever it had before the first update held.
+ */
+PREDECL_HASH(dplane_coalesce_hash);
+PREDECL_DLIST(dplane_coalesce_fifo);
+
+struct dplane_coalesce {
+	struct route_node *rn;
+
+	/* Op of the first update held: the dataplane has a route unless
+	 * it is an install.
+	 */
+	enum dplane_op_e first_op;
+
+	/* The route the dataplane has */
+	int old_type;
+	route_tag_t old_tag;
+	uint16_t old_instance;
+	uint8_t old_distance;
+	uint32_t old_metric;
+	uint32_t old_nhe_id;
+
+	/* Latest update, NULL if it cancelled out */
+	struct zebra_dplane_ctx *ctx;
+
+	struct dplane_coalesce_hash_item hitem;
+	struct dplane_coalesce_fifo_item fitem;
+};
+
+static int dplane_coalesce_cmp(const struct dplane_coalesce *a,
+			       const struct dplane_coalesce *b)
+{
+	return numcmp((uintptr_t)a->rn, (uintptr_t)b->rn);
+}
+
+static uint32_t dplane_coalesce_hashfn(const struct dplane_coalesce *c)
+{
+	return jhash(&c->rn, sizeof(c->rn), 0x5c0a1e5c);
+}
+
+DECLARE_HASH(dplane_coalesce_hash, struct dplane_coalesce, hitem,
+	     dplane_coalesce_cmp, dplane_coalesce_hashfn);
+DECLARE_DLIST(dplane_coalesce_fifo, struct dplane_coalesce, fitem);
+
 /*
  * Globals
  */
@@ -640,6 +692,27 @@ static struct zebra_dplane_globals {
 	uint32_t dg_updates_per_cycle;
 
 	_Atomic uint32_t dg_routes_in;
+
+	/* Last route generation handed out, main pthread only */
+	uint64_t dg_route_gen;
+
+	/* Route update coalescing window, 0 if disabled, and whether
+	 * updates are also released as soon as the incoming queue drains.
+	 * The held updates are only touched by the main pthread.
+	 */
+	uint32_t dg_coalesce_msec;
+	bool dg_coalesce_drain;
+	struct dplane_coalesce_hash_head dg_coalesce_hash;
+	struct dplane_coalesce_fifo_head dg_coalesce_fifo;
+	struct event *dg_t_coalesce;
+	struct event *dg_t_coalesce_drained;
+
+	/* Set by the main pthread while waiting for the incoming queue to
+	 * drain, cleared by the dplane pthread when it does.
+	 */
+	atomic_bool dg_coalesce_waiting;
+
+	_Atomic uint32_t dg_routes_coalesced;
 	_Atomic uint32_t dg_routes_queued;
 	_Atomic uint32_t dg_routes_queued_max;
 	_Atomic uint32_t dg_routes_kernel_skipped;
@@ -1965,6 +2038,13 @@ int dplane_ctx_get_old_type(const struct zebra_dplane_ctx *ctx)
 	return ctx->u.rinfo.zd_old_type;
 }
 
+uint64_t dplane_ctx_get_route_gen(const struct zebra_dplane_ctx *ctx)
+{
+	DPLANE_CTX_VALID(ctx);
+
+	return ctx->u.rinfo.zd_gen;
+}
+
 void dplane_ctx_set_afi(struct zebra_dplane_ctx *ctx, afi_t afi)
 {
 	DPLANE_CTX_VALID(ctx);
@@ -4824,6 +4904,200 @@ static int dplane_update_enqueue(struct zebra_dplane_ctx *ctx)
 	return ret;
 }
 
+static void kernel_dplane_handle_result(struct zebra_dplane_ctx *ctx);
+
+/*
+ * Number a route change as it is handed to the dataplane, the same number
+ * is kept on the dest. Held updates are only numbered when released, so
+ * the numbers reach the providers in increasing order.
+ */
+static void dplane_route_gen_set(struct zebra_dplane_ctx *ctx,
+				 struct route_node *rn)
+{
+	rib_dest_t *dest = rib_dest_from_rnode(rn);
+
+	ctx->u.rinfo.zd_gen = ++zdplane_info.dg_route_gen;
+	if (dest)
+		dest->dplane_gen = ctx->u.rinfo.zd_gen;
+}
+
+/*
+ * Hand a held route update that will not reach the dataplane back to
+ * zebra, as if it had been applied; a later update for the same node
+ * takes its place.
+ */
+static void dplane_coalesce_done(struct zebra_dplane_ctx *ctx,
+				 enum zebra_dplane_result status)
+{
+	struct dplane_ctx_list_head list;
+
+	dplane_ctx_set_status(ctx, status);
+	if (status == ZEBRA_DPLANE_REQUEST_SUCCESS) {
+		kernel_dplane_handle_result(ctx);
+		atomic_fetch_add_explicit(&zdplane_info.dg_routes_coalesced, 1,
+					  memory_order_relaxed);
+	}
+
+	dplane_ctx_q_init(&list);
+	dplane_ctx_list_add_tail(&list, ctx);
+	(zdplane_info.dg_results_cb)(&list);
+}
+
+/*
+ * Release every held route update to the dataplane, in the order their
+ * nodes were first held.
+ */
+static void dplane_coalesce_flush(struct event *event)
+{
+	struct dplane_coalesce *c;
+	struct zebra_dplane_ctx *ctx;
+	struct zebra_vrf *zvrf;
+
+	event_cancel(&zdplane_info.dg_t_coalesce);
+
+	while ((c = dplane_coalesce_fifo_pop(&zdplane_info.dg_coalesce_fifo))) {
+		dplane_coalesce_hash_del(&zdplane_info.dg_coalesce_hash, c);
+		ctx = c->ctx;
+
+		if (ctx)
+			dplane_route_gen_set(ctx, c->rn);
+
+		route_unlock_node(c->rn);
+		XFREE(MTYPE_DP_COALESCE, c);
+
+		if (ctx == NULL)
+			continue;
+
+		/* Take a new netlink sequence number, the ones handed out
+		 * while this update was held are already in flight.
+		 */
+		zvrf = vrf_info_lookup(ctx->zd_vrf_id);
+		if (zvrf)
+			dplane_ctx_ns_init(ctx, zvrf->zns,
+					   ctx->zd_op == DPLANE_OP_ROUTE_UPDATE);
+
+		if (dplane_update_enqueue(ctx) != AOK) {
+			atomic_fetch_add_explicit(&zdplane_info.dg_route_errors,
+						  1, memory_order_relaxed);
+			dplane_coalesce_done(ctx, ZEBRA_DPLANE_REQUEST_FAILURE);
+		}
+	}
+}
+
+/*
+ * Hold a route update back for coalescing with later updates of the same
+ * node. Returns true if the update was taken.
+ */
+static bool dplane_route_coalesce(struct route_node *rn,
+				  struct zebra_dplane_ctx *ctx)
+{
+	struct dplane_coalesce *c, lookup = { .rn = rn };
+	struct dplane_route_info *rinfo = &ctx->u.rinfo;
+	enum dplane_op_e op = ctx->zd_op;
+
+	if (zdplane_info.dg_coalesce_msec == 0 || zdplane_info.dg_is_shutdown)
+		return false;
+
+#ifndef HAVE_NETLINK
+	/* Per-nexthop deletes need the old nexthops of every update */
+	return false;
+#endif
+
+	if (op != DPLANE_OP_ROUTE_INSTALL && op != DPLANE_OP_ROUTE_UPDATE &&
+	    op != DPLANE_OP_ROUTE_DELETE)
+		return false;
+
+	c = dplane_coalesce_hash_find(&zdplane_info.dg_coalesce_hash, &lookup);
+	if (c == NULL) {
+		if (zdplane_info.dg_coalesce_drain) {
+			/* Nothing queued ahead to wait for */
+			atomic_store_explicit(&zdplane_info.dg_coalesce_waiting,
+					      true, memory_order_seq_cst);
+			if (dplane_get_in_queue_len() == 0)
+				return false;
+		}
+
+		c = XCALLOC(MTYPE_DP_COALESCE, sizeof(*c));
+		c->rn = route_lock_node(rn);
+		c->first_op = op;
+		if (op == DPLANE_OP_ROUTE_UPDATE) {
+			c->old_type = rinfo->zd_old_type;
+			c->old_tag = rinfo->zd_old_tag;
+			c->old_instance = rinfo->zd_old_instance;
+			c->old_distance = rinfo->zd_old_distance;
+			c->old_metric = rinfo->zd_old_metric;
+			c->old_nhe_id = rinfo->nhe.old_id;
+		} else {
+			c->old_type = rinfo->zd_type;
+			c->old_tag = rinfo->zd_tag;
+			c->old_instance = rinfo->zd_instance;
+			c->old_distance = rinfo->zd_distance;
+			c->old_metric = rinfo->zd_metric;
+			c->old_nhe_id = rinfo->nhe.id;
+		}
+		c->ctx = ctx;
+
+		dplane_coalesce_hash_add(&zdplane_info.dg_coalesce_hash, c);
+		dplane_coalesce_fifo_add_tail(&zdplane_info.dg_coalesce_fifo, c);
+
+		if (!event_is_scheduled(zdplane_info.dg_t_coalesce))
+			event_add_timer_msec(zrouter.master,
+					     dplane_coalesce_flush, NULL,
+					     zdplane_info.dg_coalesce_msec,
+					     &zdplane_info.dg_t_coalesce);
+		return true;
+	}
+
+	/* The new update supersedes the held one. Zebra is told the held
+	 * one was applied, so the new one was built against its result and
+	 * is only fixed up where the dataplane state differs.
+	 */
+	if (c->ctx)
+		dplane_coalesce_done(c->ctx, ZEBRA_DPLANE_REQUEST_SUCCESS);
+	c->ctx = ctx;
+
+	if (c->first_op == DPLANE_OP_ROUTE_INSTALL) {
+		/* Nothing to delete; an update just installs */
+		if (op == DPLANE_OP_ROUTE_DELETE) {
+			c->ctx = NULL;
+			dplane_coalesce_done(ctx, ZEBRA_DPLANE_REQUEST_SUCCESS);
+		}
+		return true;
+	}
+
+	/* The old route has to be replaced or deleted with the attributes
+	 * it was installed with: the kernel matches deletes on protocol.
+	 */
+	if (op == DPLANE_OP_ROUTE_INSTALL || rinfo->zd_old_type != c->old_type) {
+		if (op == DPLANE_OP_ROUTE_INSTALL) {
+			ctx->zd_op = DPLANE_OP_ROUTE_UPDATE;
+			ctx->zd_old_seq = 0;
+		}
+
+		rinfo->zd_old_type = c->old_type;
+		rinfo->zd_old_tag = c->old_tag;
+		rinfo->zd_old_instance = c->old_instance;
+		rinfo->zd_old_distance = c->old_distance;
+		rinfo->zd_old_metric = c->old_metric;
+		rinfo->nhe.old_id = c->old_nhe_id;
+	}
+
+	return true;
+}
+
+/*
+ * Configure route update coalescing, 0 msec disables it and releases
+ * whatever is held.
+ */
+void dplane_set_route_coalesce(uint32_t msec, bool drain)
+{
+	zdplane_info.dg_coalesce_msec = msec;
+	zdplane_info.dg_coalesce_drain = msec ? drain : false;
+
+	if (msec == 0)
+		dplane_coalesce_flush(NULL);
+}
+
 /*
  * Utility that prepares a route update and enqueues it for processing
  */
@@ -4879,8 +5153,11 @@ dplane_route_update_internal(struct route_node *rn,
 			}
 #endif	/* !HAVE_NETLINK */
 		}
-		/* Enqueue context for processing */
-		ret = dplane_update_enqueue(ctx);
+		/* Enqueue context for processing, unless it is held back */
+		if (!dplane_route_coalesce(rn, ctx)) {
+			dplane_route_gen_set(ctx, rn);
+			ret = dplane_update_enqueue(ctx);
+		}
 	}
 
 	/* Update counter */
@@ -6703,6 +6980,7 @@ enum zebra_dplane_result dplane_tc_qdisc_notify_enqueue(ns_id_t ns_id,
 int dplane_show_helper(struct vty *vty, bool detailed)
 {
 	uint64_t queued, queue_max, limit, errs, incoming, yields, other_errs, kernels_skipped;
+	uint64_t coalesced;
 
 	/* Using atomics because counters are being changed in different
 	 * pthread contexts.
@@ -6719,6 +6997,8 @@ int dplane_show_helper(struct vty *vty, bool detailed)
 				    memory_order_relaxed);
 	kernels_skipped = atomic_load_explicit(&zdplane_info.dg_routes_kernel_skipped,
 					       memory_order_relaxed);
+	coalesced = atomic_load_explicit(&zdplane_info.dg_routes_coalesced,
+					 memory_order_relaxed);
 	yields = atomic_load_explicit(&zdplane_info.dg_update_yields,
 				      memory_order_relaxed);
 	other_errs = atomic_load_explicit(&zdplane_info.dg_other_errors,
@@ -6740,6 +7020,7 @@ int dplane_show_helper(struct vty *vty, bool detailed)
 	vty_out(vty, "Route update queue depth: %"PRIu64"\n", queued);
 	vty_out(vty, "Route update queue max:   %"PRIu64"\n", queue_max);
 	vty_out(vty, "Route updates skipped:    %" PRIu64 "\n", kernels_skipped);
+	vty_out(vty, "Route updates coalesced:  %" PRIu64 "\n", coalesced);
 	vty_out(vty, "Dplane update yields:     %"PRIu64"\n", yields);
 
 	incoming = atomic_load_explicit(&zdplane_info.dg_lsps_in,
@@ -6900,6 +7181,11 @@ int dplane_config_write_helper(struct vty *vty)
 		vty_out(vty, "zebra dplane limit %u\n",
 			zdplane_info.dg_max_queued_updates);
 
+	if (zdplane_info.dg_coalesce_msec)
+		vty_out(vty, "zebra dplane route-coalesce %u%s\n",
+			zdplane_info.dg_coalesce_msec,
+			zdplane_info.dg_coalesce_drain ? " until-drained" : "");
+
 	return 0;
 }
 
@@ -7718,6 +8004,139 @@ static void kernel_dplane_process_if_speed(struct zebra_dplane_provider *prov,
 	dplane_provider_enqueue_out_ctx(prov, ctx);
 }
 
+/*
+ * With more than one kernel socket, runs of route updates are spread over
+ * the sockets by table and prefix and programmed from a set of pthreads.
+ * Updates to the same prefix always go through the same socket and so
+ * keep their order.  Anything else, notably nexthop group updates the
+ * routes may depend on, is a barrier and is done on its own on the first
+ * socket.  The results are handed on in the original order.
+ */
+static struct frr_workers kernel_dplane_workers =
+	FRR_WORKERS_INIT("Zebra dplane kernel thread", "zebra_dp_k");
+
+struct kernel_dplane_shard {
+	struct dplane_ctx_list_head ctx_list;
+	unsigned int shard;
+};
+
+/* Only used by the dplane pthread */
+static struct kernel_dplane_shard
+	kernel_dplane_shards[ZEBRA_DPLANE_KERNEL_THREADS_MAX];
+static struct zebra_dplane_ctx **kernel_dplane_order;
+static unsigned int kernel_dplane_order_size;
+
+static int kernel_dplane_start_func(struct zebra_dplane_provider *prov)
+{
+	unsigned int nshards = kernel_update_shards();
+
+	if (nshards <= 1)
+		return 0;
+
+	for (unsigned int i = 0; i < nshards; i++) {
+		dplane_ctx_list_init(&kernel_dplane_shards[i].ctx_list);
+		kernel_dplane_shards[i].shard = i;
+	}
+
+	frr_workers_start(&kernel_dplane_workers, nshards);
+
+	return 0;
+}
+
+static bool kernel_dplane_shardable(const struct zebra_dplane_ctx *ctx)
+{
+	switch (dplane_ctx_get_op(ctx)) {
+	case DPLANE_OP_ROUTE_INSTALL:
+	case DPLANE_OP_ROUTE_UPDATE:
+	case DPLANE_OP_ROUTE_DELETE:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static unsigned int kernel_dplane_shard_of(const struct zebra_dplane_ctx *ctx,
+					   unsigned int nshards)
+{
+	uint32_t key = jhash_1word(dplane_ctx_get_table(ctx),
+				   prefix_hash_key(dplane_ctx_get_dest(ctx)));
+
+	return key % nshards;
+}
+
+static void kernel_dplane_shard_work(void *item)
+{
+	struct kernel_dplane_shard *shard = item;
+
+	kernel_update_multi_shard(&shard->ctx_list, shard->shard);
+}
+
+static void kernel_dplane_update(struct dplane_ctx_list_head *work_list)
+{
+	struct dplane_ctx_list_head serial, done;
+	struct zebra_dplane_ctx *ctx;
+	unsigned int nshards = kernel_update_shards();
+	unsigned int count, i, n;
+
+	if (nshards <= 1) {
+		kernel_update_multi(work_list);
+		return;
+	}
+
+	count = dplane_ctx_list_count(work_list);
+	if (count > kernel_dplane_order_size) {
+		kernel_dplane_order = XREALLOC(MTYPE_DP_KERNEL_ORDER,
+					       kernel_dplane_order,
+					       count * sizeof(ctx));
+		kernel_dplane_order_size = count;
+	}
+
+	dplane_ctx_list_init(&done);
+
+	ctx = dplane_ctx_list_first(work_list);
+	while (ctx) {
+		/* Barrier: everything up to the next route update */
+		dplane_ctx_list_init(&serial);
+		while (ctx && !kernel_dplane_shardable(ctx)) {
+			dplane_ctx_list_del(work_list, ctx);
+			dplane_ctx_list_add_tail(&serial, ctx);
+			ctx = dplane_ctx_list_first(work_list);
+		}
+
+		if (dplane_ctx_list_count(&serial)) {
+			kernel_update_multi(&serial);
+			dplane_ctx_list_append(&done, &serial);
+		}
+
+		/* Route updates up to the next barrier */
+		n = 0;
+		while (ctx && kernel_dplane_shardable(ctx)) {
+			dplane_ctx_list_del(work_list, ctx);
+			kernel_dplane_order[n++] = ctx;
+			i = kernel_dplane_shard_of(ctx, nshards);
+			dplane_ctx_list_add_tail(&kernel_dplane_shards[i].ctx_list,
+						 ctx);
+			ctx = dplane_ctx_list_first(work_list);
+		}
+
+		if (n == 0)
+			continue;
+
+		frr_workers_run(&kernel_dplane_workers, nshards,
+				kernel_dplane_shards,
+				sizeof(kernel_dplane_shards[0]), nshards,
+				kernel_dplane_shard_work);
+
+		for (i = 0; i < nshards; i++)
+			while (dplane_ctx_list_pop(&kernel_dplane_shards[i].ctx_list))
+				;
+		for (i = 0; i < n; i++)
+			dplane_ctx_list_add_tail(&done, kernel_dplane_order[i]);
+	}
+
+	dplane_ctx_list_append(work_list, &done);
+}
+
 /*
  * Kernel provider callback
  */
@@ -7790,7 +8209,7 @@ static int kernel_dplane_process_func(struct zebra_dplane_provider *prov)
 			dplane_ctx_list_add_tail(&work_list, ctx);
 	}
 
-	kernel_update_multi(&work_list);
+	kernel_dplane_update(&work_list);
 
 	while ((ctx = dplane_ctx_list_pop(&work_list)) != NULL) {
 		kernel_dplane_handle_result(ctx);
@@ -7837,6 +8256,9 @@ static int kernel_dplane_shutdown_func(struct zebra_dplane_provider *prov,
 		ctx = dplane_provider_dequeue_out_ctx(prov);
 	}
 
+	XFREE(MTYPE_DP_KERNEL_ORDER, kernel_dplane_order);
+	kernel_dplane_order_size = 0;
+
 	return 1;
 }
 
@@ -7913,7 +8335,8 @@ static void dplane_provider_init(void)
 	int ret;
 
 	ret = dplane_provider_register("Kernel", DPLANE_PRIO_KERNEL,
-				       DPLANE_PROV_FLAGS_DEFAULT, NULL,
+				       DPLANE_PROV_FLAGS_DEFAULT,
+				       kernel_dplane_start_func,
 				       kernel_dplane_process_func,
 				       kernel_dplane_shutdown_func, NULL, NULL);
 
@@ -8001,6 +8424,10 @@ void zebra_dplane_pre_finish(void)
 	if (IS_ZEBRA_DEBUG_DPLANE)
 		zlog_debug("Zebra dataplane pre-finish called");
 
+	/* Nothing more is held back once shutdown starts */
+	dplane_coalesce_flush(NULL);
+	event_cancel(&zdplane_info.dg_t_coalesce_drained);
+
 	zdplane_info.dg_is_shutdown = true;
 
 	/* Notify provider(s) of pending shutdown. */
@@ -8207,6 +8634,13 @@ static void dplane_thread_loop(struct event *event)
 	atomic_fetch_sub_explicit(&zdplane_info.dg_routes_queued, counter,
 				  memory_order_relaxed);
 
+	/* Release held route updates once the incoming queue is drained */
+	if (dplane_get_in_queue_len() == 0 &&
+	    atomic_exchange_explicit(&zdplane_info.dg_coalesce_waiting, false,
+				     memory_order_seq_cst))
+		event_add_event(zrouter.master, dplane_coalesce_flush, NULL, 0,
+				&zdplane_info.dg_t_coalesce_drained);
+
 	if (IS_ZEBRA_DEBUG_DPLANE_DETAIL)
 		zlog_debug("dplane: incoming new work counter: %d", counter);
 
@@ -8491,6 +8925,9 @@ static void zebra_dplane_init_internal(void)
 
 	zns_info_list_init(&zdplane_info.dg_zns_list);
 
+	dplane_coalesce_hash_init(&zdplane_info.dg_coalesce_hash);
+	dplane_coalesce_fifo_init(&zdplane_info.dg_coalesce_fifo);
+
 	zdplane_info.dg_updates_per_cycle = DPLANE_DEFAULT_NEW_WORK;
 
 	zdplane_info.dg_max_queued_updates = DPLANE_DEFAULT_MAX_QUEUED;
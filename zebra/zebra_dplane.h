@@ -537,6 +537,13 @@ uint32_t dplane_ctx_get_notif_provider(const struct zebra_dplane_ctx *ctx);
 void dplane_ctx_set_type(struct zebra_dplane_ctx *ctx, int type);
 int dplane_ctx_get_type(const struct zebra_dplane_ctx *ctx);
 int dplane_ctx_get_old_type(const struct zebra_dplane_ctx *ctx);
+/*
+ * Route changes the RIB hands to the dataplane are numbered in order, and
+ * rib_dest_t.dplane_gen holds the number of the last one for the prefix.
+ * Dataplanes that keep state across reconnects can use it to replay only
+ * what changed since a given point.  0 for contexts not from the RIB.
+ */
+uint64_t dplane_ctx_get_route_gen(const struct zebra_dplane_ctx *ctx);
 void dplane_ctx_set_afi(struct zebra_dplane_ctx *ctx, afi_t afi);
 afi_t dplane_ctx_get_afi(const struct zebra_dplane_ctx *ctx);
 void dplane_ctx_set_safi(struct zebra_dplane_ctx *ctx, safi_t safi);
@@ -1239,6 +1246,12 @@ void dplane_set_in_queue_limit(uint32_t limit, bool set);
 /* Retrieve the current queue depth of incoming, unprocessed updates */
 uint32_t dplane_get_in_queue_len(void);
 
+/* Hold route updates for up to 'msec' before handing them to the dataplane,
+ * keeping only the latest one per route node. With 'drain', they are also
+ * released as soon as the incoming queue drains. 0 disables coalescing.
+ */
+void dplane_set_route_coalesce(uint32_t msec, bool drain);
+
 void dplane_ctx_set_vlan_ifindex(struct zebra_dplane_ctx *ctx,
 				 ifindex_t ifindex);
 ifindex_t dplane_ctx_get_vlan_ifindex(struct zebra_dplane_ctx *ctx);
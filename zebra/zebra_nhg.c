@@ -2344,14 +2344,33 @@ zebra_nhg_connected_ifindex(struct route_node *rn, struct route_entry *match,
 	return match;
 }
 
+/*
+ * Note a table node that a lookup off the main pthread went through.  If
+ * there are too many, leave the route entry to the main pthread.
+ */
+static bool nhg_resolve_visit(struct nhg_resolve *res,
+			      const struct route_node *rn)
+{
+	if (res->nnodes == NHG_RESOLVE_NODES) {
+		res->fallback = true;
+		return false;
+	}
+
+	res->nodes[res->nnodes++] = rn;
+	return true;
+}
+
 /*
  * Given a nexthop we need to properly recursively resolve,
  * do a table lookup to find and match if at all possible.
  * Set the nexthop->ifindex and resolution info as appropriate.
+ *
+ * With res set this runs off the main pthread: table nodes are neither
+ * locked nor unlocked, and the nodes looked at are recorded in res.
  */
 static int nexthop_active(struct nexthop *nexthop, struct nhg_hash_entry *nhe,
 			  const struct prefix *top, int type, uint32_t flags,
-			  uint32_t *pmtu, vrf_id_t vrf_id)
+			  uint32_t *pmtu, vrf_id_t vrf_id, struct nhg_resolve *res)
 {
 	struct prefix p;
 	struct route_table *table;
@@ -2529,9 +2548,15 @@ static int nexthop_active(struct nexthop *nexthop, struct nhg_hash_entry *nhe,
 		return 0;
 	}
 
-	rn = route_node_match(table, (struct prefix *)&p);
+	if (res)
+		rn = route_node_match_nolock(table, &p);
+	else
+		rn = route_node_match(table, (struct prefix *)&p);
 	while (rn) {
-		route_unlock_node(rn);
+		if (!res)
+			route_unlock_node(rn);
+		else if (!nhg_resolve_visit(res, rn))
+			return 0;
 
 		/*
 		 * Lookup should not care about the prefix being the same
@@ -2718,7 +2743,7 @@ done_with_match:
 		do {
 			rn = rn->parent;
 		} while (rn && rn->info == NULL);
-		if (rn)
+		if (rn && !res)
 			route_lock_node(rn);
 	}
 
@@ -2736,12 +2761,15 @@ done_with_match:
  * An existing route map can turn an otherwise active nexthop into inactive,
  * but not vice versa.
  *
+ * The recursive nexthop mtu is folded into *pmtu.
+ *
  * The return value is the final value of 'ACTIVE' flag.
  */
 static unsigned nexthop_active_check(struct route_node *rn,
 				     struct route_entry *re,
 				     struct nexthop *nexthop,
-				     struct nhg_hash_entry *nhe)
+				     struct nhg_hash_entry *nhe, uint32_t *pmtu,
+				     struct nhg_resolve *res)
 {
 	route_map_result_t ret = RMAP_PERMITMATCH;
 	afi_t family;
@@ -2782,7 +2810,7 @@ static unsigned nexthop_active_check(struct route_node *rn,
 	switch (nexthop->type) {
 	case NEXTHOP_TYPE_IFINDEX:
 		if (nexthop_active(nexthop, nhe, &rn->p, re->type, re->flags,
-				   &mtu, vrf_id))
+				   &mtu, vrf_id, res))
 			SET_FLAG(nexthop->flags, NEXTHOP_FLAG_ACTIVE);
 		else
 			UNSET_FLAG(nexthop->flags, NEXTHOP_FLAG_ACTIVE);
@@ -2791,7 +2819,7 @@ static unsigned nexthop_active_check(struct route_node *rn,
 	case NEXTHOP_TYPE_IPV4_IFINDEX:
 		family = AFI_IP;
 		if (nexthop_active(nexthop, nhe, &rn->p, re->type, re->flags,
-				   &mtu, vrf_id))
+				   &mtu, vrf_id, res))
 			SET_FLAG(nexthop->flags, NEXTHOP_FLAG_ACTIVE);
 		else
 			UNSET_FLAG(nexthop->flags, NEXTHOP_FLAG_ACTIVE);
@@ -2803,7 +2831,7 @@ static unsigned nexthop_active_check(struct route_node *rn,
 			family = AFI_IP6;
 
 		if (nexthop_active(nexthop, nhe, &rn->p, re->type, re->flags,
-				   &mtu, vrf_id))
+				   &mtu, vrf_id, res))
 			SET_FLAG(nexthop->flags, NEXTHOP_FLAG_ACTIVE);
 		else
 			UNSET_FLAG(nexthop->flags, NEXTHOP_FLAG_ACTIVE);
@@ -2832,8 +2860,8 @@ skip_check:
 	 * using it that way here.
 	 */
 	if (mtu > 0) {
-		if (re->nexthop_mtu == 0 || re->nexthop_mtu > mtu)
-			re->nexthop_mtu = mtu;
+		if (*pmtu == 0 || *pmtu > mtu)
+			*pmtu = mtu;
 	}
 
 	/* XXX: What exactly do those checks do? Do we support
@@ -2865,6 +2893,12 @@ skip_check:
 		return CHECK_FLAG(nexthop->flags, NEXTHOP_FLAG_ACTIVE);
 	}
 
+	/* Route-maps are for the main pthread only */
+	if (res && zebra_route_map_present(family, re, zvrf)) {
+		res->fallback = true;
+		return CHECK_FLAG(nexthop->flags, NEXTHOP_FLAG_ACTIVE);
+	}
+
 	/* It'll get set if required inside */
 	ret = zebra_route_map_check(family, re, p, nexthop, zvrf);
 	if (ret == RMAP_DENYMATCH) {
@@ -2962,11 +2996,14 @@ static bool nexthop_list_set_evpn_dvni(struct route_entry *re,
 /*
  * Process a list of nexthops, given an nhe, determining
  * whether each one is ACTIVE/installable at this time.
+ *
+ * With res set, the changes and mtu are recorded there instead of in re.
  */
 static uint32_t nexthop_list_active_update(struct route_node *rn,
 					   struct route_entry *re,
 					   struct nhg_hash_entry *nhe,
-					   bool is_backup)
+					   bool is_backup,
+					   struct nhg_resolve *res)
 {
 	union g_addr prev_src;
 	unsigned int prev_active, new_active;
@@ -2975,11 +3012,13 @@ static uint32_t nexthop_list_active_update(struct route_node *rn,
 	struct nexthop *nexthop;
 	struct nexthop_group *nhg = &nhe->nhg;
 	bool vni_removed = false;
+	bool changed = false;
+	uint32_t *pmtu = res ? &res->mtu : &re->nexthop_mtu;
 
 	nexthop = nhg->nexthop;
 
 	/* Init recursive nh mtu */
-	re->nexthop_mtu = 0;
+	*pmtu = 0;
 
 	/* Handler for dvni evpn nexthops. Has to be done at nhg level */
 	vni_removed = !nexthop_list_set_evpn_dvni(re, nhg);
@@ -2999,7 +3038,12 @@ static uint32_t nexthop_list_active_update(struct route_node *rn,
 		 */
 		new_active =
 			nexthop_active_check(rn, re, nexthop,
-					     (is_backup ? NULL : nhe));
+					     (is_backup ? NULL : nhe), pmtu,
+					     res);
+
+		/* Nothing more to do here, the main pthread takes over */
+		if (res && res->fallback)
+			break;
 
 		/*
 		 * We need to respect the multipath_num here
@@ -3032,6 +3076,13 @@ static uint32_t nexthop_list_active_update(struct route_node *rn,
 				      &nexthop->rmap_src.ipv6))) ||
 		    CHECK_FLAG(re->status, ROUTE_ENTRY_LABELS_CHANGED) ||
 		    vni_removed)
+			changed = true;
+	}
+
+	if (changed) {
+		if (res)
+			res->changed = true;
+		else
 			SET_FLAG(re->status, ROUTE_ENTRY_CHANGED);
 	}
 
@@ -3278,25 +3329,22 @@ static struct nhg_hash_entry *zebra_nhg_rib_compare_old_nhe(
 }
 
 /*
- * Iterate over all nexthops of the given RIB entry and refresh their
- * ACTIVE flag.  If any nexthop is found to toggle the ACTIVE flag,
- * the whole re structure is flagged with ROUTE_ENTRY_CHANGED.
- *
- * Return value is the new number of active nexthops.
+ * Resolve the nexthops of a local copy of re's nhe, which is returned.
+ * Unless res is set, re is flagged with ROUTE_ENTRY_CHANGED if any
+ * nexthop toggled its ACTIVE flag.
  */
-int nexthop_active_update(struct route_node *rn, struct route_entry *re,
-			  struct route_entry *old_re)
+static struct nhg_hash_entry *nexthop_active_update_copy(struct route_node *rn,
+							 struct route_entry *re,
+							 uint32_t *pactive,
+							 struct nhg_resolve *res)
 {
-	struct nhg_hash_entry *curr_nhe, *remove;
+	struct nhg_hash_entry *curr_nhe;
 	uint32_t curr_active = 0, backup_active = 0;
 
-	if (PROTO_OWNED(re->nhe) ||
-	    CHECK_FLAG(re->nhe->flags, NEXTHOP_GROUP_RECEIVED_FROM_EXTERNAL))
-		return proto_nhg_nexthop_active_update(&re->nhe->nhg);
-
-	afi_t rt_afi = family2afi(rn->p.family);
-
-	UNSET_FLAG(re->status, ROUTE_ENTRY_CHANGED);
+	if (res)
+		res->changed = false;
+	else
+		UNSET_FLAG(re->status, ROUTE_ENTRY_CHANGED);
 
 	/* Make a local copy of the existing nhe, so we don't work on/modify
 	 * the shared nhe.
@@ -3314,7 +3362,7 @@ int nexthop_active_update(struct route_node *rn, struct route_entry *re,
 	curr_nhe->id = 0;
 
 	/* Process nexthops */
-	curr_active = nexthop_list_active_update(rn, re, curr_nhe, false);
+	curr_active = nexthop_list_active_update(rn, re, curr_nhe, false, res);
 
 	if (IS_ZEBRA_DEBUG_NHG_DETAIL)
 		zlog_debug("%s: re %p curr_active %u", __func__, re,
@@ -3325,13 +3373,29 @@ int nexthop_active_update(struct route_node *rn, struct route_entry *re,
 		goto backups_done;
 
 	backup_active = nexthop_list_active_update(
-		rn, re, curr_nhe->backup_info->nhe, true /*is_backup*/);
+		rn, re, curr_nhe->backup_info->nhe, true /*is_backup*/, res);
 
 	if (IS_ZEBRA_DEBUG_NHG_DETAIL)
 		zlog_debug("%s: re %p backup_active %u", __func__, re,
 			   backup_active);
 
 backups_done:
+	*pactive = curr_active;
+	return curr_nhe;
+}
+
+/*
+ * Make re use an nhe matching the resolved copy curr_nhe, which is
+ * consumed.  Return value is curr_active.
+ */
+static int nexthop_active_update_apply(struct route_node *rn,
+				       struct route_entry *re,
+				       struct route_entry *old_re,
+				       struct nhg_hash_entry *curr_nhe,
+				       uint32_t curr_active)
+{
+	struct nhg_hash_entry *remove;
+	afi_t rt_afi = family2afi(rn->p.family);
 
 	/*
 	 * Ref or create an nhe that matches the current state of the
@@ -3382,6 +3446,81 @@ backups_done:
 	return curr_active;
 }
 
+/*
+ * Iterate over all nexthops of the given RIB entry and refresh their
+ * ACTIVE flag.  If any nexthop is found to toggle the ACTIVE flag,
+ * the whole re structure is flagged with ROUTE_ENTRY_CHANGED.
+ *
+ * Return value is the new number of active nexthops.
+ */
+int nexthop_active_update(struct route_node *rn, struct route_entry *re,
+			  struct route_entry *old_re)
+{
+	struct nhg_hash_entry *curr_nhe;
+	uint32_t curr_active;
+
+	if (PROTO_OWNED(re->nhe) ||
+	    CHECK_FLAG(re->nhe->flags, NEXTHOP_GROUP_RECEIVED_FROM_EXTERNAL))
+		return proto_nhg_nexthop_active_update(&re->nhe->nhg);
+
+	curr_nhe = nexthop_active_update_copy(rn, re, &curr_active, NULL);
+
+	return nexthop_active_update_apply(rn, re, old_re, curr_nhe,
+					   curr_active);
+}
+
+/*
+ * First half of nexthop_active_update(), safe to run on any pthread while
+ * the main pthread is blocked.  Returns false if the main pthread has to
+ * do all of it after all.
+ */
+bool nexthop_active_resolve(struct route_node *rn, struct route_entry *re,
+			    struct nhg_resolve *res)
+{
+	res->nhe = NULL;
+	res->fallback = false;
+	res->nnodes = 0;
+
+	/* Nothing to look up for these */
+	if (PROTO_OWNED(re->nhe) ||
+	    CHECK_FLAG(re->nhe->flags, NEXTHOP_GROUP_RECEIVED_FROM_EXTERNAL)) {
+		res->fallback = true;
+		return false;
+	}
+
+	res->nhe = nexthop_active_update_copy(rn, re, &res->active, res);
+
+	return !res->fallback;
+}
+
+/* Second half of nexthop_active_update(), on the main pthread */
+int nexthop_active_update_resolved(struct route_node *rn,
+				   struct route_entry *re,
+				   struct route_entry *old_re,
+				   struct nhg_resolve *res)
+{
+	struct nhg_hash_entry *curr_nhe = res->nhe;
+
+	res->nhe = NULL;
+
+	re->nexthop_mtu = res->mtu;
+	if (res->changed)
+		SET_FLAG(re->status, ROUTE_ENTRY_CHANGED);
+	else
+		UNSET_FLAG(re->status, ROUTE_ENTRY_CHANGED);
+
+	return nexthop_active_update_apply(rn, re, old_re, curr_nhe,
+					   res->active);
+}
+
+void nhg_resolve_discard(struct nhg_resolve *res)
+{
+	if (res->nhe) {
+		zebra_nhg_free(res->nhe);
+		res->nhe = NULL;
+	}
+}
+
 /* Recursively construct a grp array of fully resolved IDs.
  *
  * This function allows us to account for groups within groups,
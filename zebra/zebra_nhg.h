@@ -421,6 +421,40 @@ extern void nexthop_vrf_update(struct route_node *rn, struct route_entry *re, vr
 extern int nexthop_active_update(struct route_node *rn, struct route_entry *re,
 				 struct route_entry *old_re);
 
+/*
+ * nexthop_active_update() split in two, so that the table lookups can be
+ * done on another pthread while the main pthread is blocked.
+ * nexthop_active_resolve() works on a private copy of re's nhe and leaves
+ * the route entry and all shared state alone; the result is then applied
+ * on the main pthread by nexthop_active_update_resolved(), or dropped by
+ * nhg_resolve_discard() if the lookups have been invalidated since.
+ */
+#define NHG_RESOLVE_NODES 8
+
+struct nhg_resolve {
+	/* Resolved copy of re->nhe */
+	struct nhg_hash_entry *nhe;
+	uint32_t active;
+	uint32_t mtu;
+	bool changed;
+
+	/* Set if only the main pthread can resolve this route entry */
+	bool fallback;
+
+	/* Table nodes the lookups went through */
+	const struct route_node *nodes[NHG_RESOLVE_NODES];
+	unsigned int nnodes;
+};
+
+extern bool nexthop_active_resolve(struct route_node *rn,
+				   struct route_entry *re,
+				   struct nhg_resolve *res);
+extern int nexthop_active_update_resolved(struct route_node *rn,
+					  struct route_entry *re,
+					  struct route_entry *old_re,
+					  struct nhg_resolve *res);
+extern void nhg_resolve_discard(struct nhg_resolve *res);
+
 extern const char *zebra_nhg_afi2str(struct nhg_hash_entry *nhe);
 
 /* Format NHG flags into a comma-separated string for display */
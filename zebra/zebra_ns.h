@@ -33,6 +33,11 @@ struct nlsock {
 
 	uint8_t *buf;
 	size_t buflen;
+
+	/* For netlink_dplane_out only: the sockets used in its place by the
+	 * other kernel provider pthreads.
+	 */
+	struct nlsock *shards;
 };
 #endif
 
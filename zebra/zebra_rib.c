@@ -53,10 +53,12 @@
 #include "zebra/zebra_neigh.h"
 #include "zebra/zebra_script.h"
 #include "zebra/zebra_tc.h"
+#include "zebra/zebra_rib_resolve.h"
 
 DEFINE_MGROUP(ZEBRA, "zebra");
 
-DEFINE_MTYPE(ZEBRA, RE,       "Route Entry");
+DEFINE_MTYPE_SLAB(ZEBRA, RE, "Route Entry", sizeof(struct route_entry),
+		  MEMSLAB_MAGAZINE);
 DEFINE_MTYPE_STATIC(ZEBRA, RIB_DEST,       "RIB destination");
 DEFINE_MTYPE_STATIC(ZEBRA, RIB_UPDATE_CTX, "Rib update context object");
 DEFINE_MTYPE_STATIC(ZEBRA, WQ_WRAPPER, "WQ wrapper");
@@ -1286,8 +1288,11 @@ static struct route_entry *rib_choose_best(struct route_entry *current,
 	return current;
 }
 
-/* Core function for processing routing information base. */
-static void rib_process(struct route_node *rn)
+/* Core function for processing routing information base.
+ * job, if set, has the nexthops of the node's changed route entries
+ * resolved ahead by the rib pthreads.
+ */
+static void rib_process(struct route_node *rn, struct rib_resolve_job *job)
 {
 	struct route_entry *re;
 	struct route_entry *next;
@@ -1373,8 +1378,18 @@ static void rib_process(struct route_node *rn)
 		 * skip it.
 		 */
 		if (CHECK_FLAG(re->status, ROUTE_ENTRY_CHANGED)) {
+			struct nhg_resolve *res = zebra_rib_resolved(job, re);
+			int active;
+
 			proto_re_changed = re;
-			if (!nexthop_active_update(rn, re, old_fib)) {
+			if (res)
+				active = nexthop_active_update_resolved(rn, re,
+									old_fib,
+									res);
+			else
+				active = nexthop_active_update(rn, re, old_fib);
+
+			if (!active) {
 				struct rib_table_info *info;
 
 				if (re->type == ZEBRA_ROUTE_TABLE) {
@@ -2545,19 +2560,18 @@ static void process_subq_early_label(struct listnode *lnode)
 	XFREE(MTYPE_WQ_WRAPPER, w);
 }
 
-static void process_subq_route(struct listnode *lnode, uint8_t qindex)
+static void process_subq_route(struct route_node *rnode, uint8_t qindex,
+			       struct rib_resolve_job *job)
 {
-	struct route_node *rnode = NULL;
 	rib_dest_t *dest = NULL;
 	struct zebra_vrf *zvrf = NULL;
 
-	rnode = listgetdata(lnode);
 	dest = rib_dest_from_rnode(rnode);
 	assert(dest);
 
 	zvrf = rib_dest_vrf(dest);
 
-	rib_process(rnode);
+	rib_process(rnode, job);
 
 	if (IS_ZEBRA_DEBUG_RIB_DETAILED) {
 		struct route_entry *re = NULL;
@@ -3190,7 +3204,7 @@ static unsigned int process_subq(struct list *subq,
 	case META_QUEUE_NOTBGP:
 	case META_QUEUE_BGP:
 	case META_QUEUE_OTHER:
-		process_subq_route(lnode, qindex);
+		process_subq_route(listgetdata(lnode), qindex, NULL);
 		break;
 	case META_QUEUE_GR_RUN:
 		process_subq_gr_run(lnode);
@@ -3205,6 +3219,62 @@ static unsigned int process_subq(struct list *subq,
 	return 1;
 }
 
+/*
+ * Take up to RIB_RESOLVE_BATCH nodes off a route subqueue, have the rib
+ * pthreads resolve their nexthops and then process them in queue order on
+ * this pthread.  Return the number of nodes processed.
+ */
+static unsigned int process_subq_route_batch(struct list *subq,
+					     enum meta_queue_indexes qindex)
+{
+	static struct rib_resolve_job jobs[RIB_RESOLVE_BATCH];
+	struct listnode *lnode;
+	unsigned int count = 0;
+
+	while (count < RIB_RESOLVE_BATCH && (lnode = listhead(subq))) {
+		jobs[count].rn = listgetdata(lnode);
+		jobs[count].idx = count;
+		jobs[count].count = 0;
+		jobs[count].dep = UINT_MAX;
+		list_delete_node(subq, lnode);
+		count++;
+	}
+
+	/* Not worth waking anyone up for a single node */
+	if (count > 1)
+		zebra_rib_resolve_run(jobs, count);
+
+	for (unsigned int i = 0; i < count; i++) {
+		process_subq_route(jobs[i].rn, qindex, &jobs[i]);
+		zebra_rib_resolve_done(&jobs[i]);
+		frrtrace(1, frr_zebra, rib_process_subq_dequeue, qindex);
+	}
+
+	return count;
+}
+
+static bool meta_queue_is_route(enum meta_queue_indexes qindex)
+{
+	switch (qindex) {
+	case META_QUEUE_CONNECTED:
+	case META_QUEUE_KERNEL:
+	case META_QUEUE_STATIC:
+	case META_QUEUE_NOTBGP:
+	case META_QUEUE_BGP:
+	case META_QUEUE_OTHER:
+		return true;
+	case META_QUEUE_NHG:
+	case META_QUEUE_EVPN:
+	case META_QUEUE_EARLY_ROUTE:
+	case META_QUEUE_EARLY_LABEL:
+	case META_QUEUE_GR_RUN:
+	case META_QUEUE_FINISHED_STARTUP:
+		break;
+	}
+
+	return false;
+}
+
 /* Dispatch the meta queue by picking and processing the next node from
  * a non-empty sub-queue with lowest priority. wq is equal to zebra->ribq and
  * data is pointed to the meta queue structure.
@@ -3231,11 +3301,23 @@ static wq_item_status meta_queue_process(struct work_queue *dummy, void *data)
 		return WQ_QUEUE_BLOCKED;
 	}
 
-	for (i = 0; i < MQ_SIZE; i++)
+	for (i = 0; i < MQ_SIZE; i++) {
+		if (zrouter.rib_threads && meta_queue_is_route(i)) {
+			unsigned int count = process_subq_route_batch(mq->subq[i],
+								      i);
+
+			if (count) {
+				mq->size -= count;
+				break;
+			}
+			continue;
+		}
+
 		if (process_subq(mq->subq[i], i)) {
 			mq->size--;
 			break;
 		}
+	}
 	return mq->size ? WQ_REQUEUE : WQ_SUCCESS;
 }
 
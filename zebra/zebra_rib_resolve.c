@@ -0,0 +1,148 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/* Zebra nexthop resolution pthread pool.
+ * Resolves the nexthops of queued route nodes in parallel so that the
+ * main pthread only has to pick their nhe and select the best route.
+ *
+ * When the pool is enabled, meta_queue_process() takes a batch of nodes
+ * off a route subqueue and hands them out here in shards, one per pthread.
+ * Each pthread runs the lookup half of nexthop_active_update() for the
+ * changed route entries of its nodes, on a private copy of their nhe.
+ * Route entries that need a route-map are left to the main pthread.
+ *
+ * The main pthread then processes the batch in queue order: finding or
+ * creating the nhe, best route selection and the dataplane updates all
+ * stay single threaded, so the dataplane sees the same order as before.
+ * Since processing a node can change what a lookup of a later node would
+ * have found, the table nodes each lookup went through are recorded, and
+ * the result is dropped in favour of an inline lookup if any of them was
+ * processed earlier in the batch.  Lookups in different VRFs, or for
+ * nexthops resolving via routes that are not being changed themselves,
+ * are unaffected.
+ */
+
+#include <zebra.h>
+
+#include "frr_workers.h"
+
+#include "zebra/zebra_router.h"
+#include "zebra/zebra_rib_resolve.h"
+
+static struct frr_workers zebra_rib_workers =
+	FRR_WORKERS_INIT("Zebra RIB thread", "zebra_rib");
+
+/* The jobs of the running batch, sorted by route node; read-only while
+ * the pool is running.
+ */
+static struct rib_resolve_job *rib_resolve_index[RIB_RESOLVE_BATCH];
+static unsigned int rib_resolve_count;
+
+void zebra_rib_threads_set(unsigned int count)
+{
+	count = MIN(count, ZEBRA_RIB_THREADS_MAX);
+	zrouter.rib_threads = count;
+
+	frr_workers_start(&zebra_rib_workers, count);
+}
+
+static int rib_resolve_cmp(const void *a, const void *b)
+{
+	const struct rib_resolve_job *ja = *(struct rib_resolve_job *const *)a;
+	const struct rib_resolve_job *jb = *(struct rib_resolve_job *const *)b;
+
+	if ((uintptr_t)ja->rn < (uintptr_t)jb->rn)
+		return -1;
+	return (uintptr_t)ja->rn > (uintptr_t)jb->rn;
+}
+
+static struct rib_resolve_job *rib_resolve_lookup(const struct route_node *rn)
+{
+	unsigned int lo = 0, hi = rib_resolve_count;
+
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+		struct rib_resolve_job *job = rib_resolve_index[mid];
+
+		if (job->rn == rn)
+			return job;
+		if ((uintptr_t)job->rn < (uintptr_t)rn)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return NULL;
+}
+
+static void rib_resolve_work(void *item)
+{
+	struct rib_resolve_job *job = item;
+	struct route_entry *re;
+	struct nhg_resolve *res;
+	struct rib_resolve_job *other;
+
+	if (!rib_dest_from_rnode(job->rn))
+		return;
+
+	RNODE_FOREACH_RE (job->rn, re) {
+		if (job->count == RIB_RESOLVE_ENTRIES)
+			break;
+
+		/* Same selection as rib_process() */
+		if (CHECK_FLAG(re->status, ROUTE_ENTRY_REMOVED) ||
+		    !CHECK_FLAG(re->status, ROUTE_ENTRY_CHANGED))
+			continue;
+
+		res = &job->res[job->count];
+		job->re[job->count++] = re;
+
+		if (!nexthop_active_resolve(job->rn, re, res))
+			continue;
+
+		for (unsigned int i = 0; i < res->nnodes; i++) {
+			other = rib_resolve_lookup(res->nodes[i]);
+			if (other && other != job && other->idx < job->dep)
+				job->dep = other->idx;
+		}
+	}
+}
+
+void zebra_rib_resolve_run(struct rib_resolve_job *jobs, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++)
+		rib_resolve_index[i] = &jobs[i];
+	rib_resolve_count = count;
+
+	qsort(rib_resolve_index, count, sizeof(rib_resolve_index[0]),
+	      rib_resolve_cmp);
+
+	frr_workers_run(&zebra_rib_workers, zrouter.rib_threads, jobs,
+			sizeof(*jobs), count, rib_resolve_work);
+
+	rib_resolve_count = 0;
+}
+
+struct nhg_resolve *zebra_rib_resolved(struct rib_resolve_job *job,
+				       const struct route_entry *re)
+{
+	if (!job || job->dep < job->idx)
+		return NULL;
+
+	for (unsigned int i = 0; i < job->count; i++) {
+		if (job->re[i] != re)
+			continue;
+
+		if (job->res[i].fallback || !job->res[i].nhe)
+			return NULL;
+		return &job->res[i];
+	}
+
+	return NULL;
+}
+
+void zebra_rib_resolve_done(struct rib_resolve_job *job)
+{
+	for (unsigned int i = 0; i < job->count; i++)
+		nhg_resolve_discard(&job->res[i]);
+
+	job->count = 0;
+}
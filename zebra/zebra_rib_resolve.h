@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/* Zebra nexthop resolution pthread pool.
+ * Resolves the nexthops of queued route nodes in parallel so that the
+ * main pthread only has to pick their nhe and select the best route.
+ */
+
+#ifndef _ZEBRA_RIB_RESOLVE_H
+#define _ZEBRA_RIB_RESOLVE_H
+
+#include "table.h"
+
+#include "zebra/rib.h"
+#include "zebra/zebra_nhg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Upper bound for "zebra rib-threads" */
+#define ZEBRA_RIB_THREADS_MAX 64U
+
+/* Nodes taken off a meta queue subqueue at a time */
+#define RIB_RESOLVE_BATCH 256U
+
+/* Route entries of a node resolved ahead, any others are done inline */
+#define RIB_RESOLVE_ENTRIES 4U
+
+struct rib_resolve_job {
+	struct route_node *rn;
+
+	/* Position in the batch */
+	unsigned int idx;
+
+	struct route_entry *re[RIB_RESOLVE_ENTRIES];
+	struct nhg_resolve res[RIB_RESOLVE_ENTRIES];
+	unsigned int count;
+
+	/* Lowest position of any other node in the batch that the lookups
+	 * went through, UINT_MAX if none.
+	 */
+	unsigned int dep;
+};
+
+/*
+ * Set the number of rib pthreads.  Missing pthreads are started.
+ * 0 disables the pool and the meta queue is processed one node at a time
+ * on the main pthread only.
+ */
+extern void zebra_rib_threads_set(unsigned int count);
+
+/*
+ * Run nexthop_active_resolve() for the changed route entries of every
+ * job, split into contiguous shards over the pool, and wait for all of
+ * them.  jobs must be in batch order.
+ */
+extern void zebra_rib_resolve_run(struct rib_resolve_job *jobs,
+				  unsigned int count);
+
+/*
+ * The resolution for re to hand to nexthop_active_update_resolved(), or
+ * NULL if re has to be resolved inline.  Only valid while processing the
+ * job's node in batch order: the result is discarded if any node earlier
+ * in the batch was looked at, since processing it may have changed it.
+ */
+extern struct nhg_resolve *zebra_rib_resolved(struct rib_resolve_job *job,
+					      const struct route_entry *re);
+
+/* Drop whatever of the job was not used */
+extern void zebra_rib_resolve_done(struct rib_resolve_job *job);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ZEBRA_RIB_RESOLVE_H */
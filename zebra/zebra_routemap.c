@@ -1259,6 +1259,16 @@ route_map_result_t zebra_route_map_check(afi_t family, struct route_entry *re,
 	return (ret);
 }
 
+bool zebra_route_map_present(afi_t family, const struct route_entry *re,
+			     struct zebra_vrf *zvrf)
+{
+	if (re->type >= 0 && re->type < ZEBRA_ROUTE_MAX &&
+	    PROTO_RM_NAME(zvrf, family, re->type))
+		return true;
+
+	return PROTO_RM_NAME(zvrf, family, ZEBRA_ROUTE_ALL) != NULL;
+}
+
 char *zebra_get_import_table_route_map(afi_t afi, safi_t safi, uint32_t table)
 {
 	return zebra_import_table_routemap[afi][safi][table];
@@ -27,6 +27,9 @@ extern route_map_result_t zebra_route_map_check(afi_t family,
 						const struct prefix *p,
 						struct nexthop *nexthop,
 						struct zebra_vrf *zvrf);
+/* Whether zebra_route_map_check() would consult a route-map for re */
+extern bool zebra_route_map_present(afi_t family, const struct route_entry *re,
+				    struct zebra_vrf *zvrf);
 extern route_map_result_t zebra_nht_route_map_check(afi_t afi, int client_proto,
 						    const struct prefix *p,
 						    struct zebra_vrf *zvrf,
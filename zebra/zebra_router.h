@@ -195,6 +195,15 @@ struct zebra_router {
 #define ZEBRA_ZAPI_PACKETS_TO_PROCESS 1000
 	_Atomic uint32_t packets_to_process;
 
+	/* Nexthop resolution pthreads for the meta queue, 0 for none */
+	uint32_t rib_threads;
+
+	/* Kernel dplane provider pthreads, each with its own netlink socket;
+	 * set on startup only.  0 and 1 both mean just the dplane pthread.
+	 */
+#define ZEBRA_DPLANE_KERNEL_THREADS_MAX 16U
+	uint32_t dplane_kernel_threads;
+
 	/* Mlag information for the router */
 	struct zebra_mlag_info mlag_info;
 
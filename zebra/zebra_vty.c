@@ -54,6 +54,7 @@
 #include "zebra/rtadv.h"
 #include "zebra/zebra_neigh.h"
 #include "zebra/zebra_ptm.h"
+#include "zebra/zebra_rib_resolve.h"
 
 /* context to manage dumps in multiple tables or vrfs */
 struct route_show_ctx {
@@ -3830,6 +3831,19 @@ DEFPY (zebra_nexthop_group_keep,
 	return CMD_SUCCESS;
 }
 
+DEFPY (zebra_rib_threads,
+       zebra_rib_threads_cmd,
+       "[no] zebra rib-threads ![(1-64)$threads]",
+       NO_STR
+       ZEBRA_STR
+       "Resolve the nexthops of queued routes on a pool of pthreads\n"
+       "Number of rib pthreads\n")
+{
+	zebra_rib_threads_set(no ? 0 : threads);
+
+	return CMD_SUCCESS;
+}
+
 static int config_write_protocol(struct vty *vty)
 {
 	if (zrouter.allow_delete)
@@ -3838,6 +3852,9 @@ static int config_write_protocol(struct vty *vty)
 	if (zrouter.nhg_keep != ZEBRA_DEFAULT_NHG_KEEP_TIMER)
 		vty_out(vty, "zebra nexthop-group keep %u\n", zrouter.nhg_keep);
 
+	if (zrouter.rib_threads)
+		vty_out(vty, "zebra rib-threads %u\n", zrouter.rib_threads);
+
 	if (zrouter.ribq->spec.hold != ZEBRA_RIB_PROCESS_HOLD_TIME)
 		vty_out(vty, "zebra work-queue %u\n", zrouter.ribq->spec.hold);
 
@@ -4055,11 +4072,18 @@ DEFUN (show_dataplane,
 {
 	int idx = 0;
 	bool detailed = false;
+	int ret;
 
 	if (argv_find(argv, argc, "detailed", &idx))
 		detailed = true;
 
-	return dplane_show_helper(vty, detailed);
+	ret = dplane_show_helper(vty, detailed);
+
+#ifdef HAVE_NETLINK
+	netlink_batch_show(vty);
+#endif /* HAVE_NETLINK */
+
+	return ret;
 }
 
 /* Display dataplane providers info */
@@ -4228,6 +4252,36 @@ DEFUN_HIDDEN(no_zebra_kernel_netlink_batch_tx_buf,
 	return CMD_SUCCESS;
 }
 
+DEFPY (zebra_kernel_netlink_batch_latency,
+       zebra_kernel_netlink_batch_latency_cmd,
+       "[no] zebra kernel netlink batch-latency ![(1-10000)$msec]",
+       NO_STR
+       ZEBRA_STR
+       "Zebra kernel interface\n"
+       "Set Netlink parameters\n"
+       "Size batches adaptively to meet a p99 ack latency\n"
+       "Latency target in milliseconds\n")
+{
+	netlink_set_batch_latency(no ? 0 : msec);
+
+	return CMD_SUCCESS;
+}
+
+DEFPY (zebra_dplane_route_coalesce,
+       zebra_dplane_route_coalesce_cmd,
+       "[no] zebra dplane route-coalesce ![(1-1000)$msec [until-drained$drained]]",
+       NO_STR
+       ZEBRA_STR
+       "Zebra dataplane\n"
+       "Coalesce route updates before the dataplane\n"
+       "Time to hold updates in milliseconds\n"
+       "Release updates as soon as the dataplane queue drains\n")
+{
+	dplane_set_route_coalesce(no ? 0 : msec, !!drained);
+
+	return CMD_SUCCESS;
+}
+
 DEFPY (zebra_protodown_bit,
        zebra_protodown_bit_cmd,
        "zebra protodown reason-bit (0-31)$bit",
@@ -4314,6 +4368,7 @@ void zebra_vty_init(void)
 	install_node(&protocol_node);
 
 	install_element(CONFIG_NODE, &zebra_nexthop_group_keep_cmd);
+	install_element(CONFIG_NODE, &zebra_rib_threads_cmd);
 	install_element(CONFIG_NODE, &nexthop_group_use_enable_cmd);
 	install_element(CONFIG_NODE, &proto_nexthop_group_only_cmd);
 	install_element(CONFIG_NODE, &backup_nexthop_recursive_use_enable_cmd);
@@ -4391,6 +4446,8 @@ void zebra_vty_init(void)
 #ifdef HAVE_NETLINK
 	install_element(CONFIG_NODE, &zebra_kernel_netlink_batch_tx_buf_cmd);
 	install_element(CONFIG_NODE, &no_zebra_kernel_netlink_batch_tx_buf_cmd);
+	install_element(CONFIG_NODE, &zebra_kernel_netlink_batch_latency_cmd);
+	install_element(CONFIG_NODE, &zebra_dplane_route_coalesce_cmd);
 	install_element(CONFIG_NODE, &zebra_protodown_bit_cmd);
 	install_element(CONFIG_NODE, &no_zebra_protodown_bit_cmd);
 #endif /* HAVE_NETLINK */
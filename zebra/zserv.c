@@ -72,6 +72,7 @@ static struct zserv *find_client_internal(uint8_t proto,
 
 /* Mem type for zclients. */
 DEFINE_MTYPE_STATIC(ZEBRA, ZSERV_CLIENT, "ZClients");
+DEFINE_MTYPE_STATIC(ZEBRA, ZSERV_INBATCH, "ZClient input batch");
 
 /*
  * Client thread events.
@@ -96,6 +97,8 @@ enum zserv_client_event {
 enum zserv_event {
 	/* Schedule listen job on Zebra API socket */
 	ZSERV_ACCEPT,
+	/* Client pthreads have queued input batches */
+	ZSERV_PROCESS_INPUT,
 	/* The calling client has packets on its input buffer */
 	ZSERV_PROCESS_MESSAGES,
 	/* The calling client wishes to be killed */
@@ -137,6 +140,99 @@ static void zserv_client_event(struct zserv *client,
 static void zserv_event(struct zserv *client, enum zserv_event event);
 
 
+/* Client input handoff ----------------------------------------------------- */
+
+/*
+ * Messages read by the client pthreads are handed to the main pthread in
+ * batches, one per zserv_read() run, through a lock-free MPSC stack: the
+ * client pthreads push with a CAS, and the main pthread takes the whole
+ * stack with a single exchange and restores arrival order.  Since the
+ * main pthread never takes single items off the stack there is no ABA
+ * problem, and batches can be freed as soon as they have been taken.
+ *
+ * The main pthread is only woken up by the push that finds the stack
+ * empty, so a flood from several clients costs one event rather than one
+ * per read.
+ */
+struct zserv_inbatch {
+	struct zserv_inbatch *next;
+	struct zserv *client;
+	struct stream_fifo fifo;
+};
+
+static _Atomic(struct zserv_inbatch *) zserv_inq;
+static struct event *t_zserv_inq;
+
+static struct zserv_inbatch *zserv_inbatch_new(struct zserv *client)
+{
+	struct zserv_inbatch *batch;
+
+	batch = XCALLOC(MTYPE_ZSERV_INBATCH, sizeof(*batch));
+	batch->client = client;
+	stream_fifo_init(&batch->fifo);
+	return batch;
+}
+
+static void zserv_inbatch_free(struct zserv_inbatch *batch)
+{
+	stream_fifo_deinit(&batch->fifo);
+	XFREE(MTYPE_ZSERV_INBATCH, batch);
+}
+
+/* Client pthreads: hand a batch of messages to the main pthread */
+static void zserv_inq_push(struct zserv_inbatch *batch)
+{
+	struct zserv_inbatch *head;
+
+	head = atomic_load_explicit(&zserv_inq, memory_order_relaxed);
+	do {
+		batch->next = head;
+	} while (!atomic_compare_exchange_weak_explicit(&zserv_inq, &head,
+							batch,
+							memory_order_release,
+							memory_order_relaxed));
+
+	/* anything already on the stack has a wakeup pending */
+	if (!head)
+		zserv_event(NULL, ZSERV_PROCESS_INPUT);
+}
+
+/*
+ * Main pthread: move all queued batches onto their clients' input fifos,
+ * which only the main pthread touches, and schedule processing for them.
+ */
+static void zserv_inq_collect(void)
+{
+	struct zserv_inbatch *batch, *next, *ordered = NULL;
+	struct stream *msg;
+
+	batch = atomic_exchange_explicit(&zserv_inq, NULL,
+					 memory_order_acquire);
+
+	/* the stack is newest first */
+	for (; batch; batch = next) {
+		next = batch->next;
+		batch->next = ordered;
+		ordered = batch;
+	}
+
+	for (batch = ordered; batch; batch = next) {
+		next = batch->next;
+
+		while ((msg = stream_fifo_pop(&batch->fifo)))
+			stream_fifo_push(batch->client->ibuf_fifo, msg);
+
+		zserv_event(batch->client, ZSERV_PROCESS_MESSAGES);
+		zserv_inbatch_free(batch);
+	}
+}
+
+static void zserv_process_input(struct event *event)
+{
+	zserv_inq_collect();
+}
+
+
 /* Client thread lifecycle -------------------------------------------------- */
 
 /*
@@ -306,17 +402,16 @@ zwrite_fail:
  * ZAPI message (specifically at the header). The header is read and validated.
  * If the header passed validation then the length field found in the header is
  * used to compute the total length of the message. That much data is read (but
- * not inspected), appended to the header, placed into a stream and pushed onto
- * the client's input queue. A task is then scheduled on the main thread to
- * process the client's input queue. Finally, if all of this was successful,
- * this task reschedules itself.
+ * not inspected), appended to the header, placed into a stream and added to
+ * a batch. The batch is then handed to the main thread, see zserv_inq_push().
+ * Finally, if all of this was successful, this task reschedules itself.
  *
  * Any failure in any of these actions is handled by terminating the client.
  *
- * The client's input buffer ibuf_fifo can have a maximum items as configured
- * in the packets_to_process. This way we are not filling up the FIFO more
- * than the maximum when the zebra main is busy. If the fifo has space, we
- * reschedule ourselves to read more.
+ * The client can have a maximum of packets_to_process messages handed to the
+ * main thread but not processed yet (ibuf_pending). This way we are not
+ * filling up the input queue more than the maximum when the zebra main is
+ * busy. If there is space, we reschedule ourselves to read more.
  *
  * The main thread processes the items in ibuf_fifo and always signals the
  * client IO thread.
@@ -326,12 +421,13 @@ static void zserv_read(struct event *event)
 	struct zserv *client = EVENT_ARG(event);
 	int sock;
 	size_t already;
-	struct stream_fifo *cache;
+	struct zserv_inbatch *batch;
 	uint32_t p2p;	    /* Temp p2p used to process */
 	uint32_t p2p_orig;  /* Configured p2p (Default-1000) */
 	int p2p_avail;	    /* How much space is available for p2p */
 	struct zmsghdr hdr;
-	size_t client_ibuf_fifo_cnt = stream_fifo_count_safe(client->ibuf_fifo);
+	size_t client_ibuf_fifo_cnt =
+		atomic_load_explicit(&client->ibuf_pending, memory_order_relaxed);
 
 	p2p_orig = atomic_load_explicit(&zrouter.packets_to_process,
 					memory_order_relaxed);
@@ -345,7 +441,7 @@ static void zserv_read(struct event *event)
 		return;
 
 	p2p = p2p_avail;
-	cache = stream_fifo_new();
+	batch = zserv_inbatch_new(client);
 	sock = EVENT_FD(event);
 
 	while (p2p) {
@@ -442,7 +538,7 @@ static void zserv_read(struct event *event)
 		stream_set_getp(client->ibuf_work, 0);
 		struct stream *msg = stream_dup(client->ibuf_work);
 
-		stream_fifo_push(cache, msg);
+		stream_fifo_push(&batch->fifo, msg);
 		stream_reset(client->ibuf_work);
 		p2p--;
 	}
@@ -456,18 +552,15 @@ static void zserv_read(struct event *event)
 			client->last_read_cmd = hdr.command;
 		}
 
-		/* publish read packets on client's input queue */
-		frr_with_mutex (&client->ibuf_mtx) {
-			while (cache->head)
-				stream_fifo_push(client->ibuf_fifo,
-						 stream_fifo_pop(cache));
-			/* Need to update count as main event could have processed few */
-			client_ibuf_fifo_cnt =
-				stream_fifo_count_safe(client->ibuf_fifo);
-		}
+		/* Need to update count as main event could have processed few */
+		client_ibuf_fifo_cnt = (p2p_avail - p2p) +
+			atomic_fetch_add_explicit(&client->ibuf_pending,
+						  p2p_avail - p2p,
+						  memory_order_relaxed);
 
-		/* Schedule job to process those packets */
-		zserv_event(client, ZSERV_PROCESS_MESSAGES);
+		/* publish read packets to the main pthread */
+		zserv_inq_push(batch);
+		batch = NULL;
 	}
 
 	if (IS_ZEBRA_DEBUG_PACKET)
@@ -479,12 +572,13 @@ static void zserv_read(struct event *event)
 	if (client_ibuf_fifo_cnt < p2p_orig)
 		zserv_client_event(client, ZSERV_CLIENT_READ);
 
-	stream_fifo_free(cache);
+	if (batch)
+		zserv_inbatch_free(batch);
 
 	return;
 
 zread_fail:
-	stream_fifo_free(cache);
+	zserv_inbatch_free(batch);
 	zserv_client_fail(client);
 }
 
@@ -512,16 +606,16 @@ static void zserv_client_event(struct zserv *client,
 /*
  * Read and process messages from a client.
  *
- * This task runs on the main pthread. It is scheduled by client pthreads when
- * they have new messages available on their input queues. The client is passed
- * as the task argument.
+ * This task runs on the main pthread. It is scheduled by zserv_inq_collect()
+ * when client pthreads have handed over new messages, which are then on the
+ * client's input queue. The client is passed as the task argument.
  *
  * Each message is popped off the client's input queue and the action associated
  * with the message is executed. This proceeds until an error occurs, or the
  * processing limit is reached.
  *
- * The client's I/O thread can push at most zrouter.packets_to_process messages
- * onto the input buffer before notifying us there are packets to read. As long
+ * The client's I/O thread can hand over at most zrouter.packets_to_process
+ * messages before waiting for us to process them. As long
  * as we always process zrouter.packets_to_process messages here, then we can
  * rely on the read thread to handle queuing this task enough times to process
  * everything on the input queue.
@@ -538,6 +632,7 @@ static void zserv_process_messages(struct event *event)
 	struct stream *msg;
 	struct stream_fifo *cache = stream_fifo_new();
 	uint32_t p2p = zrouter.packets_to_process;
+	uint32_t i;
 	bool need_resched = false;
 	uint32_t meta_queue_size = zebra_rib_meta_queue_size();
 
@@ -546,20 +641,19 @@ static void zserv_process_messages(struct event *event)
 	else
 		p2p = 0;
 
-	frr_with_mutex (&client->ibuf_mtx) {
-		uint32_t i;
-		for (i = 0; i < p2p && stream_fifo_head(client->ibuf_fifo);
-		     ++i) {
-			msg = stream_fifo_pop(client->ibuf_fifo);
-			stream_fifo_push(cache, msg);
-		}
-
-		/* Need to reschedule processing work if there are still
-		 * packets in the fifo.
-		 */
-		if (stream_fifo_head(client->ibuf_fifo))
-			need_resched = true;
+	/* ibuf_fifo is only used by the main pthread */
+	for (i = 0; i < p2p && stream_fifo_head(client->ibuf_fifo); ++i) {
+		msg = stream_fifo_pop(client->ibuf_fifo);
+		stream_fifo_push(cache, msg);
 	}
+	atomic_fetch_sub_explicit(&client->ibuf_pending, i,
+				  memory_order_relaxed);
+
+	/* Need to reschedule processing work if there are still
+	 * packets in the fifo.
+	 */
+	if (stream_fifo_head(client->ibuf_fifo))
+		need_resched = true;
 
 	/* Process the batch of messages */
 	if (stream_fifo_head(cache))
@@ -690,7 +784,6 @@ static void zserv_client_free(struct zserv *client)
 	/* Free buffer mutexes */
 	pthread_mutex_destroy(&client->stats_mtx);
 	pthread_mutex_destroy(&client->obuf_mtx);
-	pthread_mutex_destroy(&client->ibuf_mtx);
 
 	/* Free bitmaps. */
 	for (afi_t afi = AFI_IP; afi < AFI_MAX; afi++) {
@@ -736,6 +829,9 @@ void zserv_close_client(struct zserv *client)
 		/* synchronously stop and join pthread */
 		frr_pthread_stop(client->pthread, NULL);
 
+		/* pick up what the pthread handed over before it stopped */
+		zserv_inq_collect();
+
 		if (IS_ZEBRA_DEBUG_EVENT)
 			zlog_debug("Closing client '%s'",
 				   zebra_route_string(client->proto));
@@ -813,7 +909,6 @@ static struct zserv *zserv_client_create(int sock)
 	client->ibuf_work = stream_new(stream_size);
 	client->obuf_work = stream_new(stream_size);
 	client->connect_time = monotime(NULL);
-	pthread_mutex_init(&client->ibuf_mtx, NULL);
 	pthread_mutex_init(&client->obuf_mtx, NULL);
 	pthread_mutex_init(&client->stats_mtx, NULL);
 	client->wb = buffer_new(0);
@@ -1057,6 +1152,10 @@ void zserv_event(struct zserv *client, enum zserv_event event)
 	case ZSERV_ACCEPT:
 		event_add_read(zrouter.master, zserv_accept, NULL, zsock, NULL);
 		break;
+	case ZSERV_PROCESS_INPUT:
+		event_add_event(zrouter.master, zserv_process_input, NULL, 0,
+				&t_zserv_inq);
+		break;
 	case ZSERV_PROCESS_MESSAGES:
 		event_add_event(zrouter.master, zserv_process_messages, client,
 				0, &client->t_process);
@@ -96,9 +96,12 @@ struct zserv {
 	/* For managing this node in the stale client list */
 	struct zserv_stale_client_list_item stale_client_list_entry;
 
-	/* Input/output buffer to the client. */
-	pthread_mutex_t ibuf_mtx;
+	/* Input/output buffer to the client.  The input buffer is only used
+	 * by the main pthread; the client pthread hands messages over through
+	 * a lock-free queue, and ibuf_pending counts those not processed yet.
+	 */
 	struct stream_fifo *ibuf_fifo;
+	atomic_size_t ibuf_pending;
 	pthread_mutex_t obuf_mtx;
 	struct stream_fifo *obuf_fifo;
 